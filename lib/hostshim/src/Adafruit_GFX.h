@@ -0,0 +1,57 @@
+#ifndef _hostAdafruitGFX_H
+#define _hostAdafruitGFX_H
+
+// host shim of Adafruit_GFX: lines, rectangles, triangles and circles are drawn into the frame
+// buffer of the display. Text is measured, not rendered: each glyph is drawn as a block of the
+// size of a lower case letter, so the layout of the text fields can be checked in the panel dump
+
+#include "Arduino.h"
+
+// font descriptor of the shim: metrics only, no bitmaps
+struct GFXfont
+{
+  uint8_t xAdvance;             // monospace fonts only
+  uint8_t yAdvance;             // line height
+  uint8_t ascent;               // capital letter above the base line
+};
+
+class Adafruit_GFX : public Print
+{
+  public:
+    Adafruit_GFX(int16_t w, int16_t h) : _width(w), _height(h) {}
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+    virtual void fillScreen(uint16_t color);
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+    void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+    void drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+    void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+    void setCursor(int16_t x, int16_t y) { cursorX = x; cursorY = y; }
+    void setTextColor(uint16_t c) { textColor = c; textBgColor = c; }
+    void setTextColor(uint16_t c, uint16_t bg) { textColor = c; textBgColor = bg; }
+    void setTextSize(uint8_t s) { textSize = (s > 0) ? s : 1; }
+    void setTextWrap(bool w) {}
+    void setFont(const GFXfont* f) { font = f; }
+    void setRotation(uint8_t r) { rotation = r & 3; }
+    uint8_t getRotation() { return(rotation); }
+    int16_t getCursorX() { return(cursorX); }
+    int16_t getCursorY() { return(cursorY); }
+    void getTextBounds(const char* s, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h);
+    int16_t width() { return(_width); }
+    int16_t height() { return(_height); }
+    size_t write(uint8_t c);
+    using Print::write;
+
+  protected:
+    int16_t _width, _height;
+    int16_t cursorX = 0, cursorY = 0;
+    uint16_t textColor = 0, textBgColor = 0xFFFF;
+    uint8_t textSize = 1, rotation = 0;
+    const GFXfont* font = NULL;
+};
+
+#endif // _hostAdafruitGFX_H
@@ -0,0 +1,157 @@
+#ifndef _hostArduino_H
+#define _hostArduino_H
+
+// host shim of the Arduino core for ESP32: the part used by the firmware, see hostShim.h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "hostShim.h"
+
+//************** module defines *************************/
+// RTC memory: own section, reset to the initial values by hostPowerOn() only
+#define RTC_DATA_ATTR         __attribute__((section("rtc_data")))
+#define RTC_NOINIT_ATTR       RTC_DATA_ATTR
+#define RTC_FAST_ATTR         RTC_DATA_ATTR
+#define IRAM_ATTR
+#define ARDUINO_ISR_ATTR
+#define PROGMEM
+
+#define HIGH                  1
+#define LOW                   0
+#define INPUT                 0x01
+#define OUTPUT                0x03
+#define PULLUP                0x04
+#define INPUT_PULLUP          0x05
+#define PULLDOWN              0x08
+#define INPUT_PULLDOWN        0x09
+#define RISING                0x01
+#define FALLING               0x02
+#define CHANGE                0x03
+#define DEC                   10
+#define HEX                   16
+#define PI                    3.1415926535897932384626433832795
+#define ADC_11db              3
+#define digitalPinToInterrupt(p) (p)
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// set by platformio.ini, defaults for a build by hand
+#ifndef PROGNAME
+  #define PROGNAME            "ePaperBarograf"
+#endif
+#ifndef VERSION
+  #define VERSION             "host"
+#endif
+#ifndef BUILD_DATE
+  #define BUILD_DATE          __DATE__
+#endif
+
+// the wall clock of the firmware is the RTC of the simulated chip
+#define gettimeofday(tv, tz)  hostGettimeofday(tv, tz)
+
+typedef enum {
+  GPIO_NUM_NC = -1,
+  GPIO_NUM_0 = 0, GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3, GPIO_NUM_4, GPIO_NUM_5, GPIO_NUM_6, GPIO_NUM_7,
+  GPIO_NUM_8, GPIO_NUM_9, GPIO_NUM_10, GPIO_NUM_11, GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_14, GPIO_NUM_15,
+  GPIO_NUM_16, GPIO_NUM_17, GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_20, GPIO_NUM_21, GPIO_NUM_22, GPIO_NUM_23,
+  GPIO_NUM_25 = 25, GPIO_NUM_26, GPIO_NUM_27, GPIO_NUM_28, GPIO_NUM_29, GPIO_NUM_30, GPIO_NUM_31,
+  GPIO_NUM_32, GPIO_NUM_33, GPIO_NUM_34, GPIO_NUM_35, GPIO_NUM_36, GPIO_NUM_37, GPIO_NUM_38, GPIO_NUM_39,
+  GPIO_NUM_40, GPIO_NUM_41, GPIO_NUM_42, GPIO_NUM_43, GPIO_NUM_44, GPIO_NUM_45, GPIO_NUM_46, GPIO_NUM_47,
+  GPIO_NUM_48, GPIO_NUM_MAX
+} gpio_num_t;
+
+typedef int esp_err_t;
+#define ESP_OK                0
+#define ESP_FAIL              -1
+#define ESP_ERR_INVALID_ARG   0x102
+#define ESP_ERR_INVALID_STATE 0x103
+
+//************** Print / Stream *************************/
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len);
+    size_t write(const char* s) { return(s == NULL ? 0 : write((const uint8_t*)s, strlen(s))); }
+    size_t print(const char* s) { return(write(s)); }
+    size_t print(char c) { return(write((uint8_t)c)); }
+    size_t print(int n, int base = DEC) { return(print((long)n, base)); }
+    size_t print(unsigned int n, int base = DEC) { return(print((unsigned long)n, base)); }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+    size_t println() { return(write("\r\n")); }
+    template<typename T> size_t println(T v) { size_t n = print(v); return(n + println()); }
+    template<typename T> size_t println(T v, int f) { size_t n = print(v, f); return(n + println()); }
+    size_t printf(const char* format, ...);
+    virtual void flush() {}
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available() { return(0); }
+    virtual int read() { return(-1); }
+    virtual int peek() { return(-1); }
+};
+
+// USB serial: output to stdout (hostSerialEcho), input from hostSerialInput()
+class HardwareSerial : public Stream
+{
+  public:
+    void begin(unsigned long baud) {}
+    void end() {}
+    operator bool() { return(true); }
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buf, size_t len);
+    using Print::write;
+    int available();
+    int read();
+    int peek();
+};
+extern HardwareSerial Serial;
+
+// heap and chip information, fixed values of a Lolin32 Lite
+class EspClass
+{
+  public:
+    uint32_t getHeapSize() { return(327680); }
+    uint32_t getFreeHeap() { return(262144); }
+    uint32_t getMaxAllocHeap() { return(110592); }
+    uint32_t getPsramSize() { return(0); }
+    uint32_t getFreePsram() { return(0); }
+    uint32_t getCycleCount();     // host time in cycles of getCpuFrequencyMhz()
+};
+extern EspClass ESP;
+
+//************** function prototypes *************************/
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+int hostGettimeofday(struct timeval* tv, void* tz);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+uint32_t analogReadMilliVolts(uint8_t pin);
+void analogSetPinAttenuation(uint8_t pin, int attenuation);
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+bool setCpuFrequencyMhz(uint32_t mhz);
+uint32_t getCpuFrequencyMhz();
+
+#endif // _hostArduino_H
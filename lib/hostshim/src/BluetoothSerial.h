@@ -0,0 +1,42 @@
+#ifndef _hostBluetoothSerial_H
+#define _hostBluetoothSerial_H
+
+// host shim of BluetoothSerial (SPP): a scripted client, see hostBtClient(). After begin() the
+// client connects (ESP_SPP_SRV_OPEN_EVT) and sends one line per second, split into two
+// packets (ESP_SPP_DATA_IND_EVT) as a real client may, then it stays silent. Output goes to stdout like Serial, prefixed with "BT> "
+
+#include "Arduino.h"
+
+#define CONFIG_BT_ENABLED         1
+#define CONFIG_BLUEDROID_ENABLED  1
+
+typedef enum {
+  ESP_SPP_INIT_EVT = 0, ESP_SPP_UNINIT_EVT = 1, ESP_SPP_DISCOVERY_COMP_EVT = 8, ESP_SPP_OPEN_EVT = 26,
+  ESP_SPP_CLOSE_EVT = 27, ESP_SPP_START_EVT = 28, ESP_SPP_CL_INIT_EVT = 29, ESP_SPP_DATA_IND_EVT = 30,
+  ESP_SPP_CONG_EVT = 31, ESP_SPP_WRITE_EVT = 33, ESP_SPP_SRV_OPEN_EVT = 34, ESP_SPP_SRV_STOP_EVT = 35
+} esp_spp_cb_event_t;
+typedef union {
+  struct { uint32_t handle; uint16_t len; uint8_t* data; } data_ind;
+} esp_spp_cb_param_t;
+typedef void (*esp_spp_cb_t)(esp_spp_cb_event_t event, esp_spp_cb_param_t* param);
+
+class BluetoothSerial : public Stream
+{
+  public:
+    bool begin(const char* name, bool isMaster = false);
+    void end();
+    bool disconnect();
+    bool hasClient();
+    bool connected(int timeout = 0) { return(hasClient()); }
+    esp_err_t register_callback(esp_spp_cb_t cb) { callback = cb; return(ESP_OK); }
+    size_t write(uint8_t c);
+    using Print::write;
+    int available();
+    int read();
+    int peek();
+
+  private:
+    esp_spp_cb_t callback = NULL;
+};
+
+#endif // _hostBluetoothSerial_H
@@ -0,0 +1,26 @@
+#ifndef _hostDallasTemperature_H
+#define _hostDallasTemperature_H
+
+// host shim of DallasTemperature: no DS18B20 is found
+
+#include "OneWire.h"
+
+#define DEVICE_DISCONNECTED_C   -127
+#define DEVICE_DISCONNECTED_RAW -7040
+typedef uint8_t DeviceAddress[8];
+
+class DallasTemperature
+{
+  public:
+    DallasTemperature(OneWire* bus) {}
+    void begin() {}
+    uint8_t getDeviceCount() { return(0); }
+    bool getAddress(uint8_t* address, uint8_t index) { return(false); }
+    bool setResolution(const uint8_t* address, uint8_t bits, bool skipGlobal = false) { return(false); }
+    void setWaitForConversion(bool wait) {}
+    void requestTemperatures() {}
+    bool isConversionComplete() { return(true); }
+    int32_t getTemp(const uint8_t* address) { return(DEVICE_DISCONNECTED_RAW); }
+};
+
+#endif // _hostDallasTemperature_H
@@ -0,0 +1,4 @@
+// host shim of the Adafruit GFX font FreeMono24pt7b: metrics only (xAdvance, yAdvance, ascent)
+#include <Adafruit_GFX.h>
+
+const GFXfont FreeMono24pt7b = { 28, 47, 26 };
@@ -0,0 +1,4 @@
+// host shim of the Adafruit GFX font FreeMonoBold12pt7b: metrics only (xAdvance, yAdvance, ascent)
+#include <Adafruit_GFX.h>
+
+const GFXfont FreeMonoBold12pt7b = { 14, 24, 13 };
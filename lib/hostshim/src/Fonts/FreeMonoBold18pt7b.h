@@ -0,0 +1,4 @@
+// host shim of the Adafruit GFX font FreeMonoBold18pt7b: metrics only (xAdvance, yAdvance, ascent)
+#include <Adafruit_GFX.h>
+
+const GFXfont FreeMonoBold18pt7b = { 21, 35, 19 };
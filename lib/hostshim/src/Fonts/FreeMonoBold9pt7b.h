@@ -0,0 +1,4 @@
+// host shim of the Adafruit GFX font FreeMonoBold9pt7b: metrics only (xAdvance, yAdvance, ascent)
+#include <Adafruit_GFX.h>
+
+const GFXfont FreeMonoBold9pt7b = { 11, 18, 10 };
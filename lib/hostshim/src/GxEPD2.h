@@ -0,0 +1,65 @@
+#ifndef _hostGxEPD2_H
+#define _hostGxEPD2_H
+
+// host shim of GxEPD2: the panel drivers of the barograph (4.2", 400 x 300) and the paged
+// drawing of GxEPD2_BW with a full frame buffer. A refresh copies the window from the frame
+// buffer to the panel image (hostPanelImage()) and takes HOST_EPD_FULL_US / HOST_EPD_PARTIAL_US
+// of virtual time, like waiting for the busy line
+
+#include "Adafruit_GFX.h"
+
+#define GxEPD_BLACK     0x0000
+#define GxEPD_WHITE     0xFFFF
+#define GxEPD_RED       0xF800
+#define GxEPD_DARKGREY  0x7BEF
+#define GxEPD_LIGHTGREY 0xC618
+
+// panel drivers: size only
+struct GxEPD2_420_GDEY042T81
+{
+  static const uint16_t WIDTH = HOST_WIDTH;
+  static const uint16_t HEIGHT = HOST_HEIGHT;
+  GxEPD2_420_GDEY042T81(int16_t cs, int16_t dc, int16_t rst, int16_t busy) {}
+};
+struct GxEPD2_420_GYE042A87
+{
+  static const uint16_t WIDTH = HOST_WIDTH;
+  static const uint16_t HEIGHT = HOST_HEIGHT;
+  GxEPD2_420_GYE042A87(int16_t cs, int16_t dc, int16_t rst, int16_t busy) {}
+};
+
+// frame buffer, window and refresh, common to all panel types
+class hostEpd : public Adafruit_GFX
+{
+  public:
+    hostEpd() : Adafruit_GFX(HOST_WIDTH, HOST_HEIGHT) {}
+    void init(uint32_t serialDiagBitrate = 0, bool initial = true, uint16_t resetDuration = 10, bool pulldownRstMode = false);
+    void setFullWindow();
+    void setPartialWindow(int16_t x, int16_t y, int16_t w, int16_t h);
+    void firstPage();
+    bool nextPage();
+    void display(bool partialUpdateMode = false);
+    void refresh(bool partialUpdateMode = false);
+    void hibernate();
+    void powerOff();
+    void drawPixel(int16_t x, int16_t y, uint16_t color);
+    void fillScreen(uint16_t color);
+
+  private:
+    void update(bool partial);
+    uint8_t buffer[HOST_WIDTH * HOST_HEIGHT / 8];   // 1: black
+    int16_t winX = 0, winY = 0, winW = HOST_WIDTH, winH = HOST_HEIGHT;
+    bool fullWindow = true;
+    bool initialRefresh = true;   // after init(initial = true): first refresh is a full one
+    bool hibernating = true;
+};
+
+template<typename GxEPD2_Type, const uint16_t page_height>
+class GxEPD2_BW : public hostEpd
+{
+  public:
+    GxEPD2_Type epd2;
+    GxEPD2_BW(GxEPD2_Type epd2_instance) : epd2(epd2_instance) {}
+};
+
+#endif // _hostGxEPD2_H
@@ -0,0 +1,16 @@
+#ifndef _hostGxEPD2_3C_H
+#define _hostGxEPD2_3C_H
+
+// host shim of GxEPD2_3C: red is drawn as black
+
+#include "GxEPD2.h"
+
+template<typename GxEPD2_Type, const uint16_t page_height>
+class GxEPD2_3C : public hostEpd
+{
+  public:
+    GxEPD2_Type epd2;
+    GxEPD2_3C(GxEPD2_Type epd2_instance) : epd2(epd2_instance) {}
+};
+
+#endif // _hostGxEPD2_3C_H
@@ -0,0 +1,8 @@
+#ifndef _hostGxEPD2_BW_H
+#define _hostGxEPD2_BW_H
+
+// host shim of GxEPD2_BW, see GxEPD2.h
+
+#include "GxEPD2.h"
+
+#endif // _hostGxEPD2_BW_H
@@ -0,0 +1,15 @@
+#ifndef _hostOneWire_H
+#define _hostOneWire_H
+
+// host shim of OneWire: bus without devices
+
+#include "Arduino.h"
+
+class OneWire
+{
+  public:
+    OneWire(uint8_t pin) {}
+    uint8_t reset() { return(0); }   // no presence pulse
+};
+
+#endif // _hostOneWire_H
@@ -0,0 +1,41 @@
+#ifndef _hostPreferences_H
+#define _hostPreferences_H
+
+// host shim of the Preferences library: NVS as a map of namespaces and keys in memory.
+// The content survives hostPowerOn(), hostNvsErase() empties it. Writes are counted in hostStats.
+// Cost model of ESP-IDF NVS: every put looks up the key and compares (HOST_NVS_SET_US), an
+// unchanged value is not written again. A changed value programs 32 byte entries: one for an
+// integer type, for a blob (also putFloat) a header and an index entry plus the data
+// (HOST_NVS_ENTRY_US each). The time passes on the virtual clock
+
+#include "Arduino.h"
+
+class Preferences
+{
+  public:
+    bool begin(const char* name, bool readOnly = false, const char* partition = NULL);
+    void end();
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+    size_t putBool(const char* key, bool value);
+    size_t putULong(const char* key, uint32_t value);
+    size_t putULong64(const char* key, uint64_t value);
+    size_t putFloat(const char* key, float value);
+    size_t putBytes(const char* key, const void* value, size_t len);
+    bool getBool(const char* key, bool defaultValue = false);
+    uint32_t getULong(const char* key, uint32_t defaultValue = 0);
+    uint64_t getULong64(const char* key, uint64_t defaultValue = 0);
+    float getFloat(const char* key, float defaultValue = NAN);
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+
+  private:
+    size_t put(const char* key, const void* value, size_t len, bool blob);
+    size_t get(const char* key, void* buf, size_t len);
+    char ns[16];
+    bool open = false;
+    bool readOnly = true;
+};
+
+#endif // _hostPreferences_H
@@ -0,0 +1,52 @@
+#ifndef _hostU8g2_H
+#define _hostU8g2_H
+
+// host shim of U8g2_for_Adafruit_GFX: the helvetica fonts used by the firmware as metrics
+// (width of digits / capitals, ascent, descent), text drawn as blocks like the Adafruit_GFX shim
+
+#include "Adafruit_GFX.h"
+
+// font descriptors: { width, ascent, -descent }
+extern const uint8_t u8g2_font_helvB08_tf[];
+extern const uint8_t u8g2_font_helvB10_tf[];
+extern const uint8_t u8g2_font_helvB12_tf[];
+extern const uint8_t u8g2_font_helvB14_tf[];
+extern const uint8_t u8g2_font_helvB18_tf[];
+extern const uint8_t u8g2_font_helvB24_tf[];
+extern const uint8_t u8g2_font_helvR08_tf[];
+extern const uint8_t u8g2_font_helvR10_tf[];
+extern const uint8_t u8g2_font_helvR12_tf[];
+extern const uint8_t u8g2_font_helvR14_tf[];
+extern const uint8_t u8g2_font_helvR18_tf[];
+extern const uint8_t u8g2_font_helvR24_tf[];
+
+class U8G2_FOR_ADAFRUIT_GFX : public Print
+{
+  public:
+    void begin(Adafruit_GFX& gfx) { this->gfx = &gfx; }
+    void setFont(const uint8_t* f) { font = f; }
+    void setFontMode(uint8_t transparent) { fontMode = transparent; }
+    void setFontDirection(uint8_t dir) {}
+    void setForegroundColor(uint16_t c) { fg = c; }
+    void setBackgroundColor(uint16_t c) { bg = c; }
+    void setCursor(int16_t x, int16_t y) { cursorX = x; cursorY = y; }
+    int16_t getCursorX() { return(cursorX); }
+    int16_t getCursorY() { return(cursorY); }
+    int8_t getFontAscent();
+    int8_t getFontDescent();
+    int16_t getUTF8Width(const char* s);
+    int16_t drawUTF8(int16_t x, int16_t y, const char* s);
+    int16_t drawStr(int16_t x, int16_t y, const char* s) { return(drawUTF8(x, y, s)); }
+    size_t write(uint8_t c);
+    using Print::write;
+
+  private:
+    int16_t glyphWidth(uint8_t c);
+    Adafruit_GFX* gfx = NULL;
+    const uint8_t* font = NULL;
+    uint8_t fontMode = 0;
+    uint16_t fg = 0, bg = 0xFFFF;
+    int16_t cursorX = 0, cursorY = 0;
+};
+
+#endif // _hostU8g2_H
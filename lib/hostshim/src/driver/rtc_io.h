@@ -0,0 +1,13 @@
+#ifndef _hostRtcIo_H
+#define _hostRtcIo_H
+
+// host shim of driver/rtc_io.h: the pulls set here decide the idle level in deep sleep
+
+#include "Arduino.h"
+
+esp_err_t rtc_gpio_pullup_en(gpio_num_t pin);
+esp_err_t rtc_gpio_pullup_dis(gpio_num_t pin);
+esp_err_t rtc_gpio_pulldown_en(gpio_num_t pin);
+esp_err_t rtc_gpio_pulldown_dis(gpio_num_t pin);
+
+#endif // _hostRtcIo_H
@@ -0,0 +1,13 @@
+#ifndef _hostEspPm_H
+#define _hostEspPm_H
+
+// host shim of esp_pm.h: CONFIG_PM_ENABLE is not set, only the types are needed
+
+#include "Arduino.h"
+
+typedef struct { int max_freq_mhz; int min_freq_mhz; bool light_sleep_enable; } esp_pm_config_esp32_t;
+typedef esp_pm_config_esp32_t esp_pm_config_esp32s3_t;
+
+esp_err_t esp_pm_configure(const void* config);
+
+#endif // _hostEspPm_H
@@ -0,0 +1,10 @@
+#ifndef _hostEspRomCrc_H
+#define _hostEspRomCrc_H
+
+// host shim of the ROM crc: CRC-32 (IEEE 802.3), result and start value inverted like the ROM function
+
+#include <stdint.h>
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const* buf, uint32_t len);
+
+#endif // _hostEspRomCrc_H
@@ -0,0 +1,18 @@
+#ifndef _hostFreeRTOS_H
+#define _hostFreeRTOS_H
+
+// host shim of FreeRTOS: 1 ms tick, no tasks. Waits advance the virtual time
+
+#include "Arduino.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+#define pdTRUE                1
+#define pdFALSE               0
+#define pdPASS                pdTRUE
+#define portMAX_DELAY         0xFFFFFFFF
+#define portTICK_PERIOD_MS    1
+#define pdMS_TO_TICKS(ms)     ((TickType_t)(ms))
+
+#endif // _hostFreeRTOS_H
@@ -0,0 +1,20 @@
+#ifndef _hostQueue_H
+#define _hostQueue_H
+
+// host shim of FreeRTOS queues: copy semantics as the original, a receive with timeout lets the
+// virtual time pass until an item is sent (by a timer callback or an ISR) or the timeout is over
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct hostQueue* QueueHandle_t;
+typedef struct { void* reserved; } StaticQueue_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t* storage, StaticQueue_t* buffer);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+BaseType_t xQueueReset(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#endif // _hostQueue_H
@@ -0,0 +1,141 @@
+/**************************************************!
+   host shim: BluetoothSerial with a scripted client
+   The events of a connection are scheduled on the virtual clock. end(), disconnect() and the
+   deep sleep end the connection: events still pending belong to an old generation and are
+   ignored.
+***************************************************/
+
+#include <string>
+#include <vector>
+
+#include "BluetoothSerial.h"
+#include "hostInternal.h"
+
+#define BT_CONNECT_US         2000000   // client connects after begin()
+#define BT_LINE_US            1000000   // one line per second
+#define BT_PACKET_US          20000     // a line arrives in two packets, 20 ms apart
+
+static std::vector<std::string> script;  // lines of the next connection
+static std::string rx;
+static std::string txLine;
+static uint32_t generation = 0;
+static bool clientConnected = false;
+static bool radioOn = false;
+static uint64_t radioOnUs;              // world time of begin()
+
+void hostBtClient(const char* lines)
+{
+  const char* p = lines;
+  const char* nl;
+
+  script.clear();
+  while(p != NULL && *p != '\0'){
+    nl = strchr(p, '\n');
+    script.push_back(nl ? std::string(p, nl - p) : std::string(p));
+    p = nl ? nl + 1 : NULL;
+  }
+}
+
+void hostBtEnd()
+{
+  generation++;
+  clientConnected = false;
+  if(radioOn)
+    hostStats.radioUs += hostWorldUs() - radioOnUs;
+  radioOn = false;
+  rx.clear();
+  txLine.clear();
+}
+
+// received data: one ESP_SPP_DATA_IND_EVT, the characters are read via read()
+static void btSchedulePacket(uint32_t gen, esp_spp_cb_t cb, uint64_t at, const std::string& packet)
+{
+  if(packet.empty())
+    return;
+  hostSchedule(at, [gen, cb, packet]() {
+    esp_spp_cb_param_t param;
+    if(gen != generation) return;
+    rx += packet;
+    param.data_ind.handle = 1;
+    param.data_ind.len = (uint16_t)packet.size();
+    param.data_ind.data = (uint8_t*)packet.c_str();
+    if(cb != NULL) cb(ESP_SPP_DATA_IND_EVT, &param);
+  });
+}
+
+bool BluetoothSerial::begin(const char* name, bool isMaster)
+{
+  uint32_t gen = ++generation;
+  uint64_t at = hostWorldUs() + BT_CONNECT_US;
+  esp_spp_cb_t cb = callback;
+  std::vector<std::string> lines = script;
+  size_t i;
+
+  script.clear();
+  if(!radioOn){
+    radioOn = true;
+    radioOnUs = hostWorldUs();
+  }
+  if(lines.empty())
+    return(true);                     // nobody connects
+  hostSchedule(at, [gen, cb]() {
+    if(gen != generation) return;
+    clientConnected = true;
+    if(cb != NULL) cb(ESP_SPP_SRV_OPEN_EVT, NULL);
+  });
+  for(i=0; i<lines.size(); i++){
+    std::string line = lines[i] + "\n";
+    size_t half = line.size() / 2;
+    btSchedulePacket(gen, cb, at + (i + 1) * BT_LINE_US, line.substr(0, half));
+    btSchedulePacket(gen, cb, at + (i + 1) * BT_LINE_US + BT_PACKET_US, line.substr(half));
+  }
+  return(true);
+}
+
+void BluetoothSerial::end()
+{
+  hostBtEnd();
+}
+
+bool BluetoothSerial::disconnect()
+{
+  bool was = clientConnected;
+
+  hostBtEnd();
+  return(was);
+}
+
+bool BluetoothSerial::hasClient()
+{
+  return(clientConnected);
+}
+
+size_t BluetoothSerial::write(uint8_t c)
+{
+  if(c == '\r')
+    return(1);
+  txLine += (char)c;
+  if(c == '\n'){
+    ::printf("BT> %s", txLine.c_str());
+    txLine.clear();
+  }
+  return(1);
+}
+
+int BluetoothSerial::available() { return((int)rx.size()); }
+
+int BluetoothSerial::read()
+{
+  int c;
+
+  if(rx.empty())
+    return(-1);
+  c = (uint8_t)rx[0];
+  rx.erase(0, 1);
+  return(c);
+}
+
+int BluetoothSerial::peek()
+{
+  return(rx.empty() ? -1 : (uint8_t)rx[0]);
+}
@@ -0,0 +1,490 @@
+/**************************************************!
+   host shim: virtual clock, esp_timer, FreeRTOS queues, sleep and the wake cycle
+   Three clocks: the world time (true time since the program start), the time since boot
+   (esp_timer, millis) and the RTC time of day (gettimeofday). Awake they advance together.
+   In deep sleep the RTC counts the requested sleep time, the world time runs longer or
+   shorter by the drift of the RTC slow clock (hostSetRtcDriftPpm).
+   Events (timer callbacks, scripted pin changes and callbacks) are run in the order of their
+   due time while the time advances; a callback may wait itself (nested hostAdvance).
+***************************************************/
+
+#include <time.h>
+#include <vector>
+#include <deque>
+
+#include "Arduino.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "hostInternal.h"
+
+hostStatistics hostStats;
+
+struct esp_timer
+{
+  esp_timer_cb_t callback;
+  void* arg;
+  const char* name;
+  bool armed;
+  uint64_t dueUs;               // world time
+  uint64_t periodUs;            // 0: one-shot
+};
+static std::vector<esp_timer*> timers;
+
+struct hostEvent
+{
+  uint64_t atUs;                // world time
+  int pin;                      // pin change, -1: callback
+  int level;
+  std::function<void()> fn;
+};
+static std::vector<hostEvent> events;
+
+static uint64_t worldUs = 0;
+static uint64_t bootWorldUs = 0;        // world time of the boot: esp_timer 0
+static uint64_t epochAtBootUs = 0;      // RTC time of day at boot
+static int32_t driftPpm = 0;
+static uint32_t bootDelayUs = 0;        // wake until setup()
+static esp_sleep_wakeup_cause_t wakeCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+static uint64_t timerWakeUs = 0;        // 0: timer wakeup disabled
+static uint64_t ext1Mask = 0, ext1Status = 0;
+static esp_sleep_ext1_wakeup_mode_t ext1Mode = ESP_EXT1_WAKEUP_ANY_HIGH;
+
+// RTC memory: all variables with RTC_DATA_ATTR, from the linker
+extern char __start_rtc_data[] __attribute__((weak));
+extern char __stop_rtc_data[] __attribute__((weak));
+static std::vector<char> rtcImage;      // initial values, taken at the first power on
+
+static uint64_t cpuNs()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+//************** time *************************/
+uint64_t hostWorldUs() { return(worldUs); }
+uint64_t hostBootUs() { return(worldUs - bootWorldUs); }
+void hostSetRtcDriftPpm(int32_t ppm) { driftPpm = ppm; }
+void hostSetBootUs(uint32_t us) { bootDelayUs = us; }
+
+int64_t esp_timer_get_time() { return((int64_t)(worldUs - bootWorldUs)); }
+unsigned long millis() { return((unsigned long)((worldUs - bootWorldUs) / 1000)); }
+unsigned long micros() { return((unsigned long)(worldUs - bootWorldUs)); }
+void delay(uint32_t ms) { hostAdvance((uint64_t)ms * 1000); }
+void delayMicroseconds(uint32_t us) { hostAdvance(us); }
+void yield() {}
+
+int hostGettimeofday(struct timeval* tv, void* tz)
+{
+  uint64_t us = epochAtBootUs + (worldUs - bootWorldUs);
+
+  if(tv != NULL){
+    tv->tv_sec = (time_t)(us / 1000000);
+    tv->tv_usec = (suseconds_t)(us % 1000000);
+  }
+  return(0);
+}
+
+void hostSchedule(uint64_t atWorldUs, std::function<void()> fn)
+{
+  hostEvent ev = { atWorldUs, -1, 0, fn };
+  events.push_back(ev);
+}
+
+void hostSchedulePin(uint64_t atWorldUs, uint8_t pin, int level)
+{
+  hostEvent ev = { atWorldUs, pin, level, NULL };
+  events.push_back(ev);
+}
+
+void hostPress(uint8_t pin, uint64_t atWorldUs, uint32_t holdMs)
+{
+  hostSchedulePin(atWorldUs, pin, HOST_PIN_PRESS);
+  hostSchedulePin(atWorldUs + (uint64_t)holdMs * 1000, pin, HOST_PIN_RELEASE);
+}
+
+// index of the next event due at or before limitUs, -1: none
+static int nextEvent(uint64_t limitUs)
+{
+  int i, next = -1;
+
+  for(i=0; i<(int)events.size(); i++)
+    if(events[i].atUs <= limitUs && (next < 0 || events[i].atUs < events[next].atUs))
+      next = i;
+  return(next);
+}
+
+static esp_timer* nextTimer(uint64_t limitUs)
+{
+  esp_timer* next = NULL;
+
+  for(esp_timer* t : timers)
+    if(t->armed && t->dueUs <= limitUs && (next == NULL || t->dueUs < next->dueUs))
+      next = t;
+  return(next);
+}
+
+/**************************************************!
+   @brief    hostAdvanceUntil()
+   @details  let the virtual time pass and run the events due meanwhile, in time order
+   @param    us: time to pass
+   @param    done: checked before each event, stops early if true. NULL: never
+   @param    arg: argument of done
+   @return   bool: true if stopped by done
+***************************************************/
+bool hostAdvanceUntil(uint64_t us, bool (*done)(void*), void* arg)
+{
+  uint64_t targetUs = worldUs + us;
+  esp_timer* t;
+  hostEvent ev;
+  int i;
+
+  while(true){
+    if(done != NULL && done(arg))
+      return(true);
+    t = nextTimer(targetUs);
+    i = nextEvent((t != NULL) ? t->dueUs : targetUs);
+    if(i >= 0){
+      ev = events[i];
+      events.erase(events.begin() + i);
+      if(ev.atUs > worldUs) worldUs = ev.atUs;
+      if(ev.pin >= 0)
+        hostPinChange(ev.pin, ev.level);
+      else
+        ev.fn();
+    }
+    else if(t != NULL){
+      if(t->dueUs > worldUs) worldUs = t->dueUs;
+      if(t->periodUs > 0)
+        t->dueUs += t->periodUs;
+      else
+        t->armed = false;
+      hostStats.timerCallbacks++;
+      t->callback(t->arg);
+    }
+    else
+      break;
+  }
+  if(worldUs < targetUs)
+    worldUs = targetUs;
+  return(done != NULL && done(arg));
+}
+
+void hostAdvance(uint64_t us)
+{
+  hostAdvanceUntil(us, NULL, NULL);
+}
+
+//************** esp_timer *************************/
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle)
+{
+  esp_timer* t;
+
+  if(args == NULL || args->callback == NULL || handle == NULL)
+    return(ESP_ERR_INVALID_ARG);
+  t = new esp_timer;
+  t->callback = args->callback;
+  t->arg = args->arg;
+  t->name = args->name;
+  t->armed = false;
+  t->dueUs = 0;
+  t->periodUs = 0;
+  timers.push_back(t);
+  *handle = t;
+  return(ESP_OK);
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs)
+{
+  if(timer->armed)
+    return(ESP_ERR_INVALID_STATE);
+  timer->armed = true;
+  timer->dueUs = worldUs + timeoutUs;
+  timer->periodUs = 0;
+  return(ESP_OK);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs)
+{
+  if(timer->armed)
+    return(ESP_ERR_INVALID_STATE);
+  if(periodUs == 0)
+    return(ESP_ERR_INVALID_ARG);
+  timer->armed = true;
+  timer->dueUs = worldUs + periodUs;
+  timer->periodUs = periodUs;
+  return(ESP_OK);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+  if(!timer->armed)
+    return(ESP_ERR_INVALID_STATE);
+  timer->armed = false;
+  return(ESP_OK);
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+  size_t i;
+
+  if(timer->armed)
+    return(ESP_ERR_INVALID_STATE);
+  for(i=0; i<timers.size(); i++){
+    if(timers[i] == timer){
+      timers.erase(timers.begin() + i);
+      break;
+    }
+  }
+  delete timer;
+  return(ESP_OK);
+}
+
+//************** FreeRTOS queues *************************/
+struct hostQueue
+{
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  std::deque<std::vector<uint8_t> > items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+  hostQueue* q = new hostQueue;
+
+  q->length = length;
+  q->itemSize = itemSize;
+  return(q);
+}
+
+// the storage of the caller is not used, the items are copied as by FreeRTOS
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t* storage, StaticQueue_t* buffer)
+{
+  return(xQueueCreate(length, itemSize));
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+  const uint8_t* p = (const uint8_t*)item;
+
+  if(queue->items.size() >= queue->length)
+    return(pdFALSE);                  // nobody receives while the sender waits: no wait
+  queue->items.push_back(std::vector<uint8_t>(p, p + queue->itemSize));
+  return(pdTRUE);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken)
+{
+  if(woken != NULL) *woken = pdFALSE;
+  return(xQueueSend(queue, item, 0));
+}
+
+static bool queueFilled(void* arg)
+{
+  return(!((hostQueue*)arg)->items.empty());
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks)
+{
+  if(queue->items.empty()){
+    if(ticks == 0)
+      return(pdFALSE);
+    // portMAX_DELAY: about 49 days of virtual time, ends the wait if nothing will come
+    if(!hostAdvanceUntil((uint64_t)ticks * 1000, queueFilled, queue))
+      return(pdFALSE);
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  return(pdTRUE);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+  queue->items.clear();
+  return(pdPASS);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+  return((UBaseType_t)queue->items.size());
+}
+
+//************** sleep *************************/
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() { return(wakeCause); }
+uint64_t esp_sleep_get_ext1_wakeup_status() { return(ext1Status); }
+esp_err_t esp_sleep_pd_config(esp_sleep_pd_domain_t domain, esp_sleep_pd_option_t option) { return(ESP_OK); }
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs)
+{
+  timerWakeUs = (timeUs > 0) ? timeUs : 1;
+  return(ESP_OK);
+}
+
+esp_err_t esp_sleep_enable_ext1_wakeup(uint64_t mask, esp_sleep_ext1_wakeup_mode_t mode)
+{
+  ext1Mask = mask;
+  ext1Mode = mode;
+  return(ESP_OK);
+}
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source)
+{
+  if(source == ESP_SLEEP_WAKEUP_TIMER || source == ESP_SLEEP_WAKEUP_ALL) timerWakeUs = 0;
+  if(source == ESP_SLEEP_WAKEUP_EXT1 || source == ESP_SLEEP_WAKEUP_ALL) ext1Mask = 0;
+  return(ESP_OK);
+}
+
+// light sleep: the timers are served when the time has passed, i.e. after the wakeup
+esp_err_t esp_light_sleep_start()
+{
+  if(timerWakeUs == 0)
+    return(ESP_ERR_INVALID_STATE);    // no wakeup source
+  hostStats.lightSleepUs += timerWakeUs;
+  hostAdvance(timerWakeUs);
+  return(ESP_OK);
+}
+
+void esp_deep_sleep_start()
+{
+  hostDeepSleep s = { timerWakeUs };
+  throw s;
+}
+
+// EXT1 condition with the pin levels now: mask of the pins that wake, 0: none
+static uint64_t ext1Wakes()
+{
+  uint64_t high = 0;
+  int pin;
+
+  for(pin=0; pin<HOST_MAX_PINS; pin++)
+    if((ext1Mask & (1ULL << pin)) && hostPinLevel(pin))
+      high |= 1ULL << pin;
+  switch(ext1Mode){
+    case ESP_EXT1_WAKEUP_ANY_HIGH: return(high);
+    case ESP_EXT1_WAKEUP_ANY_LOW:  return(ext1Mask & ~high);
+    default:                       return((high == 0 && ext1Mask != 0) ? ext1Mask : 0);
+  }
+}
+
+/**************************************************!
+   @brief    deepSleep()
+   @details  pass the deep sleep: until the timer or a pin change that meets the EXT1
+   @details  condition. Scripted callbacks are dropped, the radio is off
+   @param    sleepUs: timer wakeup, 0: none
+   @return   bool: false if there is no wakeup
+***************************************************/
+static bool deepSleep(uint64_t sleepUs)
+{
+  uint64_t epochUs = epochAtBootUs + (worldUs - bootWorldUs);
+  uint64_t wakeUs = UINT64_MAX, rtcUs;
+  hostEvent ev;
+  int i;
+
+  for(esp_timer* t : timers)
+    t->armed = false;
+  for(i=(int)events.size()-1; i>=0; i--)
+    if(events[i].pin < 0)
+      events.erase(events.begin() + i);
+  hostBtEnd();
+
+  if(sleepUs > 0)
+    wakeUs = worldUs + sleepUs + (int64_t)sleepUs * driftPpm / 1000000;
+  wakeCause = ESP_SLEEP_WAKEUP_TIMER;
+  ext1Status = 0;
+  while((i = nextEvent(wakeUs)) >= 0){
+    ev = events[i];
+    events.erase(events.begin() + i);
+    hostPinChange(ev.pin, ev.level);
+    if(ext1Mask != 0 && ext1Wakes() != 0){
+      wakeUs = (ev.atUs > worldUs) ? ev.atUs : worldUs;
+      wakeCause = ESP_SLEEP_WAKEUP_EXT1;
+      ext1Status = ext1Wakes();
+      break;
+    }
+  }
+  if(wakeUs == UINT64_MAX)
+    return(false);
+
+  // the RTC counts the sleep in its own, drifting time base
+  rtcUs = (wakeCause == ESP_SLEEP_WAKEUP_TIMER) ? sleepUs
+        : (uint64_t)((double)(wakeUs - worldUs) * 1000000.0 / (1000000.0 + driftPpm));
+  hostStats.deepSleepUs += wakeUs - worldUs;
+  worldUs = wakeUs;
+  bootWorldUs = worldUs;                // esp_timer restarts at 0, the clocks are valid until the next hostWake()
+  epochAtBootUs = epochUs + rtcUs;
+  return(true);
+}
+
+//************** wake cycle *************************/
+/**************************************************!
+   @brief    hostPowerOn()
+   @details  cold boot: RTC memory back to the initial values of the program image,
+   @details  wakeup cause undefined, RTC time 0. NVS, journal file and panel are kept
+   @return   void
+***************************************************/
+void hostPowerOn()
+{
+  size_t len = (size_t)(__stop_rtc_data - __start_rtc_data);
+
+  if(__start_rtc_data != NULL){
+    if(rtcImage.empty())
+      rtcImage.assign(__start_rtc_data, __stop_rtc_data);
+    else
+      memcpy(__start_rtc_data, rtcImage.data(), len);
+  }
+  for(esp_timer* t : timers)
+    t->armed = false;
+  for(int i=(int)events.size()-1; i>=0; i--)
+    if(events[i].pin < 0)
+      events.erase(events.begin() + i);
+  hostBtEnd();
+  hostPinsBoot(true);
+  wakeCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+  ext1Status = 0;
+  epochAtBootUs = 0;
+  bootWorldUs = worldUs;
+  hostStats.powerOns++;
+}
+
+/**************************************************!
+   @brief    hostWake()
+   @details  one wake: boot, setup(), loop() until the firmware enters deep sleep, then
+   @details  the deep sleep until the next wakeup. After hostPowerOn() or the last hostWake()
+   @param    info: result of the wake, may be NULL
+   @return   bool: false if the firmware did not sleep or cannot wake again
+***************************************************/
+bool hostWake(hostWakeInfo* info)
+{
+  hostWakeInfo w;
+  uint64_t cpu;
+  int n;
+
+  memset(&w, 0, sizeof(w));
+  w.cause = wakeCause;
+  hostPinsBoot(false);
+  timerWakeUs = 0;
+  ext1Mask = 0;
+  worldUs += bootDelayUs;
+
+  cpu = cpuNs();
+  try{
+    setup();
+    for(n=0; n<HOST_MAX_LOOPS; n++)
+      loop();
+  }
+  catch(hostDeepSleep& s){
+    w.slept = true;
+    w.sleepUs = s.sleepUs;
+  }
+  w.cpuNs = cpuNs() - cpu;
+  w.awakeUs = worldUs - bootWorldUs;
+  hostStats.cpuNs += w.cpuNs;
+  hostStats.awakeUs += w.awakeUs;
+  if(w.slept)
+    hostStats.wakes++;
+  if(info != NULL)
+    *info = w;
+  return(w.slept && deepSleep(w.sleepUs));
+}
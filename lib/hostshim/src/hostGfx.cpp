@@ -0,0 +1,371 @@
+/**************************************************!
+   host shim: Adafruit_GFX primitives, the ePaper frame buffer and the U8g2 font metrics
+   Text is not rendered from glyphs: each character is a block of the x-height, as wide as the
+   font advances. Enough to see the layout and the overlaps of the text fields in the dump.
+***************************************************/
+
+#include <algorithm>
+
+#include "GxEPD2.h"
+#include "U8g2_for_Adafruit_GFX.h"
+#include "hostInternal.h"
+
+static uint8_t panel[HOST_WIDTH * HOST_HEIGHT / 8];   // image shown by the panel, 1: black
+
+//************** Adafruit_GFX *************************/
+void Adafruit_GFX::fillScreen(uint16_t color)
+{
+  fillRect(0, 0, _width, _height, color);
+}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+{
+  int16_t i;
+
+  for(i=0; i<w; i++)
+    drawPixel(x + i, y, color);
+}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+{
+  int16_t i;
+
+  for(i=0; i<h; i++)
+    drawPixel(x, y + i, color);
+}
+
+// Bresenham
+void Adafruit_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+{
+  int dx = abs(x1 - x0), sx = (x0 < x1) ? 1 : -1;
+  int dy = -abs(y1 - y0), sy = (y0 < y1) ? 1 : -1;
+  int err = dx + dy, e2;
+
+  while(true){
+    drawPixel(x0, y0, color);
+    if(x0 == x1 && y0 == y1)
+      break;
+    e2 = 2 * err;
+    if(e2 >= dy){ err += dy; x0 += sx; }
+    if(e2 <= dx){ err += dx; y0 += sy; }
+  }
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, y + h - 1, w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(x + w - 1, y, h, color);
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  int16_t i;
+
+  for(i=0; i<h; i++)
+    drawFastHLine(x, y + i, w, color);
+}
+
+void Adafruit_GFX::drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color)
+{
+  int16_t x, y;
+
+  for(y=-r; y<=r; y++)
+    for(x=-r; x<=r; x++)
+      if(abs(x * x + y * y - r * r) <= r)
+        drawPixel(x0 + x, y0 + y, color);
+}
+
+void Adafruit_GFX::fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color)
+{
+  int16_t x, y;
+
+  for(y=-r; y<=r; y++)
+    for(x=-r; x<=r; x++)
+      if(x * x + y * y <= r * r)
+        drawPixel(x0 + x, y0 + y, color);
+}
+
+void Adafruit_GFX::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color)
+{
+  drawLine(x0, y0, x1, y1, color);
+  drawLine(x1, y1, x2, y2, color);
+  drawLine(x2, y2, x0, y0, color);
+}
+
+static int edge(int ax, int ay, int bx, int by, int px, int py)
+{
+  return((bx - ax) * (py - ay) - (by - ay) * (px - ax));
+}
+
+// all pixels of the bounding box on the inner side of the three edges
+void Adafruit_GFX::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color)
+{
+  int minX = std::min(x0, std::min(x1, x2)), maxX = std::max(x0, std::max(x1, x2));
+  int minY = std::min(y0, std::min(y1, y2)), maxY = std::max(y0, std::max(y1, y2));
+  int area = edge(x0, y0, x1, y1, x2, y2);
+  int x, y, e0, e1, e2;
+
+  if(area == 0){
+    drawTriangle(x0, y0, x1, y1, x2, y2, color);
+    return;
+  }
+  for(y=minY; y<=maxY; y++){
+    for(x=minX; x<=maxX; x++){
+      e0 = edge(x1, y1, x2, y2, x, y);
+      e1 = edge(x2, y2, x0, y0, x, y);
+      e2 = edge(x0, y0, x1, y1, x, y);
+      if(area > 0 ? (e0 >= 0 && e1 >= 0 && e2 >= 0) : (e0 <= 0 && e1 <= 0 && e2 <= 0))
+        drawPixel(x, y, color);
+    }
+  }
+}
+
+// classic font (font NULL): 6 x 8 cell, cursor at the top left. GFX fonts: cursor on the base line
+size_t Adafruit_GFX::write(uint8_t c)
+{
+  int16_t adv, asc;
+
+  if(c == '\n'){
+    cursorX = 0;
+    cursorY += (font != NULL) ? font->yAdvance * textSize : 8 * textSize;
+    return(1);
+  }
+  if(c == '\r' || (c & 0xC0) == 0x80)   // UTF-8 continuation byte
+    return(1);
+  adv = ((font != NULL) ? font->xAdvance : 6) * textSize;
+  asc = ((font != NULL) ? font->ascent : 7) * textSize;
+  if(textBgColor != textColor){
+    if(font != NULL)
+      fillRect(cursorX, cursorY - asc, adv, font->yAdvance * textSize, textBgColor);
+    else
+      fillRect(cursorX, cursorY, adv, 8 * textSize, textBgColor);
+  }
+  if(c != ' '){
+    if(font != NULL)
+      fillRect(cursorX + 1, cursorY - asc * 2 / 3, adv - 2, asc * 2 / 3, textColor);
+    else
+      fillRect(cursorX, cursorY + 2 * textSize, adv - textSize, 5 * textSize, textColor);
+  }
+  cursorX += adv;
+  return(1);
+}
+
+void Adafruit_GFX::getTextBounds(const char* s, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h)
+{
+  uint16_t n = 0;
+
+  for(; *s != '\0'; s++)
+    if((*s & 0xC0) != 0x80)
+      n++;
+  *x1 = x;
+  *y1 = (font != NULL) ? y - font->ascent * textSize : y;
+  *w = n * ((font != NULL) ? font->xAdvance : 6) * textSize;
+  *h = ((font != NULL) ? font->yAdvance : 8) * textSize;
+}
+
+//************** ePaper *************************/
+const uint8_t* hostPanelImage()
+{
+  return(panel);
+}
+
+/**************************************************!
+   @brief    hostPanelDump()
+   @details  write the panel image as binary PBM (P4), viewable with most image tools
+   @param    path: file name
+   @return   bool: false if the file cannot be written
+***************************************************/
+bool hostPanelDump(const char* path)
+{
+  FILE* f = fopen(path, "wb");
+  bool ok;
+
+  if(f == NULL)
+    return(false);
+  fprintf(f, "P4\n%d %d\n", HOST_WIDTH, HOST_HEIGHT);
+  ok = (fwrite(panel, 1, sizeof(panel), f) == sizeof(panel));
+  return((fclose(f) == 0) && ok);
+}
+
+void hostEpd::init(uint32_t serialDiagBitrate, bool initial, uint16_t resetDuration, bool pulldownRstMode)
+{
+  hostStats.panelBusyUs += HOST_EPD_INIT_US;
+  hostAdvance(HOST_EPD_INIT_US);
+  initialRefresh = initial;
+  hibernating = false;
+}
+
+void hostEpd::setFullWindow()
+{
+  fullWindow = true;
+  winX = 0; winY = 0; winW = HOST_WIDTH; winH = HOST_HEIGHT;
+}
+
+// like the controller: x and width in whole bytes
+void hostEpd::setPartialWindow(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  int16_t x1 = x + w;
+
+  x = std::max<int16_t>(0, x) & ~7;
+  x1 = std::min<int16_t>(HOST_WIDTH, (x1 + 7) & ~7);
+  y = std::max<int16_t>(0, y);
+  h = std::min<int16_t>(HOST_HEIGHT - y, h);
+  fullWindow = false;
+  winX = x; winY = y; winW = std::max<int16_t>(0, x1 - x); winH = std::max<int16_t>(0, h);
+}
+
+void hostEpd::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+  int16_t t;
+  uint32_t i;
+
+  switch(rotation){                   // to panel coordinates
+    case 1: t = x; x = HOST_WIDTH - 1 - y; y = t; break;
+    case 2: x = HOST_WIDTH - 1 - x; y = HOST_HEIGHT - 1 - y; break;
+    case 3: t = x; x = y; y = HOST_HEIGHT - 1 - t; break;
+  }
+  if(x < winX || x >= winX + winW || y < winY || y >= winY + winH)
+    return;
+  i = (uint32_t)y * HOST_WIDTH + x;
+  if(color == GxEPD_WHITE || color == GxEPD_LIGHTGREY)
+    buffer[i / 8] &= ~(0x80 >> (i % 8));
+  else
+    buffer[i / 8] |= 0x80 >> (i % 8);
+}
+
+void hostEpd::fillScreen(uint16_t color)
+{
+  int16_t x, y;
+
+  for(y=winY; y<winY+winH; y++)
+    for(x=winX; x<winX+winW; x++){
+      uint32_t i = (uint32_t)y * HOST_WIDTH + x;
+      if(color == GxEPD_WHITE || color == GxEPD_LIGHTGREY)
+        buffer[i / 8] &= ~(0x80 >> (i % 8));
+      else
+        buffer[i / 8] |= 0x80 >> (i % 8);
+    }
+}
+
+void hostEpd::firstPage()
+{
+  uint8_t r = rotation;
+
+  rotation = 0;
+  fillScreen(GxEPD_WHITE);
+  rotation = r;
+}
+
+// one page: the whole window fits into the buffer
+bool hostEpd::nextPage()
+{
+  update(!fullWindow);
+  return(false);
+}
+
+void hostEpd::display(bool partialUpdateMode)
+{
+  update(partialUpdateMode);
+}
+
+void hostEpd::refresh(bool partialUpdateMode)
+{
+  update(partialUpdateMode);
+}
+
+void hostEpd::hibernate() { hibernating = true; }
+void hostEpd::powerOff() {}
+
+// copy the window to the panel, a partial update after init(initial = true) is a full one
+void hostEpd::update(bool partial)
+{
+  int16_t y;
+
+  if(hibernating)
+    init(0, false);
+  partial = partial && !initialRefresh;
+  for(y=winY; y<winY+winH; y++)
+    memcpy(&panel[(y * HOST_WIDTH + winX) / 8], &buffer[(y * HOST_WIDTH + winX) / 8], winW / 8);
+  initialRefresh = false;
+  if(partial){
+    hostStats.partialRefreshes++;
+    hostStats.panelBusyUs += HOST_EPD_PARTIAL_US;
+    hostAdvance(HOST_EPD_PARTIAL_US);
+  }
+  else{
+    hostStats.fullRefreshes++;
+    hostStats.panelBusyUs += HOST_EPD_FULL_US;
+    hostAdvance(HOST_EPD_FULL_US);
+  }
+}
+
+//************** U8g2 *************************/
+// { width of digits and capitals, ascent, -descent }
+const uint8_t u8g2_font_helvB08_tf[] = { 6, 8, 2 };
+const uint8_t u8g2_font_helvB10_tf[] = { 8, 10, 3 };
+const uint8_t u8g2_font_helvB12_tf[] = { 10, 12, 3 };
+const uint8_t u8g2_font_helvB14_tf[] = { 11, 14, 4 };
+const uint8_t u8g2_font_helvB18_tf[] = { 14, 19, 5 };
+const uint8_t u8g2_font_helvB24_tf[] = { 19, 25, 7 };
+const uint8_t u8g2_font_helvR08_tf[] = { 6, 8, 2 };
+const uint8_t u8g2_font_helvR10_tf[] = { 7, 10, 3 };
+const uint8_t u8g2_font_helvR12_tf[] = { 9, 12, 3 };
+const uint8_t u8g2_font_helvR14_tf[] = { 10, 14, 4 };
+const uint8_t u8g2_font_helvR18_tf[] = { 13, 19, 5 };
+const uint8_t u8g2_font_helvR24_tf[] = { 17, 25, 7 };
+
+int8_t U8G2_FOR_ADAFRUIT_GFX::getFontAscent() { return(font != NULL ? font[1] : 0); }
+int8_t U8G2_FOR_ADAFRUIT_GFX::getFontDescent() { return(font != NULL ? -font[2] : 0); }
+
+// proportional font: narrow punctuation, wide m and w
+int16_t U8G2_FOR_ADAFRUIT_GFX::glyphWidth(uint8_t c)
+{
+  int16_t w = (font != NULL) ? font[0] : 6;
+
+  if((c & 0xC0) == 0x80)
+    return(0);
+  if(c == ' ' || c == '.' || c == ',' || c == ':')
+    return(w / 2);
+  if(c == 'm' || c == 'w' || c == 'M' || c == 'W')
+    return(w + 2);
+  if(c >= 'a' && c <= 'z')
+    return(w - 1);
+  return(w);
+}
+
+int16_t U8G2_FOR_ADAFRUIT_GFX::getUTF8Width(const char* s)
+{
+  int16_t w = 0;
+
+  for(; *s != '\0'; s++)
+    w += glyphWidth((uint8_t)*s);
+  return(w);
+}
+
+int16_t U8G2_FOR_ADAFRUIT_GFX::drawUTF8(int16_t x, int16_t y, const char* s)
+{
+  int16_t x0 = x;
+
+  cursorX = x;
+  cursorY = y;
+  for(; *s != '\0'; s++)
+    write((uint8_t)*s);
+  return(cursorX - x0);
+}
+
+size_t U8G2_FOR_ADAFRUIT_GFX::write(uint8_t c)
+{
+  int16_t w = glyphWidth(c);
+  int16_t asc = getFontAscent(), h = asc * 2 / 3;
+
+  if(gfx == NULL || w == 0 || c == '\n' || c == '\r')
+    return(1);
+  if(fontMode == 0)                   // solid: background of the glyph box
+    gfx->fillRect(cursorX, cursorY - asc, w, asc - getFontDescent(), bg);
+  if(c != ' ')
+    gfx->fillRect(cursorX, cursorY - h, std::max<int16_t>(1, w - 1), h, fg);
+  cursorX += w;
+  return(1);
+}
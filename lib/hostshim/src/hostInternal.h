@@ -0,0 +1,19 @@
+#ifndef _hostInternal_H
+#define _hostInternal_H
+
+// functions shared by the files of the host shim, not for the firmware
+
+#include <functional>
+#include "Arduino.h"
+
+#define HOST_PIN_PRESS        2       // hostPress(): drive the pin against its pull
+#define HOST_PIN_RELEASE      -1
+
+void hostSchedule(uint64_t atWorldUs, std::function<void()> fn);   // callback at a world time, dropped at deep sleep
+void hostSchedulePin(uint64_t atWorldUs, uint8_t pin, int level);  // pin change, also wakes from deep sleep
+void hostPinChange(uint8_t pin, int level);   // apply a pin change, run the interrupt on an edge
+int hostPinLevel(uint8_t pin);
+void hostPinsBoot(bool powerOn);              // wake: interrupts detached. Power on: pulls off as well
+void hostBtEnd();
+
+#endif // _hostInternal_H
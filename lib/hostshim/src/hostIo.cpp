@@ -0,0 +1,374 @@
+/**************************************************!
+   host shim: pins, interrupts, ADC, LEDC, Serial, Print and the small chip functions
+   A pin level is: the output level if the pin is an output, else the level driven from
+   outside (hostSetPin, hostPress), else the pull. A change of the level runs the interrupt
+   attached to the pin if the edge matches its mode.
+***************************************************/
+
+#include <string>
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "esp_pm.h"
+#include "esp_rom_crc.h"
+#include "driver/ledc.h"
+#include "driver/rtc_io.h"
+#include "hostInternal.h"
+
+struct hostPin
+{
+  uint8_t mode;
+  int pull;                     // 1: up, 0: down, -1: none
+  int drive;                    // level driven from outside, -1: none
+  int output;                   // level of an output
+  void (*isr)(void);
+  void (*isrArg)(void*);
+  void* arg;
+  int isrMode;
+  uint32_t milliVolt;
+};
+static hostPin pins[HOST_MAX_PINS];
+
+static uint32_t ledcDuty[LEDC_CHANNEL_MAX];
+static uint32_t cpuMhz = 240;
+static bool serialEcho = true;
+static std::string serialOut;
+static std::string serialIn;
+
+HardwareSerial Serial;
+TwoWire Wire;
+EspClass ESP;
+
+//************** pins *************************/
+static bool validPin(uint8_t pin)
+{
+  return(pin < HOST_MAX_PINS);
+}
+
+int hostPinLevel(uint8_t pin)
+{
+  hostPin* p;
+
+  if(!validPin(pin))
+    return(LOW);
+  p = &pins[pin];
+  if(p->mode == OUTPUT)
+    return(p->output);
+  if(p->drive >= 0)
+    return(p->drive);
+  return(p->pull == 1 ? HIGH : LOW);
+}
+
+// run the interrupt of the pin if the level change is an edge of its mode
+static void pinEdge(uint8_t pin, int before)
+{
+  hostPin* p = &pins[pin];
+  int after = hostPinLevel(pin);
+
+  if(before == after || (p->isr == NULL && p->isrArg == NULL))
+    return;
+  if(p->isrMode == CHANGE || (p->isrMode == RISING && after == HIGH) || (p->isrMode == FALLING && after == LOW)){
+    if(p->isr != NULL)
+      p->isr();
+    else
+      p->isrArg(p->arg);
+  }
+}
+
+void hostPinChange(uint8_t pin, int level)
+{
+  int before;
+
+  if(!validPin(pin))
+    return;
+  before = hostPinLevel(pin);
+  if(level == HOST_PIN_PRESS)
+    pins[pin].drive = (pins[pin].pull == 1) ? LOW : HIGH;
+  else
+    pins[pin].drive = level;
+  pinEdge(pin, before);
+}
+
+void hostSetPin(uint8_t pin, int level)
+{
+  hostPinChange(pin, (level < 0) ? HOST_PIN_RELEASE : (level ? HIGH : LOW));
+}
+
+void hostSetAnalogMv(uint8_t pin, uint32_t milliVolt)
+{
+  if(validPin(pin))
+    pins[pin].milliVolt = milliVolt;
+}
+
+void hostPinsBoot(bool powerOn)
+{
+  int i;
+
+  for(i=0; i<HOST_MAX_PINS; i++){
+    pins[i].isr = NULL;
+    pins[i].isrArg = NULL;
+    if(powerOn){
+      pins[i].mode = INPUT;
+      pins[i].pull = -1;
+      pins[i].output = LOW;
+    }
+  }
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if(!validPin(pin))
+    return;
+  pins[pin].mode = (mode == OUTPUT) ? OUTPUT : INPUT;
+  if(mode == INPUT_PULLUP)
+    pins[pin].pull = 1;
+  else if(mode == INPUT_PULLDOWN)
+    pins[pin].pull = 0;
+  else
+    pins[pin].pull = -1;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level)
+{
+  int before;
+
+  if(!validPin(pin))
+    return;
+  before = hostPinLevel(pin);
+  pins[pin].output = level ? HIGH : LOW;
+  pinEdge(pin, before);
+}
+
+int digitalRead(uint8_t pin)
+{
+  return(hostPinLevel(pin));
+}
+
+uint32_t analogReadMilliVolts(uint8_t pin)
+{
+  return(validPin(pin) ? pins[pin].milliVolt : 0);
+}
+
+// 12 bit at 11 dB attenuation, about 3.1 V full scale
+uint16_t analogRead(uint8_t pin)
+{
+  uint32_t raw = analogReadMilliVolts(pin) * 4095 / 3100;
+
+  return((uint16_t)(raw > 4095 ? 4095 : raw));
+}
+
+void analogSetPinAttenuation(uint8_t pin, int attenuation) {}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode)
+{
+  if(!validPin(pin))
+    return;
+  pins[pin].isr = isr;
+  pins[pin].isrArg = NULL;
+  pins[pin].isrMode = mode;
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int mode)
+{
+  if(!validPin(pin))
+    return;
+  pins[pin].isr = NULL;
+  pins[pin].isrArg = isr;
+  pins[pin].arg = arg;
+  pins[pin].isrMode = mode;
+}
+
+void detachInterrupt(uint8_t pin)
+{
+  if(!validPin(pin))
+    return;
+  pins[pin].isr = NULL;
+  pins[pin].isrArg = NULL;
+}
+
+static esp_err_t rtcPull(gpio_num_t pin, int pull, bool enable)
+{
+  if(pin < 0 || pin >= HOST_MAX_PINS)
+    return(ESP_ERR_INVALID_ARG);
+  if(enable)
+    pins[pin].pull = pull;
+  else if(pins[pin].pull == pull)
+    pins[pin].pull = -1;
+  return(ESP_OK);
+}
+
+esp_err_t rtc_gpio_pullup_en(gpio_num_t pin) { return(rtcPull(pin, 1, true)); }
+esp_err_t rtc_gpio_pullup_dis(gpio_num_t pin) { return(rtcPull(pin, 1, false)); }
+esp_err_t rtc_gpio_pulldown_en(gpio_num_t pin) { return(rtcPull(pin, 0, true)); }
+esp_err_t rtc_gpio_pulldown_dis(gpio_num_t pin) { return(rtcPull(pin, 0, false)); }
+
+//************** LEDC *************************/
+esp_err_t ledc_timer_config(const ledc_timer_config_t* config) { return(ESP_OK); }
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t* config)
+{
+  if(config->channel >= LEDC_CHANNEL_MAX)
+    return(ESP_ERR_INVALID_ARG);
+  ledcDuty[config->channel] = config->duty;
+  return(ESP_OK);
+}
+
+// the duty takes effect with ledc_update_duty(), kept simple: at once
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty)
+{
+  if(channel >= LEDC_CHANNEL_MAX)
+    return(ESP_ERR_INVALID_ARG);
+  ledcDuty[channel] = duty;
+  return(ESP_OK);
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel) { return(ESP_OK); }
+
+uint32_t hostLedcDuty(ledc_channel_t channel)
+{
+  return(channel < LEDC_CHANNEL_MAX ? ledcDuty[channel] : 0);
+}
+
+//************** chip *************************/
+bool setCpuFrequencyMhz(uint32_t mhz)
+{
+  if(mhz != 80 && mhz != 160 && mhz != 240)
+    return(false);
+  cpuMhz = mhz;
+  return(true);
+}
+
+uint32_t getCpuFrequencyMhz() { return(cpuMhz); }
+
+// CPU time of the host, not virtual time: for the benchmark
+uint32_t EspClass::getCycleCount()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((uint32_t)(((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec) * cpuMhz / 1000));
+}
+
+esp_err_t esp_pm_configure(const void* config) { return(ESP_OK); }
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const* buf, uint32_t len)
+{
+  uint32_t i;
+  int b;
+
+  crc = ~crc;
+  for(i=0; i<len; i++){
+    crc ^= buf[i];
+    for(b=0; b<8; b++)
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return(~crc);
+}
+
+//************** Serial *************************/
+void hostSerialEcho(bool on) { serialEcho = on; }
+void hostSerialInput(const char* text) { serialIn += text; }
+
+// like the UART: received while awake, text due in deep sleep is lost
+void hostSerialInputAt(uint64_t atWorldUs, const char* text)
+{
+  std::string t(text);
+  hostSchedule(atWorldUs, [t]() { serialIn += t; });
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  if(c == '\r')
+    return(1);
+  serialOut += (char)c;
+  if(c == '\n'){
+    if(serialEcho)
+      fputs(serialOut.c_str(), stdout);
+    serialOut.clear();
+  }
+  return(1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t len)
+{
+  size_t i;
+
+  for(i=0; i<len; i++)
+    write(buf[i]);
+  return(len);
+}
+
+int HardwareSerial::available() { return((int)serialIn.size()); }
+
+int HardwareSerial::read()
+{
+  int c;
+
+  if(serialIn.empty())
+    return(-1);
+  c = (uint8_t)serialIn[0];
+  serialIn.erase(0, 1);
+  return(c);
+}
+
+int HardwareSerial::peek()
+{
+  return(serialIn.empty() ? -1 : (uint8_t)serialIn[0]);
+}
+
+//************** Print *************************/
+size_t Print::write(const uint8_t* buf, size_t len)
+{
+  size_t i, n = 0;
+
+  for(i=0; i<len; i++)
+    n += write(buf[i]);
+  return(n);
+}
+
+static size_t printNumber(Print* p, unsigned long n, int base, bool negative)
+{
+  char buf[8 * sizeof(long) + 2];
+  char* s = &buf[sizeof(buf) - 1];
+
+  if(base < 2) base = 10;
+  *s = '\0';
+  do{
+    *--s = "0123456789ABCDEF"[n % base];
+    n /= base;
+  } while(n > 0);
+  if(negative)
+    *--s = '-';
+  return(p->write(s));
+}
+
+size_t Print::print(long n, int base)
+{
+  if(base == DEC && n < 0)
+    return(printNumber(this, 0UL - (unsigned long)n, base, true));
+  return(printNumber(this, (unsigned long)n, base, false));
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  return(printNumber(this, n, base, false));
+}
+
+size_t Print::print(double n, int digits)
+{
+  char buf[48];
+
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return(write(buf));
+}
+
+size_t Print::printf(const char* format, ...)
+{
+  char buf[256];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  return(write(buf));
+}
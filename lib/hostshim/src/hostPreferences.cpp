@@ -0,0 +1,155 @@
+/**************************************************!
+   host shim: Preferences (NVS) in memory
+***************************************************/
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Preferences.h"
+
+typedef std::map<std::string, std::vector<uint8_t> > hostNamespace;
+static std::map<std::string, hostNamespace> nvs;
+static int putsLeft = -1;               // puts until a simulated power loss, -1: no limit
+
+void hostNvsErase()
+{
+  nvs.clear();
+  putsLeft = -1;
+}
+
+void hostNvsFailAfter(int puts)
+{
+  putsLeft = puts;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partition)
+{
+  if(name == NULL || strlen(name) >= sizeof(ns))
+    return(false);
+  strcpy(ns, name);
+  this->readOnly = readOnly;
+  open = true;
+  return(true);
+}
+
+void Preferences::end()
+{
+  open = false;
+}
+
+bool Preferences::clear()
+{
+  if(!open || readOnly)
+    return(false);
+  nvs[ns].clear();
+  hostStats.nvsWrites++;
+  return(true);
+}
+
+bool Preferences::remove(const char* key)
+{
+  if(!open || readOnly || putsLeft == 0)
+    return(false);
+  if(nvs[ns].erase(key) == 0)
+    return(false);
+  hostStats.nvsWrites++;
+  return(true);
+}
+
+bool Preferences::isKey(const char* key)
+{
+  return(open && nvs[ns].count(key) > 0);
+}
+
+size_t Preferences::put(const char* key, const void* value, size_t len, bool blob)
+{
+  const uint8_t* p = (const uint8_t*)value;
+  std::vector<uint8_t> v(p, p + len);
+  uint32_t entries;
+
+  if(!open || readOnly || key == NULL || strlen(key) > 15 || putsLeft == 0)
+    return(0);
+  if(putsLeft > 0)
+    putsLeft--;
+  hostStats.nvsWrites++;
+  hostAdvance(HOST_NVS_SET_US);
+  if(nvs[ns].count(key) > 0 && nvs[ns][key] == v)
+    return(len);                // like nvs_set_*(): same value, nothing programmed
+  entries = blob ? 2 + (len + 31) / 32 : 1;
+  nvs[ns][key] = v;
+  hostStats.nvsBytes += len;
+  hostStats.nvsEntries += entries;
+  hostAdvance((uint64_t)entries * HOST_NVS_ENTRY_US);
+  return(len);
+}
+
+// value of the key if it has exactly len bytes, 0: missing or of an other type
+size_t Preferences::get(const char* key, void* buf, size_t len)
+{
+  hostNamespace::iterator it;
+
+  if(!open)
+    return(0);
+  it = nvs[ns].find(key);
+  if(it == nvs[ns].end() || it->second.size() != len)
+    return(0);
+  memcpy(buf, it->second.data(), len);
+  return(len);
+}
+
+size_t Preferences::putBool(const char* key, bool value)
+{
+  uint8_t v = value ? 1 : 0;
+  return(put(key, &v, 1, false));
+}
+
+// the library stores a float as blob
+size_t Preferences::putULong(const char* key, uint32_t value) { return(put(key, &value, sizeof(value), false)); }
+size_t Preferences::putULong64(const char* key, uint64_t value) { return(put(key, &value, sizeof(value), false)); }
+size_t Preferences::putFloat(const char* key, float value) { return(put(key, &value, sizeof(value), true)); }
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) { return(put(key, value, len, true)); }
+
+bool Preferences::getBool(const char* key, bool defaultValue)
+{
+  uint8_t v;
+  return(get(key, &v, 1) ? (v != 0) : defaultValue);
+}
+
+uint32_t Preferences::getULong(const char* key, uint32_t defaultValue)
+{
+  uint32_t v;
+  return(get(key, &v, sizeof(v)) ? v : defaultValue);
+}
+
+uint64_t Preferences::getULong64(const char* key, uint64_t defaultValue)
+{
+  uint64_t v;
+  return(get(key, &v, sizeof(v)) ? v : defaultValue);
+}
+
+float Preferences::getFloat(const char* key, float defaultValue)
+{
+  float v;
+  return(get(key, &v, sizeof(v)) ? v : defaultValue);
+}
+
+size_t Preferences::getBytesLength(const char* key)
+{
+  hostNamespace::iterator it;
+
+  if(!open)
+    return(0);
+  it = nvs[ns].find(key);
+  return(it == nvs[ns].end() ? 0 : it->second.size());
+}
+
+// like the library: 0 if the value does not fit into buf
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen)
+{
+  size_t len = getBytesLength(key);
+
+  if(len == 0 || len > maxLen)
+    return(0);
+  return(get(key, buf, len));
+}
@@ -0,0 +1,98 @@
+#ifndef _hostShim_H
+#define _hostShim_H
+
+// host shim: the Arduino / ESP-IDF functions used by the firmware, implemented on Linux for the
+// native build (HOST_NATIVE). The firmware runs unchanged against a virtual clock: delay(), waits
+// on queues, light sleep and the panel refresh advance the time instead of waiting, esp_timer
+// callbacks and scripted pin changes are run at their due time. esp_deep_sleep_start() ends the
+// wake by throwing hostDeepSleep; hostWake() catches it, advances the time by the sleep and the
+// next hostWake() boots again. Variables with RTC_DATA_ATTR are kept in their own section: they
+// survive the deep sleep and are reset to their initial values by hostPowerOn(), like on the chip.
+// Other globals are not reset between wakes (on the chip every wake is a reboot): the firmware
+// modules must not depend on zero-initialized statics after the first wake.
+// NVS (Preferences) and the panel image survive hostPowerOn(), as flash and ePaper do.
+
+#include <stdint.h>
+#include <stddef.h>
+
+//************** module defines *************************/
+#define HOST_EPD_FULL_US      3600000   // busy time of a full refresh of the 4.2" SSD1683 panels
+#define HOST_EPD_PARTIAL_US   600000    // busy time of a partial refresh
+#define HOST_EPD_INIT_US      20000     // reset and controller init
+#define HOST_NVS_SET_US       100       // NVS: key lookup and compare with the stored value, per put
+#define HOST_NVS_ENTRY_US     400       // NVS: one 32 byte entry programmed, incl. its state bits
+#define HOST_WIDTH            400       // panel size
+#define HOST_HEIGHT           300
+#define HOST_MAX_PINS         64
+#define HOST_MAX_LOOPS        100       // loop() calls without deep sleep before hostWake() gives up
+
+// thrown by esp_deep_sleep_start(), caught by hostWake()
+struct hostDeepSleep
+{
+  uint64_t sleepUs;             // timer wakeup, 0: none
+};
+
+//************** module global variables *************************/
+// statistics since the start of the program
+struct hostStatistics
+{
+  uint32_t wakes;               // completed wakes (deep sleep reached)
+  uint32_t powerOns;
+  uint64_t awakeUs;             // virtual time awake, from wake to deep sleep
+  uint64_t deepSleepUs;         // virtual (world) time in deep sleep
+  uint64_t lightSleepUs;
+  uint64_t cpuNs;               // host CPU time of setup() / loop()
+  uint32_t fullRefreshes;       // panel
+  uint32_t partialRefreshes;
+  uint64_t panelBusyUs;         // panel controller busy: init and refreshes
+  uint32_t nvsWrites;           // Preferences put calls
+  uint32_t nvsBytes;
+  uint32_t nvsEntries;          // 32 byte NVS entries programmed (unchanged values are not written)
+  uint32_t timerCallbacks;      // esp_timer callbacks run
+  uint64_t radioUs;             // bluetooth on: BluetoothSerial begin() until end, disconnect or deep sleep
+};
+extern hostStatistics hostStats;
+
+// result of one wake
+struct hostWakeInfo
+{
+  bool slept;                   // deep sleep reached
+  int cause;                    // esp_sleep_wakeup_cause_t of this wake
+  uint64_t awakeUs;             // virtual time from wake to deep sleep
+  uint64_t sleepUs;             // requested timer wakeup, 0: none
+  uint64_t cpuNs;               // host CPU time
+};
+
+//************** function prototypes *************************/
+// run
+void hostPowerOn();                             // cold boot: RTC memory to initial values, clocks to 0
+bool hostWake(hostWakeInfo* info);              // boot, setup(), loop() until deep sleep, then sleep
+void hostSetBootUs(uint32_t us);                // time from wake to setup(), default 0
+
+// time
+uint64_t hostWorldUs();                         // true time since the program start
+uint64_t hostBootUs();                          // esp_timer_get_time(): time since boot, between wakes 0
+void hostAdvance(uint64_t us);                  // let time pass, running timers and pin events
+bool hostAdvanceUntil(uint64_t us, bool (*done)(void*), void* arg);   // stop early if done(arg)
+void hostSetRtcDriftPpm(int32_t ppm);           // RTC slow clock error: deep sleep lasts longer (> 0)
+
+// pins and peripherals
+void hostPress(uint8_t pin, uint64_t atWorldUs, uint32_t holdMs);     // button press at a world time
+void hostSetPin(uint8_t pin, int level);        // drive a pin from outside, -1: released
+void hostSetAnalogMv(uint8_t pin, uint32_t milliVolt);
+void hostSerialInput(const char* text);         // characters received by Serial
+void hostSerialInputAt(uint64_t atWorldUs, const char* text);   // received at a world time, lost in deep sleep
+void hostSerialEcho(bool on);                   // Serial output to stdout, default on
+void hostBtClient(const char* lines);           // lines a bluetooth client sends after the next connect, '\n' separated
+
+// storage and panel
+void hostNvsErase();                            // empty NVS, as a new chip
+void hostNvsFailAfter(int puts);                // puts after the next <puts> fail (power loss), -1: never
+bool hostPanelDump(const char* path);           // panel image as PBM file
+const uint8_t* hostPanelImage();                // 1 bit per pixel, row major, 1: black
+
+// firmware entry points
+void setup();
+void loop();
+
+#endif // _hostShim_H
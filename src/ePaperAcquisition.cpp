@@ -0,0 +1,176 @@
+/**************************************************!
+   robust acquisition of BME280 data
+   normally one conversion per measurement (the one started in setup()).
+   If the last measurement was not quiet, or the value jumped against the
+   last measurement, a burst of 3 conversions is taken, extended to 5 if
+   the spread is high. Samples are combined by median (3) or trimmed
+   mean (4, 5), which suppresses single glitches.
+***************************************************/
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "global.h"
+#include "ePaperBME280.h"
+#include "ePaperAcquisition.h"
+
+// statistics, in RTC memory which survives the deep sleep. Zero after power on
+RTC_DATA_ATTR acqStatistics acqStats;
+
+/**************************************************!
+   @brief    acqCombine()
+   @details  combine samples: 1: value, 2: mean, 3: median, 4-5: mean without min and max
+   @param    values: samples, sorted on return
+   @param    n: number of samples, 1..ACQ_MAX_SAMPLES
+   @param    spread: max - min, for 4-5 samples without min and max
+   @param    outlier: set true if a sample deviates more than outlierLimit from the median (n >= 3)
+   @param    outlierLimit: see outlier
+   @return   float: combined value
+***************************************************/
+float acqCombine(float* values, int n, float* spread, bool* outlier, float outlierLimit)
+{
+  float v, sum = 0, median;
+  int i, j;
+
+  // insertion sort, n is small
+  for(i=1; i<n; i++){
+    v = values[i];
+    for(j=i-1; j>=0 && values[j] > v; j--)
+      values[j+1] = values[j];
+    values[j+1] = v;
+  }
+  // spread without min and max if these are dropped
+  *spread = (n < 4) ? values[n-1] - values[0] : values[n-2] - values[1];
+  if(n < 3)
+    return((n == 1) ? values[0] : (values[0] + values[1]) / 2);
+
+  median = values[n/2];
+  if(values[n-1] - median > outlierLimit || median - values[0] > outlierLimit)
+    *outlier = true;
+  if(n == 3)
+    return(median);
+  for(i=1; i<n-1; i++)
+    sum += values[i];
+  return(sum / (float)(n-2));
+}
+
+/**************************************************!
+   @brief    plausible()
+   @details  range check of a converted sample, outside: I2C error or sensor fault
+***************************************************/
+static bool plausible(float p, float t, float h)
+{
+  return(p > 300.0 && p < 1100.0 && t > -40.0 && t < 85.0 && h >= 0.0 && h <= 100.0);
+}
+
+/**************************************************!
+   @brief    range()
+   @return   float: max - min of n values
+***************************************************/
+static float range(const float* values, int n)
+{
+  float vMin = values[0], vMax = values[0];
+  int i;
+
+  for(i=1; i<n; i++){
+    if(values[i] < vMin) vMin = values[i];
+    if(values[i] > vMax) vMax = values[i];
+  }
+  return(vMax - vMin);
+}
+
+/**************************************************!
+   @brief    acqMeasure()
+   @details  burst of forced conversions in one I2C session, adaptive length
+   @param    res: combined values, spread, quality
+   @param    firstStarted: true if the first conversion has already been started (setup())
+   @param    lastPressure, lastTemperature, lastHumidity: last stored values, for jump check
+   @return   bool: true if at least one valid sample
+***************************************************/
+bool acqMeasure(acqResult* res, bool firstStarted, float lastPressure, float lastTemperature, float lastHumidity)
+{
+  float p[ACQ_MAX_SAMPLES], t[ACQ_MAX_SAMPLES], h[ACQ_MAX_SAMPLES];
+  float sp, st, sh;
+  bmeReading r;
+  int attempts, target, n = 0;
+  bool outlier = false, ok;
+
+  memset(res, 0, sizeof(acqResult));
+  target = acqStats.lastQuiet ? 1 : ACQ_BURST_SAMPLES;
+  for(attempts=0; attempts<ACQ_MAX_ATTEMPTS && n<target; attempts++){
+    ok = (attempts > 0 || !firstStarted) ? bmeStartForced() : true;
+    ok = ok && bmeReadForced(&r);
+    if(ok){
+      p[n] = (float)r.pressure / 25600.0;     // Q24.8 Pa -> hPa
+      h[n] = (float)r.humidity / 1024.0;      // Q22.10 %RH
+      t[n] = (float)r.temperature / 100.0;    // 0.01 °C
+      ok = plausible(p[n], t[n], h[n]);
+    }
+    if(!ok){
+      res->failed++;
+      continue;
+    }
+    n++;
+    if(n < target) continue;
+
+    if(n == 1){
+      // single sample: burst if jump against last measurement
+      if(fabs(p[0]-lastPressure) > ACQ_JUMP_PRESS || fabs(t[0]-lastTemperature) > ACQ_JUMP_TEMP
+         || fabs(h[0]-lastHumidity) > ACQ_JUMP_HUMI)
+        target = ACQ_BURST_SAMPLES;
+    }
+    else if(target < ACQ_MAX_SAMPLES){
+      // burst: extend if spread high
+      if(range(p, n) > ACQ_SPREAD_PRESS || range(t, n) > ACQ_SPREAD_TEMP || range(h, n) > ACQ_SPREAD_HUMI){
+        target = ACQ_MAX_SAMPLES;
+        acqStats.extended++;
+      }
+    }
+  }
+
+  acqStats.measurements++;
+  acqStats.conversions += attempts;
+  acqStats.failed += res->failed;
+  res->samples = n;
+  if(res->failed > 0) res->quality |= QUAL_READ_ERROR;
+  if(n == 0){
+    res->quality |= QUAL_NO_DATA;
+    res->pressure = res->temperature = res->humidity = NAN;
+    acqStats.lastQuiet = false;
+    return(false);
+  }
+
+  res->pressure    = acqCombine(p, n, &sp, &outlier, ACQ_SPREAD_PRESS);
+  res->temperature = acqCombine(t, n, &st, &outlier, ACQ_SPREAD_TEMP);
+  res->humidity    = acqCombine(h, n, &sh, &outlier, ACQ_SPREAD_HUMI);
+  res->pressureSpread = sp;
+  res->temperatureSpread = st;
+  res->humiditySpread = sh;
+  if(n == 1) res->quality |= QUAL_SINGLE;
+  if(outlier){
+    res->quality |= QUAL_OUTLIER;
+    acqStats.outliers++;
+  }
+  if(sp > ACQ_SPREAD_PRESS || st > ACQ_SPREAD_TEMP || sh > ACQ_SPREAD_HUMI)
+    res->quality |= QUAL_SPREAD;
+  // next measurement starts with a single conversion only if this one was clean
+  acqStats.lastQuiet = !(res->quality & (QUAL_SPREAD | QUAL_READ_ERROR | QUAL_OUTLIER));
+  return(true);
+}
+
+/**************************************************!
+   @brief    acqReport()
+   @details  output of acquisition statistics
+   @param    printLine : function to output one line of text (serial, bluetooth)
+   @return   void
+***************************************************/
+void acqReport(void (*printLine)(char*))
+{
+  char line[maxLOG_STRING_LEN];
+
+  snprintf(line, sizeof(line), "Acquisition: %lu measurements, %3.2f conversions each, %lu extended, %lu failed, %lu outliers",
+    (unsigned long)acqStats.measurements,
+    acqStats.measurements > 0 ? (float)acqStats.conversions / (float)acqStats.measurements : 0.0,
+    (unsigned long)acqStats.extended, (unsigned long)acqStats.failed, (unsigned long)acqStats.outliers);
+  printLine(line);
+}
@@ -0,0 +1,63 @@
+#ifndef _ePaperAcquisition_H
+#define _ePaperAcquisition_H
+
+// robust acquisition: a short burst of forced BME280 conversions per measurement,
+// combined by median / trimmed mean, with spread and a quality flag per stored sample.
+// The burst is extended only if the spread is high or the first value is implausible.
+
+#include <stdint.h>
+
+//************** module defines *************************/
+#define ACQ_MAX_SAMPLES     5       // max. conversions per measurement
+#define ACQ_BURST_SAMPLES   3       // burst length if last measurement was not quiet
+#define ACQ_MAX_ATTEMPTS    7       // max. conversions incl. failed ones
+
+// spread (max - min) above which the burst is extended to ACQ_MAX_SAMPLES
+#define ACQ_SPREAD_PRESS    0.10    // hPa
+#define ACQ_SPREAD_TEMP     0.10    // °C
+#define ACQ_SPREAD_HUMI     1.0     // %
+// single sample: max. change vs. last measurement, otherwise burst
+#define ACQ_JUMP_PRESS      1.0     // hPa
+#define ACQ_JUMP_TEMP       2.0     // °C
+#define ACQ_JUMP_HUMI       10.0    // %
+
+// quality flags of a measurement, stored per sample in wData.qualHistory
+#define QUAL_OK             0x00
+#define QUAL_SPREAD         0x01    // spread high even with full burst
+#define QUAL_READ_ERROR     0x02    // at least one conversion failed (I2C error, implausible raw value)
+#define QUAL_OUTLIER        0x04    // a sample deviated from the median and was suppressed
+#define QUAL_SINGLE         0x08    // only one valid sample, not checked against others
+#define QUAL_NO_DATA        0x80    // no valid sample
+
+//************** module global variables *************************/
+struct acqResult
+{
+  float pressure;           // hPa, raw
+  float temperature;        // °C
+  float humidity;           // %
+  float pressureSpread;     // max - min of the valid samples (without min, max if 4-5 samples)
+  float temperatureSpread;
+  float humiditySpread;
+  uint8_t samples;          // valid samples
+  uint8_t failed;           // failed conversions
+  uint8_t quality;          // QUAL_xxx
+};
+
+// statistics, stored in RTC memory
+struct acqStatistics
+{
+  bool lastQuiet;           // last measurement had low spread: next starts with a single conversion
+  uint32_t measurements;    // since cold boot
+  uint32_t conversions;
+  uint32_t extended;        // bursts extended to ACQ_MAX_SAMPLES
+  uint32_t failed;          // failed conversions
+  uint32_t outliers;        // measurements with suppressed outlier
+};
+extern acqStatistics acqStats;
+
+//************** function prototypes *************************/
+bool acqMeasure(acqResult* res, bool firstStarted, float lastPressure, float lastTemperature, float lastHumidity);
+float acqCombine(float* values, int n, float* spread, bool* outlier, float outlierLimit);
+void acqReport(void (*printLine)(char*));
+
+#endif // _ePaperAcquisition_H
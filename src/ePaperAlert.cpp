@@ -0,0 +1,442 @@
+/**************************************************!
+   Alert rule engine
+   alertEvaluate() runs once per new sample, after the history arrays have been shifted.
+   Each window keeps the index of its oldest sample and the sums of the valid samples in it.
+   The shift moves all samples one index down: the window follows by oldest--, the newest
+   sample is added, and samples older than the window are subtracted while the oldest index
+   moves up. Each sample is added and subtracted once per window: O(1) per sample on average.
+   The windows are built again from the history (O(n)) after cold boot and when the
+   measurement interval has changed, since the time scale functions rearrange the history.
+   A rule becomes active when its statistic reaches the threshold, and clears when it falls
+   below threshold - hysteresis. An active rule sounds at activation and again every cooldown,
+   until it is acknowledged (button press or "ATA,ACK") or clears.
+***************************************************/
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "global.h"
+#include "ePaperAlert.h"
+#include "ePaperCommand.h"
+#include "ePaperTrace.h"
+
+// alert data, in RTC memory which survives the deep sleep. Zero after power on
+RTC_DATA_ATTR alertData aData;
+
+static const uint8_t windowHours[ALERT_NUM_WINDOWS] = ALERT_WINDOW_HOURS;
+static const alertRule defaultRules[ALERT_MAX_RULES] = ALERT_DEFAULT_RULES;
+static const char channelLetters[] = "PTH";
+static const char kindLetters[] = "FRBA";
+static const char* kindNames[ALERT_NUM_KINDS] = { "fall", "rise", "below", "above" };
+
+// parsed "ATA" argument
+#define ALERT_OP_ACK      0     // "ACK"
+#define ALERT_OP_ON       1     // "<n>,ON"
+#define ALERT_OP_OFF      2     // "<n>,OFF"
+#define ALERT_OP_SET      3     // "<n>,<channel><kind>,<hours>,<threshold>,<hysteresis>,<cooldown>"
+#define ALERT_MAX_FIELDS  6
+
+/**************************************************!
+   @brief    alertInit()
+   @details  initialize after cold boot: default rules, windows not built
+***************************************************/
+static void alertInit()
+{
+  int i;
+
+  if(aData.magic == ALERT_MAGIC)
+    return;
+  memset(&aData, 0, sizeof(aData));
+  aData.magic = ALERT_MAGIC;
+  for(i=0; i<ALERT_NUM_WINDOWS; i++)
+    aData.win[i].oldest = -1;
+  for(i=0; i<ALERT_MAX_RULES; i++)
+    aData.state[i].lastSoundSec = ALERT_NO_SOUND_SEC;
+  memcpy(aData.rules, defaultRules, sizeof(aData.rules));
+}
+
+// forget the state of a rule, e.g. after it has been changed
+static void alertResetState(int r)
+{
+  aData.state[r].active = 0;
+  aData.state[r].acked = 0;
+  aData.state[r].lastSoundSec = ALERT_NO_SOUND_SEC;
+  aData.state[r].value = 0;
+}
+
+// history point i has valid values (not nanDATA after a time scale change)
+static inline bool alertValid(int i)
+{
+  return(wData.pressHistory[i] < nanDATA/4 && wData.tempHistory[i] < nanDATA/4 && wData.humiHistory[i] < nanDATA/4);
+}
+
+// value of history point i in 0.01 units: Pa, 0.01 °C, 0.01 %
+static int32_t alertSample(int c, int i)
+{
+  switch(c){
+    case ALERT_CH_PRESSURE:     return(lroundf(wData.pressHistory[i] * 100.0));
+    case ALERT_CH_TEMPERATURE:  return(lroundf(wData.tempHistory[i] * 100.0));
+    default:                    return((int32_t)wData.humiHistory[i] * 10);   // promille
+  }
+}
+
+// add (sign 1) or subtract (sign -1) history point i to / from the sums of a window
+static void alertWindowAdd(alertWindow* w, int i, int sign)
+{
+  int c;
+
+  if(!alertValid(i))
+    return;
+  for(c=0; c<ALERT_NUM_CHANNELS; c++)
+    w->sum[c] += sign * alertSample(c, i);
+  w->count += sign;
+}
+
+// max. age of a sample in window w, half an interval tolerance for the sleep time jitter
+static int32_t alertWindowLimit(int w)
+{
+  return((int32_t)windowHours[w] * 3600 + wData.targetMeasurementIntervalSec / 2);
+}
+
+// move the oldest index up while its sample is too old or not valid, subtract the valid ones
+static void alertWindowTrim(alertWindow* w, int32_t limit)
+{
+  while(w->oldest < noDataPoints-1 && (wData.ageOfDatapoint[w->oldest] > limit || !alertValid(w->oldest))){
+    alertWindowAdd(w, w->oldest, -1);
+    w->oldest++;
+  }
+}
+
+/**************************************************!
+   @brief    alertWindowBuild()
+   @details  sums of window w from the history, O(n)
+   @param    w: window index
+   @return   void
+***************************************************/
+static void alertWindowBuild(int w)
+{
+  alertWindow* win = &aData.win[w];
+  int32_t limit = alertWindowLimit(w);
+  int i;
+
+  memset(win, 0, sizeof(alertWindow));
+  for(i=noDataPoints-1; i>0 && wData.ageOfDatapoint[i-1] <= limit; i--);
+  win->oldest = i;
+  for(; i<noDataPoints; i++)
+    alertWindowAdd(win, i, 1);
+  alertWindowTrim(win, limit);
+}
+
+/**************************************************!
+   @brief    alertWindowUpdate()
+   @details  follow the shift of the history by one sample, O(1) on average
+   @param    w: window index
+   @return   void
+***************************************************/
+static void alertWindowUpdate(int w)
+{
+  alertWindow* win = &aData.win[w];
+
+  if(win->oldest <= 0){       // not built, or the oldest sample has been shifted out of the history
+    alertWindowBuild(w);
+    return;
+  }
+  win->oldest--;
+  alertWindowAdd(win, noDataPoints-1, 1);
+  alertWindowTrim(win, alertWindowLimit(w));
+}
+
+/**************************************************!
+   @brief    alertStatistic()
+   @details  statistic of a rule from its window, oriented such that larger is worse:
+   @details  fall: start - now, rise: now - start, above: mean, below: -mean
+   @param    r: rule
+   @param    value: statistic in 0.01 units
+   @return   bool: false if the window has no valid sample
+***************************************************/
+static bool alertStatistic(const alertRule* r, int32_t* value)
+{
+  const alertWindow* win = &aData.win[r->window];
+  int32_t mean;
+
+  if(win->count == 0 || !alertValid(noDataPoints-1))
+    return(false);
+  switch(r->kind){
+    case ALERT_FALL:
+      *value = alertSample(r->channel, win->oldest) - alertSample(r->channel, noDataPoints-1);
+      break;
+    case ALERT_RISE:
+      *value = alertSample(r->channel, noDataPoints-1) - alertSample(r->channel, win->oldest);
+      break;
+    default:
+      mean = lroundf((float)win->sum[r->channel] / win->count);
+      if(r->channel == ALERT_CH_PRESSURE && wData.applyPressureCorrection)
+        mean += lroundf(wData.pressureCorrValue * 100.0);   // level as displayed
+      *value = (r->kind == ALERT_ABOVE) ? mean : -mean;
+      break;
+  }
+  return(true);
+}
+
+// statistic as shown: mean for below (stored negated)
+static float alertShownValue(const alertRule* r, int32_t value)
+{
+  return((r->kind == ALERT_BELOW ? -value : value) / 100.0);
+}
+
+/**************************************************!
+   @brief    alertEvaluate()
+   @details  update the windows with the newest sample and evaluate all rules.
+   @details  Called once per sample, after storeMeasurementData()
+   @return   bool: true if an alert is to be sounded
+***************************************************/
+bool alertEvaluate()
+{
+  const alertRule* r;
+  alertState* s;
+  int32_t value, threshold;
+  bool sound = false;
+  int i;
+
+  alertInit();
+  aData.clockSec += wData.ageOfDatapoint[noDataPoints-2];   // interval of the shift
+  if(aData.intervalSec != wData.targetMeasurementIntervalSec){
+    for(i=0; i<ALERT_NUM_WINDOWS; i++)
+      aData.win[i].oldest = -1;
+    aData.intervalSec = wData.targetMeasurementIntervalSec;
+  }
+  for(i=0; i<ALERT_NUM_WINDOWS; i++)
+    alertWindowUpdate(i);
+
+  for(i=0; i<ALERT_MAX_RULES; i++){
+    r = &aData.rules[i];
+    s = &aData.state[i];
+    if(!r->enabled || !alertStatistic(r, &value))
+      continue;
+    s->value = value;
+    threshold = (int32_t)r->threshold * 10;
+    if(r->kind == ALERT_BELOW)
+      threshold = -threshold;
+
+    if(!s->active && value >= threshold){
+      s->active = 1;
+      s->acked = 0;
+      trace(TR_ALERT, i+1, value / 10);
+      logOut<2>("Alert rule %d active: %c %s %3.2f", i+1, channelLetters[r->channel], kindNames[r->kind], alertShownValue(r, value));
+    }
+    else if(s->active && value < threshold - (int32_t)r->hysteresis * 10){
+      s->active = 0;                        // lastSoundSec is kept: cooldown against a quick reactivation
+      s->acked = 0;
+      trace(TR_ALERT_CLEAR, i+1, value / 10);
+      logOut<2>("Alert rule %d cleared: %3.2f", i+1, alertShownValue(r, value));
+    }
+
+    if(s->active && !s->acked
+       && (s->lastSoundSec == ALERT_NO_SOUND_SEC || aData.clockSec - s->lastSoundSec >= (uint32_t)r->cooldownMin * 60)){
+      s->lastSoundSec = aData.clockSec;
+      sound = true;
+    }
+  }
+  if(sound)
+    aData.sounds++;
+  return(sound);
+}
+
+// number of active rules
+int alertActive()
+{
+  int i, n = 0;
+
+  alertInit();
+  for(i=0; i<ALERT_MAX_RULES; i++)
+    if(aData.rules[i].enabled && aData.state[i].active)
+      n++;
+  return(n);
+}
+
+/**************************************************!
+   @brief    alertAcknowledge()
+   @details  silence all active rules until they clear
+   @return   void
+***************************************************/
+void alertAcknowledge()
+{
+  int i;
+
+  alertInit();
+  for(i=0; i<ALERT_MAX_RULES; i++){
+    if(aData.state[i].active && !aData.state[i].acked){
+      aData.state[i].acked = 1;
+      logOut<2>("Alert rule %d acknowledged", i+1);
+    }
+  }
+}
+
+// take the rules from the settings. The state of the rules is kept
+void alertSetRules(const alertRule* rules)
+{
+  alertInit();
+  memcpy(aData.rules, rules, sizeof(aData.rules));
+}
+
+// copy of the rules for the settings
+void alertGetRules(alertRule* rules)
+{
+  alertInit();
+  memcpy(rules, aData.rules, sizeof(aData.rules));
+}
+
+void alertDefaultRules(alertRule* rules)
+{
+  memcpy(rules, defaultRules, sizeof(defaultRules));
+}
+
+/**************************************************!
+   @brief    alertParseNumber()
+   @details  one field as number, the whole field must be used
+   @param    text: field
+   @param    v: value
+   @return   bool: false if not a number
+***************************************************/
+static bool alertParseNumber(const char* text, float* v)
+{
+  char* end;
+
+  if(*text == 0)
+    return(false);
+  *v = strtof(text, &end);
+  return(*end == 0 && !isnan(*v));
+}
+
+/**************************************************!
+   @brief    alertParse()
+   @details  parse the argument of "ATA" (upper case), e.g. "ACK", "2,OFF", "3,PF,1,1.5,0.3,60"
+   @param    text: argument text
+   @param    index: rule index 0 .. ALERT_MAX_RULES-1
+   @param    rule: new rule for ALERT_OP_SET
+   @return   int: ALERT_OP_xxx, -1 if invalid
+***************************************************/
+static int alertParse(const char* text, int* index, alertRule* rule)
+{
+  char buf[CMD_MAX_LEN];
+  char* field[ALERT_MAX_FIELDS];
+  char* p;
+  const char *c, *k;
+  float v[4];
+  int i, n = 0, w;
+
+  snprintf(buf, sizeof(buf), "%s", text);
+  field[n++] = buf;
+  for(p = buf; (p = strchr(p, ',')) != NULL; ){
+    if(n >= ALERT_MAX_FIELDS)
+      return(-1);
+    *p++ = 0;
+    field[n++] = p;
+  }
+  if(n == 1 && strcmp(field[0], "ACK") == 0)
+    return(ALERT_OP_ACK);
+  if(n < 2 || !alertParseNumber(field[0], &v[0]) || v[0] != (int)v[0] || v[0] < 1 || v[0] > ALERT_MAX_RULES)
+    return(-1);
+  *index = (int)v[0] - 1;
+  if(n == 2 && strcmp(field[1], "ON") == 0)
+    return(ALERT_OP_ON);
+  if(n == 2 && strcmp(field[1], "OFF") == 0)
+    return(ALERT_OP_OFF);
+  if(n != ALERT_MAX_FIELDS || strlen(field[1]) != 2)
+    return(-1);
+  c = strchr(channelLetters, field[1][0]);
+  k = strchr(kindLetters, field[1][1]);
+  if(c == NULL || k == NULL)
+    return(-1);
+  for(i=0; i<4; i++)
+    if(!alertParseNumber(field[i+2], &v[i]))
+      return(-1);
+  for(w=0; w<ALERT_NUM_WINDOWS && windowHours[w] != v[0]; w++);
+  if(w == ALERT_NUM_WINDOWS)
+    return(-1);
+  rule->enabled = 1;
+  rule->channel = c - channelLetters;
+  rule->kind = k - kindLetters;
+  rule->window = w;
+  if((rule->kind == ALERT_FALL || rule->kind == ALERT_RISE) && w == 0)   // a change needs a time span
+    return(-1);
+  if(v[1] < -3000 || v[1] > 3000 || v[2] < 0 || v[2] > 1000 || v[3] < 0 || v[3] > 1440 || v[3] != (int)v[3])
+    return(-1);
+  rule->threshold = (int16_t)lroundf(v[1] * 10.0);
+  rule->hysteresis = (uint16_t)lroundf(v[2] * 10.0);
+  rule->cooldownMin = (uint16_t)v[3];
+  return(ALERT_OP_SET);
+}
+
+// check the argument of "ATA" before the batch runs
+bool alertCommandValid(const char* text)
+{
+  alertRule rule;
+  int index;
+
+  return(alertParse(text, &index, &rule) >= 0);
+}
+
+/**************************************************!
+   @brief    alertCommand()
+   @details  execute the argument of "ATA": acknowledge, enable / disable or set a rule.
+   @details  The state of a changed rule starts again
+   @param    text: argument text, checked by alertCommandValid()
+   @return   bool: true if a rule has been changed (settings to be saved)
+***************************************************/
+bool alertCommand(const char* text)
+{
+  alertRule rule;
+  int index;
+
+  alertInit();
+  switch(alertParse(text, &index, &rule)){
+    case ALERT_OP_ACK:
+      alertAcknowledge();
+      return(false);
+    case ALERT_OP_ON:
+      aData.rules[index].enabled = 1;
+      break;
+    case ALERT_OP_OFF:
+      aData.rules[index].enabled = 0;
+      break;
+    case ALERT_OP_SET:
+      aData.rules[index] = rule;
+      break;
+    default:
+      return(false);
+  }
+  alertResetState(index);
+  return(true);
+}
+
+/**************************************************!
+   @brief    alertReport()
+   @details  rules and their state
+   @param    printLine : function to output one line of text (serial, bluetooth)
+   @return   void
+***************************************************/
+void alertReport(void (*printLine)(char*))
+{
+  char line[maxLOG_STRING_LEN];
+  const alertRule* r;
+  const alertState* s;
+  int i;
+
+  alertInit();
+  snprintf(line, sizeof(line), "Alerts: %d active, %lu sounded, window samples 1h/3h/6h: %d/%d/%d",
+    alertActive(), (unsigned long)aData.sounds, aData.win[1].count, aData.win[2].count, aData.win[3].count);
+  printLine(line);
+  for(i=0; i<ALERT_MAX_RULES; i++){
+    r = &aData.rules[i];
+    s = &aData.state[i];
+    snprintf(line, sizeof(line), "%d %-3s %c%c %-5s %dh %5.1f hyst %3.1f cool %d min: %6.2f%s%s",
+      i+1, r->enabled ? "on" : "off", channelLetters[r->channel], kindLetters[r->kind], kindNames[r->kind],
+      windowHours[r->window], r->threshold / 10.0, r->hysteresis / 10.0, r->cooldownMin,
+      alertShownValue(r, s->value), s->active ? " ACTIVE" : "", s->acked ? " ack" : "");
+    printLine(line);
+  }
+  snprintf(line, sizeof(line), "ATA,<n>,<P|T|H><F|R|B|A>,<0|1|3|6 h>,<thr>,<hyst>,<cool min> | ATA,<n>,ON|OFF | ATA,ACK");
+  printLine(line);
+}
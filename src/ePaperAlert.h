@@ -0,0 +1,102 @@
+#ifndef _ePaperAlert_H
+#define _ePaperAlert_H
+
+// alert rules: evaluated once per new sample, right after storeMeasurementData(), not while
+// drawing. A rule compares a statistic of one channel (pressure, temperature, humidity) over
+// a time window with a threshold: change over the window (fall, rise) or window mean (below,
+// above). The windows (1 h, 3 h, 6 h) are kept as running sums over the history arrays: per
+// sample the new point is added and the points that left the window are subtracted, so a
+// rule costs O(1) per sample. Hysteresis, cooldown and acknowledge state are kept in RTC
+// memory, the rules themselves are part of the settings blob (NVS).
+
+#include <stdint.h>
+
+//************** module defines *************************/
+#define ALERT_MAX_RULES       6
+#define ALERT_MAGIC           0x414C5254  // "ALRT", marks initialized RTC alert data
+#define ALERT_NO_SOUND_SEC    0xFFFFFFFF  // lastSoundSec: never sounded
+
+// channels
+#define ALERT_CH_PRESSURE     0       // hPa, corrected if pressure correction is on
+#define ALERT_CH_TEMPERATURE  1       // °C
+#define ALERT_CH_HUMIDITY     2       // %
+#define ALERT_NUM_CHANNELS    3
+
+// kinds of rules
+#define ALERT_FALL            0       // value at window start - now >= threshold
+#define ALERT_RISE            1       // now - value at window start >= threshold
+#define ALERT_BELOW           2       // window mean <= threshold
+#define ALERT_ABOVE           3       // window mean >= threshold
+#define ALERT_NUM_KINDS       4
+
+// windows: 0 is the newest sample only
+#define ALERT_WINDOW_HOURS    { 0, 1, 3, 6 }
+#define ALERT_NUM_WINDOWS     4
+
+// default rules: pressure fall / rise over 3 h as the former fixed 3 hPa alert, the others disabled.
+// enabled, channel, kind, window, threshold, hysteresis (0.1 units), cooldown minutes
+#define ALERT_DEFAULT_RULES { \
+  { 1, ALERT_CH_PRESSURE,    ALERT_FALL,  2,  30,  5, 180 }, \
+  { 1, ALERT_CH_PRESSURE,    ALERT_RISE,  2,  30,  5, 180 }, \
+  { 0, ALERT_CH_PRESSURE,    ALERT_FALL,  1,  15,  3,  60 }, \
+  { 0, ALERT_CH_PRESSURE,    ALERT_FALL,  3,  60, 10, 360 }, \
+  { 0, ALERT_CH_TEMPERATURE, ALERT_BELOW, 0,  10,  5, 360 }, \
+  { 0, ALERT_CH_HUMIDITY,    ALERT_ABOVE, 1, 800, 50, 360 }, \
+}
+
+//************** module global variables *************************/
+// one rule, part of the settings blob
+struct alertRule
+{
+  uint8_t enabled;
+  uint8_t channel;              // ALERT_CH_xxx
+  uint8_t kind;                 // ALERT_FALL ... ALERT_ABOVE
+  uint8_t window;               // index in ALERT_WINDOW_HOURS
+  int16_t threshold;            // 0.1 units of the channel
+  uint16_t hysteresis;          // 0.1 units: the rule clears at threshold - hysteresis
+  uint16_t cooldownMin;         // min. time between two sounds of an active rule. 0: every sample
+};
+
+// running sums of one window over the history arrays. Values in 0.01 units as integers:
+// samples are added and subtracted exactly, no drift of the sums
+struct alertWindow
+{
+  int16_t oldest;               // index of the oldest valid sample in the window, -1: not built
+  uint16_t count;               // valid samples in the sums
+  int32_t sum[ALERT_NUM_CHANNELS];
+};
+
+// state of one rule
+struct alertState
+{
+  uint8_t active;               // threshold crossed, not yet cleared
+  uint8_t acked;                // acknowledged by a button press or "ATA,ACK" while active
+  uint32_t lastSoundSec;        // alert clock at the last sound, ALERT_NO_SOUND_SEC: none
+  int32_t value;                // statistic at the last evaluation, 0.01 units
+};
+
+// alert data, stored in RTC memory which survives deep sleep
+struct alertData
+{
+  uint32_t magic;               // ALERT_MAGIC if initialized
+  uint32_t clockSec;            // sum of the sample intervals since cold boot, time base of the cooldown
+  int32_t intervalSec;          // measurement interval the windows were built with
+  alertWindow win[ALERT_NUM_WINDOWS];
+  alertState state[ALERT_MAX_RULES];
+  alertRule rules[ALERT_MAX_RULES];   // working copy of the rules, from / to the settings blob
+  uint32_t sounds;              // alerts sounded since cold boot
+};
+extern alertData aData;
+
+//************** function prototypes *************************/
+void alertSetRules(const alertRule* rules);   // take the rules from the settings
+void alertGetRules(alertRule* rules);         // copy of the rules for the settings
+void alertDefaultRules(alertRule* rules);
+bool alertEvaluate();                         // after storeMeasurementData(): true if an alert is to be sounded
+int alertActive();                            // number of active rules
+void alertAcknowledge();                      // silence all active rules until they clear
+bool alertCommandValid(const char* text);     // check "ATA" argument
+bool alertCommand(const char* text);          // execute "ATA" argument: true if a rule has been changed
+void alertReport(void (*printLine)(char*));
+
+#endif // _ePaperAlert_H
@@ -3,218 +3,337 @@
 // only for CrowPanel
 #ifdef CROW_PANEL
 
-
-// ESP32 Web Bluetooth (BLE)
-// https://randomnerdtutorials.com/esp32-web-bluetooth/
-
+// GATT service with one characteristic per setting, current readings and history,
+// see ePaperBLE.h. NimBLE-Arduino 2.x.
+// https://github.com/h2zero/NimBLE-Arduino/blob/master/docs/Migration_guide.md
 
 #include <Arduino.h>
-/*
-#include <BLEDevice.h>
-#include <BLEServer.h>
-#include <BLEUtils.h>
-#include <BLE2902.h>
-*/
-// https://github.com/h2zero/NimBLE-Arduino/blob/master/docs/Migration_guide.md
 #include "NimBLEDevice.h"
 
 #include "global.h"
 #include "ePaperBLE.h"
+#include "ePaperCommand.h"
+#include "ePaperProfiler.h"
+#include "ePaperTrace.h"
+#include "ePaperBuzzer.h"
+
+#define SERVICE_UUID                "19b10000-e8f2-537e-4f6c-d104768a1214"
+#define COMMAND_CHARACTERISTIC_UUID "19b10003-e8f2-537e-4f6c-d104768a1214"
+#define GRAPHTYPE_UUID              "19b10010-e8f2-537e-4f6c-d104768a1214"
+#define INVERSION_UUID              "19b10011-e8f2-537e-4f6c-d104768a1214"
+#define CORRECTION_UUID             "19b10012-e8f2-537e-4f6c-d104768a1214"
+#define INTERVAL_UUID               "19b10013-e8f2-537e-4f6c-d104768a1214"
+#define TIMERANGE_UUID              "19b10014-e8f2-537e-4f6c-d104768a1214"
+#define READINGS_UUID               "19b10020-e8f2-537e-4f6c-d104768a1214"
+#define HISTORY_UUID                "19b10021-e8f2-537e-4f6c-d104768a1214"
+
+#define SETTING_PROPERTIES (NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::NOTIFY)
+
+static NimBLEServer* pServer = NULL;
+static NimBLEService* pService = NULL;
+static NimBLECharacteristic* pCommandChar = NULL;
+static NimBLECharacteristic* pGraphTypeChar = NULL;
+static NimBLECharacteristic* pInversionChar = NULL;
+static NimBLECharacteristic* pCorrectionChar = NULL;
+static NimBLECharacteristic* pIntervalChar = NULL;
+static NimBLECharacteristic* pTimeRangeChar = NULL;
+static NimBLECharacteristic* pReadingsChar = NULL;
+static NimBLECharacteristic* pHistoryChar = NULL;
+
+static volatile uint16_t bleMtu = 23;   // negotiated ATT MTU, 23 until exchanged
+
+// graph type -> command letter, '-' if no graph type
+static const char graphCommand[] = "PTH-LMNOG";
+
+//************** callbacks, run in the NimBLE host task *************************/
+
+class ServerCallbacks : public NimBLEServerCallbacks {
+  void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) override {
+    // short connection interval (7.5..15 ms) while configuring, 2M PHY and long
+    // link layer packets: the history needs a few connection events only
+    pServer->updateConnParams(connInfo.getConnHandle(), 6, 12, 0, 200);
+    pServer->updatePhy(connInfo.getConnHandle(), BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK, 0);
+    pServer->setDataLen(connInfo.getConnHandle(), 251);
+    logOut<2>("BLE connected, MTU %d", connInfo.getMTU());
+  }
 
-#define bleTEST
-#ifdef bleTEST
-
-NimBLEServer* pServer = NULL;
-NimBLECharacteristic* pSensorCharacteristic = NULL;
-NimBLECharacteristic* pLedCharacteristic = NULL;
-bool deviceConnected = false;
-bool oldDeviceConnected = false;
-uint32_t value = 0;
-
-NimBLEService *pService;
+  void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) override {
+    logOut<2>("BLE disconnected, reason %d", reason);
+    bleMtu = 23;
+    cmdPostEvent(BLE_EVENT_DISCONNECT);
+  }
 
-uint32_t actTime, startTime;  
+  void onMTUChange(uint16_t MTU, NimBLEConnInfo& connInfo) override {
+    bleMtu = MTU;
+  }
+};
 
-// See the following for generating UUIDs:
-// https://www.uuidgenerator.net/
-#define SERVICE_UUID        "19b10000-e8f2-537e-4f6c-d104768a1214"
-#define SENSOR_CHARACTERISTIC_UUID "19b10001-e8f2-537e-4f6c-d104768a1214"
-#define LED_CHARACTERISTIC_UUID "19b10002-e8f2-537e-4f6c-d104768a1214"
+// command line written: queue it for bleConfigMain (must not block)
+class CommandCallbacks : public NimBLECharacteristicCallbacks {
+  void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+    NimBLEAttValue value = pCharacteristic->getValue();
 
-class MyServerCallbacks: public NimBLEServerCallbacks {
-  void onConnect(NimBLEServer* pServer) {
-    deviceConnected = true;
-  };
+    cmdPost((const char*)value.data(), value.length());
+  }
+};
 
-  void onDisconnect(NimBLEServer* pServer) {
-    deviceConnected = false;
+// setting written: translate into AT command(s) and queue them
+class SettingCallbacks : public NimBLECharacteristicCallbacks {
+  void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+    NimBLEAttValue value = pCharacteristic->getValue();
+    const uint8_t* d = value.data();
+    size_t len = value.length();
+    char line[CMD_MAX_LEN];
+    int n = 0;
+
+    if(pCharacteristic == pGraphTypeChar && len == 1 && d[0] < sizeof(graphCommand) - 1 && graphCommand[d[0]] != '-')
+      n = snprintf(line, sizeof(line), "AT%c", graphCommand[d[0]]);
+    else if(pCharacteristic == pInversionChar && len == 1)
+      n = snprintf(line, sizeof(line), "ATI,%d", d[0] ? 1 : 0);
+    else if(pCharacteristic == pCorrectionChar && len == 3)
+      n = snprintf(line, sizeof(line), "ATC,%d;ATD,%.1f", d[0] ? 1 : 0, (int16_t)(d[1] | (d[2] << 8)) / 10.0);
+    else if(pCharacteristic == pIntervalChar && len == 2)
+      n = snprintf(line, sizeof(line), "ATS,%ld", (long)(d[0] | (d[1] << 8)) * noDataPoints / 3600);
+    else if(pCharacteristic == pTimeRangeChar && len == 1)
+      n = snprintf(line, sizeof(line), "ATS,%d", d[0]);
+    if(n > 0)
+      cmdPost(line, n);   // invalid values are rejected by ePaperCommand, value is restored
+    else
+      cmdPostEvent(BLE_EVENT_RESTORE);   // wrong length or no graph type: restore value
   }
 };
 
-class MyCharacteristicCallbacks : public NimBLECharacteristicCallbacks {
-  void onWrite(NimBLECharacteristic* pLedCharacteristic) {
-    //String value = pLedCharacteristic->getValue();
-    std::string value = pLedCharacteristic->getValue();
-    if (value.length() > 0) {
-      Serial.print("Characteristic event, written: ");
-      Serial.println(static_cast<int>(value[0])); // Print the integer value
-
-      int receivedValue = static_cast<int>(value[0]);
-      if (receivedValue == 1) {
-        //digitalWrite(ledPin, HIGH);
-        Serial.println("LED on, timer reset");
-        startTime = millis();
-      } else {
-        //digitalWrite(ledPin, LOW);
-        Serial.println("LED off, timer reset");
-        startTime = millis();
-      }
-    }
+// history subscribed: send it from the session loop
+class HistoryCallbacks : public NimBLECharacteristicCallbacks {
+  void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) override {
+    if(subValue & 1)      // notifications enabled
+      cmdPostEvent(BLE_EVENT_HISTORY);
   }
 };
 
-void bleSetup() {
-  //Serial.begin(115200);
-  // pinMode(ledPin, OUTPUT);
+static ServerCallbacks serverCallbacks;
+static CommandCallbacks commandCallbacks;
+static SettingCallbacks settingCallbacks;
+static HistoryCallbacks historyCallbacks;
+
+//************** session loop *************************/
+/**************************************************!
+   @brief    bleNotify()
+   @details  notify, retry while the NimBLE buffers are full
+   @param    c: characteristic
+   @param    data, len: value
+   @return   bool: true if sent
+***************************************************/
+static bool bleNotify(NimBLECharacteristic* c, const uint8_t* data, size_t len)
+{
+  int tries;
 
-  Serial.printf("bleSetup started\n");
-  Serial.printf("Free Heap: %ld Max Alloc: %ld\n",ESP.getFreeHeap(), ESP.getMaxAllocHeap());
-  // Create the NimBLE Device
-  NimBLEDevice::init("ESP32");
+  for(tries=0; tries<20; tries++){
+    if(c->notify(data, len))
+      return(true);
+    delay(5);
+  }
+  return(false);
+}
 
-  // Create the NimBLE Server
-  pServer = NimBLEDevice::createServer();
-  pServer->setCallbacks(new MyServerCallbacks());
+// reply to a command: notified via the command characteristic
+static void bleReplyLine(char* line)
+{
+  logOut<2>("%s", line);
+  bleNotify(pCommandChar, (const uint8_t*)line, strlen(line));
+}
+
+/**************************************************!
+   @brief    bleUpdateValues()
+   @details  set the values of the settings and readings characteristics from wData
+   @param    notify: notify subscribed clients
+   @return   void
+***************************************************/
+static void bleUpdateValues(bool notify)
+{
+  uint8_t graphType = (uint8_t)wData.graphicsType;
+  uint8_t inversion = wData.applyInversion ? 1 : 0;
+  int16_t corr = (int16_t)lroundf(wData.pressureCorrValue * 10.0);
+  uint8_t correction[3] = { (uint8_t)(wData.applyPressureCorrection ? 1 : 0), (uint8_t)(corr & 0xFF), (uint8_t)(corr >> 8) };
+  uint16_t interval = (uint16_t)wData.targetMeasurementIntervalSec;
+  uint8_t timeRange = (uint8_t)(wData.targetMeasurementIntervalSec * noDataPoints / 3600);
+  bleReadings r;
+
+  r.pressureCorr = (uint32_t)lroundf(wData.actPressureCorr * 100.0);
+  r.pressureRaw = (uint32_t)lroundf(wData.actPressureRaw * 100.0);
+  r.temperature = (int16_t)lroundf(wData.actTemperature * 100.0);
+  r.humidity = (uint16_t)wData.actHumidity;
+  r.batteryMv = (uint16_t)lroundf(wData.batteryVoltage * 1000.0);
+  r.batteryPercent = (uint8_t)constrain(lroundf(wData.batteryPercent), 0, 100);
+  r.quality = wData.actQuality;
+  r.intervalSec = interval;
+
+  pGraphTypeChar->setValue(&graphType, 1);
+  pInversionChar->setValue(&inversion, 1);
+  pCorrectionChar->setValue(correction, sizeof(correction));
+  pIntervalChar->setValue((const uint8_t*)&interval, sizeof(interval));
+  pTimeRangeChar->setValue(&timeRange, 1);
+  pReadingsChar->setValue((const uint8_t*)&r, sizeof(r));
+  if(notify){
+    pGraphTypeChar->notify();
+    pInversionChar->notify();
+    pCorrectionChar->notify();
+    pIntervalChar->notify();
+    pTimeRangeChar->notify();
+  }
+}
 
-  // Create the NimBLE Service
-  //NimBLEService *pService = pServer->createService(SERVICE_UUID);
+/**************************************************!
+   @brief    bleSendHistory()
+   @details  all data points, oldest first, as many records per notification as
+   @details  the MTU allows (27 with MTU 247: 13 notifications)
+   @return   void
+***************************************************/
+static void bleSendHistory()
+{
+  uint8_t buf[BLE_MTU - 3];
+  bleHistoryHeader h;
+  bleHistoryRecord r;
+  int i, n, perNotify;
+  uint32_t t = millis();
+
+  perNotify = ((int)bleMtu - 3 - (int)sizeof(h)) / (int)sizeof(r);
+  if(perNotify > (int)((sizeof(buf) - sizeof(h)) / sizeof(r)))
+    perNotify = (sizeof(buf) - sizeof(h)) / sizeof(r);
+  if(perNotify < 1)
+    return;
+  h.total = noDataPoints;
+  for(h.first = 0; h.first < noDataPoints; h.first += n){
+    memcpy(buf, &h, sizeof(h));
+    for(n=0; n < perNotify && h.first + n < noDataPoints; n++){
+      i = h.first + n;
+      r.ageMin = (uint16_t)(wData.ageOfDatapoint[i] / 60);
+      r.pressure = (wData.pressHistory[i] < nanDATA/4) ? (uint16_t)lroundf(wData.pressHistory[i] * 10.0) : 0xFFFF;
+      r.temperature = (wData.tempHistory[i] < nanDATA/4) ? (int16_t)lroundf(wData.tempHistory[i] * 100.0) : -32768;
+      r.humidity = (wData.humiHistory[i] < nanDATA/4) ? (uint16_t)wData.humiHistory[i] : 0xFFFF;
+      r.quality = wData.qualHistory[i];
+      memcpy(buf + sizeof(h) + n * sizeof(r), &r, sizeof(r));
+    }
+    if(!bleNotify(pHistoryChar, buf, sizeof(h) + n * sizeof(r))){
+      logOut<1>("BLE history: notify failed at %d", h.first);
+      return;
+    }
+  }
+  logOut<2>("BLE history: %d records, MTU %d, %lu ms", noDataPoints, bleMtu, millis() - t);
+}
+
+/**************************************************!
+   @brief    bleSetup()
+   @details  create server, service and characteristics, start advertising
+   @return   void
+***************************************************/
+static void bleSetup()
+{
+  NimBLEDevice::init(BLE_DEVICE_NAME);
+  NimBLEDevice::setMTU(BLE_MTU);
+
+  pServer = NimBLEDevice::createServer();
+  pServer->setCallbacks(&serverCallbacks, false);
   pService = pServer->createService(SERVICE_UUID);
 
-  // Create a NimBLE Characteristic
-  pSensorCharacteristic = pService->createCharacteristic(
-          SENSOR_CHARACTERISTIC_UUID,
-          NIMBLE_PROPERTY::READ   |
-          NIMBLE_PROPERTY::WRITE  |
-          NIMBLE_PROPERTY::NOTIFY |
-          NIMBLE_PROPERTY::INDICATE
-  );
-  /*
-  pSensorCharacteristic = pService->createCharacteristic(
-                      SENSOR_CHARACTERISTIC_UUID,
-                      NimBLECharacteristic::PROPERTY_READ   |
-                      NimBLECharacteristic::PROPERTY_WRITE  |
-                      NimBLECharacteristic::PROPERTY_NOTIFY |
-                      NimBLECharacteristic::PROPERTY_INDICATE
-                    );
-*/
-  // Create the ON button Characteristic
-  /*
-  pLedCharacteristic = pService->createCharacteristic(
-                      LED_CHARACTERISTIC_UUID,
-                      NimBLECharacteristic::PROPERTY_WRITE
-                    );
-  */
-  pLedCharacteristic = pService->createCharacteristic(
-                      LED_CHARACTERISTIC_UUID,
-                      NIMBLE_PROPERTY::WRITE
-);
-  // Register the callback for the ON button characteristic
-  pLedCharacteristic->setCallbacks(new MyCharacteristicCallbacks());
-
-  // https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.descriptor.gatt.client_characteristic_configuration.xml
-  // Create a NimBLE Descriptor
-  // left out for nimBLE
-  //pSensorCharacteristic->addDescriptor(new BLE2902());
-  //pLedCharacteristic->addDescriptor(new BLE2902());
-  NimBLE2904* pSensorCharacteristic2904 = pSensorCharacteristic->create2904();
-  pSensorCharacteristic2904->setFormat(NimBLE2904::FORMAT_UTF8);
-  //pSensorCharacteristic2904->setCallbacks(&dscCallbacks);
-  NimBLE2904* pLedCharacteristic2904 = pLedCharacteristic->create2904();
-  pLedCharacteristic2904->setFormat(NimBLE2904::FORMAT_UTF8);
-  //pSensorCharacteristic2904->setCallbacks(&dscCallbacks);
-
-  // Start the service
+  pCommandChar = pService->createCharacteristic(COMMAND_CHARACTERISTIC_UUID,
+                      NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::NOTIFY, CMD_MAX_LEN);
+  pCommandChar->setCallbacks(&commandCallbacks);
+  pCommandChar->create2904()->setFormat(NimBLE2904::FORMAT_UTF8);
+
+  pGraphTypeChar = pService->createCharacteristic(GRAPHTYPE_UUID, SETTING_PROPERTIES, 1);
+  pInversionChar = pService->createCharacteristic(INVERSION_UUID, SETTING_PROPERTIES, 1);
+  pCorrectionChar = pService->createCharacteristic(CORRECTION_UUID, SETTING_PROPERTIES, 3);
+  pIntervalChar = pService->createCharacteristic(INTERVAL_UUID, SETTING_PROPERTIES, 2);
+  pTimeRangeChar = pService->createCharacteristic(TIMERANGE_UUID, SETTING_PROPERTIES, 1);
+  pGraphTypeChar->setCallbacks(&settingCallbacks);
+  pInversionChar->setCallbacks(&settingCallbacks);
+  pCorrectionChar->setCallbacks(&settingCallbacks);
+  pIntervalChar->setCallbacks(&settingCallbacks);
+  pTimeRangeChar->setCallbacks(&settingCallbacks);
+
+  pReadingsChar = pService->createCharacteristic(READINGS_UUID,
+                      NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY, sizeof(bleReadings));
+  pHistoryChar = pService->createCharacteristic(HISTORY_UUID, NIMBLE_PROPERTY::NOTIFY, BLE_MTU - 3);
+  pHistoryChar->setCallbacks(&historyCallbacks);
+
+  bleUpdateValues(false);
   pService->start();
 
-  // Start advertising
   NimBLEAdvertising *pAdvertising = NimBLEDevice::getAdvertising();
-  pAdvertising->setName("ESP32");
+  pAdvertising->setName(BLE_DEVICE_NAME);
   pAdvertising->addServiceUUID(SERVICE_UUID);
-
-  // Changed for NimBLE
   pAdvertising->enableScanResponse(true);
-  //pAdvertising->setScanResponse(false);
-
-  // disable for NimBLE
-  //pAdvertising->setMinPreferred(0x0);  // set value to 0x00 to not advertise this parameter
-
-  // new for NimBLE
   pAdvertising->start();
-
-  // removed for NimBLE
-  //NimBLEDevice::startAdvertising();
-  Serial.println("Waiting a client connection to notify...");
+  logOut<2>("BLE advertising as %s", BLE_DEVICE_NAME);
 }
 
-// experimental function to clean up NimBLE
-void bleCleanup() 
+// stop advertising, free all NimBLE objects and the controller memory
+static void bleCleanup()
 {
-  pServer->removeService(pService); 
   NimBLEDevice::deinit(true);
-  
+  pServer = NULL;
+  pService = NULL;
 }
 
-#endif // bleTEST
-
-void bleConfigMain() 
+/**************************************************!
+   @brief    bleConfigMain()
+   @details  configuration session: wait for commands and setting writes (queued by
+   @details  the callbacks), end after BLE_MAX_WAIT without command, "ATX" or disconnect
+   @return   void
+***************************************************/
+void bleConfigMain()
 {
+  static cmdContext ctx;    // reply buffer, not on the stack
+  unsigned long startMillis = millis();
   bool stopBLE = false;
-  startTime = millis();  
-  Serial.printf("bleConfigMain started\n");
-  sprintf(outstring,"Heap Size: %ld FreeHp: %ld Max Block Alloc: %ld    ",
-      ESP.getHeapSize(),ESP.getFreeHeap(), ESP.getMaxAllocHeap());
-  logOut(2, outstring);  
-  #ifdef bleTEST
+  int commands = 0;
+  char text[maxLOG_STRING_LEN];
+  char line[CMD_MAX_LEN];
+  uint8_t event;
+
+  logOut<2>("Entering bleConfigMain(), FreeHp: %ld Max Block Alloc: %ld", ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+  snprintf(text, sizeof(text), "Ready for BLE Configuration");
+  buzzerPlay(BUZ_BT_ENTER);
+
+  cmdQueueBegin();
+  cmdSessionPower(true);  // lower CPU clock while waiting for commands
   bleSetup();
-  do{
-    // notify changed value
-    if (deviceConnected) {
-        pSensorCharacteristic->setValue(String(value).c_str());
-        pSensorCharacteristic->notify();
-        value++;
-        Serial.print("New value notified: ");
-        Serial.println(value);
-        delay(3000); // bluetooth stack will go into congestion, if too many packets are sent, in 6 hours test i was able to go as low as 3ms
-    }
-    // disconnecting
-    if (!deviceConnected && oldDeviceConnected) {
-        Serial.println("Device disconnected, exiting.");
-        stopBLE = true;
-        delay(500); // give the bluetooth stack the chance to get things ready
-        pServer->startAdvertising(); // restart advertising
-        Serial.println("Start advertising");
-        oldDeviceConnected = deviceConnected;
-    }
-    // connecting
-    if (deviceConnected && !oldDeviceConnected) {
-        // do stuff here on connecting
-        oldDeviceConnected = deviceConnected;
-        Serial.println("Device Connected");      
+  ctx.replyLine = bleReplyLine;
+  ctx.printLine = bleReplyLine;
+  ctx.exit = false;
+
+  drawBluetoothInfo(text, 0);
+
+  while(!stopBLE && cmdWait(line, BLE_MAX_WAIT, &event)){
+    if(event == BLE_EVENT_HISTORY)
+      bleSendHistory();
+    else if(event == BLE_EVENT_DISCONNECT)
+      stopBLE = true;
+    else{
+      if(event == CMD_EVENT_NONE){
+        cmdExecute(line, &ctx);
+        commands++;
+        stopBLE = ctx.exit;
+        drawBluetoothInfo(ctx.reply, 1);
+      }
+      bleUpdateValues(true);  // also restores a setting value that has been rejected
     }
-    actTime = millis();  
-  }  
-  while((actTime < startTime + 60000) && (!stopBLE));
-  Serial.println("Cleaning up in bleConfigMain()");
-  sprintf(outstring,"Heap Size: %ld FreeHp: %ld Max Block Alloc: %ld    ",
-      ESP.getHeapSize(),ESP.getFreeHeap(), ESP.getMaxAllocHeap());
-  logOut(2, outstring);  
-  void bleCleanup();
-  Serial.println("Leaving bleConfigMain()");
-  sprintf(outstring,"Heap Size: %ld FreeHp: %ld Max Block Alloc: %ld    ",
-      ESP.getHeapSize(),ESP.getFreeHeap(), ESP.getMaxAllocHeap());
-  logOut(2, outstring);  
-  #endif // bleTEST
-}
+  }
 
+  if(wData.preferencesChanged){
+    writePreferences();
+    wData.preferencesChanged = false;
+  }
+  trace(TR_BT_SESSION, (millis() - startMillis) / 1000, commands);
+  profSession(millis() - startMillis);   // radio on, for the energy model
+  bleCleanup();
+  cmdSessionPower(false);
+
+  snprintf(text, sizeof(text), "BLE Configuration ended.");
+  logOut<2>("%s, FreeHp: %ld", text, ESP.getFreeHeap());
+  drawBluetoothInfo(text, 1);
+  buzzerPlay(BUZ_BT_EXIT);
+}
 
-#endif // CROW_PANEL
\ No newline at end of file
+#endif // CROW_PANEL
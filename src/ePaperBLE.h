@@ -1,10 +1,63 @@
 #ifndef _ePaperBLE_H
 #define _ePaperBLE_H
 
+// GATT configuration and data service for the CrowPanel (ESP32-S3, BLE only).
+// All values are little endian binary. Writes to the setting characteristics are
+// translated into AT commands and queued (ePaperCommand), so they are validated and
+// executed by the session loop, not in the NimBLE host task.
+//
+// service                        19b10000-e8f2-537e-4f6c-d104768a1214
+//   command    write/notify      19b10003  AT command line, replies are notified (UTF-8)
+//   graphType  read/write/notify 19b10010  uint8: 0 P, 1 T, 2 H, 4 P/T, 5 P/H, 6 T/H, 7 P/T/H, 8 diagnostics
+//   inversion  read/write/notify 19b10011  uint8: 0 black on white, 1 white on black
+//   correction read/write/notify 19b10012  uint8 enabled, int16 value in 0.1 hPa
+//   interval   read/write/notify 19b10013  uint16: measurement interval in s (225|450|900)
+//   timeRange  read/write/notify 19b10014  uint8: time range of the graph in h (21|42|84)
+//   readings   read/notify       19b10020  bleReadings
+//   history    notify            19b10021  on subscribe: bleHistoryHeader + bleHistoryRecord[], oldest first
+
+#include <stdint.h>
+
 //************** module defines *************************/
+#define BLE_DEVICE_NAME     "ESP32Barograph"
+#define BLE_MTU             247       // ATT MTU requested: 244 bytes per notification
+#define BLE_MAX_WAIT        60000     // end session 60 sec after last command
+#define BLE_EVENT_HISTORY   1         // events queued with cmdPostEvent(), apart from the command lines:
+#define BLE_EVENT_DISCONNECT 2        // onSubscribe of the history characteristic, onDisconnect,
+#define BLE_EVENT_RESTORE   3         // setting written with wrong length or value: notify the value again
 
 //************** module global variables *************************/
+// current readings
+struct __attribute__((packed)) bleReadings
+{
+  uint32_t pressureCorr;      // Pa, correction applied
+  uint32_t pressureRaw;       // Pa, as measured
+  int16_t temperature;        // 0.01 °C
+  uint16_t humidity;          // permille
+  uint16_t batteryMv;
+  uint8_t batteryPercent;
+  uint8_t quality;            // QUAL_xxx of the last measurement
+  uint16_t intervalSec;       // measurement interval
+};
+
+// first bytes of each history notification
+struct __attribute__((packed)) bleHistoryHeader
+{
+  uint16_t first;             // index of the first record in this notification
+  uint16_t total;             // number of records of the whole transfer
+};
+
+// one history data point, invalid values are 0xFFFF / -32768
+struct __attribute__((packed)) bleHistoryRecord
+{
+  uint16_t ageMin;            // age in minutes
+  uint16_t pressure;          // 0.1 hPa, not corrected
+  int16_t temperature;        // 0.01 °C
+  uint16_t humidity;          // permille
+  uint8_t quality;            // QUAL_xxx
+};
 
 //************** function prototypes *************************/
+void bleConfigMain();         // configuration session: advertise, serve, end at timeout or "ATX"
 
-#endif // _ePaperBLE_H
\ No newline at end of file
+#endif // _ePaperBLE_H
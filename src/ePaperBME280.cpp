@@ -0,0 +1,422 @@
+/**************************************************!
+   native BME280 driver
+   forced mode only: the sensor sleeps between measurements.
+   A measurement is one write of ctrl_meas, status polling until the
+   conversion is done, and one burst read of the 8 data registers.
+   Calibration and register configuration are cached in RTC memory,
+   so they are read / written only after cold boot or change.
+***************************************************/
+
+#include <Arduino.h>
+#ifndef HOST_NATIVE
+  #include <Wire.h>
+#endif
+
+#include "global.h"
+#include "ePaperBME280.h"
+
+#define BME_CACHE_MAGIC  0x424D4532  // "BME2", marks valid RTC cache
+
+// calibration and configuration, in RTC memory which survives the deep sleep. Zero after power on
+struct bmeCacheData
+{
+  uint32_t magic;
+  uint8_t devAddr;
+  uint8_t ctrlHum;          // register values written to the sensor
+  uint8_t ctrlMeas;         // without mode bits
+  uint8_t config;
+  bool configured;          // ctrlHum, ctrlMeas, config written
+  bmeCalib calib;
+};
+RTC_DATA_ATTR bmeCacheData bmeCache;
+
+bmeStatistics bmeStats;
+
+static const bmeBus* bus = NULL;
+static uint32_t startUsec = 0;     // micros() at start of conversion
+
+/**************************************************!
+   @brief    regWrite() / regRead()
+   @details  register access via the bus, counting transactions
+***************************************************/
+static bool regWrite(uint8_t reg, uint8_t value)
+{
+  bmeStats.transactions++;
+  return(bus->write(bmeCache.devAddr, reg, value));
+}
+
+static bool regRead(uint8_t reg, uint8_t* buf, size_t len)
+{
+  bmeStats.transactions++;
+  return(bus->read(bmeCache.devAddr, reg, buf, len));
+}
+
+#ifndef HOST_NATIVE
+//************** device backend: Wire, pins and clock set by caller *************************/
+static bool wireWrite(uint8_t devAddr, uint8_t reg, uint8_t value)
+{
+  Wire.beginTransmission(devAddr);
+  Wire.write(reg);
+  Wire.write(value);
+  return(Wire.endTransmission() == 0);
+}
+
+static bool wireRead(uint8_t devAddr, uint8_t reg, uint8_t* buf, size_t len)
+{
+  size_t i;
+
+  Wire.beginTransmission(devAddr);
+  Wire.write(reg);
+  if(Wire.endTransmission(false) != 0)  // repeated start
+    return(false);
+  if(Wire.requestFrom(devAddr, (uint8_t)len) != len)
+    return(false);
+  for(i=0; i<len; i++)
+    buf[i] = Wire.read();
+  return(true);
+}
+
+static const bmeBus wireBus = { wireWrite, wireRead };
+#endif // HOST_NATIVE
+
+/**************************************************!
+   @brief    bmeParseCalib()
+   @details  calibration parameters from the register contents
+   @param    calib00: 26 bytes from register 0x88
+   @param    calib26: 7 bytes from register 0xE1
+   @param    c: calibration parameters
+   @return   void
+***************************************************/
+void bmeParseCalib(const uint8_t* calib00, const uint8_t* calib26, bmeCalib* c)
+{
+  c->dig_T1 = (uint16_t)(calib00[1] << 8 | calib00[0]);
+  c->dig_T2 = (int16_t)(calib00[3] << 8 | calib00[2]);
+  c->dig_T3 = (int16_t)(calib00[5] << 8 | calib00[4]);
+  c->dig_P1 = (uint16_t)(calib00[7] << 8 | calib00[6]);
+  c->dig_P2 = (int16_t)(calib00[9] << 8 | calib00[8]);
+  c->dig_P3 = (int16_t)(calib00[11] << 8 | calib00[10]);
+  c->dig_P4 = (int16_t)(calib00[13] << 8 | calib00[12]);
+  c->dig_P5 = (int16_t)(calib00[15] << 8 | calib00[14]);
+  c->dig_P6 = (int16_t)(calib00[17] << 8 | calib00[16]);
+  c->dig_P7 = (int16_t)(calib00[19] << 8 | calib00[18]);
+  c->dig_P8 = (int16_t)(calib00[21] << 8 | calib00[20]);
+  c->dig_P9 = (int16_t)(calib00[23] << 8 | calib00[22]);
+  c->dig_H1 = calib00[25];
+  c->dig_H2 = (int16_t)(calib26[1] << 8 | calib26[0]);
+  c->dig_H3 = calib26[2];
+  c->dig_H4 = (int16_t)((int8_t)calib26[3] * 16 | (calib26[4] & 0x0F));
+  c->dig_H5 = (int16_t)((int8_t)calib26[5] * 16 | (calib26[4] >> 4));
+  c->dig_H6 = (int8_t)calib26[6];
+}
+
+/**************************************************!
+   @brief    bmeCompensateT()
+   @param    adcT: raw temperature, 20 bit
+   @param    c: calibration
+   @param    tFine: fine temperature, needed for pressure and humidity
+   @return   int32_t: temperature in 0.01 °C
+***************************************************/
+int32_t bmeCompensateT(int32_t adcT, const bmeCalib* c, int32_t* tFine)
+{
+  int32_t var1, var2;
+
+  var1 = ((((adcT >> 3) - ((int32_t)c->dig_T1 << 1))) * ((int32_t)c->dig_T2)) >> 11;
+  var2 = (((((adcT >> 4) - ((int32_t)c->dig_T1)) * ((adcT >> 4) - ((int32_t)c->dig_T1))) >> 12)
+          * ((int32_t)c->dig_T3)) >> 14;
+  *tFine = var1 + var2;
+  return((*tFine * 5 + 128) >> 8);
+}
+
+/**************************************************!
+   @brief    bmeCompensateP()
+   @details  64 bit integer version of the datasheet
+   @param    adcP: raw pressure, 20 bit
+   @param    c: calibration
+   @param    tFine: from bmeCompensateT()
+   @return   uint32_t: pressure in Pa as Q24.8, 0 if invalid calibration
+***************************************************/
+uint32_t bmeCompensateP(int32_t adcP, const bmeCalib* c, int32_t tFine)
+{
+  int64_t var1, var2, p;
+
+  var1 = ((int64_t)tFine) - 128000;
+  var2 = var1 * var1 * (int64_t)c->dig_P6;
+  var2 = var2 + ((var1 * (int64_t)c->dig_P5) << 17);
+  var2 = var2 + (((int64_t)c->dig_P4) << 35);
+  var1 = ((var1 * var1 * (int64_t)c->dig_P3) >> 8) + ((var1 * (int64_t)c->dig_P2) << 12);
+  var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)c->dig_P1) >> 33;
+  if(var1 == 0)
+    return(0);  // avoid division by zero
+  p = 1048576 - adcP;
+  p = (((p << 31) - var2) * 3125) / var1;
+  var1 = (((int64_t)c->dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+  var2 = (((int64_t)c->dig_P8) * p) >> 19;
+  p = ((p + var1 + var2) >> 8) + (((int64_t)c->dig_P7) << 4);
+  return((uint32_t)p);
+}
+
+/**************************************************!
+   @brief    bmeCompensateH()
+   @param    adcH: raw humidity, 16 bit
+   @param    c: calibration
+   @param    tFine: from bmeCompensateT()
+   @return   uint32_t: humidity in %RH as Q22.10
+***************************************************/
+uint32_t bmeCompensateH(int32_t adcH, const bmeCalib* c, int32_t tFine)
+{
+  int32_t v;
+
+  v = (tFine - ((int32_t)76800));
+  v = (((((adcH << 14) - (((int32_t)c->dig_H4) << 20) - (((int32_t)c->dig_H5) * v))
+        + ((int32_t)16384)) >> 15)
+      * (((((((v * ((int32_t)c->dig_H6)) >> 10) * (((v * ((int32_t)c->dig_H3)) >> 11)
+        + ((int32_t)32768))) >> 10) + ((int32_t)2097152)) * ((int32_t)c->dig_H2) + 8192) >> 14));
+  v = (v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t)c->dig_H1)) >> 4));
+  v = (v < 0 ? 0 : v);
+  v = (v > 419430400 ? 419430400 : v);
+  return((uint32_t)(v >> 12));
+}
+
+/**************************************************!
+   @brief    bmeBegin()
+   @details  after cold boot: check chip id and read calibration. Afterwards from RTC cache,
+   @details  no bus transaction.
+   @param    devAddr: I2C address, 0x76 or 0x77
+   @param    b: bus, NULL for Wire (pins and clock have to be set before), the fake on the host
+   @return   bool: true if sensor found
+***************************************************/
+bool bmeBegin(uint8_t devAddr, const bmeBus* b)
+{
+  uint8_t id, calib00[26], calib26[7];
+
+  #ifndef HOST_NATIVE
+    bus = (b != NULL) ? b : &wireBus;
+  #else
+    bus = (b != NULL) ? b : &bmeFakeBus;
+  #endif
+  memset(&bmeStats, 0, sizeof(bmeStats));
+  if(bmeCache.magic == BME_CACHE_MAGIC && bmeCache.devAddr == devAddr)
+    return(true);
+
+  memset(&bmeCache, 0, sizeof(bmeCache));
+  bmeCache.devAddr = devAddr;
+  if(!regRead(BME_REG_CHIPID, &id, 1) || id != BME_CHIP_ID){
+    logOut<1>("BME280 not found at 0x%02X", devAddr);
+    return(false);
+  }
+  if(!regRead(BME_REG_CALIB00, calib00, sizeof(calib00)) || !regRead(BME_REG_CALIB26, calib26, sizeof(calib26)))
+    return(false);
+  bmeParseCalib(calib00, calib26, &bmeCache.calib);
+  bmeCache.magic = BME_CACHE_MAGIC;
+  return(true);
+}
+
+/**************************************************!
+   @brief    bmeSetSampling()
+   @details  oversampling and IIR filter. Registers are written only if changed.
+   @details  sensor stays in sleep mode, conversion is started by bmeStartForced()
+   @param    osrsT, osrsP, osrsH: oversampling, BME_OSRS_xx
+   @param    filter: IIR filter, BME_FILTER_xx
+   @return   bool: true if ok
+***************************************************/
+bool bmeSetSampling(uint8_t osrsT, uint8_t osrsP, uint8_t osrsH, uint8_t filter)
+{
+  uint8_t ctrlHum = osrsH & 0x07;
+  uint8_t ctrlMeas = (uint8_t)((osrsT & 0x07) << 5 | (osrsP & 0x07) << 2);
+  uint8_t config = (uint8_t)((filter & 0x07) << 2);
+
+  if(bus == NULL || bmeCache.magic != BME_CACHE_MAGIC) return(false);
+  if(bmeCache.configured && bmeCache.ctrlHum == ctrlHum && bmeCache.ctrlMeas == ctrlMeas
+     && bmeCache.config == config)
+    return(true);
+
+  bmeCache.configured = false;
+  // config is only written in sleep mode, ctrl_hum becomes effective with write of ctrl_meas
+  if(!regWrite(BME_REG_CTRL_MEAS, ctrlMeas | BME_MODE_SLEEP)) return(false);
+  if(!regWrite(BME_REG_CONFIG, config)) return(false);
+  if(!regWrite(BME_REG_CTRL_HUM, ctrlHum)) return(false);
+  if(!regWrite(BME_REG_CTRL_MEAS, ctrlMeas | BME_MODE_SLEEP)) return(false);
+  bmeCache.ctrlHum = ctrlHum;
+  bmeCache.ctrlMeas = ctrlMeas;
+  bmeCache.config = config;
+  bmeCache.configured = true;
+  return(true);
+}
+
+/**************************************************!
+   @brief    bmeMaxMeasUsec()
+   @details  maximum conversion time, datasheet appendix B
+   @return   uint32_t: time in usec
+***************************************************/
+uint32_t bmeMaxMeasUsec(uint8_t osrsT, uint8_t osrsP, uint8_t osrsH)
+{
+  static const uint8_t factor[6] = {0, 1, 2, 4, 8, 16};
+  uint32_t usec = 1250;
+
+  if(osrsT > 5) osrsT = 5;
+  if(osrsP > 5) osrsP = 5;
+  if(osrsH > 5) osrsH = 5;
+  usec += 2300 * factor[osrsT];
+  if(osrsP) usec += 2300 * factor[osrsP] + 575;
+  if(osrsH) usec += 2300 * factor[osrsH] + 575;
+  return(usec);
+}
+
+/**************************************************!
+   @brief    bmeStartForced()
+   @details  start one conversion. The sensor returns to sleep mode afterwards
+   @return   bool: true if ok
+***************************************************/
+bool bmeStartForced()
+{
+  if(bus == NULL || !bmeCache.configured) return(false);
+  startUsec = micros();
+  return(regWrite(BME_REG_CTRL_MEAS, bmeCache.ctrlMeas | BME_MODE_FORCED));
+}
+
+/**************************************************!
+   @brief    bmeIsMeasuring()
+   @return   bool: true while a conversion is running
+***************************************************/
+bool bmeIsMeasuring()
+{
+  uint8_t status;
+
+  if(bus == NULL || !regRead(BME_REG_STATUS, &status, 1)) return(false);
+  return((status & BME_STATUS_MEASURING) != 0);
+}
+
+/**************************************************!
+   @brief    bmeReadForced()
+   @details  wait for the conversion started by bmeStartForced() by polling the status
+   @details  register, then one burst read of 0xF7..0xFE and compensation.
+   @details  Polling starts after the typical conversion time (measuring bit may not
+   @details  be set immediately after the start)
+   @param    r: compensated values
+   @return   bool: true if ok
+***************************************************/
+bool bmeReadForced(bmeReading* r)
+{
+  uint8_t data[BME_DATA_LEN];
+  uint8_t osrsT = bmeCache.ctrlMeas >> 5, osrsP = (bmeCache.ctrlMeas >> 2) & 0x07;
+  uint32_t minUsec, elapsed;
+  int32_t adcT, adcP, adcH, tFine;
+
+  if(bus == NULL || !bmeCache.configured) return(false);
+  // typical conversion time is ~80% of max time
+  minUsec = bmeMaxMeasUsec(osrsT, osrsP, bmeCache.ctrlHum) * 4 / 5;
+  elapsed = micros() - startUsec;
+  bmeStats.collectUsec = elapsed;
+  if(elapsed < minUsec)
+    delayMicroseconds(minUsec - elapsed);
+
+  bmeStats.polls = 0;
+  do{
+    bmeStats.polls++;
+    if(!bmeIsMeasuring()) break;
+    if(micros() - startUsec > BME_TIMEOUT_USEC){
+      logOut<1>("BME280 conversion timeout");
+      return(false);
+    }
+    delayMicroseconds(BME_POLL_USEC);
+  } while(true);
+  r->waitUsec = micros() - startUsec;
+
+  if(!regRead(BME_REG_DATA, data, sizeof(data))) return(false);
+  adcP = (int32_t)((uint32_t)data[0] << 12 | (uint32_t)data[1] << 4 | data[2] >> 4);
+  adcT = (int32_t)((uint32_t)data[3] << 12 | (uint32_t)data[4] << 4 | data[5] >> 4);
+  adcH = (int32_t)((uint32_t)data[6] << 8 | data[7]);
+
+  r->temperature = bmeCompensateT(adcT, &bmeCache.calib, &tFine);
+  r->pressure = bmeCompensateP(adcP, &bmeCache.calib, tFine);
+  r->humidity = bmeCompensateH(adcH, &bmeCache.calib, tFine);
+  return(true);
+}
+
+#ifdef HOST_NATIVE
+//************** host backend: register level fake *************************/
+static uint8_t fakeRegs[256];
+static bool fakeInit = false;
+static bool fakeAbsent = false;          // no acknowledge: sensor missing or bus fault
+static uint32_t fakeBusyPolls = 0, fakeBusy = 0;
+static int32_t fakeAdcT = 519888, fakeAdcP = 415148, fakeAdcH = 27000;
+
+// calibration example of the datasheet (T, P) and a typical sensor (H)
+static void fakeReset()
+{
+  static const uint8_t calib00[26] = {
+    0x70, 0x6B, 0x43, 0x67, 0x18, 0xFC,             // T1 27504, T2 26435, T3 -1000
+    0x7D, 0x8E, 0x43, 0xD6, 0xD0, 0x0B, 0x27, 0x0B, // P1 36477, P2 -10685, P3 3024, P4 2855
+    0x8C, 0x00, 0xF9, 0xFF, 0x8C, 0x3C, 0xF8, 0xC6, // P5 140, P6 -7, P7 15500, P8 -14600
+    0x70, 0x17, 0x00, 0x4B };                       // P9 6000, -, H1 75
+  static const uint8_t calib26[7] = {
+    0x72, 0x01, 0x00, 0x13, 0x29, 0x03, 0x1E };     // H2 370, H3 0, H4 313, H5 50, H6 30
+
+  memset(fakeRegs, 0, sizeof(fakeRegs));
+  memcpy(&fakeRegs[BME_REG_CALIB00], calib00, sizeof(calib00));
+  memcpy(&fakeRegs[BME_REG_CALIB26], calib26, sizeof(calib26));
+  fakeRegs[BME_REG_CHIPID] = BME_CHIP_ID;
+  fakeInit = true;
+}
+
+static bool fakeWrite(uint8_t devAddr, uint8_t reg, uint8_t value)
+{
+  if(!fakeInit) fakeReset();
+  if(devAddr != BME_I2C_ADDR || fakeAbsent) return(false);
+  if(reg == BME_REG_CTRL_MEAS && (value & 0x03) == BME_MODE_FORCED){
+    // conversion: data registers updated, sensor back to sleep mode
+    fakeRegs[BME_REG_DATA+0] = (uint8_t)(fakeAdcP >> 12);
+    fakeRegs[BME_REG_DATA+1] = (uint8_t)(fakeAdcP >> 4);
+    fakeRegs[BME_REG_DATA+2] = (uint8_t)(fakeAdcP << 4);
+    fakeRegs[BME_REG_DATA+3] = (uint8_t)(fakeAdcT >> 12);
+    fakeRegs[BME_REG_DATA+4] = (uint8_t)(fakeAdcT >> 4);
+    fakeRegs[BME_REG_DATA+5] = (uint8_t)(fakeAdcT << 4);
+    fakeRegs[BME_REG_DATA+6] = (uint8_t)(fakeAdcH >> 8);
+    fakeRegs[BME_REG_DATA+7] = (uint8_t)fakeAdcH;
+    fakeBusy = fakeBusyPolls;
+    value &= 0xFC;
+  }
+  fakeRegs[reg] = value;
+  return(true);
+}
+
+static bool fakeRead(uint8_t devAddr, uint8_t reg, uint8_t* buf, size_t len)
+{
+  if(!fakeInit) fakeReset();
+  if(devAddr != BME_I2C_ADDR || fakeAbsent || reg + len > sizeof(fakeRegs)) return(false);
+  if(reg == BME_REG_STATUS){
+    fakeRegs[BME_REG_STATUS] = (fakeBusy > 0) ? BME_STATUS_MEASURING : 0;
+    if(fakeBusy > 0) fakeBusy--;
+  }
+  memcpy(buf, &fakeRegs[reg], len);
+  return(true);
+}
+
+const bmeBus bmeFakeBus = { fakeWrite, fakeRead };
+
+/**************************************************!
+   @brief    bmeFakeSetRaw()
+   @details  raw values of the next conversion of the fake sensor
+   @param    adcT, adcP, adcH: raw values
+   @param    busyPolls: number of status reads that return "measuring"
+   @return   void
+***************************************************/
+void bmeFakeSetRaw(int32_t adcT, int32_t adcP, int32_t adcH, uint32_t busyPolls)
+{
+  fakeAdcT = adcT;
+  fakeAdcP = adcP;
+  fakeAdcH = adcH;
+  fakeBusyPolls = busyPolls;
+}
+
+/**************************************************!
+   @brief    bmeFakeSetAbsent()
+   @details  sensor dropout: no transaction is acknowledged until reset
+   @param    absent: true: all reads and writes fail
+   @return   void
+***************************************************/
+void bmeFakeSetAbsent(bool absent)
+{
+  fakeAbsent = absent;
+}
+#endif // HOST_NATIVE
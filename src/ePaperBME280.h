@@ -0,0 +1,98 @@
+#ifndef _ePaperBME280_H
+#define _ePaperBME280_H
+
+// native BME280 driver: forced mode, one burst read of all measurement registers,
+// Bosch integer compensation (32 bit temperature/humidity, 64 bit pressure).
+// Register access is done via bmeBus: Wire on the device, a register level fake
+// on the host (HOST_NATIVE). All bus transactions are counted in bmeStats.
+
+#include <stdint.h>
+#include <stddef.h>
+
+//************** module defines *************************/
+#define BME_I2C_ADDR        0x76
+#define BME_I2C_CLOCK       400000    // I2C fast mode
+#define BME_CHIP_ID         0x60
+
+// registers
+#define BME_REG_CALIB00     0x88      // dig_T1 ... dig_H1, 26 bytes
+#define BME_REG_CHIPID      0xD0
+#define BME_REG_RESET       0xE0
+#define BME_REG_CALIB26     0xE1      // dig_H2 ... dig_H6, 7 bytes
+#define BME_REG_CTRL_HUM    0xF2
+#define BME_REG_STATUS      0xF3
+#define BME_REG_CTRL_MEAS   0xF4
+#define BME_REG_CONFIG      0xF5
+#define BME_REG_DATA        0xF7      // press_msb ... hum_lsb, 8 bytes
+#define BME_DATA_LEN        8
+
+#define BME_STATUS_MEASURING 0x08
+#define BME_MODE_SLEEP      0x00
+#define BME_MODE_FORCED     0x01
+
+// oversampling (osrs_x) and IIR filter (filter) register values
+#define BME_OSRS_SKIP       0
+#define BME_OSRS_X1         1
+#define BME_OSRS_X2         2
+#define BME_OSRS_X4         3
+#define BME_OSRS_X8         4
+#define BME_OSRS_X16        5
+#define BME_FILTER_OFF      0
+#define BME_FILTER_2        1
+#define BME_FILTER_4        2
+#define BME_FILTER_8        3
+#define BME_FILTER_16       4
+
+#define BME_POLL_USEC       500       // interval of status polling
+#define BME_TIMEOUT_USEC    150000    // max. wait for a conversion, longest is ~113 ms (all x16)
+
+//************** module global variables *************************/
+// register access. Return true if the device acknowledged
+struct bmeBus
+{
+  bool (*write)(uint8_t devAddr, uint8_t reg, uint8_t value);
+  bool (*read)(uint8_t devAddr, uint8_t reg, uint8_t* buf, size_t len);   // burst read from reg on
+};
+
+struct bmeCalib
+{
+  uint16_t dig_T1; int16_t dig_T2, dig_T3;
+  uint16_t dig_P1; int16_t dig_P2, dig_P3, dig_P4, dig_P5, dig_P6, dig_P7, dig_P8, dig_P9;
+  uint8_t dig_H1; int16_t dig_H2; uint8_t dig_H3; int16_t dig_H4, dig_H5; int8_t dig_H6;
+};
+
+struct bmeReading
+{
+  int32_t temperature;      // 0.01 °C
+  uint32_t pressure;        // Pa, Q24.8 (pressure / 256 = Pa)
+  uint32_t humidity;        // %RH, Q22.10 (humidity / 1024 = %RH)
+  uint32_t waitUsec;        // time from start of conversion until data ready
+};
+
+struct bmeStatistics
+{
+  uint32_t transactions;    // I2C transactions since begin
+  uint32_t polls;           // status polls of last conversion
+  uint32_t collectUsec;     // time from start of last conversion until bmeReadForced() was called
+};
+extern bmeStatistics bmeStats;
+
+//************** function prototypes *************************/
+bool bmeBegin(uint8_t devAddr, const bmeBus* bus);    // bus NULL: Wire (host: fake). Checks chip id, reads calibration
+bool bmeSetSampling(uint8_t osrsT, uint8_t osrsP, uint8_t osrsH, uint8_t filter);
+bool bmeStartForced();                                // start a forced conversion, does not wait
+bool bmeIsMeasuring();
+bool bmeReadForced(bmeReading* r);                    // wait (status polling) and read the conversion
+uint32_t bmeMaxMeasUsec(uint8_t osrsT, uint8_t osrsP, uint8_t osrsH);
+// compensation, datasheet BST-BME280-DS002 chapter 8.2 / 4.2.3
+int32_t bmeCompensateT(int32_t adcT, const bmeCalib* c, int32_t* tFine);
+uint32_t bmeCompensateP(int32_t adcP, const bmeCalib* c, int32_t tFine);
+uint32_t bmeCompensateH(int32_t adcH, const bmeCalib* c, int32_t tFine);
+void bmeParseCalib(const uint8_t* calib00, const uint8_t* calib26, bmeCalib* c);
+#ifdef HOST_NATIVE
+  extern const bmeBus bmeFakeBus;                     // register level fake, datasheet calibration example
+  void bmeFakeSetRaw(int32_t adcT, int32_t adcP, int32_t adcH, uint32_t busyPolls);
+  void bmeFakeSetAbsent(bool absent);                 // dropout: no acknowledge
+#endif
+
+#endif // _ePaperBME280_H
@@ -0,0 +1,64 @@
+/**************************************************!
+   BTHome v2 encoder for the beacon mode (ePaperBeacon.cpp)
+   no Arduino dependencies: also used by host tests
+***************************************************/
+
+#include <stdint.h>
+
+#include "ePaperBTHome.h"
+
+// little endian writer with bound check
+struct advWriter
+{
+  uint8_t* buf;
+  int len;
+  int max;
+};
+
+static void put(advWriter* w, uint32_t v, int bytes)
+{
+  int i;
+
+  for(i=0; i<bytes; i++, v >>= 8){
+    if(w->len < w->max)
+      w->buf[w->len] = (uint8_t)(v & 0xFF);
+    w->len++;
+  }
+}
+
+/**************************************************!
+   @brief    bthomeEncode()
+   @details  advertising data: flags, service data 0xFCD2 with BTHome v2 objects
+   @param    r: readings, already scaled
+   @param    adv: output buffer
+   @param    maxLen: size of adv, BTHOME_ADV_MAX is always enough
+   @return   int: length of the payload, -1 if maxLen is too small
+***************************************************/
+int bthomeEncode(const bthomeReadings* r, uint8_t* adv, int maxLen)
+{
+  advWriter w = { adv, 0, maxLen };
+  int lenPos;
+
+  // flags: LE general discoverable, BR/EDR not supported
+  put(&w, 2, 1);
+  put(&w, 0x01, 1);
+  put(&w, 0x06, 1);
+  // service data, 16 bit UUID. Length is filled in at the end
+  lenPos = w.len;
+  put(&w, 0, 1);
+  put(&w, 0x16, 1);
+  put(&w, BTHOME_UUID, 2);
+  put(&w, BTHOME_INFO_V2, 1);
+  // objects in ascending order of the id, as required by BTHome v2
+  put(&w, BTHOME_PACKET_ID, 1);   put(&w, r->packetId, 1);
+  put(&w, BTHOME_BATTERY, 1);     put(&w, r->batteryPercent, 1);
+  put(&w, BTHOME_TEMPERATURE, 1); put(&w, (uint16_t)r->temperature, 2);
+  put(&w, BTHOME_HUMIDITY, 1);    put(&w, r->humidity, 2);
+  put(&w, BTHOME_PRESSURE, 1);    put(&w, r->pressure, 3);
+  put(&w, BTHOME_VOLTAGE, 1);     put(&w, r->voltageMv, 2);
+  put(&w, BTHOME_COUNT_S16, 1);   put(&w, (uint16_t)r->tendency, 2);
+  if(w.len > w.max)
+    return(-1);
+  adv[lenPos] = (uint8_t)(w.len - lenPos - 1);
+  return(w.len);
+}
@@ -0,0 +1,40 @@
+#ifndef _ePaperBTHome_H
+#define _ePaperBTHome_H
+
+// BTHome v2 advertising payload (https://bthome.io/format/), unencrypted.
+// Pure encoder without Arduino dependencies, can be compiled and tested on the host.
+// The payload is a complete advertising data block (max. 31 bytes):
+//   flags AD, service data AD with UUID 0xFCD2, device info byte, objects sorted by id.
+
+#include <stdint.h>
+
+//************** module defines *************************/
+#define BTHOME_UUID             0xFCD2
+#define BTHOME_INFO_V2          0x40      // version 2, not encrypted, regular interval
+#define BTHOME_ADV_MAX          31        // legacy advertising data
+
+// object ids used, with factor of the value
+#define BTHOME_PACKET_ID        0x00      // uint8, receivers drop repeated packets
+#define BTHOME_BATTERY          0x01      // uint8, %
+#define BTHOME_TEMPERATURE      0x02      // sint16, 0.01 °C
+#define BTHOME_HUMIDITY         0x03      // uint16, 0.01 %
+#define BTHOME_PRESSURE         0x04      // uint24, 0.01 hPa
+#define BTHOME_VOLTAGE          0x0C      // uint16, 0.001 V
+#define BTHOME_COUNT_S16        0x5A      // sint16, no unit: pressure change in 3 h, 0.1 hPa
+
+//************** module global variables *************************/
+struct bthomeReadings
+{
+  uint8_t packetId;           // incremented every measurement
+  uint8_t batteryPercent;
+  int16_t temperature;        // 0.01 °C
+  uint16_t humidity;          // 0.01 %
+  uint32_t pressure;          // 0.01 hPa, corrected if correction is on
+  uint16_t voltageMv;
+  int16_t tendency;           // pressure change in 3 h, 0.1 hPa
+};
+
+//************** function prototypes *************************/
+int bthomeEncode(const bthomeReadings* r, uint8_t* adv, int maxLen);  // length of payload, -1 if maxLen too small
+
+#endif // _ePaperBTHome_H
@@ -5,6 +5,7 @@
 
 #include <Arduino.h>
 #include <math.h>
+#include <stdarg.h>
 
 //**** ESP32 sleep and rtc memory (which survives deep sleep)
 #include "esp_sleep.h"
@@ -12,53 +13,43 @@
 
 //*** libs and defines for BME280
 #include <Wire.h>
-#include <Adafruit_Sensor.h>
-#include <Adafruit_BME280.h>
 
 // *** lib for permanent data storage in EEPROM
 // https://randomnerdtutorials.com/esp32-save-data-permanently-preferences/
 // if these defines are set, preferences are written / saved to eeprom. 
 // otherwise just from RTC storage (survives deep sleep)
 #define WRITE_PREFERENCES
-#define WRITE_PREFS_INTERVAL 250 // store counters into preferences every <x> run
+#define WRITE_PREFS_INTERVAL 250 // store counters into preferences every <x> run, if counter journal not available
 #define READ_PREFERENCES
 #include <Preferences.h>
 Preferences preferences; // object for preference storage in EEPROM
 #define prefIDENT "barograf1"
+#define prefRECORDKEY "settingsRec"   // keys within namespace prefIDENT: settings record,
+#define prefALERTSKEY "alerts"        // alert rules blob,
+#define prefCOUNTERSKEY "counters"    // counters if the journal is not available,
+#define prefBLOBKEY "settings"        // settings blob of version 1 / 2, migrated
+#include "esp_rom_crc.h" // crc32 from ROM, for checksum of RTC settings cache
 
 // header file mit #defines, forward declarations, "extern" declarations von woanders deklarierten globalen var's
 // globale variablen und alle anderen #includes sind im .cpp file
 #include "ePaperBarograf.h"
 #include "global.h" // global stuff from other modules
+#include "ePaperProfiler.h" // timing of wake phases
+#include "ePaperEnergy.h"   // energy model, display refresh policy
+#include "ePaperGraphics.h" // tendency limits
+#include "ePaperJournal.h"  // counters in wear leveled flash journal, written every wake
+#include "ePaperBME280.h"   // native BME280 driver
+#include "ePaperSensorProfile.h" // BME280 oversampling / filter profiles
+#include "ePaperAcquisition.h"  // burst acquisition, quality flags
+#include "ePaperBattery.h"   // calibrated battery voltage, state of charge table
+#include "ePaperTrace.h"     // binary trace ring, text logging is opt-in
+#include "ePaperDS18B20.h"   // DS18B20 temperature channels, conversion overlapped with rendering
+#include "ePaperBeacon.h"    // BTHome advertisement of the readings (-D BTHOME_BEACON)
+#include "ePaperButton.h"    // button wakeup, short / long / double press
+#include "ePaperCommand.h"   // buttons change settings through the command table
+#include "ePaperBuzzer.h"    // buzzer patterns, LEDC and timer driven
+#include "ePaperAlert.h"     // alert rules, evaluated once per sample
 
-//************ push button stuff *****************/
-struct Button {
-  const uint8_t PIN;
-  uint32_t numberKeyPresses;
-  bool pressed;
-};
-
-#ifdef isPushButtons
-  #ifdef LOLIN32_LITE
-    #define BUTTON1 GPIO_NUM_12   // upper black button
-    #define BUTTON2 GPIO_NUM_14  // middle red button
-    #define BUTTON3 GPIO_NUM_13  // lower red  button
-  #endif
-  #ifdef CROW_PANEL  
-    #define BUTTON1 GPIO_NUM_2  // upper button MENU
-    #define BUTTON2 GPIO_NUM_1  // lower button EXIT
-    #define BUTTON3 GPIO_NUM_5  // button CONFIRM at rotary switch
-    #define BUTTON4 GPIO_NUM_4  // button DOWN at rotary switch
-    #define BUTTON5 GPIO_NUM_6  // button DOWN at rotary switch
-  #endif  
-  volatile Button button1 = {BUTTON1, 0, false};
-  volatile Button button2 = {BUTTON2, 0, false};
-  volatile Button button3 = {BUTTON3, 0, false};
-
-  void ARDUINO_ISR_ATTR button1Handler();
-  void ARDUINO_ISR_ATTR button2Handler();
-  void ARDUINO_ISR_ATTR button3Handler();
-#endif // isPushButtons
 
 // GPIO definition for battery voltage reading
 #ifdef HANDMADE_BOARD
@@ -68,25 +59,22 @@ struct Button {
   #define VOLTAGE_PIN 39
 #endif 
 
-// GPIO definition for buzzer
-#define BUZZER_PIN 2
-
 // 08.01.25: store these variables in RTC memory, which survives deep sleep. 
 RTC_DATA_ATTR uint32_t startCounter = 0;    // total counter for starts of ESP32
 RTC_DATA_ATTR uint32_t dischgCnt = 0;    // counter for starts of ESP32 since last charge
 RTC_DATA_ATTR uint32_t prevMicrovolt = 0;
 RTC_DATA_ATTR float prevVoltage = 0;
-float prefs[4] = {0.0, 0.0, 0.0, 0.0};  // storage for preferences
 
 float volt, percent;                    // battery voltage and percent fill degree
 
-uint32_t multiplier = MULTIPLIER_FULL;  // slepp time multiplier (standard is 1 min, this multiplier is applied to that)
+bool bmeSensorOk = false;               // BME280 found and conversion started in setup()
+uint8_t measQuality = QUAL_OK;          // quality flags of the measurement, QUAL_xxx
+uint32_t multiplier = MULTIPLIER_FULL;  // display refresh multiplier: panel refreshed every <multiplier> measurements
 //uint32_t targetSleepSec;                // target sleep time in seconds
 uint32_t targetSleepUSec;               // target sleep time in microseconds
 
-char outstring[maxLOG_STRING_LEN];      // for serial and other debug output
+char outstring[maxLOG_STRING_LEN];      // scratch buffer for display text
 
-Adafruit_BME280 bme;                    // BME280 sensor I2C
 float temperature = 0;                  // data read by BME280
 float humidity = 0;
 float pressure = 0;
@@ -95,14 +83,19 @@ float pressure = 0;
 //----------------------- measurement data variables -----------------------
 uint32_t startTimeMillis; 
 uint32_t measTimeMillis;
+uint32_t firstPixelMs = 0;              // button wake: ms since boot until the feedback is on the panel
 
 // measurement data
 
 #define createTestData          // flag to create test data at setup, overwriting whatever may be there
 
-// measurement data, stored in RTC memory which survives the deep sleep. ESP32 has 8 K, used for this 5448 Bytes
+// measurement data, stored in RTC memory which survives the deep sleep. ESP32 has 8 K, 7680 Bytes
+// after the ULP reserve. wData uses 5232 of the 7524 Bytes of all RTC variables, 156 Bytes are left
 RTC_DATA_ATTR measurementData wData;
 
+// copy of the preference values as stored in NVS, RTC memory
+RTC_DATA_ATTR settingsCacheData sCache;
+
 // screen colors
 RTC_DATA_ATTR uint32_t fgndColor;
 RTC_DATA_ATTR uint32_t bgndColor;
@@ -117,46 +110,42 @@ RTC_DATA_ATTR uint32_t bgndColor;
 #endif
 
 /**************************************************!
-   @brief    buzzer()
-   @details  Function to create a buzzer sound
-   @param    uint16_t number    : how many buzzes
-   @param    uint16_t duration : how long in ms for every buzz
-   @param    uint16_t interval : how long in ms between buzzes
+   @brief    serialPrintLine()
+   @details  output function for reports to USB serial, e.g. trace dump
+   @param    line: one line of text
    @return   void
 ***************************************************/
-void buzzer(uint16_t number, uint16_t duration, uint16_t interval)
+void serialPrintLine(char* line)
 {
-  uint16_t i;
-  for(i=0; i<number; i++){
-    logOut(3, (char*)"Start Buzzer");
-    pinMode(BUZZER_PIN, OUTPUT);
-    digitalWrite(BUZZER_PIN, HIGH);
-    delay(duration);
-    digitalWrite(BUZZER_PIN, LOW);
-    delay(interval);
-    logOut(3, (char*)"End of Buzzer");
-  }  
-}    
+  Serial.println(line);
+}
 
 /**************************************************!
-   @brief    logOut()
-   @details  Function create log output
+   @brief    logWrite()
+   @details  output sink of logOut<level>(): formats the counter and the message
+   @details  into a local buffer, truncated at maxLOG_STRING_LEN, and prints it
+   @param    format: printf format
    @return   void
 ***************************************************/
-void logOut(int logLevel, char* str)
+void logWrite(const char* format, ...)
 {
-  char safeStr[maxLOG_STRING_LEN+10];
+  va_list args;
+
+  va_start(args, format);
+  logWriteV(format, args);
+  va_end(args);
+}
+
+void logWriteV(const char* format, va_list args)
+{
+  char line[maxLOG_STRING_LEN+12];
   static uint32_t logCnt = 0;
-  // for safety: ensure zero termination well before the end of the string
-  // crashes with static strings.
-  // str[maxLOG_STRING_LEN-1]=0;
-  if(logLevel <= logLEVEL){
-    strncat(safeStr, str, maxLOG_STRING_LEN-1); // copy limited number of characters only
-    sprintf(safeStr,"%ld %s",logCnt,str);
-    //Serial.println(str);
-    Serial.println(safeStr);
-    logCnt++;
-  }
+  int len;
+
+  len = snprintf(line, sizeof(line), "%lu ", (unsigned long)logCnt);
+  vsnprintf(line+len, sizeof(line)-len, format, args);
+  Serial.println(line);
+  logCnt++;
 }
 
 /**************************************************!
@@ -166,44 +155,59 @@ void logOut(int logLevel, char* str)
 ***************************************************/
 void getBME280SensorData() 
 {
-  // Only needed in forced mode! Forced mode lets the sensor sleep between measurements.
+  acqResult res;
+
+  // Forced mode lets the sensor sleep between measurements.
   // normal mode: sensor warming +1,5°C vs. DS18B20. Forced mode: +0,9°C
-  bme.takeForcedMeasurement(); // has no effect in normal mode
-
-  pressure = bme.readPressure()/100;
-  sprintf(outstring,"Pressure: %3.1f mBar ", pressure);
-  logOut(2, outstring);
-  humidity = bme.readHumidity();
-  sprintf(outstring,"Humidity: %3.1f %% ", humidity);
-  logOut(2, outstring);
-  temperature = bme.readTemperature();
-  sprintf(outstring,"Temperature: %3.1f °C \n", temperature);
-  logOut(2, outstring);
+  // the first conversion has been started at the beginning of setup(), normally it is finished here.
+  // more conversions only if the last measurement was not quiet or the value jumped
+  if(!bmeSensorOk || !acqMeasure(&res, true, wData.actPressureRaw, wData.actTemperature, 
+                                  (float)wData.actHumidity / 10.0)){
+    logOut<1>("BME280 measurement failed");
+    trace(TR_BME_FAIL, bmeSensorOk ? res.samples : 0, bmeSensorOk ? res.failed : 0);
+    pressure = NAN;
+    humidity = NAN;
+    temperature = NAN;
+    measQuality = QUAL_NO_DATA;
+    return;
+  }
+  pressure = res.pressure;
+  humidity = res.humidity;
+  temperature = res.temperature;
+  measQuality = res.quality;
+
+  profSampleReady();
+  trace(TR_MEASURE, (int32_t)(10.0 * pressure + 0.5), (int32_t)(100.0 * temperature + (temperature >= 0 ? 0.5 : -0.5)));
+  trace(TR_HUMIDITY, (int32_t)(10.0 * humidity + 0.5), measQuality);
+
+  logOut<2>("Pressure: %3.1f mBar Humidity: %3.1f %% Temperature: %3.1f °C", pressure, humidity, temperature);
+  logOut<2>("BME280: %d samples %d failed, spread P %3.2f T %3.2f H %3.2f, quality 0x%02X", 
+    res.samples, res.failed, res.pressureSpread, res.temperatureSpread, res.humiditySpread, res.quality);
+  logOut<2>("BME280: %ld status polls, %ld I2C transactions, time to sample %ld usec", 
+    (long)bmeStats.polls, (long)bmeStats.transactions, (long)pData.sampleUsec);
 }  // of method "getSensorData()"
 
 
-/*************************** getBatteryCapacity ************************** */
+/**************************************************!
+   @brief    readBatteryVoltage()
+   @details  battery voltage and state of charge from battery module. Measured every
+   @details  BAT_MEASURE_INTERVAL calls, in between the last measurement from RTC memory
+   @param    percent: state of charge
+   @param    volt: battery voltage
+   @return   int: true
+***************************************************/
 int readBatteryVoltage(float* percent, float* volt)
 {
-  uint16_t readval;
-
-  *percent = 100;
-  pinMode(VOLTAGE_PIN, INPUT);
-  readval = analogRead(VOLTAGE_PIN);// / 4096.0 * 7.23;      // LOLIN D32 (no voltage divider need already fitted to board.or NODEMCU ESP32 with 100K+100K voltage divider
-  *volt= (float)readval / 4096.0 * 7.23;
-  //float voltage = analogRead(39) / 4096.0 * 7.23;    // NODEMCU ESP32 with 100K+100K voltage divider added
-  //float voltage = analogRead(A0) / 4096.0 * 4.24;    // Wemos / Lolin D1 Mini 100K series resistor added
-  //float voltage = analogRead(A0) / 4096.0 * 5.00;    // Ardunio UNO, no voltage divider required
-  
-  *percent = 2808.3808 * pow(*volt, 4) - 43560.9157 * pow(*volt, 3) + 252848.5888 * pow(*volt, 2) - 650767.4615 * *volt + 626532.5703;
-  
-  if(*percent<0) *percent =0; // to ensure that the above formula does not produce negative values, as it does slightly above 3.5V
+  bool measured;
 
-  if (*volt > 4.19) *percent = 100;
-  else if (*volt <= 3.50) *percent = 0;
+  measured = batUpdate(VOLTAGE_PIN, false);
+  *volt = (float)batData.milliVolt / 1000.0;
+  *percent = (float)batData.socPermille / 10.0;
 
-  sprintf(outstring," readval: %d Voltage: %3.2f Percent: %3.1f\n",readval, *volt,*percent);
-  logOut(2,outstring);
+  if(measured)
+    trace(TR_BATTERY, batData.milliVolt, batData.socPermille);
+  logOut<2>(" %s Voltage: %4.3f spread %d mV Percent: %3.1f\n",
+    measured ? "measured" : "stored", *volt, batData.spreadMv, *percent);
   return(true);
 }
 
@@ -217,7 +221,7 @@ void fillTestData()
   float randomspread = 2.0;
   float cosrange = 5.0;
 
-  logOut(2,(char*)"Filling test data");
+  logOut<2>("Filling test data");
 
   wData.pressHistoryMax= - 1000000;
   wData.pressHistoryMin=   1000000;
@@ -232,6 +236,7 @@ void fillTestData()
   wData.preferencesChanged = true;
   wData.indexFirstPointToDraw = offsetData72hGraph;
   wData.graphicsType = d_graphicsType;
+  wData.targetLifetimeDays = d_targetLifetimeDays;
   //if(wData.applyPressureCorrection) 
   //  wData.applyPressureCorrection = true;
   //  wData.pressureCorrValue = 15.0;
@@ -242,8 +247,7 @@ void fillTestData()
   wData.lastActualSleeptimeAfterMeasUsec = 0; // we have not slept yet. causes measurement ot be started immediately in doWork()
   delay(500);                                // this brings us beyond the 5 sec threshold in doWork()
 
-  sprintf(outstring,"************** fill test data %d ********************\n", wData.dataPresent);
-  logOut(2,outstring);
+  logOut<2>("************** fill test data %d ********************\n", wData.dataPresent);
   for(i=0;i<noDataPoints;i++)
   {
     wData.ageOfDatapoint[i] = (noDataPoints-i) * wData.targetMeasurementIntervalSec; // default spacing: 15 min = 900 sec
@@ -268,13 +272,11 @@ void fillTestData()
         wData.humiHistoryMin = wData.humiHistory[i];      
   }
 
-  sprintf(outstring,"Min/Max Tstdata: P: %3.1f-%3.1f T:  %3.1f-%3.1f H: %d-%d", 
+  logOut<2>("Min/Max Tstdata: P: %3.1f-%3.1f T:  %3.1f-%3.1f H: %d-%d", 
         wData.pressHistoryMin, wData.pressHistoryMax,  wData.tempHistoryMin,  wData.tempHistoryMax,
-        wData.humiHistoryMin, wData.humiHistoryMax);
-  logOut(2,outstring);  
-  sprintf(outstring,"Tstdata: Time: %ld.%06ld sec", 
-        wData.lastMeasurementTimestamp.tv_sec, wData.lastMeasurementTimestamp.tv_usec);
-  logOut(2,outstring);  
+        wData.humiHistoryMin, wData.humiHistoryMax);  
+  logOut<2>("Tstdata: Time: %ld.%06ld sec", 
+        (long)wData.lastMeasurementTimestamp.tv_sec, wData.lastMeasurementTimestamp.tv_usec);  
 
   // 3 hour pressure change value: minus 3h = 12 data points at 15 min per point
   wData.pressure3hChange = wData.pressHistory[noDataPoints-1]-wData.pressHistory[noDataPoints-1-12];
@@ -294,20 +296,37 @@ void fillTestData()
   wData.justInitialized = true;
 }
 
+// mean of the valid values (not nanDATA) of three neighbouring history points, false if none is valid
+static bool validMean3(float v0, float v1, float v2, float* mean)
+{
+  float sum = 0;
+  int n = 0;
+
+  if(v0 < (nanDATA/4)){ sum += v0; n++; }
+  if(v1 < (nanDATA/4)){ sum += v1; n++; }
+  if(v2 < (nanDATA/4)){ sum += v2; n++; }
+  if(n > 0)
+    *mean = sum / n;
+  return(n > 0);
+}
+
 /**************************************************!
    @brief    Function to calculate the pressure, temperature,humdity change during the last 3 hours 
-   @details  using the time information in wData.ageOfDatapoint[i]
+   @details  using the time information in wData.ageOfDatapoint[i]. Invalid points (nanDATA, e.g.
+   @details  failed measurement) are left out, no valid point now or 3 hours ago: change 0
    @return   void
 ***************************************************/
 void calc3HourChanges()
 {
-  int i, marker;
-  uint32_t threeHourMark = 3*3600;
-  float newP, oldP, oldT, newT, oldH, newH;
+  int i, marker = 1;
+  int32_t threeHourMark = 3*3600;
+  float newP, oldP = 0, oldT = 0, newT, oldH = 0, newH;
 
-  for (i=noDataPoints-1; i>0; i--)
+  // youngest point at least 3 hours old. Shorter intervals (button wake) can step over a
+  // window of half an interval, marker stays valid then as well
+  for (i=noDataPoints-2; i>0; i--)
   {
-    if ((wData.ageOfDatapoint[i]-threeHourMark) < wData.targetMeasurementIntervalSec/2)
+    if (wData.ageOfDatapoint[i] >= threeHourMark)
     {
       marker=i;
       break;
@@ -315,31 +334,36 @@ void calc3HourChanges()
   }
 
   //calculate average over three data points for now and three hours ago, changed to only one last point
-  oldP = (wData.pressHistory[marker-1] + wData.pressHistory[marker] + wData.pressHistory[marker+1])/3;
-  //newP = (wData.pressHistory[noDataPoints-1]+wData.pressHistory[noDataPoints-2]+wData.pressHistory[noDataPoints-3])/3;
   newP = wData.pressHistory[noDataPoints-1];
-  wData.pressure3hChange =  newP - oldP;
+  if(validMean3(wData.pressHistory[marker-1], wData.pressHistory[marker], wData.pressHistory[marker+1], &oldP)
+     && newP < (nanDATA/4))
+    wData.pressure3hChange =  newP - oldP;
+  else
+    wData.pressure3hChange = 0;
 
   //same for humidity
-  oldH = (wData.humiHistory[marker-1] + wData.humiHistory[marker] + wData.humiHistory[marker+1])/3;
-  // newH = (wData.humiHistory[noDataPoints-1]+wData.humiHistory[noDataPoints-2]+wData.humiHistory[noDataPoints-3])/3;
   newH = wData.humiHistory[noDataPoints-1];
-  wData.humidity3hChange =  (float)(newH - oldH)/10.0;
+  if(validMean3(wData.humiHistory[marker-1], wData.humiHistory[marker], wData.humiHistory[marker+1], &oldH)
+     && newH < (nanDATA/4))
+    wData.humidity3hChange =  (newH - oldH)/10.0;
+  else
+    wData.humidity3hChange = 0;
 
   //and temperature
-  oldT = (wData.tempHistory[marker-1] + wData.tempHistory[marker] + wData.tempHistory[marker+1])/3;
-  //newT = (wData.tempHistory[noDataPoints-1]+wData.tempHistory[noDataPoints-2]+wData.tempHistory[noDataPoints-3])/3;
   newT = wData.tempHistory[noDataPoints-1];
-  wData.temperature3hChange =  newT - oldT;
+  if(validMean3(wData.tempHistory[marker-1], wData.tempHistory[marker], wData.tempHistory[marker+1], &oldT)
+     && newT < (nanDATA/4))
+    wData.temperature3hChange =  newT - oldT;
+  else
+    wData.temperature3hChange = 0;
 
   //previous simplified method, on point and assuming 900 sec per data point
   //wData.pressure3hChange = wData.pressHistory[noDataPoints-1]-wData.pressHistory[noDataPoints-1-12];
-  sprintf(outstring, "3h:%d t:%ld Pold:%3.2f Pnew:%3.2f 3hC:%3.3f Told:%3.2f, Tnew:%3.2f 3hC:%3.3f Hold:%3.2f Hnew:%3.2f 3hC:%3.3f\n",
-      marker, wData.ageOfDatapoint[marker], 
+  logOut<2>("3h:%d t:%ld Pold:%3.2f Pnew:%3.2f 3hC:%3.3f Told:%3.2f, Tnew:%3.2f 3hC:%3.3f Hold:%3.2f Hnew:%3.2f 3hC:%3.3f\n",
+      marker, (long)wData.ageOfDatapoint[marker], 
       oldP, newP, wData.pressure3hChange, 
       oldT, newT, wData.temperature3hChange,
-      oldH, newH, wData.humidity3hChange);
-  logOut(2,outstring);    
+      oldH, newH, wData.humidity3hChange);    
 }
 
 /**************************************************!
@@ -355,10 +379,9 @@ void outputStoredData(uint16_t l_idx, uint16_t u_idx)
   for(i=0;i<noDataPoints;i++){
     if(i <= l_idx || i >= u_idx){
       //sprintf(outstring,"i: %d, age %ld time_sec: %ld P: %3.1f T: %3.1f H: %3.1f",
-      sprintf(outstring,"i: %d, age %ld P: %3.1f H: %d H: %3.1f",
-        i, wData.ageOfDatapoint[i], //wData.timestampSecondsOfDataPoint[i],
+      logOut<2>("i: %d, age %ld P: %3.1f H: %d H: %3.1f",
+        i, (long)wData.ageOfDatapoint[i], //wData.timestampSecondsOfDataPoint[i],
         wData.pressHistory[i], wData.humiHistory[i], wData.tempHistory[i]);
-      logOut(2,outstring)  ;
     }  
   }
 
@@ -375,8 +398,7 @@ void quarterMeasurementScale()
   int16_t i, idx;
   uint32_t interv;
 
-  sprintf(outstring,"Before quarterMScale: wData.targetMeasurementIntervalSec: %ld",  wData.targetMeasurementIntervalSec);
-  logOut(2,outstring);
+  logOut<2>("Before quarterMScale: wData.targetMeasurementIntervalSec: %ld",  (long)wData.targetMeasurementIntervalSec);
 
   //outputStoredData(5, noDataPoints-5); // limited ouput
   outputStoredData(noDataPoints, 0);   // output all 
@@ -392,10 +414,9 @@ void quarterMeasurementScale()
   for(i=3*noDataPoints/4; i<noDataPoints; i++){
     if(idx<30 || idx > (noDataPoints-10))
     {
-      sprintf(outstring, "idx: %d i: %d age[idx, i] %ld %ld: P[idx, i]: %3.1f %3.1f", 
-        idx, i, wData.ageOfDatapoint[idx], wData.ageOfDatapoint[i],
+      logOut<2>("idx: %d i: %d age[idx, i] %ld %ld: P[idx, i]: %3.1f %3.1f", 
+        idx, i, (long)wData.ageOfDatapoint[idx], (long)wData.ageOfDatapoint[i],
         wData.pressHistory[idx], wData.pressHistory[i]);
-      logOut(2,outstring);
     }  
     wData.ageOfDatapoint[idx]             = wData.ageOfDatapoint[i];
     //wData.timestampSecondsOfDataPoint[idx]= wData.timestampSecondsOfDataPoint[i];
@@ -432,8 +453,7 @@ void quarterMeasurementScale()
      //logOut(2,outstring);
   } 
 
-  sprintf(outstring,"After quarterMScale: wData.targetMeasurementIntervalSec: %ld",  wData.targetMeasurementIntervalSec);
-  logOut(2,outstring);
+  logOut<2>("After quarterMScale: wData.targetMeasurementIntervalSec: %ld",  (long)wData.targetMeasurementIntervalSec);
   //outputStoredData(5, noDataPoints-5); // limited ouput
   outputStoredData(noDataPoints, 0);   // output all 
 }
@@ -449,8 +469,7 @@ void halfMeasurementScale()
   int16_t i, idx;
   uint32_t interv;
 
-  sprintf(outstring,"Before halfMScale: wData.targetMeasurementIntervalSec: %ld",  wData.targetMeasurementIntervalSec);
-  logOut(2,outstring);
+  logOut<2>("Before halfMScale: wData.targetMeasurementIntervalSec: %ld",  (long)wData.targetMeasurementIntervalSec);
   //outputStoredData(5, noDataPoints-5); // limited ouput
   outputStoredData(noDataPoints, 0);   // output all 
 
@@ -465,10 +484,9 @@ void halfMeasurementScale()
   for(i=noDataPoints/2; i<noDataPoints; i++){
     if(idx<15 || idx > (noDataPoints-10))
     {
-      sprintf(outstring, "idx: %d i: %d age[idx, i] %ld %ld: P[idx, i]: %3.1f %3.1f", 
-        idx, i, wData.ageOfDatapoint[idx], wData.ageOfDatapoint[i],
+      logOut<2>("idx: %d i: %d age[idx, i] %ld %ld: P[idx, i]: %3.1f %3.1f", 
+        idx, i, (long)wData.ageOfDatapoint[idx], (long)wData.ageOfDatapoint[i],
         wData.pressHistory[idx], wData.pressHistory[i]);
-      logOut(2,outstring);
     }  
     wData.ageOfDatapoint[idx]             = wData.ageOfDatapoint[i];
     //wData.timestampSecondsOfDataPoint[idx]= wData.timestampSecondsOfDataPoint[i];
@@ -491,8 +509,7 @@ void halfMeasurementScale()
      idx++;
   } 
 
-  sprintf(outstring,"After halfMScale: wData.targetMeasurementIntervalSec: %ld",  wData.targetMeasurementIntervalSec);
-  logOut(2,outstring);
+  logOut<2>("After halfMScale: wData.targetMeasurementIntervalSec: %ld",  (long)wData.targetMeasurementIntervalSec);
   //outputStoredData(5, noDataPoints-5); // limited ouput
   outputStoredData(noDataPoints, 0);   // output all 
 }
@@ -508,8 +525,7 @@ void quadrupleMeasurementScale()
   int16_t i, idx;
   uint32_t interv;
 
-  sprintf(outstring,"Before quadrupleMScale: wData.targetMeasurementIntervalSec: %ld",  wData.targetMeasurementIntervalSec);
-  logOut(2,outstring);
+  logOut<2>("Before quadrupleMScale: wData.targetMeasurementIntervalSec: %ld",  (long)wData.targetMeasurementIntervalSec);
   //outputStoredData(5, noDataPoints-5); // limited ouput
   outputStoredData(noDataPoints, 0);   // output all 
 
@@ -524,10 +540,9 @@ void quadrupleMeasurementScale()
   for(i=(noDataPoints-1); i>0; i-=4){
     if(idx<15 || idx > (noDataPoints-10))
     {
-      sprintf(outstring, "idx: %d i: %d age[idx, i] %ld %ld: P[idx, i]: %3.1f %3.1f", 
-        idx, i, wData.ageOfDatapoint[idx], wData.ageOfDatapoint[i],
+      logOut<2>("idx: %d i: %d age[idx, i] %ld %ld: P[idx, i]: %3.1f %3.1f", 
+        idx, i, (long)wData.ageOfDatapoint[idx], (long)wData.ageOfDatapoint[i],
         wData.pressHistory[idx], wData.pressHistory[i]);
-      logOut(2,outstring);
     }  
     wData.ageOfDatapoint[idx]             = (wData.ageOfDatapoint[i]              +wData.ageOfDatapoint[i-1]              +wData.ageOfDatapoint[i-2]              +wData.ageOfDatapoint[i-3])/4;
     //wData.timestampSecondsOfDataPoint[idx]= (wData.timestampSecondsOfDataPoint[i] +wData.timestampSecondsOfDataPoint[i-1] +wData.timestampSecondsOfDataPoint[i-2] +wData.timestampSecondsOfDataPoint[i-3])/4;
@@ -572,8 +587,7 @@ void quadrupleMeasurementScale()
      idx++;
   } 
 
-  sprintf(outstring,"After quadrupleMScale: wData.targetMeasurementIntervalSec: %ld",  wData.targetMeasurementIntervalSec);
-  logOut(2,outstring);
+  logOut<2>("After quadrupleMScale: wData.targetMeasurementIntervalSec: %ld",  (long)wData.targetMeasurementIntervalSec);
   //outputStoredData(5, noDataPoints-5); // limited ouput
   outputStoredData(noDataPoints, 0);   // output all 
 }
@@ -589,8 +603,7 @@ void doubleMeasurementScale()
   int16_t i, idx;
   uint32_t interv;
 
-  sprintf(outstring,"Before doubleMScale: wData.targetMeasurementIntervalSec: %ld",  wData.targetMeasurementIntervalSec);
-  logOut(2,outstring);
+  logOut<2>("Before doubleMScale: wData.targetMeasurementIntervalSec: %ld",  (long)wData.targetMeasurementIntervalSec);
   //outputStoredData(5, noDataPoints-5); // limited ouput
   outputStoredData(noDataPoints, 0);   // output all 
 
@@ -605,10 +618,9 @@ void doubleMeasurementScale()
   for(i=(noDataPoints-1); i>0; i-=2){
     if(idx<15 || idx > (noDataPoints-10))
     {
-      sprintf(outstring, "idx: %d i: %d age[idx, i] %ld %ld: P[idx, i]: %3.1f %3.1f", 
-        idx, i, wData.ageOfDatapoint[idx], wData.ageOfDatapoint[i],
+      logOut<2>("idx: %d i: %d age[idx, i] %ld %ld: P[idx, i]: %3.1f %3.1f", 
+        idx, i, (long)wData.ageOfDatapoint[idx], (long)wData.ageOfDatapoint[i],
         wData.pressHistory[idx], wData.pressHistory[i]);
-      logOut(2,outstring);
     }  
     wData.ageOfDatapoint[idx]             = (wData.ageOfDatapoint[i]              +wData.ageOfDatapoint[i-1]              )/2;
     //wData.timestampSecondsOfDataPoint[idx]= (wData.timestampSecondsOfDataPoint[i] +wData.timestampSecondsOfDataPoint[i-1] )/2;
@@ -651,8 +663,7 @@ void doubleMeasurementScale()
      idx++;
   }  
 
-  sprintf(outstring,"After doubleMScale: wData.targetMeasurementIntervalSec: %ld",  wData.targetMeasurementIntervalSec);
-  logOut(2,outstring);
+  logOut<2>("After doubleMScale: wData.targetMeasurementIntervalSec: %ld",  (long)wData.targetMeasurementIntervalSec);
   //outputStoredData(5, noDataPoints-5); // limited ouput
   outputStoredData(noDataPoints, 0);   // output all 
 }
@@ -706,11 +717,12 @@ void storeMeasurementData()
   wData.batteryVoltage = volt;
   wData.batteryPercent = percent;
 
-  // sensor data BME280
+  // sensor data BME280. Failed measurement (NaN): history points marked invalid
   wData.actPressureRaw = pressure;
   wData.actPressureCorr= pressure + wData.pressureCorrValue;
   wData.actTemperature = temperature;
-  wData.actHumidity    = (int)(10*humidity + 0.5);  // humidity stored in promille as integer
+  wData.actHumidity    = isnan(humidity) ? nanDATA : (int)(10*humidity + 0.5);  // humidity stored in promille as integer
+  wData.actQuality     = measQuality;
 
   // shift older data, check min / max
   wData.pressHistoryMax = -1;
@@ -725,35 +737,49 @@ void storeMeasurementData()
     wData.pressHistory[i]  = wData.pressHistory[i+1];
     wData.tempHistory[i]   = wData.tempHistory[i+1];
     wData.humiHistory[i]   = wData.humiHistory[i+1];
+    wData.qualHistory[i]   = wData.qualHistory[i+1];
     wData.ageOfDatapoint[i]= wData.ageOfDatapoint[i+1] + wData.lastTargetSleeptime; // shift and increment age of data point
 
-    // also check for min / max in remaining data. Last point is checked in next step below
-    if(wData.pressHistory[i] > wData.pressHistoryMax)  wData.pressHistoryMax = wData.pressHistory[i];
-    if(wData.pressHistory[i] < wData.pressHistoryMin)  wData.pressHistoryMin = wData.pressHistory[i];
-    if(wData.tempHistory[i] > wData.tempHistoryMax)  wData.tempHistoryMax = wData.tempHistory[i];
-    if(wData.tempHistory[i] < wData.tempHistoryMin)  wData.tempHistoryMin = wData.tempHistory[i];
-    if(wData.humiHistory[i] > wData.humiHistoryMax)  wData.humiHistoryMax = wData.humiHistory[i];
-    if(wData.humiHistory[i] < wData.humiHistoryMin)  wData.humiHistoryMin = wData.humiHistory[i];
+    // also check for min / max in remaining data, invalid points (nanDATA) skipped. Last point is checked in next step below
+    if(wData.pressHistory[i] < (nanDATA/4)){
+      if(wData.pressHistory[i] > wData.pressHistoryMax)  wData.pressHistoryMax = wData.pressHistory[i];
+      if(wData.pressHistory[i] < wData.pressHistoryMin)  wData.pressHistoryMin = wData.pressHistory[i];
+    }
+    if(wData.tempHistory[i] < (nanDATA/4)){
+      if(wData.tempHistory[i] > wData.tempHistoryMax)  wData.tempHistoryMax = wData.tempHistory[i];
+      if(wData.tempHistory[i] < wData.tempHistoryMin)  wData.tempHistoryMin = wData.tempHistory[i];
+    }
+    if(wData.humiHistory[i] < (nanDATA/4)){
+      if(wData.humiHistory[i] > wData.humiHistoryMax)  wData.humiHistoryMax = wData.humiHistory[i];
+      if(wData.humiHistory[i] < wData.humiHistoryMin)  wData.humiHistoryMin = wData.humiHistory[i];
+    }
   }
 
   // add newest data
-  wData.pressHistory[noDataPoints-1]  = wData.actPressureRaw;
-  wData.tempHistory[noDataPoints-1]   = wData.actTemperature;
+  wData.pressHistory[noDataPoints-1]  = isnan(wData.actPressureRaw) ? nanDATA : wData.actPressureRaw;
+  wData.tempHistory[noDataPoints-1]   = isnan(wData.actTemperature) ? nanDATA : wData.actTemperature;
   wData.humiHistory[noDataPoints-1]   = wData.actHumidity;
+  wData.qualHistory[noDataPoints-1]   = wData.actQuality;
+  dsShiftHistory();   // DS18B20 channels: newest value filled in by dsCollect()
   wData.ageOfDatapoint[noDataPoints-1]= 0; // latest data point is at 0 seconds age
 
   // min/max handling for new data
-  if(wData.pressHistory[noDataPoints-1] > wData.pressHistoryMax)  wData.pressHistoryMax = wData.pressHistory[noDataPoints-1];
-  if(wData.pressHistory[noDataPoints-1] < wData.pressHistoryMin)  wData.pressHistoryMin = wData.pressHistory[noDataPoints-1];
-  if(wData.tempHistory[noDataPoints-1] > wData.tempHistoryMax)  wData.tempHistoryMax = wData.tempHistory[noDataPoints-1];
-  if(wData.tempHistory[noDataPoints-1] < wData.tempHistoryMin)  wData.tempHistoryMin = wData.tempHistory[noDataPoints-1];
-  if(wData.humiHistory[noDataPoints-1] > wData.humiHistoryMax)  wData.humiHistoryMax = wData.humiHistory[noDataPoints-1];
-  if(wData.humiHistory[noDataPoints-1] < wData.humiHistoryMin)  wData.humiHistoryMin = wData.humiHistory[noDataPoints-1];
-
-  sprintf(outstring,"Min/Max StorMeasedata: P: %3.1f-%3.1f T:  %3.1f-%3.1f H:  %d-%d", 
+  if(wData.pressHistory[noDataPoints-1] < (nanDATA/4)){
+    if(wData.pressHistory[noDataPoints-1] > wData.pressHistoryMax)  wData.pressHistoryMax = wData.pressHistory[noDataPoints-1];
+    if(wData.pressHistory[noDataPoints-1] < wData.pressHistoryMin)  wData.pressHistoryMin = wData.pressHistory[noDataPoints-1];
+  }
+  if(wData.tempHistory[noDataPoints-1] < (nanDATA/4)){
+    if(wData.tempHistory[noDataPoints-1] > wData.tempHistoryMax)  wData.tempHistoryMax = wData.tempHistory[noDataPoints-1];
+    if(wData.tempHistory[noDataPoints-1] < wData.tempHistoryMin)  wData.tempHistoryMin = wData.tempHistory[noDataPoints-1];
+  }
+  if(wData.humiHistory[noDataPoints-1] < (nanDATA/4)){
+    if(wData.humiHistory[noDataPoints-1] > wData.humiHistoryMax)  wData.humiHistoryMax = wData.humiHistory[noDataPoints-1];
+    if(wData.humiHistory[noDataPoints-1] < wData.humiHistoryMin)  wData.humiHistoryMin = wData.humiHistory[noDataPoints-1];
+  }
+
+  logOut<2>("Min/Max StorMeasedata: P: %3.1f-%3.1f T:  %3.1f-%3.1f H:  %d-%d", 
         wData.pressHistoryMin, wData.pressHistoryMax,  wData.tempHistoryMin,  wData.tempHistoryMax,
-        wData.humiHistoryMin, wData.humiHistoryMax);
-  logOut(2,outstring);      
+        wData.humiHistoryMin, wData.humiHistoryMax);      
 
   // don't forget to write the target sleeptime in sec last - needed next time!
   wData.lastTargetSleeptime = wData.targetMeasurementIntervalSec;
@@ -777,219 +803,554 @@ uint32_t print_wakeup_reason()
   wakeup_reason = esp_sleep_get_wakeup_cause();
 
   switch (wakeup_reason) {
-    case ESP_SLEEP_WAKEUP_EXT0:     logOut(2,(char*)"Wakeup caused by external signal using RTC_IO"); break;
-    case ESP_SLEEP_WAKEUP_EXT1:     logOut(2,(char*)"Wakeup caused by external signal using RTC_CNTL"); break;
-    case ESP_SLEEP_WAKEUP_TIMER:    logOut(2,(char*)"Wakeup caused by timer"); break;
-    case ESP_SLEEP_WAKEUP_TOUCHPAD: logOut(2,(char*)"Wakeup caused by touchpad"); break;
-    case ESP_SLEEP_WAKEUP_ULP:      logOut(2,(char*)"Wakeup caused by ULP program"); break;
-    default:                        sprintf(outstring,"Wakeup was not caused by deep sleep: %d\n", wakeup_reason); break;
-                                    logOut(2, outstring);
+    case ESP_SLEEP_WAKEUP_EXT0:     logOut<2>("Wakeup caused by external signal using RTC_IO"); break;
+    case ESP_SLEEP_WAKEUP_EXT1:     logOut<2>("Wakeup caused by external signal using RTC_CNTL"); break;
+    case ESP_SLEEP_WAKEUP_TIMER:    logOut<2>("Wakeup caused by timer"); break;
+    case ESP_SLEEP_WAKEUP_TOUCHPAD: logOut<2>("Wakeup caused by touchpad"); break;
+    case ESP_SLEEP_WAKEUP_ULP:      logOut<2>("Wakeup caused by ULP program"); break;
+    default:                        logOut<2>("Wakeup was not caused by deep sleep: %d", wakeup_reason); break;
   }
   return(wakeup_reason);
 }
 
-#ifdef isPushButtons
-  #ifdef isButtonInterrupts
-  /*****************************************************************************! 
-    @brief  push button interrupt routines
-    @details 
-    @return void
-  *****************************************************************************/
-  void ARDUINO_ISR_ATTR button1Handler()
-  {
-    if(!button1.pressed)  // avoid repeated pressed to be counted, entprellen
-      button1.numberKeyPresses += 1;
-    button1.pressed = true;
-    //sprintf(outstring, "Button 1 pressed %d\n", button1.numberKeyPresses);
-    //logOut(2,outstring);
-  }
 
-  void ARDUINO_ISR_ATTR button2Handler()
-  {
-    if(!button2.pressed)  // avoid repeated pressed to be counted, entprellen
-    {
-      button2.numberKeyPresses += 1;
-      // change scale
-      //changeMeasurementScale();
-    }  
-    button2.pressed = true;
-    //printf(outstring, "Button 2 pressed %d\n", button2.numberKeyPresses);
-    //logOut(2,outstring);
+/*****************************************************************************! 
+  @brief  settingsFromWData()
+  @details copy the preference values from wData to a persistentSettings struct
+  @param  s : destination
+  @return void
+*****************************************************************************/
+void settingsFromWData(persistentSettings* s)
+{
+  memset(s, 0, sizeof(persistentSettings));
+  s->applyPressureCorrection = wData.applyPressureCorrection;
+  s->applyInversion          = wData.applyInversion;
+  s->pressureCorrValue       = wData.pressureCorrValue;
+  s->measIntervalSec         = wData.targetMeasurementIntervalSec;
+  s->timeRangeHours          = wData.graphTimeRangeHours;
+  s->graphicsType            = wData.graphicsType;
+  s->targetLifetimeDays      = wData.targetLifetimeDays;
+}
+
+/*****************************************************************************! 
+  @brief  settingsToWData()
+  @details copy the preference values from a persistentSettings struct to wData
+  @param  s : source
+  @return void
+*****************************************************************************/
+void settingsToWData(const persistentSettings* s)
+{
+  wData.applyPressureCorrection      = s->applyPressureCorrection;
+  wData.applyInversion               = s->applyInversion;
+  wData.pressureCorrValue            = s->pressureCorrValue;
+  wData.targetMeasurementIntervalSec = s->measIntervalSec;
+  wData.graphTimeRangeHours          = s->timeRangeHours;
+  wData.graphicsType                 = s->graphicsType;
+  wData.targetLifetimeDays           = s->targetLifetimeDays;
+}
+
+/*****************************************************************************! 
+  @brief  settingsDefaults()
+  @details default preference values
+  @param  s : destination
+  @return void
+*****************************************************************************/
+void settingsDefaults(persistentSettings* s)
+{
+  memset(s, 0, sizeof(persistentSettings));
+  s->applyPressureCorrection = d_applyPressureCorrection;
+  s->applyInversion          = d_applyInversion;
+  s->pressureCorrValue       = d_pressureCorrValue;
+  s->measIntervalSec         = d_measIntervalSec;
+  s->timeRangeHours          = d_timeRangeHours;
+  s->graphicsType            = d_graphicsType;
+  s->targetLifetimeDays      = d_targetLifetimeDays;
+}
+
+/*****************************************************************************! 
+  @brief  srPut(), srGet()
+  @details bit field of the settings record, from bit *shift upwards. *shift is advanced
+  @return record with the field set / value of the field
+*****************************************************************************/
+static uint64_t srPut(uint64_t record, uint32_t value, int bits, int* shift)
+{
+  record |= ((uint64_t)value & ((1ULL << bits) - 1)) << *shift;
+  *shift += bits;
+  return(record);
+}
+
+static uint32_t srGet(uint64_t record, int bits, int* shift)
+{
+  uint32_t value = (uint32_t)((record >> *shift) & ((1ULL << bits) - 1));
+  *shift += bits;
+  return(value);
+}
+
+/*****************************************************************************! 
+  @brief  settingsPack()
+  @details pack the settings into the 64 bit settings record (layout: SR_xxx_BITS).
+  @details the pressure correction is kept in 0.01 hPa
+  @param  s : settings
+  @return uint64_t settings record
+*****************************************************************************/
+uint64_t settingsPack(const persistentSettings* s)
+{
+  uint64_t record = 0;
+  int shift = 0;
+  int32_t pcorr = (int32_t)lroundf(s->pressureCorrValue * SR_PCORR_SCALE);
+
+  record = srPut(record, SETTINGS_RECORD_VERSION, SR_VERSION_BITS, &shift);
+  record = srPut(record, s->applyPressureCorrection ? 1 : 0, 1, &shift);
+  record = srPut(record, s->applyInversion ? 1 : 0, 1, &shift);
+  record = srPut(record, s->graphicsType, SR_GRAPHICS_BITS, &shift);
+  record = srPut(record, s->timeRangeHours, SR_RANGE_BITS, &shift);
+  record = srPut(record, s->measIntervalSec, SR_INTERVAL_BITS, &shift);
+  record = srPut(record, s->targetLifetimeDays, SR_LIFETIME_BITS, &shift);
+  record = srPut(record, (uint16_t)(int16_t)pcorr, SR_PCORR_BITS, &shift);
+  return(record);
+}
+
+/*****************************************************************************! 
+  @brief  settingsUnpack()
+  @details settings from the 64 bit settings record. The record is checked for version,
+  @details unused bits and a time range / interval > 0; NVS has a crc per entry
+  @param  record : settings record as read from NVS
+  @param  s : destination, only changed if the record is valid
+  @return bool: true if valid
+*****************************************************************************/
+bool settingsUnpack(uint64_t record, persistentSettings* s)
+{
+  persistentSettings v;
+  int shift = 0;
+
+  memset(&v, 0, sizeof(v));
+  if(srGet(record, SR_VERSION_BITS, &shift) != SETTINGS_RECORD_VERSION)
+    return(false);
+  v.applyPressureCorrection = srGet(record, 1, &shift) != 0;
+  v.applyInversion          = srGet(record, 1, &shift) != 0;
+  v.graphicsType            = srGet(record, SR_GRAPHICS_BITS, &shift);
+  v.timeRangeHours          = srGet(record, SR_RANGE_BITS, &shift);
+  v.measIntervalSec         = srGet(record, SR_INTERVAL_BITS, &shift);
+  v.targetLifetimeDays      = srGet(record, SR_LIFETIME_BITS, &shift);
+  v.pressureCorrValue       = (int16_t)srGet(record, SR_PCORR_BITS, &shift) / SR_PCORR_SCALE;
+  if((record >> shift) != 0 || v.timeRangeHours == 0 || v.measIntervalSec == 0)
+    return(false);
+  *s = v;
+  return(true);
+}
+
+/*****************************************************************************! 
+  @brief  alertsBlobFromRules()
+  @details build the alert rules blob, version, size and crc
+  @param  a : destination
+  @param  rules : ALERT_MAX_RULES rules
+  @return void
+*****************************************************************************/
+void alertsBlobFromRules(alertsBlob* a, const alertRule* rules)
+{
+  memset(a, 0, sizeof(alertsBlob));   // defined padding bytes for crc and compare
+  a->version = ALERTS_BLOB_VERSION;
+  a->size    = sizeof(alertsBlob);
+  memcpy(a->rules, rules, sizeof(a->rules));
+  a->crc     = esp_rom_crc32_le(0x5EED, (const uint8_t*)a, offsetof(alertsBlob, crc));
+}
+
+/*****************************************************************************! 
+  @brief  alertsBlobValid()
+  @details check version, size and crc of an alert rules blob read from NVS
+  @param  a : alert rules blob
+  @param  bytes : number of bytes read from NVS
+  @return bool: true if valid
+*****************************************************************************/
+bool alertsBlobValid(const alertsBlob* a, size_t bytes)
+{
+  return((bytes == sizeof(alertsBlob)) && (a->version == ALERTS_BLOB_VERSION) && (a->size == sizeof(alertsBlob))
+      && (a->crc == esp_rom_crc32_le(0x5EED, (const uint8_t*)a, offsetof(alertsBlob, crc))));
+}
+
+/*****************************************************************************! 
+  @brief  settingsCacheChecksum()
+  @details crc32 over record, generation and alert rules of the RTC settings cache
+  @return uint32_t checksum
+*****************************************************************************/
+uint32_t settingsCacheChecksum()
+{
+  // seed != 0: RTC memory cleared to zero after power on never has a valid checksum
+  return(esp_rom_crc32_le(0x5EED, (const uint8_t*)&sCache, offsetof(settingsCacheData, checksum)));
+}
+
+/*****************************************************************************! 
+  @brief  settingsCacheStore()
+  @details store the settings record and alert rules as in NVS in the RTC settings cache
+  @param  record : settings record as in NVS
+  @param  a : alert rules blob as in NVS
+  @return void
+*****************************************************************************/
+void settingsCacheStore(uint64_t record, const alertsBlob* a)
+{
+  sCache.record = record;
+  sCache.alerts = *a;
+  sCache.checksum = settingsCacheChecksum();
+}
+
+/*****************************************************************************! 
+  @brief  settingsFromBlobV2()
+  @details take settings, alert rules and counters from a blob of version 2
+  @param  s : destination settings
+  @param  rules : destination alert rules
+  @param  counters : destination startCounter, dischgCnt, prevMicrovolt
+  @param  old : blob as read from NVS
+  @return bool: true if old is a valid blob of version 2
+*****************************************************************************/
+bool settingsFromBlobV2(persistentSettings* s, alertRule* rules, uint32_t* counters, const settingsBlobV2* old)
+{
+  if(old->version != 2 || old->size != sizeof(settingsBlobV2)
+     || old->crc != esp_rom_crc32_le(0x5EED, (const uint8_t*)old, offsetof(settingsBlobV2, crc)))
+    return(false);
+  s->applyPressureCorrection = old->values.applyPressureCorrection;
+  s->applyInversion          = old->values.applyInversion;
+  s->pressureCorrValue       = old->values.pressureCorrValue;
+  s->measIntervalSec         = old->values.measIntervalSec;
+  s->timeRangeHours          = old->values.timeRangeHours;
+  s->graphicsType            = old->values.graphicsType;
+  s->targetLifetimeDays      = old->values.targetLifetimeDays;
+  memcpy(rules, old->values.alertRules, sizeof(old->values.alertRules));
+  counters[0] = old->startCounter;
+  counters[1] = old->dischgCnt;
+  counters[2] = old->prevMicrovolt;
+  return(true);
+}
+
+/*****************************************************************************! 
+  @brief  settingsFromBlobV1()
+  @details take settings and counters from a blob of version 1, which has no alert rules:
+  @details the rules are left unchanged (defaults)
+  @param  s : destination settings
+  @param  counters : destination startCounter, dischgCnt, prevMicrovolt
+  @param  old : blob as read from NVS
+  @return bool: true if old is a valid blob of version 1
+*****************************************************************************/
+bool settingsFromBlobV1(persistentSettings* s, uint32_t* counters, const settingsBlobV1* old)
+{
+  if(old->version != 1 || old->size != sizeof(settingsBlobV1)
+     || old->crc != esp_rom_crc32_le(0x5EED, (const uint8_t*)old, offsetof(settingsBlobV1, crc)))
+    return(false);
+  s->applyPressureCorrection = old->values.applyPressureCorrection;
+  s->applyInversion          = old->values.applyInversion;
+  s->pressureCorrValue       = old->values.pressureCorrValue;
+  s->measIntervalSec         = old->values.measIntervalSec;
+  s->timeRangeHours          = old->values.timeRangeHours;
+  s->graphicsType            = old->values.graphicsType;
+  s->targetLifetimeDays      = old->values.targetLifetimeDays;
+  counters[0] = old->startCounter;
+  counters[1] = old->dischgCnt;
+  counters[2] = old->prevMicrovolt;
+  return(true);
+}
+
+// keys of the former layouts: one key per setting, counters under prefIDENT (written) or
+// "prefs" (read), settings blob of version 1 / 2
+static const char* oldPrefKeys[] = {"applyPCorr", "pCorrValue", "applyInversion", "measIntervalSec",
+                                    "timeRangeHours", "graphicsType", "lifeDays", prefIDENT, "prefs", prefBLOBKEY};
+
+/*****************************************************************************! 
+  @brief  readLegacyPreferences()
+  @details read the old layout with one NVS key per setting. The keys are not removed here:
+  @details see removeOldPreferences(). Counters were written under key prefIDENT, but read
+  @details from "prefs": both are checked. Preferences namespace must be open
+  @param  s : destination settings, values not found in NVS are left unchanged
+  @param  counters : destination startCounter, dischgCnt, prevMicrovolt
+  @return bool: true if any key of the old layout has been found
+*****************************************************************************/
+bool readLegacyPreferences(persistentSettings* s, uint32_t* counters)
+{
+  float oldCounters[4] = {0.0, 0.0, 0.0, 0.0};
+  bool found = false;
+
+  if(preferences.isKey("applyPCorr"))
+    { s->applyPressureCorrection = preferences.getBool("applyPCorr", d_applyPressureCorrection); found = true; }
+  if(preferences.isKey("pCorrValue"))
+    { s->pressureCorrValue = preferences.getFloat("pCorrValue", d_pressureCorrValue); found = true; }
+  if(preferences.isKey("applyInversion"))
+    { s->applyInversion = preferences.getBool("applyInversion", d_applyInversion); found = true; }
+  if(preferences.isKey("measIntervalSec"))
+    { s->measIntervalSec = preferences.getULong("measIntervalSec", d_measIntervalSec); found = true; }
+  if(preferences.isKey("timeRangeHours"))
+    { s->timeRangeHours = preferences.getULong("timeRangeHours", d_timeRangeHours); found = true; }
+  if(preferences.isKey("graphicsType"))
+    { s->graphicsType = preferences.getULong("graphicsType", d_graphicsType); found = true; }
+  if(preferences.isKey("lifeDays"))
+    { s->targetLifetimeDays = preferences.getULong("lifeDays", d_targetLifetimeDays); found = true; }
+  //----- counters etc.
+  if((preferences.getBytes(prefIDENT, oldCounters, sizeof(oldCounters)) == sizeof(oldCounters))
+   ||(preferences.getBytes("prefs", oldCounters, sizeof(oldCounters)) == sizeof(oldCounters))){
+    counters[0] = oldCounters[0];
+    counters[1] = oldCounters[1];
+    counters[2] = oldCounters[2];
+    found = true;
   }
+  return(found);
+}
 
-  void ARDUINO_ISR_ATTR button3Handler()
-  {
-    if(!button3.pressed)  // avoid repeated pressed to be counted, entprellen
-    {
-      button3.numberKeyPresses += 1;
-      // toggle pressure correction
-      wData.applyPressureCorrection = !wData.applyPressureCorrection;
+/*****************************************************************************! 
+  @brief  readOldPreferences()
+  @details read settings, rules and counters of a former layout: settings blob of version
+  @details 2 or 1, or one key per setting. Preferences namespace must be open
+  @param  s : destination settings, defaults if nothing is found
+  @param  rules : destination alert rules, defaults if not in the old layout
+  @param  counters : destination startCounter, dischgCnt, prevMicrovolt, 0 if not found
+  @return const char*: layout found, "defaults" if none
+*****************************************************************************/
+const char* readOldPreferences(persistentSettings* s, alertRule* rules, uint32_t* counters)
+{
+  settingsBlobV2 blobV2;
+  settingsBlobV1 blobV1;
+  size_t bytes;
+
+  settingsDefaults(s);
+  alertDefaultRules(rules);
+  counters[0] = counters[1] = counters[2] = 0;
+  memset(&blobV2, 0, sizeof(blobV2));
+  memset(&blobV1, 0, sizeof(blobV1));
+  bytes = preferences.getBytesLength(prefBLOBKEY);
+  if(bytes == sizeof(blobV2) && preferences.getBytes(prefBLOBKEY, &blobV2, sizeof(blobV2)) == sizeof(blobV2)
+     && settingsFromBlobV2(s, rules, counters, &blobV2))
+    return("version 2");
+  if(bytes == sizeof(blobV1) && preferences.getBytes(prefBLOBKEY, &blobV1, sizeof(blobV1)) == sizeof(blobV1)
+     && settingsFromBlobV1(s, counters, &blobV1))
+    return("version 1");
+  return(readLegacyPreferences(s, counters) ? "migrated" : "defaults");
+}
 
-      //sprintf(outstring, "Button 3 pressed %d PressurecCorrection toggled to %d\n", 
-      //        button3.numberKeyPresses, wData.applyPressureCorrection);
-      //logOut(2,outstring);
-    }  
-    button3.pressed = true;
-   }
-   #endif // isButtonInterrupts
-#endif // isPushButtons
+/*****************************************************************************! 
+  @brief  removeOldPreferences()
+  @details remove the keys of the former layouts. Only called after the new layout has
+  @details been written completely. Preferences namespace must be open in rw mode
+  @return void
+*****************************************************************************/
+void removeOldPreferences()
+{
+  int i;
+
+  for(i=0; i<(int)(sizeof(oldPrefKeys)/sizeof(oldPrefKeys[0])); i++){
+    if(preferences.isKey(oldPrefKeys[i]))
+      preferences.remove(oldPrefKeys[i]);
+  }
+}
 
 /*****************************************************************************! 
   @brief  read all preferences values
-  @details remember: short names (max 15 char), otherwise not stored
+  @details the settings are one 64 bit record (settingsPack()), the alert rules a versioned,
+  @details crc checked blob. Counters are in the counter journal, the counter key is a fallback.
+  @details NVS is read only after cold boot, or if the RTC settings cache is corrupted.
+  @details otherwise the values are taken from the RTC cache.
+  @details if no valid record is found, a former layout is migrated, or defaults are written.
+  @details the former keys are removed only after rules, counters and record are written
   @return void
 *****************************************************************************/
 void readPreferences()
 {
-    preferences.begin(prefIDENT, true);
-    //----- counters etc.
-    int bytes=preferences.getBytes("prefs", prefs, sizeof(prefs));
-    //----- pressure correction
-    if(preferences.isKey("applyPCorr"))
-      wData.applyPressureCorrection = preferences.getBool("applyPCorr", d_applyPressureCorrection);
-    else {  // set default    
-      wData.applyPressureCorrection = d_applyPressureCorrection;
-      preferences.putBool("applyPCorr", wData.applyPressureCorrection);
-    }  
-    //----- pressure correction value
-    if(preferences.isKey("pCorrValue"))
-      wData.pressureCorrValue = preferences.getFloat("pCorrValue", d_pressureCorrValue);
-    else {  // set default    
-      wData.pressureCorrValue = d_pressureCorrValue;
-      preferences.putFloat("pCorrValue", wData.pressureCorrValue);
-    }  
-    //----- screen inversion
-    if(preferences.isKey("applyInversion"))
-      wData.applyInversion = preferences.getBool("applyInversion", d_applyInversion);
-    else {  // set default    
-      wData.applyInversion = d_applyInversion;
-      preferences.putBool("applyInversion", wData.applyInversion);
-    }  
-    //----- measurement interval in sec
-    if(preferences.isKey("measIntervalSec"))
-      wData.targetMeasurementIntervalSec = preferences.getULong("measIntervalSec", d_measIntervalSec);
-    else {  // set default    
-      wData.targetMeasurementIntervalSec = d_measIntervalSec;
-      preferences.putULong("measIntervalSec", wData.targetMeasurementIntervalSec);
-    }  
-    //+++ test: for initialization if it was wrong. Needs the changed-marker too to initiate writing
-    //wData.targetMeasurementIntervalSec = d_measIntervalSec;
-    //wData.preferencesChanged = true;
-
-    //----- time range to display in hours
-    if(preferences.isKey("timeRangeHours"))
-      wData.graphTimeRangeHours = preferences.getULong("timeRangeHours", d_timeRangeHours);
-    else {  // set default    
-      wData.graphTimeRangeHours = d_timeRangeHours;
-      preferences.putULong("timeRangeHours", wData.graphTimeRangeHours);
-    }  
-
-    //----- graphicsType
-    if(preferences.isKey("graphicsType"))
-      wData.graphicsType = preferences.getULong("graphicsType", 0);
-    else {  // set default    
-      wData.graphicsType = d_graphicsType;
-      preferences.putULong("graphicsType", wData.graphicsType);
-    }  
-
-    //int bytes2= preferences.getBytes("teststring2", teststring2, 80); // test
-    //preferences.remove("teststring1"); // remove single key
+    persistentSettings settings;
+    alertRule rules[ALERT_MAX_RULES];
+    alertsBlob alerts;
+    uint64_t record;
+    uint32_t counters[3] = {0, 0, 0};
+    journalRecord jRec;
+    size_t bytes;
+    bool written;
+    const char* source = "record";
+    bool coldBoot = (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED);
+
+    if(!coldBoot && sCache.checksum == settingsCacheChecksum() && settingsUnpack(sCache.record, &settings)){
+      settingsToWData(&settings);
+      alertSetRules(sCache.alerts.rules);
+      logOut<2>("Preferences from RTC cache: generation %ld pcorr: %d pval: %3.1f Inv: %d measInt:%ld TRange:%ld Graph: %ld Life: %ld", 
+                (long)sCache.generation, wData.applyPressureCorrection, wData.pressureCorrValue, wData.applyInversion,
+                (long)wData.targetMeasurementIntervalSec, (long)wData.graphTimeRangeHours, (long)wData.graphicsType,
+                (long)wData.targetLifetimeDays);  
+      return;
+    }
+    logOut<2>("Reading preferences from NVS. coldBoot: %d cache checksum %s", 
+        coldBoot, (sCache.checksum == settingsCacheChecksum()) ? "ok" : "invalid");  
+
+    preferences.begin(prefIDENT, false);  // rw, migration or defaults may have to be written
+    record = preferences.getULong64(prefRECORDKEY, 0);
+    if(settingsUnpack(record, &settings)){
+      bytes = preferences.getBytes(prefALERTSKEY, &alerts, sizeof(alerts));
+      if(!alertsBlobValid(&alerts, bytes)){
+        logOut<2>("Alert rules blob invalid: bytes %d, default rules", (int)bytes);  
+        alertDefaultRules(rules);
+        alertsBlobFromRules(&alerts, rules);
+      }
+      preferences.getBytes(prefCOUNTERSKEY, counters, sizeof(counters));
+      // a migration interrupted after the record was written
+      removeOldPreferences();
+    }
+    else{
+      // no valid record: migrate a former layout, or start with defaults.
+      // New keys first, the record last: the old keys are removed only if all are written,
+      // a power loss in between repeats the migration at the next cold boot
+      logOut<2>("Settings record invalid: %08lx%08lx", (unsigned long)(record >> 32), (unsigned long)record);  
+      source = readOldPreferences(&settings, rules, counters);
+      alertsBlobFromRules(&alerts, rules);
+      record = settingsPack(&settings);
+      written = (preferences.putBytes(prefALERTSKEY, &alerts, sizeof(alerts)) == sizeof(alerts));
+      if(written && counters[0] > 0)
+        written = (preferences.putBytes(prefCOUNTERSKEY, counters, sizeof(counters)) == sizeof(counters));
+      if(written)
+        written = (preferences.putULong64(prefRECORDKEY, record) == sizeof(record));
+      if(written)
+        removeOldPreferences();
+      else
+        logOut<1>("Settings (%s) not written, former layout kept", source);
+    }
     //preferences.clear();  // clear the namespace completely
     preferences.end(); // close the namespace
-  
+
+    settingsToWData(&settings);
+    alertSetRules(alerts.rules);
     // if preference contain larger counter value, use these (likely power outage or firmware update)
-    if(startCounter < prefs[0])
+    if(startCounter < counters[0])
     {
-      startCounter = prefs[0];
-      dischgCnt    = prefs[1];
-      prevMicrovolt= prefs[2];
+      startCounter = counters[0];
+      dischgCnt    = counters[1];
+      prevMicrovolt= counters[2];
+      prevVoltage = (float)prevMicrovolt / 1000000;
+    }
+    // counter journal has the counters of the last wake, if available
+    if(journalRecover(&jRec) && startCounter < jRec.startCounter)
+    {
+      startCounter = jRec.startCounter;
+      dischgCnt    = jRec.dischgCnt;
+      prevMicrovolt= jRec.prevMicrovolt;
       prevVoltage = (float)prevMicrovolt / 1000000;
     }
     //if(startCounter > 9999999) startCounter = 0; // rollover
     //if(dischgCnt > 9999999) dischgCnt = 0; // rollover
 
-    sprintf(outstring,"Read Preferences: pcorr: %d pval: %3.1f Inv: %d measInt:%ld TRange:%ld Graph: %ld", 
-                wData.applyPressureCorrection, wData.pressureCorrValue, wData.applyInversion,
-                wData.targetMeasurementIntervalSec, wData.graphTimeRangeHours, wData.graphicsType);
-    logOut(2,outstring);  
-    sprintf(outstring,"Read Preferences: bytes: %d startCounter: %ld dischgCnt %ld prevVoltage %3.3f, prevMicrovolt %ld ", 
-                bytes, startCounter, dischgCnt, prevVoltage, prevMicrovolt);
-    logOut(2,outstring); 
+    // remember what is in NVS, following wakes take the values from RTC
+    settingsCacheStore(record, &alerts);
+
+    logOut<2>("Read Preferences (%s): pcorr: %d pval: %3.1f Inv: %d measInt:%ld TRange:%ld Graph: %ld Life: %ld", 
+                source, wData.applyPressureCorrection, wData.pressureCorrValue, wData.applyInversion,
+                (long)wData.targetMeasurementIntervalSec, (long)wData.graphTimeRangeHours, (long)wData.graphicsType,
+                (long)wData.targetLifetimeDays);  
+    logOut<2>("Read Preferences: startCounter: %ld dischgCnt %ld prevVoltage %3.3f, prevMicrovolt %ld ", 
+                (long)startCounter, (long)dischgCnt, prevVoltage, (long)prevMicrovolt); 
 }
 
 /*****************************************************************************! 
-  @brief  write all preference values
-  @details 
+  @brief  writeSettings()
+  @details write the settings record and the alert rules blob to NVS, each only if different
+  @details from the NVS content (RTC settings cache). Nothing is written if nothing has changed.
+  @details a changed setting programs one NVS entry, the rules are written only if changed
+  @param  reason : for log output only
   @return void
 *****************************************************************************/
-void writePreferences()
+void writeSettings(const char* reason)
 {
-    size_t ret1, ret2, ret3, ret4, ret5, ret6, ret7;
+    persistentSettings settings;
+    alertRule rules[ALERT_MAX_RULES];
+    alertsBlob alerts;
+    uint64_t record;
+    size_t ret;
+    bool cacheOk, recordChanged, alertsChanged, ok = true;
+    int64_t profT = profStart();
+
+    settingsFromWData(&settings);
+    record = settingsPack(&settings);
+    alertGetRules(rules);
+    alertsBlobFromRules(&alerts, rules);
+    cacheOk = (sCache.checksum == settingsCacheChecksum());
+    recordChanged = !cacheOk || record != sCache.record;
+    alertsChanged = !cacheOk || memcmp(&alerts, &sCache.alerts, sizeof(alerts)) != 0;
+    if(!recordChanged && !alertsChanged){
+      logOut<2>("Preferences (%s) unchanged, generation %ld: nothing written", reason, (long)sCache.generation);
+      return;
+    }
 
     preferences.begin(prefIDENT, false);
-    //----- counters etc.
-    prefs[0] = startCounter;
-    prefs[1] = dischgCnt;
-    prefs[2] = prevMicrovolt;
-    prefs[3] = 0;
-    ret1 = preferences.putBytes(prefIDENT, prefs, sizeof(prefs));
-    sprintf(outstring,"Wrote Counter Preferences: ret: %d ctrM:%ld ctrD:%ld prevMV:%ld [3]:%3.1f",
-      ret1, startCounter, dischgCnt, prevMicrovolt, prefs[3]);
-    logOut(3,outstring); 
-
-    //----- pressure correction
-    ret2 = preferences.putBool("applyPCorr", wData.applyPressureCorrection);
-
-    //----- pressure correction value
-    ret3 = preferences.putFloat("pCorrValue", wData.pressureCorrValue);
-
-    //----- screen inversion
-    ret4 = preferences.putBool("applyInversion", wData.applyInversion);
-
-    //----- measurement interval in sec
-    ret5 =   preferences.putULong("measIntervalSec", wData.targetMeasurementIntervalSec);
+    if(alertsChanged){
+      ret = preferences.putBytes(prefALERTSKEY, &alerts, sizeof(alerts));
+      if(ret == sizeof(alerts)) sCache.alerts = alerts; else ok = false;
+    }
+    if(recordChanged){
+      ret = preferences.putULong64(prefRECORDKEY, record);
+      if(ret == sizeof(record)) sCache.record = record; else ok = false;
+    }
+    preferences.end(); // close the namespace
+    sCache.generation++;
+    sCache.checksum = settingsCacheChecksum();
+    trace(TR_PREFS, ok, sCache.generation);
+    profStop(PROF_WRITEPREFS, profT);
+
+    logOut<2>("Wrote Preferences (%s): generation %ld record %d rules %d ok %d in %ld usec", 
+                reason, (long)sCache.generation, recordChanged, alertsChanged, ok, (long)pData.lastUsec[PROF_WRITEPREFS]);  
+    logOut<3>("Wrote Preferences: pcorr: %d pval: %3.1f Inv: %d measInt:%ld TRange:%ld Graph: %ld Life: %ld", 
+                wData.applyPressureCorrection, wData.pressureCorrValue, wData.applyInversion,
+                (long)wData.targetMeasurementIntervalSec, (long)wData.graphTimeRangeHours,
+                (long)wData.graphicsType, (long)wData.targetLifetimeDays);  
+}
 
-    //----- time range to display in hours
-    ret6 =  preferences.putULong("timeRangeHours", wData.graphTimeRangeHours);
+/*****************************************************************************! 
+  @brief  write all preference values
+  @details settings record and alert rules, each only if changed. Counters are journaled
+  @return void
+*****************************************************************************/
+void writePreferences()
+{
+    writeSettings("settings");
+}
 
-    //----- graphics type (0: pressure, 1: temperature, 2: humidity)
-    ret7 =  preferences.putULong("graphicsType", wData.graphicsType);
 
-    //int bytes2= preferences.getBytes("teststring2", teststring2, 80); // test
-    //preferences.remove("teststring1"); // remove single key
-    //preferences.clear();  // clear the namespace completely
-    preferences.end(); // close the namespace
+/*****************************************************************************! 
+  @brief  serialTraceRequest()
+  @details dump the trace ring to USB serial if 'T' has been received. The UART buffers what
+  @details arrives while the barograph is awake (not in deep sleep), all characters are read.
+  @details Called at the end of setup() and before deep sleep: a 'T' sent at any time of the
+  @details wake is seen, without waiting for input
+  @return void
+*****************************************************************************/
+void serialTraceRequest()
+{
+  bool request = false;
 
-    sprintf(outstring,"Wrote Preferences: pcorr: %d pval: %3.1f Inv: %d measInt:%ld TRange:%ld", 
-                wData.applyPressureCorrection, wData.pressureCorrValue, wData.applyInversion,
-                wData.targetMeasurementIntervalSec, wData.graphTimeRangeHours);
-    logOut(3,outstring);  
-    sprintf(outstring,"Wrote Preferences: ret values: %d %d %d %d %d %d\n", 
-                ret1, ret2, ret3, ret4, ret5, ret6);
-    logOut(3,outstring); 
+  while(Serial.available() > 0)
+    if(Serial.read() == 'T')
+      request = true;
+  if(request)
+    traceDrain(serialPrintLine);
 }
 
-
 /*****************************************************************************! 
   @brief    gotoDeepSleep: routine to enter deep sleep
   @details  
   @param  deepSleepTime  time to to into deep sleep
   @return void
 *****************************************************************************/
-void gotoDeepSleep(gpio_num_t button, uint64_t deepSleepTime)
+void gotoDeepSleep(uint64_t deepSleepTime)
 {
   //**********  TEST override
   // sleeptime = 60 * SECONDS - 1000*(millis()-startTimeMillis);
-  uint32_t am = millis();
-  sprintf(outstring,"Hibernating for target %ld sec: %lld usec (act millis: %ld start millis: %ld)    ", 
-          wData.targetMeasurementIntervalSec, deepSleepTime, am, startTimeMillis);  
-  logOut(2,outstring);
+  int64_t profT = profStart();
+  uint32_t am = millis(), waitMs;
+  logOut<2>("Hibernating for target %ld sec: %lld usec (act millis: %ld start millis: %ld)    ", 
+          (long)wData.targetMeasurementIntervalSec, (long long)deepSleepTime, (long)am, (long)startTimeMillis);
   if(deepSleepTime > maxSleeptimeSafetyLimit){
-    sprintf(outstring,"Hibernating time %lld usec above safety limit. Reducing to %ld usec    ", 
-          deepSleepTime, maxSleeptimeSafetyLimit);  
-    logOut(2,outstring);
+    logOut<2>("Hibernating time %lld usec above safety limit. Reducing to %ld usec    ", 
+          (long long)deepSleepTime, (long)maxSleeptimeSafetyLimit);
   }
 
+  // trace dump on demand: 'T' received from USB serial during this wake, also during the refresh
+  serialTraceRequest();
+
+  // a buzzer pattern still playing ends first, in light sleep. The time waited is taken
+  // from the sleep, the next wake stays on schedule
+  buzzerWait(BUZZER_MAX_WAIT_MS);
+  waitMs = millis() - am;
+  if(deepSleepTime > 1000ULL * waitMs + SECONDS)
+    deepSleepTime -= 1000ULL * waitMs;
+
   // shut down display
   endDisplay(1); // mode 0: power off, mode 1: hibernate
   //1: display.hibernate();  // danach wird beim wieder aufwachen kein Reset des Screens gemacht.
@@ -997,16 +1358,14 @@ void gotoDeepSleep(gpio_num_t button, uint64_t deepSleepTime)
 
   // Initiate sleep
   esp_sleep_enable_timer_wakeup(deepSleepTime);   // define sleeptime for timer wakeup
-  // and via external pin. only one seems possible.
+  // and via all buttons (EXT1)
   // https://randomnerdtutorials.com/esp32-deep-sleep-arduino-ide-wake-up-sources/
-  #ifdef LOLIN32_LITE
-    esp_sleep_enable_ext0_wakeup(button, HIGH); // enable wakeup via button1
-  #endif  
-  #ifdef CROW_PANEL
-    esp_sleep_enable_ext0_wakeup(button, LOW); // enable wakeup via button1
-  #endif  
-  rtc_gpio_pullup_dis(button);  //Configure pullup/downs via RTCIO to LOW during deepsleep
-  rtc_gpio_pulldown_en(button); // EXT0 resides in the same power domain (RTC_PERIPH) as the RTC IO pullup/downs.
+  buttonSleepSetup();
+
+  // timing of this wake: last entries of the profiler before sleep
+  profStop(PROF_SLEEP, profT);
+  profStop(PROF_WAKE, 0);         // esp_timer starts at 0 at boot
+  trace(TR_SLEEP, (int32_t)(deepSleepTime / 1000000), millis());
     
   esp_deep_sleep_start();                               // go to sleep
 }
@@ -1014,56 +1373,144 @@ void gotoDeepSleep(gpio_num_t button, uint64_t deepSleepTime)
 
 /*****************************************************************************! 
   @brief  writeCounterPreferences()
-  @details writes the counter related preference data
+  @details writes the counters to their NVS key. Fallback if the counter journal is not available
   @return void
 *****************************************************************************/
 void writeCounterPreferences()
 {
-  int ret;
-  bool writing_counter_prefs = false;
-  writing_counter_prefs = true;
-  sprintf(outstring,"Store to preferences: startCounter %ld dischgCnt %ld prevVoltage %f prevMicrovolt %ld\n", 
-     startCounter, dischgCnt, prevVoltage, prevMicrovolt),
-  logOut(2,outstring);
-  // open preferences namespace in rw mode mode and write preferences infos.
+  uint32_t counters[3] = {startCounter, dischgCnt, prevMicrovolt};
+  size_t ret;
+  int64_t profT = profStart();
+
   preferences.begin(prefIDENT, false);
-  prefs[0] = startCounter;
-  prefs[1] = dischgCnt;
-  prefs[2] = prevMicrovolt;
-  prefs[3] = 0;
-  ret = preferences.putBytes(prefIDENT, prefs, sizeof(prefs));
+  ret = preferences.putBytes(prefCOUNTERSKEY, counters, sizeof(counters));
   preferences.end(); // close the namespace
-  sprintf(outstring,"Write Counter preferenes ret: %d \n", ret);
-  logOut(2,outstring);        
+  profStop(PROF_WRITEPREFS, profT);
+  logOut<2>("Store to preferences: startCounter %ld dischgCnt %ld prevVoltage %f prevMicrovolt %ld ret %d\n", 
+     (long)startCounter, (long)dischgCnt, prevVoltage, (long)prevMicrovolt, (int)ret);
 }
 
+// button actions. Settings are changed through the command table, like bluetooth commands
+static const buttonAction buttonActions[] = {
+  { 0, BTN_SHORT,  BTN_ACT_ACK },
+  { 0, BTN_LONG,   BTN_ACT_CONFIG },
+  { 0, BTN_DOUBLE, BTN_ACT_DIAG },
+  #ifdef LOLIN32_LITE
+    { 1, BTN_NONE, BTN_ACT_GRAPH },       // red middle
+    { 2, BTN_NONE, BTN_ACT_RANGE },       // red lower
+  #endif
+  #ifdef CROW_PANEL
+    { 1, BTN_NONE, BTN_ACT_ACK },         // exit
+    { 2, BTN_NONE, BTN_ACT_RANGE },       // confirm
+    { 3, BTN_NONE, BTN_ACT_GRAPH },       // down
+    { 4, BTN_NONE, BTN_ACT_GRAPH_BACK },  // up
+  #endif
+};
+
 /*****************************************************************************! 
-  @brief  handleExt0Wakeup()
-  @details handle wakeup by EXT0 wakeup source = button via GPIO 
+  @brief  buttonCommand()
+  @details AT command of a button action: next / previous graph type, next time range
+  @param  action: BTN_ACT_xxx
+  @param  line: command, empty if the action has none
+  @param  len: size of line
   @return void
 *****************************************************************************/
-void handleExt0Wakeup()
+static void buttonCommand(uint8_t action, char* line, int len)
 {
-    // if woken up by button 1 short press: toggle display
-    // not yet implemented
-
-    // if woken up by button remember this, may be alert acknowledge
-    wData.buttonPressed = true;
-
-    // if woken up by button1 long press: goto bluetooth configuration routine
-    // but not if an alert was on, then the button press is assumed to cancel the alert only
-    if(!wData.alertON){
-      #ifdef LOLIN32_LITE
-        bluetoothConfigMain(); 
-      #endif
-      // if CrowPanel: try Web Bluetooth BLE 
-      #ifdef CROW_PANEL
-        bleConfigMain();
-      #endif
-    } // !alertON
+  static const uint8_t graphTypes[] = { 0, 1, 2, 4, 5, 6, 7 };   // cycle, diagnostics not included
+  static const char graphLetters[] = "PTHLMNO";                 // command of each graph type
+  const int n = sizeof(graphTypes);
+  int i, hours;
+
+  line[0] = '\0';
+  for(i=0; i<n && graphTypes[i] != wData.graphicsType; i++);
+  switch(action){
+    case BTN_ACT_GRAPH:
+      snprintf(line, len, "AT%c", graphLetters[(i + 1) % n]);   // not found: first one
+      break;
+    case BTN_ACT_GRAPH_BACK:
+      snprintf(line, len, "AT%c", graphLetters[(i + n - 1) % n]);
+      break;
+    case BTN_ACT_RANGE:
+      hours = wData.targetMeasurementIntervalSec * noDataPoints / 3600;   // 21, 42, 84
+      snprintf(line, len, "ATS,%d", (hours >= 84) ? 21 : 2 * hours);
+      break;
+  }
 }
 
+/*****************************************************************************! 
+  @brief  handleButtonWakeup()
+  @details handle wakeup by a button (EXT1). The presses are classified since setup().
+  @details The first press usually is decided by now, more presses are taken until there is
+  @details none for BTN_IDLE_MS, e.g. to cycle through the graph types. Each selection is shown
+  @details in the feedback box at once, the graph is drawn once afterwards.
+  @details Only the long press of button 1 starts the radio: bluetooth configuration
+  @return bool: true if the diagnostics screen is to be shown instead of the graph
+*****************************************************************************/
+bool handleButtonWakeup()
+{
+  static cmdContext ctx;    // reply buffer, not on the stack
+  buttonEvent ev;
+  char line[CMD_MAX_LEN];
+  uint32_t timeout = BTN_MAX_WAIT_MS;
+  uint8_t action;
+  bool diagnostics = false;
+  int i, n = sizeof(buttonActions) / sizeof(buttonActions[0]);
+
+  while(buttonGet(&ev, timeout)){
+    logOut<2>("Button %s: %s press, first pixel after %ld ms", buttonLabel(ev.button), buttonName(ev.press), (long)firstPixelMs);
+    if(timeout == BTN_MAX_WAIT_MS)
+      trace(TR_BUTTON, ev.press, firstPixelMs);
+    trace(TR_KEY, ev.button, ev.press);
+    timeout = BTN_IDLE_MS;
+
+    // any press acknowledges the active alerts
+    alertAcknowledge();
+
+    action = BTN_ACT_ACK;
+    for(i=0; i<n; i++){
+      if(buttonActions[i].button == ev.button
+         && (buttonActions[i].press == ev.press || buttonActions[i].press == BTN_NONE)){
+        action = buttonActions[i].action;
+        break;
+      }
+    }
 
+    switch(action){
+      case BTN_ACT_CONFIG:      // goto bluetooth configuration routine
+        buttonEnd();
+        #ifdef LOLIN32_LITE
+          bluetoothConfigMain(); 
+        #endif
+        // if CrowPanel: try Web Bluetooth BLE 
+        #ifdef CROW_PANEL
+          bleConfigMain();
+        #endif
+        return(false);
+      case BTN_ACT_DIAG:
+        diagnostics = true;
+        break;
+      case BTN_ACT_ACK:
+        break;
+      default:
+        buttonCommand(action, line, sizeof(line));
+        ctx.replyLine = NULL;
+        ctx.printLine = NULL;
+        ctx.exit = false;
+        cmdExecute(line, &ctx);
+        logOut<2>("%s", ctx.reply);
+        drawButtonFeedback(ctx.reply);
+        diagnostics = false;
+        break;
+    }
+  }
+  buttonEnd();
+  return(diagnostics);
+}
+
+
+// the benchmark (-D BENCH, ePaperBench.cpp) has its own setup() and loop()
+#ifndef BENCH
 /*****************************************************************************! 
   @brief  setup routine
   @details 
@@ -1072,23 +1519,58 @@ void handleExt0Wakeup()
 void setup()
 {
   startTimeMillis = millis(); // remember time when woken up
+  profInit();                 // wake profiler: record time from boot to setup()
+  int64_t profT;
+
+  // start the BME280 conversion first: it runs while display, preferences and timing are handled.
+  // collected in getBME280SensorData(). First set the pins I2C, not available in standard for Lolin32 Lite.
+  // Default object is : TwoWire Wire;
+  Wire.setPins(I2C_SDA_PIN, I2C_SCL_PIN);
+  Wire.begin();
+  Wire.setClock(BME_I2C_CLOCK);
+  // Init BME280 I2C address depends on sensor 0x76 or 0x77. Calibration read only after cold boot
+  // forced mode, oversampling and filter from sensor profile manager, chosen by pressure noise
+  bmeSensorOk = bmeBegin(BME_I2C_ADDR, NULL)
+             && spApply()
+             && bmeStartForced();
 
   char* cp;
+  int wokenButton = buttonWoken();
+  bool buttonWake = (wokenButton >= 0);
   Serial.begin(115200);   // set speed for serial monitor
+  traceBegin();           // binary trace ring in RTC memory
+
+  // button wake: feedback first. Partial init and a small partial window, before preferences
+  // and sensors. The press is classified meanwhile, the action is chosen in handleButtonWakeup()
+  if(buttonWake){
+    buttonBegin(wokenButton);
+    initDisplay(startCounter, 0);
+    snprintf(outstring, sizeof(outstring), (wokenButton == 0) ? "Button %s - hold for setup" : "Button %s",
+             buttonLabel(wokenButton));
+    drawButtonFeedback(outstring);
+    firstPixelMs = (uint32_t)(profStart() / 1000);   // esp_timer starts at 0 at boot
+  }
 
-  logOut(2,(char*)"**********************************************************");
-  sprintf(outstring,"* %s %s - %s ",PROGNAME, VERSION, BUILD_DATE);
-  logOut(2,outstring);
-  logOut(2,(char*)"**********************************************************");
+  logOut<2>("**********************************************************");
+  logOut<2>("* %s %s - %s ",PROGNAME, VERSION, BUILD_DATE);
+  logOut<2>("**********************************************************");
+  if(!bmeSensorOk)
+    logOut<1>("Could not find a valid BME280 sensor, check wiring!");
+  // DS18B20: collect a conversion left from the last wake, start a new one. Collected after rendering.
+  // No conversion if woken by button
+  dsBegin(!buttonWake);
 
   #ifdef READ_PREFERENCES
     // get data from EEPROM using preferences library in readonly mode
+    journalBegin(NULL);
+    profT = profStart();
     readPreferences();
+    profStop(PROF_READPREFS, profT);
   #else
-    sprintf(outstring,"Values from RTC memory: startCounter: %ld dischgCnt %ld prevVoltage %3.3f, prevMicrovolt %ld ", 
-                startCounter, dischgCnt, prevVoltage, prevMicrovolt);
-    logOut(2,outstring);   
+    logOut<2>("Values from RTC memory: startCounter: %ld dischgCnt %ld prevVoltage %3.3f, prevMicrovolt %ld ", 
+                startCounter, dischgCnt, prevVoltage, prevMicrovolt);   
   #endif // READ_PREFERENCES        
+  trace(TR_WAKE, esp_sleep_get_wakeup_cause(), startCounter);
 
   // create test data if required
   #ifdef createTestData
@@ -1100,54 +1582,26 @@ void setup()
   #endif
 
   // initialize the display
-  logOut(2,(char*)"before initDisplay()");
+  logOut<2>("before initDisplay()");
+  profT = profStart();
   initDisplay(startCounter, FULL_UPDATE_INTERVAL); 
+  profStop(PROF_INITDISPLAY, profT);
 
-  // BME280 initialization. First set the pins I2C, not available in standard for Lolin32 Lite.
-  // Default object is : TwoWire Wire;
-  Wire.setPins(I2C_SDA_PIN, I2C_SCL_PIN);
-  // Init BME280 I2C address depends on sensor 0x76 or 0x77.
-  if (!bme.begin(0x76, &Wire)){
-    logOut(2,(char*)"Could not find a valid BME280 sensor, check wiring!");
-    //delay(2000);
-  }  
- 
-  // recommended settings for weather monitoring
-  logOut(2,(char*)"-- Weather Station Scenario --");
-  logOut(2,(char*)"forced mode, 1x temperature / 1x humidity / 1x pressure oversampling,");
-  logOut(2,(char*)"filter off");
-  bme.setSampling(Adafruit_BME280::MODE_FORCED,
-                  Adafruit_BME280::SAMPLING_X1, // temperature
-                  Adafruit_BME280::SAMPLING_X1, // pressure
-                  Adafruit_BME280::SAMPLING_X1, // humidity
-                  Adafruit_BME280::FILTER_OFF   );
-
-  // PushButton setup
-  #ifdef isPushButtons
-    // pinMode(PushButton, RISING);
-    
-    pinMode(button1.PIN, INPUT_PULLDOWN);
-    pinMode(button2.PIN, INPUT_PULLDOWN);
-    pinMode(button3.PIN, INPUT_PULLDOWN);    
-    #ifdef isButtonInterrupts
-      attachInterrupt(digitalPinToInterrupt(button1.PIN),button1Handler, FALLING); 
-      attachInterrupt(digitalPinToInterrupt(button2.PIN),button2Handler, FALLING); 
-      attachInterrupt(digitalPinToInterrupt(button3.PIN),button3Handler, FALLING); 
-    #endif
-  #endif // isPushButtons    
 
   // buzzer test
   /*
-  buzzer(1,1000,0);
+  buzzerPlay(BUZ_ACK);
   */
 
-  sprintf(outstring,"Heap Size: %ld FreeHp: %ld Max Block Alloc: %ld    ",
-      ESP.getHeapSize(),ESP.getFreeHeap(), ESP.getMaxAllocHeap());
-  logOut(2, outstring);    
-  sprintf(outstring,"Total PSRAM: %ld Free PSRAM: %ld    \n",
-      ESP.getPsramSize(),ESP.getFreePsram());    
-  logOut(2, outstring);    
+  logOut<2>("Heap Size: %ld FreeHp: %ld Max Block Alloc: %ld    ",
+      (long)(ESP.getHeapSize()),(long)(ESP.getFreeHeap()), (long)(ESP.getMaxAllocHeap()));    
+  logOut<2>("Total PSRAM: %ld Free PSRAM: %ld    \n",
+      (long)(ESP.getPsramSize()),(long)(ESP.getFreePsram()));    
+
+  // trace dump on demand: 'T' received from USB serial so far. Checked again before deep sleep
+  serialTraceRequest();
 }  // setup()
+#endif // BENCH
 
 /************************** doWork - main worker routine ****************************/
 void doWork()
@@ -1160,21 +1614,20 @@ void doWork()
   time_t      nowSec, measSec;    // seconds since 00:00:00 on January 1, 1970, Coordinated Universal Time. 
   suseconds_t nowUsec, measUsec;   // additional microseconds, never more than a million. Add both to get precise time
   bool readyToMeasure = false;
+  uint32_t graphicsType = wData.graphicsType;  // screen of this wake
 
   // determine reason for wakeup. if timer wakeup: continue with measurements. 
-  // if EXT0 wakeup (button pressed): handleExt0Wakeup()
+  // if EXT1 wakeup (button pressed): handleButtonWakeup()
   ret=print_wakeup_reason(); // determine reason for wakeup
   // switch colors if woken up by GPIO = key pressed
-  if(ret == ESP_SLEEP_WAKEUP_EXT0)
-    handleExt0Wakeup();
+  if(ret == ESP_SLEEP_WAKEUP_EXT1 && handleButtonWakeup())
+    graphicsType = 8;   // diagnostics screen, setting not changed
 
   // check if time for measurement or continue to sleep
   // get time. nowTime: present time, just determined. wData.lastMeasurementTimestamp: timeval at last measurement
   gettimeofday(&nowTime, NULL);                         // get time struct
   nowSec= nowTime.tv_sec; nowUsec = nowTime.tv_usec;
   measSec = wData.lastMeasurementTimestamp.tv_sec; measUsec = wData.lastMeasurementTimestamp.tv_usec;
-  sprintf(outstring,"doWork: nowSec: %ld nowUsec: %ld measSec: %ld measUsec: %ld    ",
-    nowSec,  nowUsec, measSec, measUsec);
   elapsedSec = (long)nowTime.tv_sec - (long)wData.lastMeasurementTimestamp.tv_sec;
   elapsedUsec= (long)nowTime.tv_usec - (long)wData.lastMeasurementTimestamp.tv_usec; // can be negative, therefore singed type!
   elapsedUsec+= 1000000*elapsedSec;  
@@ -1185,19 +1638,17 @@ void doWork()
   else  
     readyToMeasure = false;  
 
-  sprintf(outstring,"DoWork. nowSec: %ld nowUsec: %ld measSec: %ld measUsec:%ld lastSleepAftM: %lld    ",
-          nowSec, nowUsec, measSec, measUsec, wData.lastActualSleeptimeAfterMeasUsec);
-  logOut(2,outstring);  
+  logOut<2>("DoWork. nowSec: %ld nowUsec: %ld measSec: %ld measUsec:%ld lastSleepAftM: %lld    ",
+          nowSec, nowUsec, measSec, measUsec, (long long)wData.lastActualSleeptimeAfterMeasUsec);  
 
-  sprintf(outstring,"DoWork. now: %ld.%06ld lastMeas: %ld.%06ld elapsed s:%ld usec:%ld ReadytoMeas: %d    ",
-          nowTime.tv_sec,nowTime.tv_usec, 
-          wData.lastMeasurementTimestamp.tv_sec, wData.lastMeasurementTimestamp.tv_usec,
+  logOut<2>("DoWork. now: %ld.%06ld lastMeas: %ld.%06ld elapsed s:%ld usec:%ld ReadytoMeas: %d    ",
+          (long)nowTime.tv_sec,nowTime.tv_usec, 
+          (long)wData.lastMeasurementTimestamp.tv_sec, wData.lastMeasurementTimestamp.tv_usec,
           elapsedSec, elapsedUsec,
-          readyToMeasure);
-    logOut(2,outstring);  
+          readyToMeasure);  
 
   if(!readyToMeasure){  // if time not reached: calculate new sleeptime and go to sleep
-    drawMainGraphics(wData.graphicsType);
+    drawMainGraphics(graphicsType);
     // write all preferences, incl. counter, if changed in bluetooth setup
     if(wData.preferencesChanged){
       writePreferences();
@@ -1214,23 +1665,26 @@ void doWork()
     else  
       sleeptime = 1000000;    
     //wData.lastActualSleeptimeAfterMeasUsec = sleeptime;
-    sprintf(outstring,"Before gotoToSleep notReadyTo Measure. now: %ld.%06ld lastMeas: %ld.%06ld elapsedUsec %ld lastTargetS:%ld sleeptime: %lld",
-          nowTime.tv_sec,nowTime.tv_usec, 
-          wData.lastMeasurementTimestamp.tv_sec, wData.lastMeasurementTimestamp.tv_usec,
+    logOut<2>("Before gotoToSleep notReadyTo Measure. now: %ld.%06ld lastMeas: %ld.%06ld elapsedUsec %ld lastTargetS:%ld sleeptime: %lld",
+          (long)nowTime.tv_sec,nowTime.tv_usec, 
+          (long)wData.lastMeasurementTimestamp.tv_sec, wData.lastMeasurementTimestamp.tv_usec,
           elapsedUsec,
-          wData.lastTargetSleeptime, sleeptime);
-    logOut(2,outstring);
+          (long)wData.lastTargetSleeptime, (long long)sleeptime);
     // one more safety: when we have a measurement due to initialization, the sleep time becomes larger than the 
     // target sleep time. We have to subtract the targetSleeptimeUsec again. 3 sec tolerance added in comparison.
     if(sleeptime > targetSleepUSec + 10000000)
         sleeptime = sleeptime - targetSleepUSec;
     // this is the number in usec actually used to set the sleep timer when no measurement taken
     wData.lastActualSleeptimeNotMeasUsec = sleeptime;
-    gotoDeepSleep(BUTTON1, sleeptime); // go to deep sleep. parameters: sleeptime in us, button to wakeup from  
+    trace(TR_NOT_READY, elapsedSec, (int32_t)(sleeptime / 1000000));
+    gotoDeepSleep(sleeptime); // go to deep sleep. parameter: sleeptime in us  
   }
   else{   // if time reached: continue with measurement
     measTimeMillis = millis();                            // remember millis at measurement
+    int64_t profT = profStart();
+    bool journalOk;
     getBME280SensorData();                                // Lesen der Messwerte vom BME280
+    profStop(PROF_SENSOR, profT);
 
     // remember time and store it after checking how long since last measurement
     // https://github.com/espressif/esp-idf/blob/master/examples/system/deep_sleep/main/deep_sleep_example_main.c
@@ -1242,56 +1696,79 @@ void doWork()
     elapsedSec = nowTime.tv_sec - wData.lastMeasurementTimestamp.tv_sec;
     elapsedUsec= nowTime.tv_usec - wData.lastMeasurementTimestamp.tv_usec; // can be negative, therefore singed type!
     elapsedUsec+= 1000000*elapsedSec;            
-    sprintf(outstring,"After Measurement. now: %ld.%06ld lastMeas: %ld.%06ld elapsedUsec %ld    ",
-          nowTime.tv_sec,nowTime.tv_usec, 
-          wData.lastMeasurementTimestamp.tv_sec, wData.lastMeasurementTimestamp.tv_usec,
+    logOut<2>("After Measurement. now: %ld.%06ld lastMeas: %ld.%06ld elapsedUsec %ld    ",
+          (long)nowTime.tv_sec,nowTime.tv_usec, 
+          (long)wData.lastMeasurementTimestamp.tv_sec, wData.lastMeasurementTimestamp.tv_usec,
           elapsedUsec);
-    logOut(2,outstring);
 
-    sprintf(outstring,"Timestamps before assignment.last: %ld.%06ld last2: %lD.%06ld    ",
-        wData.lastMeasurementTimestamp.tv_sec, wData.lastMeasurementTimestamp.tv_usec,
-        wData.last2MeasurementTimestamp.tv_sec, wData.last2MeasurementTimestamp.tv_usec);
-    logOut(2,outstring);
+    logOut<2>("Timestamps before assignment.last: %ld.%06ld last2: %ld.%06ld    ",
+        (long)wData.lastMeasurementTimestamp.tv_sec, wData.lastMeasurementTimestamp.tv_usec,
+        (long)wData.last2MeasurementTimestamp.tv_sec, wData.last2MeasurementTimestamp.tv_usec);
     // remember the previous measurement timestamp
     wData.last2MeasurementTimestamp = wData.lastMeasurementTimestamp; 
     // store actual time as measurement time.
     gettimeofday(&wData.lastMeasurementTimestamp, NULL);         
-    sprintf(outstring,"Timestamps after assignment. last: %ld.%06ld last2: %lD.%06ld    ",
-        wData.lastMeasurementTimestamp.tv_sec, wData.lastMeasurementTimestamp.tv_usec,
-        wData.last2MeasurementTimestamp.tv_sec, wData.last2MeasurementTimestamp.tv_usec);
-    logOut(2,outstring);
+    logOut<2>("Timestamps after assignment. last: %ld.%06ld last2: %ld.%06ld    ",
+        (long)wData.lastMeasurementTimestamp.tv_sec, wData.lastMeasurementTimestamp.tv_usec,
+        (long)wData.last2MeasurementTimestamp.tv_sec, wData.last2MeasurementTimestamp.tv_usec);
 
     #ifdef LOLIN32_LITE
       readBatteryVoltage(&percent, &volt);                  // Auslesen der Batteriespannung
     #endif  
-    sprintf(outstring,"Voltage: %4.3f prevVoltage: %4.3f Percent: %3.1f    \n", volt, prevVoltage, percent);
-    logOut(2,outstring);
+    logOut<2>("Voltage: %4.3f prevVoltage: %4.3f Percent: %3.1f    \n", volt, prevVoltage, percent);
 
     // recognize start of a discharge: voltage has decreased significantly, of a charge: voltage has increased significantly
     if((volt - prevVoltage > CHARGE_THRESHOLD)||(volt - prevVoltage < -DISCHARGE_THRESHOLD)){
       dischgCnt = 0;
-      sprintf(outstring,"Reset dischgCnt to: %ld volt: %3.2f prevVoltage: %f Percent: %3.1f    \n", 
-            dischgCnt, volt, prevVoltage, percent);
-      logOut(2,outstring);
+      logOut<2>("Reset dischgCnt to: %ld volt: %3.2f prevVoltage: %f Percent: %3.1f    \n", 
+            (long)dischgCnt, volt, prevVoltage, percent);
     }  
     prevVoltage = volt;  
 
     // set sleep time. 
     targetSleepUSec= wData.targetMeasurementIntervalSec * SECONDS;
-    sprintf(outstring,"target sleep time: %ld WData.mIS: %ld, SEC: %ld    ", targetSleepUSec, wData.targetMeasurementIntervalSec, SECONDS);
-    logOut(2,outstring);
+    logOut<2>("target sleep time: %ld WData.mIS: %ld, SEC: %ld    ", (long)targetSleepUSec, (long)wData.targetMeasurementIntervalSec, (long)SECONDS);
 
     // store data to main measurement data structure
+    profT = profStart();
     storeMeasurementData();
+    profStop(PROF_STORE, profT);
 
-    #ifdef showSimpleData
-      displayTextData(startCounter, dischgCnt, temperature, humidity, pressure, 
-                        percent,volt, multiplier);
-    #else
-      drawMainGraphics(wData.graphicsType);
-    #endif    
+    // alert rules over the new sample: the pattern plays while the panel refreshes
+    if(alertEvaluate())
+      buzzerPlay(BUZ_ALERT);
+
+    #ifdef BTHOME_BEACON
+      // broadcast the readings before the display refresh: one advertising event
+      beaconSend(wData.applyPressureCorrection ? wData.actPressureCorr : wData.actPressureRaw,
+                 wData.actTemperature, wData.actHumidity,
+                 volt, percent, wData.pressure3hChange, (uint8_t)startCounter);
+    #endif
 
-    logOut(2,(char*)"measurement and display done");
+    // display refresh policy from energy model: refresh only every <multiplier> measurements.
+    // always refresh while an alert is active, to show the current values,
+    // and at button wake, which replaces the button feedback
+    energyUpdate(percent, volt > 0, dischgCnt);
+    multiplier = eEstimate.multiplier;
+    // sampling profile for the next measurement, from pressure noise. Cheap profiles only if battery saving
+    spUpdate(pressure * 100.0, bmeStats.collectUsec, multiplier > MULTIPLIER_FULL);
+    if((startCounter % multiplier == 0) || (alertActive() > 0) || (ret == ESP_SLEEP_WAKEUP_EXT1)){
+      #ifdef showSimpleData
+        displayTextData(startCounter, dischgCnt, temperature, humidity, pressure, 
+                          percent,volt, multiplier);
+      #else
+        drawMainGraphics(graphicsType);
+      #endif    
+      trace(TR_REFRESH, graphicsType, multiplier);
+    }
+    else{
+      trace(TR_SKIP, startCounter, multiplier);
+      logOut<2>("Display refresh skipped. multiplier: %ld startCounter: %ld", (long)multiplier, (long)startCounter);
+    }
+
+    // DS18B20 conversion ran while rendering: collect if complete, else at start of next wake
+    dsCollect();
+    logOut<2>("measurement and display done");
     // increment counter and write it to permanent storage
     startCounter++;
     dischgCnt++;
@@ -1299,8 +1776,12 @@ void doWork()
     prevMicrovolt= (int)(0.5+1000000*prevVoltage);
 
     #ifdef WRITE_PREFERENCES
-      // write counter preferences
-      if(startCounter % WRITE_PREFS_INTERVAL == 0){
+      // write counters to journal every wake. Counter preferences only as fallback
+      profT = profStart();
+      journalOk = journalAppend(startCounter, dischgCnt, prevMicrovolt);
+      profStop(PROF_JOURNAL, profT);
+      trace(TR_JOURNAL, journalOk, jState.appends);
+      if(!journalOk && (startCounter % WRITE_PREFS_INTERVAL == 0)){
         writeCounterPreferences();
       }
       // write all preferences, incl. counter
@@ -1309,20 +1790,11 @@ void doWork()
         wData.preferencesChanged = false;
       }
     #else
-      sprintf(outstring,"Values in RTC memory: startCounter %d dischgCnt %d prevVoltage %f prevMicrovolt %d\n", 
-            startCounter, dischgCnt, prevVoltage, prevMicrovolt),
+      logOut<2>("Values in RTC memory: startCounter %d dischgCnt %d prevVoltage %f prevMicrovolt %d\n", 
+            startCounter, dischgCnt, prevVoltage, prevMicrovolt);
     #endif //WRITE_PREFERENCES
 
     #ifdef USESLEEP
-      if(button1.pressed || button2.pressed || button3.pressed){
-          sprintf(outstring,"Button pressed: %ld %ld %ld",
-            button1.numberKeyPresses,button2.numberKeyPresses,button3.numberKeyPresses);
-          logOut(2,outstring);
-          button1.pressed = false;
-          button2.pressed = false;
-          button3.pressed = false;
-      }
-      
       /* trial 1
       delay(100); // to give time to properly store before hibernating
       uint32_t am = millis();
@@ -1330,10 +1802,9 @@ void doWork()
       */
       /* trial 2 - correct with respect to window over 2 cycles
       gettimeofday(&nowTime, NULL);         // get time struct
-      sprintf(outstring,"Timestamps before sleep. now: %ld.%06ld last2: %lD.%06ld",
+      logOut<2>("Timestamps before sleep. now: %ld.%06ld last2: %lD.%06ld",
         nowTime.tv_sec, nowTime.tv_usec,
         wData.last2MeasurementTimestamp.tv_sec, wData.last2MeasurementTimestamp.tv_usec);
-      logOut(2,outstring);
       elapsedSec = nowTime.tv_sec - wData.last2MeasurementTimestamp.tv_sec; // compare with the remembered meas. time before
       elapsedUsec= nowTime.tv_usec- wData.last2MeasurementTimestamp.tv_usec; // can be negative, therefore singed type!
       elapsedUsec+= 1000000*elapsedSec;     // now we have the actually elapsed usec since last measurement
@@ -1341,9 +1812,8 @@ void doWork()
       long corr1 = targetSleepUSec - elapsedUsec;
       float dampingFactor = 0.8;
       long corr = corr1 * dampingFactor;
-      sprintf(outstring,"sleeptime factors: elsapsedUsec:%ld targetMeasIntv: %ld %ld corr1: %ld corr: %ld",
+      logOut<2>("sleeptime factors: elsapsedUsec:%ld targetMeasIntv: %ld %ld corr1: %ld corr: %ld",
          elapsedUsec, wData.targetMeasurementIntervalSec, targetSleepUSec, corr1, corr);
-      logOut(2,outstring);
       
       if(elapsedSec < 2 * wData.targetMeasurementIntervalSec) // correct sleeptime, with damping to allow drift towards center 
         sleeptime = targetSleepUSec + corr; // instead of 230/220/230/220 sec now: 230/221/228/222/227/223/226/224...
@@ -1366,16 +1836,15 @@ void doWork()
       if(wData.justInitialized){
         uint32_t am = millis();
         sleeptime = targetSleepUSec - 1000*(am-measTimeMillis);
-        sprintf(outstring,">>>>> JUST INITIALIZED. sleeptime set to %ld", sleeptime);
+        logOut<2>(">>>>> JUST INITIALIZED. sleeptime set to %ld", sleeptime);
         wData.justInitialized = false;
       }
 
       wData.lastActualSleeptimeAfterMeasUsec = sleeptime;
-      sprintf(outstring,"Before sleep elapsedUs: %ld sleeptime: %lld, now: %ld.%06ld last: %lD.%06ld    ",
+      logOut<2>("Before sleep elapsedUs: %ld sleeptime: %lld, now: %ld.%06ld last: %lD.%06ld    ",
         elapsedUsec, sleeptime, 
         nowTime.tv_sec, nowTime.tv_usec,
-        wData.last2MeasurementTimestamp.tv_sec, wData.last2MeasurementTimestamp.tv_usec);
-      logOut(2,outstring);  
+        wData.last2MeasurementTimestamp.tv_sec, wData.last2MeasurementTimestamp.tv_usec);  
       end of trial 2*/ 
 
       /* trial 3 - simplified */
@@ -1384,30 +1853,24 @@ void doWork()
       //sleeptime = targetSleepUSec - 1000*(am-measTimeMillis);
       wData.lastActualSleeptimeAfterMeasUsec = sleeptime;
       wData.justInitialized = false;
-      sprintf(outstring, "simplified sleep calc. targetSlUSec: %ld startTM:%ld measTM: %ld actTM:%ld sleeptime: %lld      ",
-          targetSleepUSec, startTimeMillis, measTimeMillis, am, sleeptime);
-      logOut(2,outstring);    
-      gotoDeepSleep(BUTTON1, sleeptime); // go to deep sleep. parameters: sleeptime in us, button to wakeup from
+      logOut<2>("simplified sleep calc. targetSlUSec: %ld startTM:%ld measTM: %ld actTM:%ld sleeptime: %lld      ",
+          (long)targetSleepUSec, (long)startTimeMillis, (long)measTimeMillis, (long)am, (long long)sleeptime);    
+      gotoDeepSleep(sleeptime); // go to deep sleep. parameter: sleeptime in us
     #else
-      logOut(2,(char*)"Sleep has been disabled");
+      logOut<2>("Sleep has been disabled");
 
       // test for buttons only in loop
-      for(i=0; i<50; i++){
-        if(button1.pressed || button2.pressed || button3.pressed){
-          sprintf(outstring,"Button presed: %d %d %d",
-            button1.numberKeyPresses,button2.numberKeyPresses,button3.numberKeyPresses);
-          logOut(2,outstring);
-          button1.pressed = false;
-          button2.pressed = false;
-          button3.pressed = false;
-        }
-        delay(250);
-      }  
+      buttonEvent ev;
+      buttonBegin(-1);
+      while(buttonGet(&ev, 12500))
+        logOut<2>("Button %s: %s press", buttonLabel(ev.button), buttonName(ev.press));
+      buttonEnd();
     #endif 
   } // else  if time reached
 }
 
 
+#ifndef BENCH
 /*****************************************************************************! 
   @brief  main loop
   @details 
@@ -1424,3 +1887,4 @@ void loop()
   doWork();
 
 };
+#endif // BENCH
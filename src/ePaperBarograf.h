@@ -14,6 +14,7 @@ static const uint8_t EPD_MOSI = 23; // to EPD DIN
 
 // Screen parameters
 #include "screenParameters.h"
+#include "ePaperAlert.h"
 
 // global stuff (variables, function prototypes)
 
@@ -29,30 +30,145 @@ static const uint8_t EPD_MOSI = 23; // to EPD DIN
 #define SECONDS (1000 * 1000)   // 1 second = 1 Mio microseconds
 //#define SLEEPTIME 60            // sleep time in seconds
 
-//**** use push buttons */
-#define isPushButtons 
-#undef isButtonInterrupts
+//**** button actions at button wake, table buttonActions[] in ePaperBarograf.cpp */
+#define BTN_ACT_ACK         0   // alert acknowledge, redraw
+#define BTN_ACT_CONFIG      1   // bluetooth configuration session
+#define BTN_ACT_DIAG        2   // diagnostics screen for this wake, setting unchanged
+#define BTN_ACT_GRAPH       3   // next graph type
+#define BTN_ACT_GRAPH_BACK  4   // previous graph type
+#define BTN_ACT_RANGE       5   // next time range: 21 -> 42 -> 84 -> 21 h
+#define BTN_IDLE_MS         1500  // wait for more presses, then draw and sleep
+
+struct buttonAction
+{
+  uint8_t button;               // index in BUTTON_PINS
+  uint8_t press;                // BTN_SHORT / BTN_LONG / BTN_DOUBLE, BTN_NONE: any
+  uint8_t action;               // BTN_ACT_xxx
+};
+
 #undef showSimpleData // no simple data display, but full graphics
 
 //*** define for voltage threshhold: recognition of chage/discharge if voltage increases/ drops more than this
 #define CHARGE_THRESHOLD      0.025
 #define DISCHARGE_THRESHOLD   0.025
 
-// sleeptimer multipliers for battery percentages in minutes. 1 == 1 min, 10 = 10 min 
+// display refresh multipliers: panel is refreshed every <multiplier> measurements.
+// chosen by the energy model (ePaperEnergy.cpp) to reach the target lifetime, 
+// or by battery percentage (full, <50%, <20%, <10%, <5%) if no target is set
 #define MULTIPLIER_FULL 1 // 1
 #define MULTIPLIER_50   2 // 2
 #define MULTIPLIER_20   10 // 5
 #define MULTIPLIER_10   30 // 10
 #define MULTIPLIER_5    60 // 30
 
+//*** RTC cache of the preferences: NVS is only read after cold boot or checksum mismatch,
+// and only written if a value has changed
+struct persistentSettings
+{
+  bool applyPressureCorrection;
+  bool applyInversion;
+  float pressureCorrValue;
+  int32_t measIntervalSec;
+  int32_t timeRangeHours;
+  int32_t graphicsType;
+  int32_t targetLifetimeDays;
+};
+
+// the settings are packed into one 64 bit NVS integer: one entry is programmed per change,
+// like one key of the former key-per-setting layout. Increment the version if the layout changes
+#define SETTINGS_RECORD_VERSION 3   // versions 1 and 2 were blobs, see settingsBlobV2
+#define SR_VERSION_BITS     4       // bit fields from bit 0 upwards
+#define SR_GRAPHICS_BITS    4
+#define SR_RANGE_BITS       8
+#define SR_INTERVAL_BITS    16
+#define SR_LIFETIME_BITS    10
+#define SR_PCORR_BITS       16      // pressure correction in 0.01 hPa, signed
+#define SR_PCORR_SCALE      100.0
+
+// alert rules in their own blob: a change of graph type or inversion does not rewrite them
+#define ALERTS_BLOB_VERSION 1
+struct alertsBlob
+{
+  uint16_t version;             // ALERTS_BLOB_VERSION
+  uint16_t size;                // sizeof(alertsBlob)
+  alertRule rules[ALERT_MAX_RULES];
+  uint32_t crc;                 // crc32 over all bytes before
+};
+
+// settings blob of version 2, with alert rules and counters: read once and migrated
+struct settingsBlobV2
+{
+  uint16_t version;
+  uint16_t size;
+  struct
+  {
+    bool applyPressureCorrection;
+    bool applyInversion;
+    float pressureCorrValue;
+    int32_t measIntervalSec;
+    int32_t timeRangeHours;
+    int32_t graphicsType;
+    int32_t targetLifetimeDays;
+    alertRule alertRules[ALERT_MAX_RULES];
+  } values;
+  uint32_t startCounter;
+  uint32_t dischgCnt;
+  uint32_t prevMicrovolt;
+  uint32_t crc;
+};
+
+// settings blob of version 1, without alert rules: read once and migrated
+struct settingsBlobV1
+{
+  uint16_t version;
+  uint16_t size;
+  struct
+  {
+    bool applyPressureCorrection;
+    bool applyInversion;
+    float pressureCorrValue;
+    int32_t measIntervalSec;
+    int32_t timeRangeHours;
+    int32_t graphicsType;
+    int32_t targetLifetimeDays;
+  } values;
+  uint32_t startCounter;
+  uint32_t dischgCnt;
+  uint32_t prevMicrovolt;
+  uint32_t crc;
+};
+
+struct settingsCacheData
+{
+  uint64_t record;              // settings record as stored in NVS
+  uint32_t generation;          // incremented with every write of settings or rules to NVS
+  alertsBlob alerts;            // alert rules as stored in NVS
+  uint32_t checksum;            // crc32 over record, generation and alerts
+};
+
+//*** measurement of this wake, input of storeMeasurementData()
+extern float temperature, humidity, pressure;
+extern float volt, percent;
+
+//*** counters and settings cache, RTC memory
+extern RTC_DATA_ATTR uint32_t startCounter, dischgCnt, prevMicrovolt;
+extern RTC_DATA_ATTR settingsCacheData sCache;
+
 /************************** forward declarations *************************/
 void getBME280SensorData();
+void storeMeasurementData();    // shift history, add the measurement, 3 h changes
+void calc3HourChanges();
 int readBatteryVoltage(float* percent, float* volt);
+void readPreferences();         // settings and counters: RTC cache, NVS after cold boot
+void writeSettings(const char* reason);   // settings record and alert rules to NVS, only if changed
+void writeCounterPreferences();
 //void clearScreenPartialUpdate();
 //void clearScreenFullUpdate();
 //void displaySimpleData( uint32_t startCounter, uint32_t dischgCnt,
 //                        float temperature, float humidity, float pressure,
 //                        float percent, float volt, uint32_t multiplier);
+void serialPrintLine(char* line);
+void serialTraceRequest();      // 'T' from USB serial: trace dump
 void doWork();
 uint32_t print_wakeup_reason();
 
@@ -0,0 +1,104 @@
+/**************************************************!
+   battery voltage and state of charge
+   analogReadMilliVolts() converts with the ADC calibration from eFuse
+   (two point or Vref), which removes the spread of the ADC gain between chips.
+   16 samples are averaged. The measurement is done before the display refresh,
+   the radio is off in measurement wakes, so the battery is not loaded by
+   current peaks. The state of charge is interpolated from an open circuit
+   voltage table of a 1S LiPo cell, integer arithmetic only.
+***************************************************/
+
+#include <Arduino.h>
+
+#include "global.h"
+#include "ePaperBattery.h"
+
+// open circuit voltage of a 1S LiPo cell at low load (mV, permille), ascending.
+// 3.5 V: the regulator of the Lolin32 Lite drops out, the barograph stops
+static const batSocPoint socTable[] = {
+  { 3500,    0 }, { 3610,   50 }, { 3690,  100 }, { 3710,  150 }, { 3730,  200 },
+  { 3750,  250 }, { 3770,  300 }, { 3790,  350 }, { 3800,  400 }, { 3820,  450 },
+  { 3840,  500 }, { 3850,  550 }, { 3870,  600 }, { 3910,  650 }, { 3950,  700 },
+  { 3980,  750 }, { 4020,  800 }, { 4080,  850 }, { 4110,  900 }, { 4150,  950 },
+  { 4190, 1000 },
+};
+#define SOC_TABLE_LEN (sizeof(socTable) / sizeof(socTable[0]))
+
+// last measurement, in RTC memory which survives the deep sleep. Zero after power on
+RTC_DATA_ATTR batteryData batData;
+
+/**************************************************!
+   @brief    batSocPermille()
+   @details  linear interpolation in the table, clamped at both ends
+   @param    milliVolt: battery voltage
+   @return   uint16_t: state of charge 0..1000
+***************************************************/
+uint16_t batSocPermille(uint16_t milliVolt)
+{
+  uint32_t i;
+  const batSocPoint *lo, *hi;
+
+  if(milliVolt <= socTable[0].milliVolt)
+    return(socTable[0].socPermille);
+  for(i=1; i<SOC_TABLE_LEN; i++){
+    if(milliVolt < socTable[i].milliVolt){
+      lo = &socTable[i-1];
+      hi = &socTable[i];
+      return(lo->socPermille + (uint32_t)(milliVolt - lo->milliVolt) * (hi->socPermille - lo->socPermille)
+                               / (hi->milliVolt - lo->milliVolt));
+    }
+  }
+  return(socTable[SOC_TABLE_LEN-1].socPermille);
+}
+
+/**************************************************!
+   @brief    batUpdate()
+   @details  measure battery voltage and state of charge, if due or forced.
+   @details  Otherwise batData keeps the last measurement
+   @param    pin: ADC pin with battery voltage divider
+   @param    force: measure now, e.g. after cold boot
+   @return   bool: true if measured
+***************************************************/
+bool batUpdate(uint8_t pin, bool force)
+{
+  uint32_t sum = 0, mv, mvMin = 0xFFFF, mvMax = 0;
+  int i;
+
+  if(batData.magic != BAT_MAGIC){
+    memset(&batData, 0, sizeof(batData));
+    force = true;
+  }
+  batData.calls++;
+  if(!force && (batData.calls % BAT_MEASURE_INTERVAL != 0))
+    return(false);
+
+  pinMode(pin, INPUT);
+  for(i=0; i<BAT_SAMPLES; i++){
+    mv = analogReadMilliVolts(pin);   // calibrated, default attenuation 11 dB
+    sum += mv;
+    if(mv < mvMin) mvMin = mv;
+    if(mv > mvMax) mvMax = mv;
+  }
+  batData.milliVolt = (uint16_t)((sum * BAT_DIVIDER + BAT_SAMPLES/2) / BAT_SAMPLES);
+  batData.spreadMv = (uint16_t)((mvMax - mvMin) * BAT_DIVIDER);
+  batData.socPermille = batSocPermille(batData.milliVolt);
+  batData.measurements++;
+  batData.magic = BAT_MAGIC;
+  return(true);
+}
+
+/**************************************************!
+   @brief    batReport()
+   @details  output of last battery measurement
+   @param    printLine : function to output one line of text (serial, bluetooth)
+   @return   void
+***************************************************/
+void batReport(void (*printLine)(char*))
+{
+  char line[maxLOG_STRING_LEN];
+
+  snprintf(line, sizeof(line), "Battery: %4.3f V %3.1f %%, spread %d mV, %lu measurements in %lu calls",
+    (float)batData.milliVolt / 1000.0, (float)batData.socPermille / 10.0, batData.spreadMv,
+    (unsigned long)batData.measurements, (unsigned long)batData.calls);
+  printLine(line);
+}
@@ -0,0 +1,41 @@
+#ifndef _ePaperBattery_H
+#define _ePaperBattery_H
+
+// battery measurement: mean of several ADC samples converted with the factory eFuse calibration
+// (analogReadMilliVolts()), state of charge from an interpolated table in fixed point.
+// Measured only every BAT_MEASURE_INTERVAL measurements, in between the value from RTC memory is used.
+
+#include <stdint.h>
+
+//************** module defines *************************/
+#define BAT_DIVIDER           2       // 100 K / 100 K voltage divider at VOLTAGE_PIN
+#define BAT_SAMPLES           16      // ADC samples per measurement
+#define BAT_MEASURE_INTERVAL  4       // measure every 4th measurement, 1 hour at 15 min interval
+#define BAT_MAGIC             0x42415431  // "BAT1", marks initialized RTC data
+
+//************** module global variables *************************/
+// one point of the state of charge table
+struct batSocPoint
+{
+  uint16_t milliVolt;
+  uint16_t socPermille;
+};
+
+// last measurement, stored in RTC memory
+struct batteryData
+{
+  uint32_t magic;           // BAT_MAGIC if valid
+  uint16_t milliVolt;       // battery voltage, mean of BAT_SAMPLES
+  uint16_t socPermille;     // state of charge 0..1000
+  uint16_t spreadMv;        // max - min of the samples
+  uint32_t calls;           // calls of batUpdate() since cold boot
+  uint32_t measurements;    // actual ADC measurements since cold boot
+};
+extern batteryData batData;
+
+//************** function prototypes *************************/
+bool batUpdate(uint8_t pin, bool force);          // measure if due, else keep value from RTC memory
+uint16_t batSocPermille(uint16_t milliVolt);      // state of charge from table
+void batReport(void (*printLine)(char*));
+
+#endif // _ePaperBattery_H
@@ -0,0 +1,154 @@
+/**************************************************!
+   BTHome beacon: readings broadcast in one advertising event
+   The controller is used without host stack: 5 HCI commands via VHCI.
+   The radio transmits about 1.2 ms per advertising event (3 channels, 31 byte
+   payload at 1 Mbit/s). Legacy advertising reports no end of an event, so
+   advertising is disabled BEACON_EVENT_MS after the enable is complete; the
+   interval (100 ms) is longer, a second event does not start.
+   Requires that the controller memory has not been released at boot:
+   btInUse() returns true if BluetoothSerial or NimBLE is linked.
+***************************************************/
+
+// only with -D BTHOME_BEACON
+#ifdef BTHOME_BEACON
+
+#include <Arduino.h>
+#include "esp_bt.h"
+
+#include "global.h"
+#include "ePaperBeacon.h"
+#include "ePaperBTHome.h"
+#include "ePaperProfiler.h"
+#include "ePaperTrace.h"
+
+// HCI command packets
+#define HCI_COMMAND_PKT           0x01
+#define HCI_EVENT_PKT             0x04
+#define HCI_EV_COMMAND_COMPLETE   0x0E
+#define HCI_RESET                 0x0C03    // OGF 0x03 controller & baseband
+#define HCI_LE_SET_ADV_PARAM      0x2006    // OGF 0x08 LE controller
+#define HCI_LE_SET_ADV_DATA       0x2008
+#define HCI_LE_SET_ADV_ENABLE     0x200A
+#define ADV_NONCONN_IND           0x03
+
+// opcode of the last command complete event, set by the controller task
+static volatile uint16_t hciCompleted = 0;
+
+// only command complete events are evaluated, flow control via send_available
+static void hciSendAvailable() {}
+static int hciReceived(uint8_t* data, uint16_t len)
+{
+  if(len >= 6 && data[0] == HCI_EVENT_PKT && data[1] == HCI_EV_COMMAND_COMPLETE)
+    hciCompleted = data[4] | (data[5] << 8);
+  return(0);
+}
+static esp_vhci_host_callback_t hciCallbacks = { hciSendAvailable, hciReceived };
+
+/**************************************************!
+   @brief    hciCommand()
+   @details  send one HCI command to the controller and wait until it is complete
+   @param    opcode: OGF << 10 | OCF
+   @param    params, len: parameters
+   @return   bool: false if the controller did not accept or complete it in time
+***************************************************/
+static bool hciCommand(uint16_t opcode, const uint8_t* params, uint8_t len)
+{
+  uint8_t buf[4 + 32];
+  uint32_t t = millis();
+
+  buf[0] = HCI_COMMAND_PKT;
+  buf[1] = opcode & 0xFF;
+  buf[2] = opcode >> 8;
+  buf[3] = len;
+  memcpy(buf + 4, params, len);
+  while(!esp_vhci_host_check_send_available()){
+    if(millis() - t > BEACON_HCI_TIMEOUT_MS)
+      return(false);
+    delay(1);
+  }
+  hciCompleted = 0;
+  esp_vhci_host_send_packet(buf, 4 + len);
+  t = millis();
+  while(hciCompleted != opcode){
+    if(millis() - t > BEACON_HCI_TIMEOUT_MS)
+      return(false);
+    delay(1);
+  }
+  return(true);
+}
+
+/**************************************************!
+   @brief    beaconSend()
+   @details  encode the readings, start the BLE controller, advertise one event,
+   @details  shut the controller down. Nothing is sent if a reading is invalid
+   @param    pressureHpa, temperature: as displayed, NaN or nanDATA if invalid
+   @param    humidityPromille: as stored in wData, nanDATA if invalid
+   @param    volt, percent: battery
+   @param    tendencyHpa: pressure change in 3 h
+   @param    packetId: changes every measurement
+   @return   bool: true if sent
+***************************************************/
+bool beaconSend(float pressureHpa, float temperature, int16_t humidityPromille,
+                float volt, float percent, float tendencyHpa, uint8_t packetId)
+{
+  esp_bt_controller_config_t cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
+  bthomeReadings r;
+  uint8_t advData[1 + BTHOME_ADV_MAX] = { 0 };    // length, data padded to 31 bytes
+  uint8_t advParam[15] = { BEACON_ADV_INTERVAL & 0xFF, BEACON_ADV_INTERVAL >> 8,   // min. interval
+                           BEACON_ADV_INTERVAL & 0xFF, BEACON_ADV_INTERVAL >> 8,   // max. interval
+                           ADV_NONCONN_IND, 0x00,                                   // type, own address public
+                           0x00, 0, 0, 0, 0, 0, 0,                                  // peer address (unused)
+                           0x07, 0x00 };                                            // all channels, no filter
+  uint8_t on = 1, off = 0;
+  uint32_t t0 = millis(), tRadio = 0;
+  int64_t profT;
+  int len;
+  bool ok;
+
+  r.packetId = packetId;
+  r.batteryPercent = (uint8_t)constrain(lroundf(percent), 0, 100);
+  r.temperature = (int16_t)lroundf(temperature * 100.0);
+  r.humidity = (uint16_t)(humidityPromille * 10);
+  r.pressure = (uint32_t)lroundf(pressureHpa * 100.0);
+  r.voltageMv = (uint16_t)lroundf(volt * 1000.0);
+  r.tendency = (int16_t)lroundf(tendencyHpa * 10.0);
+  len = bthomeEncode(&r, advData + 1, BTHOME_ADV_MAX);
+  if(len < 0 || isnan(pressureHpa) || isnan(temperature)
+     || pressureHpa >= (nanDATA/4) || temperature >= (nanDATA/4) || humidityPromille >= (nanDATA/4))
+    return(false);
+  advData[0] = (uint8_t)len;
+
+  if(esp_bt_controller_get_status() != ESP_BT_CONTROLLER_STATUS_IDLE)  // in use, or memory released
+    return(false);
+  #ifdef CONFIG_IDF_TARGET_ESP32
+    cfg.mode = ESP_BT_MODE_BLE;
+  #endif
+  profT = profStart();      // radio on: charged by the energy model (PROF_RADIO)
+  if(esp_bt_controller_init(&cfg) != ESP_OK)
+    return(false);
+  if(esp_bt_controller_enable(ESP_BT_MODE_BLE) != ESP_OK){
+    esp_bt_controller_deinit();
+    return(false);
+  }
+  esp_vhci_host_register_callback(&hciCallbacks);
+
+  ok = hciCommand(HCI_RESET, NULL, 0)
+    && hciCommand(HCI_LE_SET_ADV_PARAM, advParam, sizeof(advParam))
+    && hciCommand(HCI_LE_SET_ADV_DATA, advData, sizeof(advData))
+    && hciCommand(HCI_LE_SET_ADV_ENABLE, &on, 1);
+  if(ok){
+    tRadio = millis();
+    delay(BEACON_EVENT_MS);
+    hciCommand(HCI_LE_SET_ADV_ENABLE, &off, 1);
+    tRadio = millis() - tRadio;
+  }
+  esp_bt_controller_disable();
+  esp_bt_controller_deinit();
+  profStop(PROF_RADIO, profT);
+
+  trace(TR_BEACON, tRadio, millis() - t0);
+  logOut<2>("Beacon: %d bytes, advertising %lu ms, total %lu ms", len, (unsigned long)tRadio, (unsigned long)(millis() - t0));
+  return(ok);
+}
+
+#endif // BTHOME_BEACON
@@ -0,0 +1,22 @@
+#ifndef _ePaperBeacon_H
+#define _ePaperBeacon_H
+
+// beacon mode (-D BTHOME_BEACON): after each measurement one non-connectable
+// advertising event with the readings in BTHome v2 format (ePaperBTHome.h), e.g. for
+// Home Assistant. Only the BLE controller is started and driven with raw HCI commands
+// via VHCI, no host stack (Bluedroid/NimBLE), and shut down right after the event.
+
+#include <stdint.h>
+
+//************** module defines *************************/
+#define BEACON_ADV_INTERVAL   0x00A0    // 100 ms in 0.625 ms units, min. for non-connectable advertising
+#define BEACON_EVENT_MS       5         // one advertising event on 3 channels (about 1.2 ms) after the enable is complete
+#define BEACON_HCI_TIMEOUT_MS 20        // max. wait for the controller to accept / complete a command
+
+//************** module global variables *************************/
+
+//************** function prototypes *************************/
+bool beaconSend(float pressureHpa, float temperature, int16_t humidityPromille,
+                float volt, float percent, float tendencyHpa, uint8_t packetId);  // encode, advertise, shut down
+
+#endif // _ePaperBeacon_H
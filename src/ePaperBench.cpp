@@ -0,0 +1,292 @@
+/**************************************************!
+   micro-benchmarks of the per-wake hot paths
+   The benchmarks are a table: name, preparation (not timed), function (timed per call).
+   All work on a fixed pseudo-random history of 84 h, restored before each call,
+   so the numbers of two builds can be compared function by function.
+   On the host the drawing functions run against the shim (lib/hostshim), the render
+   numbers show changes of the firmware code, not the speed of GxEPD2 on the device.
+***************************************************/
+
+// only with -D BENCH
+#ifdef BENCH
+
+#include <Arduino.h>
+
+#include "global.h"
+#include "ePaperBarograf.h"
+#include "ePaperGraphics.h"
+#include "ePaperCommand.h"
+#include "ePaperBench.h"
+
+// one benchmark: prepare(arg) restores the input state, run(arg) is timed
+struct benchCase
+{
+  const char* name;
+  void (*prepare)(int arg);     // NULL: nothing to prepare
+  void (*run)(int arg);
+  int arg;
+  uint16_t iterations;
+};
+
+static measurementData benchData;      // history all benchmarks start from
+static cmdContext benchCtx;
+
+//************** input data *************************/
+static uint32_t benchRandom(uint32_t* state)
+{
+  *state = *state * 1103515245 + 12345;
+  return((*state >> 16) & 0x7FFF);
+}
+
+/**************************************************!
+   @brief    benchFillData()
+   @details  84 h history at 15 min: pressure random walk with a front, diurnal
+   @details  temperature and humidity, 3 invalid points. Same values on host and device
+   @return   void
+***************************************************/
+static void benchFillData()
+{
+  uint32_t state = BENCH_SEED;
+  float p = 1008.0;
+  int i;
+
+  wData.targetMeasurementIntervalSec = 900;
+  wData.lastTargetSleeptime = 900;
+  wData.graphTimeRangeHours = 84;
+  wData.graphicsType = 7;
+  wData.applyPressureCorrection = true;
+  wData.pressureCorrValue = 15.0;
+  wData.applyInversion = false;
+  wData.dataPresent = true;
+  for(i=0; i<noDataPoints; i++){
+    p += ((float)benchRandom(&state) / 0x7FFF - 0.5) * 0.4 + ((i > 200 && i < 260) ? -0.15 : 0.0);
+    wData.ageOfDatapoint[i] = (noDataPoints - 1 - i) * 900;
+    wData.pressHistory[i] = p;
+    wData.tempHistory[i] = 12.0 + 5.0 * sin(2 * PI * i / 96);
+    wData.humiHistory[i] = (int16_t)(650 - 150 * sin(2 * PI * i / 96) + benchRandom(&state) % 20);
+    wData.qualHistory[i] = 0;
+  }
+  wData.pressHistory[100] = nanDATA;
+  wData.tempHistory[101] = nanDATA;
+  wData.humiHistory[102] = nanDATA;
+  wData.actPressureRaw = wData.pressHistory[noDataPoints-1];
+  wData.actPressureCorr = wData.actPressureRaw + wData.pressureCorrValue;
+  wData.actTemperature = wData.tempHistory[noDataPoints-1];
+  wData.actHumidity = wData.humiHistory[noDataPoints-1];
+  wData.batteryVoltage = 3.95;
+  wData.batteryPercent = 78.0;
+  calc3HourChanges();
+  prepareGraphicsParameters(84);
+  benchData = wData;
+
+  // measurement of the wake, input of storeMeasurementData()
+  pressure = p + 0.1;
+  temperature = 12.3;
+  humidity = 64.5;
+  volt = 3.95;
+  percent = 78.0;
+}
+
+//************** preparation *************************/
+static void benchRestore(int arg)
+{
+  wData = benchData;
+}
+
+static void benchRestorePrepared(int arg)
+{
+  wData = benchData;
+  prepareGraphicsParameters(72);
+}
+
+//************** timed functions *************************/
+static void benchEmpty(int arg) {}
+
+static void benchStore(int arg) { storeMeasurementData(); }
+
+static void benchCalc3h(int arg) { calc3HourChanges(); }
+
+static void benchPrepare(int arg) { prepareGraphicsParameters(arg); }
+
+static void benchScale(int arg)
+{
+  switch(arg){
+    case 0: quarterMeasurementScale(); break;
+    case 1: halfMeasurementScale(); break;
+    case 2: doubleMeasurementScale(); break;
+    default: quadrupleMeasurementScale(); break;
+  }
+}
+
+static void benchYAxis(int arg)
+{
+  char unit[10], name[20];
+
+  switch(arg){
+    case 0:
+      strcpy(unit, wData.pressureUnit);
+      strcpy(name, wData.pressureName);
+      drawPressureYAxisNumbers(unit, name);
+      break;
+    case 1:
+      strcpy(unit, wData.temperatureUnit);
+      strcpy(name, wData.temperatureName);
+      drawTemperatureYAxisNumbers(unit, name, 0);
+      break;
+    default:
+      strcpy(unit, wData.humidityUnit);
+      strcpy(name, wData.humidityName);
+      drawHumidityYAxisNumbers(unit, name, 0);
+      break;
+  }
+}
+
+static void benchRender(int arg) { drawScene(arg); }
+
+// tokenize, look up and convert one command, as cmdExecute() does for each of a batch
+static void benchCmdParse(int arg)
+{
+  char line[CMD_MAX_LEN];
+  cmdRequest req;
+  const cmdEntry* e;
+  cmdArg a;
+
+  strcpy(line, " atd,-12.5 ");
+  if(cmdParse(line, &req) == CMD_OK && (e = cmdFind(req.name)) != NULL)
+    cmdParseArg(req.argText, e->argType, &a);
+}
+
+// batch of 6, rejected by the range of the last one: parsed and validated, nothing changed
+static void benchCmdBatch(int arg)
+{
+  char line[CMD_MAX_LEN];
+
+  strcpy(line, "ATD,12.5;ati,1;ATS,42;ATE,120;ATA,3,PF,1,1.5,0.3,60;ATE,5000");
+  cmdExecute(line, &benchCtx);
+}
+
+static void benchNoReply(char* line) {}
+
+static const benchCase benchTable[] = {
+  { "empty",                      NULL,                 benchEmpty,     0,  BENCH_ITERATIONS },
+  { "storeMeasurementData",       benchRestore,         benchStore,     0,  BENCH_ITERATIONS },
+  { "calc3HourChanges",           benchRestore,         benchCalc3h,    0,  BENCH_ITERATIONS },
+  { "prepareGraphicsParameters72",benchRestore,         benchPrepare,   72, BENCH_ITERATIONS },
+  { "prepareGraphicsParameters84",benchRestore,         benchPrepare,   84, BENCH_ITERATIONS },
+  { "quarterMeasurementScale",    benchRestore,         benchScale,     0,  BENCH_ITERATIONS },
+  { "halfMeasurementScale",       benchRestore,         benchScale,     1,  BENCH_ITERATIONS },
+  { "doubleMeasurementScale",     benchRestore,         benchScale,     2,  BENCH_ITERATIONS },
+  { "quadrupleMeasurementScale",  benchRestore,         benchScale,     3,  BENCH_ITERATIONS },
+  { "yAxisPressure",              benchRestorePrepared, benchYAxis,     0,  BENCH_ITERATIONS },
+  { "yAxisTemperature",           benchRestorePrepared, benchYAxis,     1,  BENCH_ITERATIONS },
+  { "yAxisHumidity",              benchRestorePrepared, benchYAxis,     2,  BENCH_ITERATIONS },
+  { "render0",                    benchRestore,         benchRender,    0,  BENCH_RENDER_ITER },
+  { "render1",                    benchRestore,         benchRender,    1,  BENCH_RENDER_ITER },
+  { "render2",                    benchRestore,         benchRender,    2,  BENCH_RENDER_ITER },
+  { "render4",                    benchRestore,         benchRender,    4,  BENCH_RENDER_ITER },
+  { "render5",                    benchRestore,         benchRender,    5,  BENCH_RENDER_ITER },
+  { "render6",                    benchRestore,         benchRender,    6,  BENCH_RENDER_ITER },
+  { "render7",                    benchRestore,         benchRender,    7,  BENCH_RENDER_ITER },
+  { "render8",                    benchRestore,         benchRender,    8,  BENCH_RENDER_ITER },
+  { "cmdParse",                   NULL,                 benchCmdParse,  0,  BENCH_ITERATIONS },
+  { "cmdBatch",                   NULL,                 benchCmdBatch,  0,  BENCH_ITERATIONS },
+};
+#define BENCH_COUNT (sizeof(benchTable) / sizeof(benchTable[0]))
+
+/**************************************************!
+   @brief    benchMeasure()
+   @details  one untimed call to warm the caches, then iterations timed calls
+   @param    b: benchmark
+   @param    r: result, ns per call
+   @return   void
+***************************************************/
+static void benchMeasure(const benchCase* b, benchResult* r)
+{
+  uint32_t i, c0, cycles, ns, mhz = getCpuFrequencyMhz();
+  uint64_t sumNs = 0;
+
+  r->n = b->iterations;
+  r->minNs = UINT32_MAX;
+  r->maxNs = 0;
+  if(b->prepare != NULL) b->prepare(b->arg);
+  b->run(b->arg);
+  for(i=0; i<b->iterations; i++){
+    if(b->prepare != NULL) b->prepare(b->arg);
+    c0 = ESP.getCycleCount();
+    b->run(b->arg);
+    cycles = ESP.getCycleCount() - c0;
+    ns = (uint32_t)((uint64_t)cycles * 1000 / mhz);
+    sumNs += ns;
+    if(ns < r->minNs) r->minNs = ns;
+    if(ns > r->maxNs) r->maxNs = ns;
+  }
+  r->meanNs = (uint32_t)(sumNs / b->iterations);
+}
+
+/**************************************************!
+   @brief    benchRun()
+   @details  run all benchmarks and print the result as JSON, one benchmark per line
+   @param    printLine : function to output one line of text
+   @return   void
+***************************************************/
+void benchRun(void (*printLine)(char*))
+{
+  char line[maxLOG_STRING_LEN];
+  benchResult r;
+  size_t i;
+
+  memset(&benchCtx, 0, sizeof(benchCtx));
+  benchCtx.replyLine = benchNoReply;
+  benchCtx.printLine = benchNoReply;
+  benchFillData();
+
+  #ifdef HOST_NATIVE
+    const char* target = "host";
+  #else
+    const char* target = "esp32";
+  #endif
+  snprintf(line, sizeof(line), "{\"bench\":\"%s\",\"version\":\"%s\",\"target\":\"%s\",\"cpuMhz\":%u,\"results\":[",
+    PROGNAME, VERSION, target, (unsigned)getCpuFrequencyMhz());
+  printLine(line);
+  for(i=0; i<BENCH_COUNT; i++){
+    benchMeasure(&benchTable[i], &r);
+    snprintf(line, sizeof(line), "{\"name\":\"%s\",\"n\":%u,\"minNs\":%u,\"meanNs\":%u,\"maxNs\":%u}%s",
+      benchTable[i].name, (unsigned)r.n, (unsigned)r.minNs, (unsigned)r.meanNs, (unsigned)r.maxNs,
+      (i < BENCH_COUNT - 1) ? "," : "");
+    printLine(line);
+  }
+  snprintf(line, sizeof(line), "]}");
+  printLine(line);
+  wData = benchData;
+}
+
+/*****************************************************************************!
+  @brief  setup routine of the benchmark
+  @details the panel is initialized for the drawing functions, but not refreshed
+  @return void
+*****************************************************************************/
+void setup()
+{
+  Serial.begin(115200);
+  delay(2000);                          // time to start the monitor
+  initDisplay(1, 0);                    // partial init: no full refresh
+  benchRun(serialPrintLine);
+  endDisplay(1);
+}
+
+void loop()
+{
+  delay(1000);
+}
+
+#ifdef HOST_NATIVE
+// host: one run to stdout (env:bench_native, needs -D HOST_NO_MAIN)
+int main(int argc, char** argv)
+{
+  hostPowerOn();
+  setup();
+  return(0);
+}
+#endif // HOST_NATIVE
+
+#endif // BENCH
@@ -0,0 +1,32 @@
+#ifndef _ePaperBench_H
+#define _ePaperBench_H
+
+// micro-benchmarks of the code that runs on every wake (-D BENCH): storage, 3 h changes,
+// graph preparation, scale changes, y axis ranges, rendering per graphicsType and command
+// parsing. Each function is timed per call with the CPU cycle counter, its input state is
+// restored before each call and not timed. The result is one JSON document, one benchmark
+// per line; compare it with a baseline by tools/benchCompare.cpp.
+// On the device (env:bench) setup() runs the suite once and prints the result on Serial;
+// the panel is initialized but never refreshed. On the host (env:bench_native) main() runs it.
+
+#include <stdint.h>
+
+//************** module defines *************************/
+#define BENCH_ITERATIONS      50      // timed calls per benchmark
+#define BENCH_RENDER_ITER     10      // timed calls per full frame render
+#define BENCH_SEED            12345   // pseudo-random history, same on host and device
+
+//************** module global variables *************************/
+// result of one benchmark
+struct benchResult
+{
+  uint32_t n;                   // timed calls
+  uint32_t minNs;
+  uint32_t meanNs;
+  uint32_t maxNs;
+};
+
+//************** function prototypes *************************/
+void benchRun(void (*printLine)(char*));   // run all benchmarks, print JSON
+
+#endif // _ePaperBench_H
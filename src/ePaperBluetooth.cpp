@@ -11,275 +11,60 @@
 
 #include "ePaperBluetooth.h"
 #include "global.h"
+#include "ePaperProfiler.h"
+#include "ePaperTrace.h"
+#include "ePaperBuzzer.h"
 
-//---- find first integer afer a ',' in String
-int findIntInString(String inputString)
+// send one line to bluetooth, used as output function for reports
+void btPrintLine(char* line)
 {
-  int pos, number;
-  String subS;
-
-  pos = inputString.indexOf(',');
-  subS =inputString.substring(pos+1);
-  number = subS.toInt();
-  sprintf(outstring,"findIntInString pos: %d subS: %s number: %d", pos, subS, number);
-  Serial.println(outstring);
-  return(number);
+  SerialBT.println(line);
+  delay(10);
 }
 
-//---- find first float afer a ',' in String
-float findFloatInString(String inputString)
+// send a reply to a command: log and bluetooth. The display is updated once per batch
+static void btReply(char* line)
 {
-  int pos;
-  float number;
-  String subS;
-
-  pos = inputString.indexOf(',');
-  subS =inputString.substring(pos+1);
-  number = subS.toFloat();
-
-  sprintf(outstring,"findFloatInString pos: %d subS: %s number: %f", pos, subS, number);
-  Serial.println(outstring);
-  return(number);
+  logOut<2>("%s", line);
+  SerialBT.println(line);
 }
 
 // send start message to bluetooth
 void initMessagetoBTClient()
 {
   SerialBT.println("-------------------------------------"); delay(10);
-  Serial.println("Sending init message via bluetooth");   delay(10);
+  logOut<2>("Sending init message via bluetooth");   delay(10);
   SerialBT.println("**** ePaper Barograph connected *****");   delay(10);
   SerialBT.println("-------------------------------------");   delay(10);
-  SerialBT.println("Commands:");   delay(10);
-  SerialBT.println("ATI     : Invert screen");  delay(10);
-  SerialBT.println("ATC,0   : Pressure correction (0|1)");  delay(10);
-  SerialBT.println("ATD,15.2: Set pressure corr.val (hPa)");  delay(10);
-  SerialBT.println("ATS,84  : Set timescale (21|42|84)");  delay(10);
-  SerialBT.println("ATP     : Pressure graphics");  delay(10);
-  SerialBT.println("ATT     : Temperature graphics"); delay(10);
-  SerialBT.println("ATH     : Humidity graphics");  delay(10);
-  SerialBT.println("ATL     : Press/Temp graphics");  delay(10);
-  SerialBT.println("ATM     : Press/Humi graphics"); delay(10);
-  SerialBT.println("ATN     : Temp/Humi graphics");  delay(10);
-  SerialBT.println("ATO     : P/T/H graphics");  delay(10);
-  SerialBT.println("ATQ     : Meas Scale 84->21h");  delay(10);
-  SerialBT.println("ATR     : Meas Scale 84/42->42/21h");  delay(10);
-  SerialBT.println("ATU     : Meas Scale 21/42->42/84");  delay(10);
-  SerialBT.println("ATV     : Meas Scale 21->84h");  delay(10);
-  SerialBT.println("ATX     : Exit Bluetooth Setup");  delay(10);
-  SerialBT.println("AT?     : Help");  delay(10);
+  cmdHelp(btPrintLine);
   SerialBT.println("-------------------------------------");  delay(10);
 }
 
-//----- handle the string received from bluetooth
+//----- handle the command line received from bluetooth
 // return value: false if command received, true if Command "X" has been sent
-// format is: AT<x>,<parameter>
-bool bluetoothInputHandler(String btReadStr)
+// format is: AT<x>,<parameter>[;AT<x>...], parsed and executed by ePaperCommand
+// One display line and one beep per batch, not per command. The beep does not wait
+bool bluetoothInputHandler(char* line)
 {
-  int i, paramInt;
-  float paramFloat;
-  char c;
-  bool ret=false; 
-  //-------------- parse string
-  if(btReadStr.startsWith("AT")){ // string starts with "AT"
-    c = btReadStr[2];             // get third character, this is the command
-    buzzer(1,100,0);
-    switch(c){
-      case 'I': // Invert screen, no parameter
-        sprintf(outstring,"Command: %c - Changing screen inverted display",c);
-        wData.applyInversion = !wData.applyInversion;
-        wData.preferencesChanged = true;
-        Serial.println(outstring);
-        SerialBT.println(outstring);
-        drawBluetoothInfo(outstring, 1);
-        break;
-      case 'C': // Pressure correction. parameter 0=OFF|1=ON. 1 = corection enabled
-        paramInt = findIntInString(btReadStr);
-        if(paramInt ==0 || paramInt ==1){
-          sprintf(outstring,"Command: %c Param: %d - changing pressure correction",c,paramInt);
-          wData.applyPressureCorrection = !wData.applyPressureCorrection;
-          wData.preferencesChanged = true;
-        }  
-        else  
-          sprintf(outstring,"INVALID command: %c Param: %d",c,paramInt);  
-        Serial.println(outstring);      
-        SerialBT.println(outstring);
-        drawBluetoothInfo(outstring, 1);
-        break;
-      case 'D': // Pressure correction.Parameter is value to be added to pressure if correction is on
-        paramFloat = findFloatInString(btReadStr); 
-        if(paramFloat >=-300 || paramFloat <=300) {
-          sprintf(outstring,"Command: %c Param: %f - changing pressure correction",c,paramFloat);
-          wData.pressureCorrValue = paramFloat;
-          wData.preferencesChanged = true;
-        }  
-        else  
-          sprintf(outstring,"INVALID command: %c Param: %f",c,paramFloat);
-        Serial.println(outstring);
-        SerialBT.println(outstring);
-        drawBluetoothInfo(outstring, 1);
-        break;
-      case 'S': // Timescale in hours. valid are 84 (default), 42, 21 hours (not yet implemented)
-        paramInt = findIntInString(btReadStr);
-        if(paramInt ==21 || paramInt ==42 || paramInt == 84)
-          sprintf(outstring,"Command: %c Param: %d",c,paramInt);
-        else  
-          sprintf(outstring,"INVALID command: %c Param: %d",c,paramInt);   
-        Serial.println(outstring);  
-        SerialBT.println(outstring);    
-        drawBluetoothInfo(outstring, 1);
-        break;  
-      case 'P': // use pressure graphics (default)
-        sprintf(outstring,"Command: %c - use pressure graphics",c);
-        wData.graphicsType = 0;
-        wData.preferencesChanged = true;
-        Serial.println(outstring);      
-        SerialBT.println(outstring);
-        drawBluetoothInfo(outstring, 1);
-        break;
-      case 'T': // use temperature graphics 
-        sprintf(outstring,"Command: %c - temperature graphics",c);
-        wData.graphicsType = 1;
-        wData.preferencesChanged = true;
-        Serial.println(outstring);
-        SerialBT.println(outstring);
-        drawBluetoothInfo(outstring, 1);      
-        break;
-      case 'H': // use humidity graphics 
-        sprintf(outstring,"Command: %c - humidity graphics",c);
-        wData.graphicsType = 2;
-        wData.preferencesChanged = true;
-        Serial.println(outstring);
-        SerialBT.println(outstring);  
-        drawBluetoothInfo(outstring, 1);  
-        break;  
-      case 'L': // use Pressure and temperature graphics.
-        sprintf(outstring,"Command: %c - Press/Temp graphics",c);
-        wData.graphicsType = 4;
-        wData.preferencesChanged = true;
-        Serial.println(outstring);      
-        SerialBT.println(outstring);
-        drawBluetoothInfo(outstring, 1);
-        break;
-      case 'M': // use Pressure and Humidity graphics.
-        sprintf(outstring,"Command: %c - Press/Humidity graphics",c);
-        wData.graphicsType = 5;
-        wData.preferencesChanged = true;
-        Serial.println(outstring);
-        SerialBT.println(outstring);
-        drawBluetoothInfo(outstring, 1);      
-        break;
-      case 'N': // use Temperature and Humidity graphics
-        sprintf(outstring,"Command: %c - Temp/Humidity graphics",c);
-        wData.graphicsType = 6;
-        wData.preferencesChanged = true;
-        Serial.println(outstring);
-        SerialBT.println(outstring);  
-        drawBluetoothInfo(outstring, 1);  
-        break;   
-      case 'O': // use Pressure, Temperature and Humidity graphics
-        sprintf(outstring,"Command: %c - Press/Temp/Humi graphics",c);
-        wData.graphicsType = 7;
-        wData.preferencesChanged = true;
-        Serial.println(outstring);
-        SerialBT.println(outstring);  
-        drawBluetoothInfo(outstring, 1);  
-        break;     
-      case 'Q': // quarter measurement scale
-        sprintf(outstring,"Command: %c - quarter meas scale",c);
-        wData.preferencesChanged = true;
-        Serial.println(outstring);
-        SerialBT.println(outstring);  
-        drawBluetoothInfo(outstring, 1);  
-        if(wData.targetMeasurementIntervalSec == 900){
-          quarterMeasurementScale();
-          sprintf(outstring,"quartering of scale done");
-        }  
-        else  
-          sprintf(outstring,"not possible, Interval: %ld", wData.targetMeasurementIntervalSec);  
-        Serial.println(outstring);
-        SerialBT.println(outstring);  
-        drawBluetoothInfo(outstring, 1); 
-        break;  
-      case 'R': // half measurement scale: 84->42 or 42->21 h
-        sprintf(outstring,"Command: %c - half meas scale",c);
-        wData.preferencesChanged = true;
-        Serial.println(outstring);
-        SerialBT.println(outstring);  
-        drawBluetoothInfo(outstring, 1);  
-        if(wData.targetMeasurementIntervalSec == 450 || wData.targetMeasurementIntervalSec == 900){
-          halfMeasurementScale();
-          sprintf(outstring,"halfing of scale done");
-        }  
-        else  
-          sprintf(outstring,"not possible, Interval: %ld", wData.targetMeasurementIntervalSec);  
-        Serial.println(outstring);
-        SerialBT.println(outstring);  
-        drawBluetoothInfo(outstring, 1); 
-        break;        
-      case 'U': // double measurement scale 21/42->42/84h
-        sprintf(outstring,"Command: %c - double meas scale",c);
-        wData.preferencesChanged = true;
-        Serial.println(outstring);
-        SerialBT.println(outstring);  
-        drawBluetoothInfo(outstring, 1);  
-        if(wData.targetMeasurementIntervalSec == 225 || wData.targetMeasurementIntervalSec == 450){
-          doubleMeasurementScale();
-          sprintf(outstring,"doubling of scale done");
-        }  
-        else  
-          sprintf(outstring,"not possible, Interval: %ld", wData.targetMeasurementIntervalSec);  
-        Serial.println(outstring);
-        SerialBT.println(outstring);  
-        drawBluetoothInfo(outstring, 1); 
-        break;  
-      case 'V': // quadruple measurement scale: 21->84h
-        sprintf(outstring,"Command: %c - quadruple meas scale",c);
-        wData.preferencesChanged = true;
-        Serial.println(outstring);
-        SerialBT.println(outstring);  
-        drawBluetoothInfo(outstring, 1);  
-        if(wData.targetMeasurementIntervalSec == 225){
-          quadrupleMeasurementScale();
-          sprintf(outstring,"quadrupling of scale done");
-        }  
-        else  
-          sprintf(outstring,"not possible, Interval: %ld", wData.targetMeasurementIntervalSec);  
-        Serial.println(outstring);
-        SerialBT.println(outstring);  
-        drawBluetoothInfo(outstring, 1); 
-        break;              
-      case 'X': // exit bluetooth setup
-        sprintf(outstring,"Command: %c - Exit",c);
-        ret = true;
-        Serial.println(outstring);  
-        SerialBT.println(outstring);  
-        drawBluetoothInfo(outstring, 1);
-        break;
-      case '?': // provide help
-        sprintf(outstring,"Command: %c - Sending help message",c);
-        Serial.println(outstring);  
-        SerialBT.println(outstring);
-        drawBluetoothInfo(outstring, 1);
-        initMessagetoBTClient();
-        break;    
-      default: // invalid command, provide help via bluetooth anyway
-        sprintf(outstring,"Not a valid command: _%c_",c);
-        Serial.println(outstring);
-        SerialBT.println(outstring);
-        drawBluetoothInfo(outstring, 1);
-        initMessagetoBTClient();
-        buzzer(1,500,100);
-        break;
-    }
-
+  static cmdContext ctx;    // reply buffer, not on the stack of the caller
+  int ret;
+
+  ctx.replyLine = btReply;
+  ctx.printLine = btPrintLine;
+  ctx.exit = false;
+  ret = cmdExecute(line, &ctx);
+  if(ret == CMD_OK){
+    if(ctx.executed > 1)      // batch: summary instead of the last reply
+      snprintf(ctx.reply, sizeof(ctx.reply), "%d commands done", ctx.executed);
+    buzzerPlay(BUZ_ACK);
   }
   else{
-    sprintf(outstring,"Not a valid command: _%s_", btReadStr);
-    Serial.println(outstring);
-    buzzer(1,500,100);
-  }  
-
-  return(ret);
+    if(ret == CMD_ERR_UNKNOWN)  // invalid command, provide help via bluetooth anyway
+      initMessagetoBTClient();
+    buzzerPlay(BUZ_ERROR);
+  }
+  drawBluetoothInfo(ctx.reply, 1);
+  return(ctx.exit);
 }
 
 /*
@@ -301,32 +86,39 @@ typedef enum {
 } esp_spp_cb_event_t;
 */
 
+// line being received. A line may arrive in several packets (events), it is queued
+// only when its end ('\r' or '\n') arrives. Used by the bluetooth task only
+static char rxLine[CMD_MAX_LEN];
+static int rxLen = 0;
+
 void bluetoothCallback(esp_spp_cb_event_t event, esp_spp_cb_param_t *param)
 {
-  int i;
-  String readStr;
+  int c;
 
   switch(event)
   {
     case ESP_SPP_SRV_OPEN_EVT: // server opened, connection established
-      Serial.println("BT Event: ESP_SPP_SRV_OPEN_EVT"); 
+      logOut<2>("BT Event: ESP_SPP_SRV_OPEN_EVT"); 
+      rxLen = 0;
       initMessagetoBTClient(); // send init message via bluetooth
       break;  
-    case ESP_SPP_DATA_IND_EVT: // individual data received
-      Serial.println("BT Event: ESP_SPP_DATA_IND_EVT");  // individual data received
-      readStr = SerialBT.readString();
-      for(i=0;i<readStr.length();i++)
-        readStr[i]=toupper(readStr[i]);
-      btReadStr = readStr;  
-      Serial.println("Raw command: " + btReadStr);
+    case ESP_SPP_DATA_IND_EVT: // data received: queue each complete line for bluetoothConfigMain
+      logOut<2>("BT Event: ESP_SPP_DATA_IND_EVT");  // individual data received
+      while((c = SerialBT.read()) >= 0){
+        if(c == '\n' || c == '\r'){
+          cmdPost(rxLine, rxLen);     // empty line (e.g. "\r\n") is not queued
+          rxLen = 0;
+        }
+        else if(rxLen < CMD_MAX_LEN - 1)   // excess characters are dropped
+          rxLine[rxLen++] = (char)c;
+      }
       break;
-    case ESP_SPP_INIT_EVT: Serial.println("BT Event: ESP_SPP_INIT_EVT"); break;          // Serial bluetooth parallel initiated
-    case ESP_SPP_START_EVT: Serial.println("BT Event: ESP_SPP_START_EVT"); break;        // server started
-    case ESP_SPP_WRITE_EVT: Serial.println("BT Event: ESP_SPP_WRITE_EVT"); break;        // write operation completed
-    case ESP_SPP_UNINIT_EVT: Serial.println("BT Event: ESP_SPP_UNINIT_EVT"); break;      // un-initiation of SPP
+    case ESP_SPP_INIT_EVT: logOut<2>("BT Event: ESP_SPP_INIT_EVT"); break;          // Serial bluetooth parallel initiated
+    case ESP_SPP_START_EVT: logOut<2>("BT Event: ESP_SPP_START_EVT"); break;        // server started
+    case ESP_SPP_WRITE_EVT: logOut<2>("BT Event: ESP_SPP_WRITE_EVT"); break;        // write operation completed
+    case ESP_SPP_UNINIT_EVT: logOut<2>("BT Event: ESP_SPP_UNINIT_EVT"); break;      // un-initiation of SPP
     default:
-      sprintf(outstring," BT Event: %d", event);
-      Serial.println(outstring);
+      logOut<2>(" BT Event: %d", event);
     break;
   }
 }
@@ -336,13 +128,13 @@ void bluetoothCallback(esp_spp_cb_event_t event, esp_spp_cb_param_t *param)
 void disconnectBluetooth()
 {
   delay(100);
-  Serial.println("BT stopping");
+  logOut<2>("BT stopping");
   SerialBT.println("Bluetooth disconnecting...");
   delay(100);
   SerialBT.flush();
   SerialBT.disconnect();
   SerialBT.end();
-  Serial.println("BT stopped");
+  logOut<2>("BT stopped");
   delay(1000);
 }
 
@@ -352,52 +144,54 @@ void bluetoothSetup()
   Serial.begin(115200);
   SerialBT.register_callback(bluetoothCallback); // register callback function
   SerialBT.begin("ESP32Barograph"); //Bluetooth device name
-  Serial.println("The device started, now you can pair it with bluetooth!");
+  logOut<2>("The device started, now you can pair it with bluetooth!");
 }
 
 // main function to configure the device via bluetooth
 void bluetoothConfigMain() 
 {
   unsigned long startMillis = millis();
-  unsigned long actMillis;
-  bool exitSelected;
+  bool exitSelected = false;
+  int commands = 0;
+  char text[maxLOG_STRING_LEN];
+  char line[CMD_MAX_LEN];
 
-  Serial.println("Entering bluetoothConfigMain()");
-  sprintf(outstring,"Ready for Bluetooth Configuration");
-  buzzer(2,200,100);
+  logOut<2>("Entering bluetoothConfigMain()");
+  snprintf(text, sizeof(text), "Ready for Bluetooth Configuration");
+  buzzerPlay(BUZ_BT_ENTER);
 
+  cmdQueueBegin();
+  cmdSessionPower(true);  // lower CPU clock while waiting for commands
   bluetoothSetup();       // start BT, register callback
 
   delay(20);
-  drawBluetoothInfo(outstring, 0);
+  drawBluetoothInfo(text, 0);
   delay(100);
 
-  do
-  {
-    // string is filled by bluetoothCallback function
-    if(btReadStr.length() > 0){
-        exitSelected = bluetoothInputHandler(btReadStr);
-        startMillis = millis(); // restart counter if something received
-        btReadStr = "";
-    }
-    delay(50);
-    actMillis = millis();
-  } while ((actMillis - startMillis < MAX_WAIT_FOR_BLUETOOTH) && !exitSelected);
+  // wait for lines queued by bluetoothCallback, the CPU idles meanwhile.
+  // The timeout restarts with every line received
+  while(!exitSelected && cmdWait(line, MAX_WAIT_FOR_BLUETOOTH, NULL)){
+    exitSelected = bluetoothInputHandler(line);
+    commands++;
+  }
 
   if(wData.preferencesChanged){
     writePreferences();
     wData.preferencesChanged = false;
   }  
   
-  sprintf(outstring,"Bluetooth Configuration ended.");  // \n exitSelected: %d (Millis: start: %d end: %d)",
-                                                        //exitSelected, startMillis, actMillis);
-  Serial.println(outstring);
-  drawBluetoothInfo(outstring, 1);
+  snprintf(text, sizeof(text), "Bluetooth Configuration ended.");
+  logOut<2>("%s", text);
+  drawBluetoothInfo(text, 1);
+
+  trace(TR_BT_SESSION, (millis() - startMillis) / 1000, commands);
+  profSession(millis() - startMillis);   // radio on, for the energy model
+  cmdSessionPower(false);
 
-  buzzer(1,500,800);
+  buzzerPlay(BUZ_BT_EXIT);
   //delay(1000);
   //unnecessary
-  //drawBluetoothInfo(outstring, 2); // mode2: clear display
+  //drawBluetoothInfo(text, 2); // mode2: clear display
 }
 
 #endif //LOLIN32_LITE
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define _ePaperBluetooth_H
 
 #include "BluetoothSerial.h"
+#include "ePaperCommand.h"
 
 #if !defined(CONFIG_BT_ENABLED) || !defined(CONFIG_BLUEDROID_ENABLED)
 #error Bluetooth is not enabled! Please run `make menuconfig` to and enable it
@@ -13,22 +14,9 @@
 //************** module global variables *************************/
 
 BluetoothSerial SerialBT;  // Bluetooth Serial object
-// global variable to store the string sent by bluetooth
-String btReadStr; 
-
-// Handle received and sent messages
-String message = "";
-char incomingChar;
-String temperatureString = "";
-
-// Timer: auxiliar variables
-unsigned long previousMillis = 0;    // Stores last time temperature was published
-const long interval = 30000;         // interval at which to publish sensor readings
 
 //************** function prototypes *************************/
-int findIntInString(String inputString);
-float findFloatInString(String inputString);
-bool bluetoothInputHandler(String btReadStr);
+bool bluetoothInputHandler(char* line);
 void bluetoothCallback(esp_spp_cb_event_t event, esp_spp_cb_param_t *param);
 void initMessagetoBTClient();
 
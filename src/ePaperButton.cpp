@@ -0,0 +1,302 @@
+/**************************************************!
+   Buttons: wakeup, debounce and press classification
+   interrupt (any edge) -> lock-free ring of edges -> esp_timer task: debounce and state
+   machine per button -> FreeRTOS queue of classified presses -> main task.
+   The ring has one producer (the GPIO interrupt dispatcher, interrupts of all buttons are
+   serialized) and one consumer (esp_timer task), head and tail are written by one side each.
+   The interrupt only records which button had an edge and when; the level is read by the
+   task once the button has been quiet for BTN_DEBOUNCE_MS.
+   States per button: IDLE -> DOWN -> (held BTN_LONG_MS: long, HELD until released)
+   DOWN -> released -> GAP -> (pressed again: double, HELD | BTN_DOUBLE_GAP_MS over: short, IDLE)
+***************************************************/
+
+#include <Arduino.h>
+#include <atomic>
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "driver/rtc_io.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#include "global.h"
+#include "ePaperButton.h"
+
+#define BTN_ST_IDLE   0
+#define BTN_ST_DOWN   1
+#define BTN_ST_GAP    2
+#define BTN_ST_HELD   3
+
+static const gpio_num_t btnPins[] = BUTTON_PINS;
+static const char* btnNames[] = BUTTON_NAMES;
+#define BTN_COUNT ((int)(sizeof(btnPins) / sizeof(btnPins[0])))
+
+// debounce and classification state of one button, used by the esp_timer task only
+struct buttonState
+{
+  uint8_t state;                // BTN_ST_xxx
+  bool down;                    // debounced level: pressed
+  bool bouncing;                // edge seen, level not yet read
+  uint32_t edgeMs;              // time of the last edge from the interrupt
+  uint32_t stateMs;             // time the state was entered
+};
+static buttonState btn[BUTTON_MAX];
+
+// edges from the interrupt
+struct buttonEdge
+{
+  uint8_t button;
+  uint32_t ms;
+};
+static buttonEdge btnRing[BTN_RING_LEN];
+static std::atomic<uint8_t> btnHead(0);         // written by the interrupt only
+static std::atomic<uint8_t> btnTail(0);         // written by the task only
+static std::atomic<bool> btnOverflow(false);    // edge lost: all buttons are read again
+
+static esp_timer_handle_t btnTimer = NULL;
+static StaticQueue_t btnQueueBuffer;
+static uint8_t btnQueueStorage[BTN_QUEUE_LEN * sizeof(buttonEvent)];
+static QueueHandle_t btnQueue = NULL;
+
+// ms since boot
+static inline uint32_t buttonMs()
+{
+  return((uint32_t)(esp_timer_get_time() / 1000));
+}
+
+/**************************************************!
+   @brief    buttonIsr()
+   @details  GPIO interrupt of all buttons, any edge: append the edge to the ring
+   @param    arg: button index
+   @return   void
+***************************************************/
+static void ARDUINO_ISR_ATTR buttonIsr(void* arg)
+{
+  uint8_t head = btnHead.load(std::memory_order_relaxed);
+  uint8_t next = (head + 1) & (BTN_RING_LEN - 1);
+
+  if(next == btnTail.load(std::memory_order_acquire)){   // full
+    btnOverflow.store(true, std::memory_order_relaxed);
+    return;
+  }
+  btnRing[head].button = (uint8_t)(uintptr_t)arg;
+  btnRing[head].ms = buttonMs();
+  btnHead.store(next, std::memory_order_release);       // entry complete before it is visible
+}
+
+// queue a classified press for the main task
+static void buttonPost(int i, uint8_t press)
+{
+  buttonEvent ev = { (uint8_t)i, press };
+
+  if(xQueueSend(btnQueue, &ev, 0) != pdTRUE)
+    logOut<1>("Button queue full, %s press of %s dropped", buttonName(press), btnNames[i]);
+}
+
+/**************************************************!
+   @brief    buttonTick()
+   @details  esp_timer callback every BTN_TICK_MS: take the edges from the ring,
+   @details  debounce and classify each button
+   @param    arg: unused
+   @return   void
+***************************************************/
+static void buttonTick(void* arg)
+{
+  uint32_t now = buttonMs();
+  uint8_t tail = btnTail.load(std::memory_order_relaxed);
+  bool edge;
+  int i;
+
+  while(tail != btnHead.load(std::memory_order_acquire)){
+    i = btnRing[tail].button;
+    btn[i].bouncing = true;
+    btn[i].edgeMs = btnRing[tail].ms;
+    tail = (tail + 1) & (BTN_RING_LEN - 1);
+  }
+  btnTail.store(tail, std::memory_order_release);
+  if(btnOverflow.exchange(false)){
+    for(i=0; i<BTN_COUNT; i++){
+      btn[i].bouncing = true;
+      btn[i].edgeMs = now;
+    }
+  }
+
+  for(i=0; i<BTN_COUNT; i++){
+    // debounce: the level is read when there was no edge for BTN_DEBOUNCE_MS
+    edge = false;
+    if(btn[i].bouncing && now - btn[i].edgeMs >= BTN_DEBOUNCE_MS){
+      btn[i].bouncing = false;
+      if((digitalRead(btnPins[i]) == BUTTON_ACTIVE) != btn[i].down){
+        btn[i].down = !btn[i].down;
+        edge = true;
+      }
+    }
+
+    switch(btn[i].state){
+      case BTN_ST_IDLE:
+        if(edge && btn[i].down){
+          btn[i].state = BTN_ST_DOWN;
+          btn[i].stateMs = now;
+        }
+        break;
+      case BTN_ST_DOWN:
+        if(edge){                                 // released
+          btn[i].state = BTN_ST_GAP;
+          btn[i].stateMs = now;
+        }
+        else if(now - btn[i].stateMs >= BTN_LONG_MS){
+          buttonPost(i, BTN_LONG);
+          btn[i].state = BTN_ST_HELD;
+        }
+        break;
+      case BTN_ST_GAP:
+        if(edge){                                 // pressed again: no need to wait for the release
+          buttonPost(i, BTN_DOUBLE);
+          btn[i].state = BTN_ST_HELD;
+        }
+        else if(now - btn[i].stateMs >= BTN_DOUBLE_GAP_MS){
+          buttonPost(i, BTN_SHORT);
+          btn[i].state = BTN_ST_IDLE;
+        }
+        break;
+      case BTN_ST_HELD:                           // classified, wait for the release
+        if(edge)
+          btn[i].state = BTN_ST_IDLE;
+        break;
+    }
+  }
+}
+
+/**************************************************!
+   @brief    buttonWoken()
+   @details  button that woke the device, from the EXT1 wake status
+   @return   int: index in BUTTON_PINS, -1 if not woken by a button
+***************************************************/
+int buttonWoken()
+{
+  uint64_t mask;
+  int i;
+
+  if(esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_EXT1)
+    return(-1);
+  mask = esp_sleep_get_ext1_wakeup_status();
+  for(i=0; i<BTN_COUNT; i++)
+    if(mask & (1ULL << btnPins[i]))
+      return(i);
+  return(-1);
+}
+
+/**************************************************!
+   @brief    buttonBegin()
+   @details  configure the buttons, attach the interrupts and start the task.
+   @details  pinMode() also releases the pins from the RTC IO used for the wakeup.
+   @details  All levels are read at the first tick: a press that has already ended
+   @details  before is a short press
+   @param    wokenButton: index of the button that woke the device, pressed since boot. -1: none
+   @return   bool: false if the task could not be started
+***************************************************/
+bool buttonBegin(int wokenButton)
+{
+  esp_timer_create_args_t args = {};
+  int i;
+
+  if(btnQueue == NULL)
+    btnQueue = xQueueCreateStatic(BTN_QUEUE_LEN, sizeof(buttonEvent), btnQueueStorage, &btnQueueBuffer);
+  else
+    xQueueReset(btnQueue);
+  btnHead.store(0);
+  btnTail.store(0);
+  btnOverflow.store(false);
+
+  for(i=0; i<BTN_COUNT; i++){
+    btn[i].down = (i == wokenButton);
+    btn[i].state = (i == wokenButton) ? BTN_ST_DOWN : BTN_ST_IDLE;
+    btn[i].stateMs = 0;           // press started at boot at the latest
+    btn[i].bouncing = true;       // read the level at the first tick
+    btn[i].edgeMs = 0;
+    pinMode(btnPins[i], BUTTON_IDLE_MODE);
+    attachInterruptArg(btnPins[i], buttonIsr, (void*)(uintptr_t)i, CHANGE);
+  }
+
+  args.callback = buttonTick;
+  args.name = "button";
+  if(btnTimer == NULL && esp_timer_create(&args, &btnTimer) != ESP_OK){
+    logOut<1>("Button timer not created");
+    btnTimer = NULL;
+    return(false);
+  }
+  esp_timer_start_periodic(btnTimer, BTN_TICK_MS * 1000);
+  return(true);
+}
+
+/**************************************************!
+   @brief    buttonGet()
+   @details  next classified press, waits at most timeoutMs
+   @param    ev: press
+   @param    timeoutMs: max. wait
+   @return   bool: false if nothing pressed within timeoutMs
+***************************************************/
+bool buttonGet(buttonEvent* ev, uint32_t timeoutMs)
+{
+  if(btnQueue == NULL)
+    return(false);
+  return(xQueueReceive(btnQueue, ev, pdMS_TO_TICKS(timeoutMs)) == pdTRUE);
+}
+
+// detach the interrupts and stop the task
+void buttonEnd()
+{
+  int i;
+
+  for(i=0; i<BTN_COUNT; i++)
+    detachInterrupt(btnPins[i]);
+  if(btnTimer == NULL)
+    return;
+  esp_timer_stop(btnTimer);
+  esp_timer_delete(btnTimer);
+  btnTimer = NULL;
+}
+
+/**************************************************!
+   @brief    buttonSleepSetup()
+   @details  all buttons wake the device: EXT1 with any button active. The pulls of the RTC IOs
+   @details  keep the inactive level, so the RTC peripherals stay powered in deep sleep
+   @return   void
+***************************************************/
+void buttonSleepSetup()
+{
+  uint64_t mask = 0;
+  int i;
+
+  for(i=0; i<BTN_COUNT; i++){
+    mask |= 1ULL << btnPins[i];
+    #ifdef LOLIN32_LITE
+      rtc_gpio_pullup_dis(btnPins[i]);
+      rtc_gpio_pulldown_en(btnPins[i]);
+    #endif
+    #ifdef CROW_PANEL
+      rtc_gpio_pulldown_dis(btnPins[i]);
+      rtc_gpio_pullup_en(btnPins[i]);
+    #endif
+  }
+  esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+  esp_sleep_enable_ext1_wakeup(mask, BUTTON_EXT1_MODE);
+}
+
+// short name of a classification result, for log and display
+const char* buttonName(uint8_t press)
+{
+  switch(press){
+    case BTN_SHORT:  return("short");
+    case BTN_LONG:   return("long");
+    case BTN_DOUBLE: return("double");
+    default:         return("none");
+  }
+}
+
+// name of a button
+const char* buttonLabel(int button)
+{
+  if(button < 0 || button >= BTN_COUNT)
+    return("?");
+  return(btnNames[button]);
+}
@@ -0,0 +1,70 @@
+#ifndef _ePaperButton_H
+#define _ePaperButton_H
+
+// buttons: every button wakes the device (EXT1), the button that woke it is read from the
+// EXT1 wake status. While awake, button edges are passed from the GPIO interrupt to an
+// esp_timer task through a lock-free ring; the task debounces and classifies the presses
+// as short, long or double press and queues them for the main task (buttonGet()).
+// Nothing else is touched in interrupt context.
+// Press times of the button that woke the device are counted from boot: the time the
+// press started before boot is not seen.
+
+#include <stdint.h>
+
+//************** module defines *************************/
+#ifdef LOLIN32_LITE
+  #define BUTTON1             GPIO_NUM_12     // upper black button
+  #define BUTTON2             GPIO_NUM_14     // middle red button
+  #define BUTTON3             GPIO_NUM_13     // lower red  button
+  #define BUTTON_PINS         { BUTTON1, BUTTON2, BUTTON3 }
+  #define BUTTON_NAMES        { "black", "red middle", "red lower" }
+  #define BUTTON_ACTIVE       HIGH            // buttons connect to 3.3 V
+  #define BUTTON_IDLE_MODE    INPUT_PULLDOWN
+  #define BUTTON_EXT1_MODE    ESP_EXT1_WAKEUP_ANY_HIGH
+#endif
+#ifdef CROW_PANEL
+  #define BUTTON1             GPIO_NUM_2      // upper button MENU
+  #define BUTTON2             GPIO_NUM_1      // lower button EXIT
+  #define BUTTON3             GPIO_NUM_5      // button CONFIRM at rotary switch
+  #define BUTTON4             GPIO_NUM_4      // button DOWN at rotary switch
+  #define BUTTON5             GPIO_NUM_6      // button UP at rotary switch
+  #define BUTTON_PINS         { BUTTON1, BUTTON2, BUTTON3, BUTTON4, BUTTON5 }
+  #define BUTTON_NAMES        { "menu", "exit", "confirm", "down", "up" }
+  #define BUTTON_ACTIVE       LOW             // buttons connect to GND
+  #define BUTTON_IDLE_MODE    INPUT_PULLUP
+  #define BUTTON_EXT1_MODE    ESP_EXT1_WAKEUP_ANY_LOW   // ESP32-S3 only, ESP32 has ALL_LOW
+#endif
+#define BUTTON_MAX            5       // max. number of buttons of a board
+
+#define BTN_TICK_MS           10      // period of the debounce / classification task
+#define BTN_DEBOUNCE_MS       30      // level must be stable for 30 ms after the last edge
+#define BTN_LONG_MS           1000    // held at least this long: long press
+#define BTN_DOUBLE_GAP_MS     350     // second press within this time after release: double press
+#define BTN_MAX_WAIT_MS       (BTN_LONG_MS + BTN_DOUBLE_GAP_MS + 200)  // a press is classified within
+#define BTN_RING_LEN          16      // edges from the interrupt, power of 2
+#define BTN_QUEUE_LEN         8       // classified presses for the main task
+
+// results of the classification
+#define BTN_NONE              0
+#define BTN_SHORT             1
+#define BTN_LONG              2
+#define BTN_DOUBLE            3
+
+//************** module global variables *************************/
+// classified press
+struct buttonEvent
+{
+  uint8_t button;               // index in BUTTON_PINS
+  uint8_t press;                // BTN_SHORT, BTN_LONG, BTN_DOUBLE
+};
+
+//************** function prototypes *************************/
+int buttonWoken();                    // index of the button that woke the device, -1 if none
+bool buttonBegin(int wokenButton);    // attach interrupts, start classification. wokenButton is pressed
+bool buttonGet(buttonEvent* ev, uint32_t timeoutMs);  // next classified press, false at timeout
+void buttonEnd();                     // detach interrupts, stop the task
+void buttonSleepSetup();              // enable EXT1 wakeup by all buttons, keep the pulls in deep sleep
+const char* buttonName(uint8_t press);    // short name of BTN_xxx
+const char* buttonLabel(int button);      // name of the button
+
+#endif // _ePaperButton_H
@@ -0,0 +1,182 @@
+/**************************************************!
+   Buzzer pattern sequencer
+   LEDC low speed channel on BUZZER_PIN, timer clocked from RTC8M, 8 bit resolution.
+   The steps of a pattern are timed by a one-shot esp_timer; all sequencer state is changed
+   in its callback (esp_timer task) only. buzzerPlay() leaves a request and starts the timer
+   if the buzzer is idle; a different pattern replaces a running one at its next step.
+***************************************************/
+
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "driver/ledc.h"
+
+#include "global.h"
+#include "ePaperBuzzer.h"
+
+#define BUZ_LEDC_MODE     LEDC_LOW_SPEED_MODE   // only low speed channels run in light sleep
+#define BUZ_LEDC_TIMER    LEDC_TIMER_0
+#define BUZ_LEDC_CHANNEL  LEDC_CHANNEL_0
+#define BUZ_LEDC_BITS     LEDC_TIMER_8_BIT      // RTC8M: up to 31 kHz with 8 bit
+#define BUZ_NONE          -1
+
+static const buzzerStep patAlert[]   = { {150, 75}, {150, 75}, {150, 75}, {150, 75}, {150, 75}, {0, 0} };
+static const buzzerStep patAck[]     = { {100, 0}, {0, 0} };
+static const buzzerStep patError[]   = { {500, 100}, {0, 0} };
+static const buzzerStep patBtEnter[] = { {200, 100}, {200, 100}, {0, 0} };
+static const buzzerStep patBtExit[]  = { {500, 0}, {0, 0} };
+static const buzzerStep* const patterns[BUZ_NUM_PATTERNS] = { patAlert, patAck, patError, patBtEnter, patBtExit };
+
+static esp_timer_handle_t buzTimer = NULL;
+static volatile int8_t buzRequest = BUZ_NONE;   // written by buzzerPlay(), taken by the callback
+static volatile int8_t buzPattern = BUZ_NONE;   // pattern playing, written by the callback
+static volatile uint32_t buzNextMs;             // ms since boot of the next step, for buzzerWait()
+static const buzzerStep* buzStep;               // step playing
+static bool buzOn;                              // output on within the step
+
+// switch the output
+static void buzzerOutput(bool on)
+{
+  ledc_set_duty(BUZ_LEDC_MODE, BUZ_LEDC_CHANNEL, on ? ((1 << BUZ_LEDC_BITS) * BUZZER_DUTY_PERCENT / 100) : 0);
+  ledc_update_duty(BUZ_LEDC_MODE, BUZ_LEDC_CHANNEL);
+}
+
+/**************************************************!
+   @brief    buzzerTick()
+   @details  esp_timer callback: take a new request, or switch to the next half of the step
+   @param    arg: unused
+   @return   void
+***************************************************/
+static void buzzerTick(void* arg)
+{
+  uint32_t ms;
+
+  if(buzRequest != BUZ_NONE){
+    buzPattern = buzRequest;
+    buzStep = patterns[buzPattern];
+    buzRequest = BUZ_NONE;
+    if(buzOn)
+      buzzerOutput(false);
+    buzOn = false;
+  }
+  if(buzPattern == BUZ_NONE)
+    return;
+
+  if(!buzOn){
+    if(buzStep->onMs == 0){     // end of pattern
+      buzPattern = BUZ_NONE;
+      // buzzerPlay() did not start the timer if it left its request before buzPattern was
+      // cleared: start it here. If both start it, one call fails and the tick runs once
+      if(buzRequest != BUZ_NONE)
+        esp_timer_start_once(buzTimer, 0);
+      return;
+    }
+    buzzerOutput(true);
+    buzOn = true;
+    ms = buzStep->onMs;
+  }
+  else{
+    buzzerOutput(false);
+    buzOn = false;
+    ms = buzStep->offMs;
+    buzStep++;
+  }
+  buzNextMs = (uint32_t)(esp_timer_get_time() / 1000) + ms;
+  esp_timer_start_once(buzTimer, (uint64_t)ms * 1000);
+}
+
+/**************************************************!
+   @brief    buzzerBegin()
+   @details  configure LEDC timer and channel, output off, and create the sequencer timer
+   @return   bool: false if not possible
+***************************************************/
+static bool buzzerBegin()
+{
+  ledc_timer_config_t timerCfg = {};
+  ledc_channel_config_t channelCfg = {};
+  esp_timer_create_args_t args = {};
+
+  timerCfg.speed_mode = BUZ_LEDC_MODE;
+  timerCfg.duty_resolution = BUZ_LEDC_BITS;
+  timerCfg.timer_num = BUZ_LEDC_TIMER;
+  timerCfg.freq_hz = BUZZER_FREQ;
+  timerCfg.clk_cfg = LEDC_USE_RTC8M_CLK;
+  channelCfg.gpio_num = BUZZER_PIN;
+  channelCfg.speed_mode = BUZ_LEDC_MODE;
+  channelCfg.channel = BUZ_LEDC_CHANNEL;
+  channelCfg.intr_type = LEDC_INTR_DISABLE;
+  channelCfg.timer_sel = BUZ_LEDC_TIMER;
+  channelCfg.duty = 0;
+  if(ledc_timer_config(&timerCfg) != ESP_OK || ledc_channel_config(&channelCfg) != ESP_OK){
+    logOut<1>("Buzzer: LEDC configuration failed");
+    return(false);
+  }
+
+  args.callback = buzzerTick;
+  args.name = "buzzer";
+  if(esp_timer_create(&args, &buzTimer) != ESP_OK){
+    logOut<1>("Buzzer: timer not created");
+    buzTimer = NULL;
+    return(false);
+  }
+  return(true);
+}
+
+/**************************************************!
+   @brief    buzzerPlay()
+   @details  start a pattern and return at once. Calls for the pattern that is playing
+   @details  are ignored, e.g. from each page of a drawing loop
+   @param    pattern: BUZ_xxx
+   @return   void
+***************************************************/
+void buzzerPlay(uint8_t pattern)
+{
+  if(BUZZER_PIN < 0 || pattern >= BUZ_NUM_PATTERNS)
+    return;
+  if(buzTimer == NULL && !buzzerBegin())
+    return;
+  if(buzPattern == pattern || buzRequest == pattern)
+    return;
+  logOut<3>("Buzzer pattern %d", pattern);
+  buzRequest = pattern;
+  if(buzPattern == BUZ_NONE)                  // idle: start now. Otherwise taken at the next step
+    esp_timer_start_once(buzTimer, 0);        // fails if just started by the callback: taken then
+}
+
+// pattern playing or requested
+bool buzzerBusy()
+{
+  return(buzPattern != BUZ_NONE || buzRequest != BUZ_NONE);
+}
+
+/**************************************************!
+   @brief    buzzerWait()
+   @details  wait until the pattern has ended, in light sleep until the next step if it is
+   @details  far enough. The LEDC output and the RTC8M clock keep running; the esp_timer
+   @details  callback of the step runs after the wakeup. RTC8M is back to automatic power
+   @details  down afterwards, the following deep sleep does not keep it on
+   @param    timeoutMs: max. wait
+   @return   void
+***************************************************/
+void buzzerWait(uint32_t timeoutMs)
+{
+  uint32_t t = millis();
+  int32_t ms;
+  bool rtc8mOn = false;
+
+  while(buzzerBusy() && millis() - t < timeoutMs){
+    ms = (int32_t)(buzNextMs - (uint32_t)(esp_timer_get_time() / 1000));
+    if(ms >= BUZZER_SLEEP_MIN_MS){
+      esp_sleep_pd_config(ESP_PD_DOMAIN_RTC8M, ESP_PD_OPTION_ON);
+      rtc8mOn = true;
+      esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+      if(esp_light_sleep_start() != ESP_OK)   // e.g. rejected by a running radio
+        delay(ms);
+    }
+    else
+      delay(1);
+  }
+  // the setting also applies to deep sleep: RTC8M powered down again there
+  if(rtc8mOn)
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC8M, ESP_PD_OPTION_AUTO);
+}
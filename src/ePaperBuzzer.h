@@ -0,0 +1,44 @@
+#ifndef _ePaperBuzzer_H
+#define _ePaperBuzzer_H
+
+// buzzer: LEDC output switched by a pattern sequencer on an esp_timer. buzzerPlay() returns at
+// once, the pattern plays while the caller draws or the panel refreshes. The LEDC timer runs
+// from the RTC 8 MHz clock, so the output continues in light sleep: buzzerWait() light-sleeps
+// until the pattern has ended, called before deep sleep.
+
+#include <stdint.h>
+
+//************** module defines *************************/
+#ifdef LOLIN32_LITE
+  #define BUZZER_PIN          2       // GPIO of the buzzer
+#endif
+#ifdef CROW_PANEL
+  #define BUZZER_PIN          -1      // no buzzer: GPIO 2 is the MENU button
+#endif
+#define BUZZER_FREQ           2700    // Hz, resonance of common piezo buzzers
+#define BUZZER_DUTY_PERCENT   100     // 100: constant level for an active buzzer (own oscillator), 50 for a passive one
+#define BUZZER_SLEEP_MIN_MS   20      // shorter waits are not worth a light sleep
+#define BUZZER_MAX_WAIT_MS    3000    // longest wait for the end of a pattern before deep sleep
+
+// patterns
+#define BUZ_ALERT             0       // alert rule: 5 x 150 ms
+#define BUZ_ACK               1       // command done: 100 ms
+#define BUZ_ERROR             2       // command rejected: 500 ms
+#define BUZ_BT_ENTER          3       // bluetooth configuration started: 2 x 200 ms
+#define BUZ_BT_EXIT           4       // bluetooth configuration ended: 500 ms
+#define BUZ_NUM_PATTERNS      5
+
+//************** module global variables *************************/
+// one step of a pattern: output on, then off. A step with onMs 0 ends the pattern
+struct buzzerStep
+{
+  uint16_t onMs;
+  uint16_t offMs;
+};
+
+//************** function prototypes *************************/
+void buzzerPlay(uint8_t pattern);     // start pattern, returns at once. No effect if it is playing already
+bool buzzerBusy();                    // pattern playing or requested
+void buzzerWait(uint32_t timeoutMs);  // light-sleep until the pattern has ended, at most timeoutMs
+
+#endif // _ePaperBuzzer_H
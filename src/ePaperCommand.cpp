@@ -0,0 +1,599 @@
+/**************************************************!
+   configuration commands for serial bluetooth and BLE
+   the transport reads a line into its own fixed buffer and calls
+   cmdExecute() with a session context. A line may hold a batch of commands
+   separated by ';', e.g. "ATP;ATI;ATD,12.5". The transport redraws, beeps
+   and persists once per batch instead of once per command. Replies go to ctx->replyLine(),
+   report lines to ctx->printLine(). No String, no heap allocation.
+***************************************************/
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_pm.h"
+
+#include "global.h"
+#include "ePaperCommand.h"
+#include "ePaperProfiler.h"
+#include "ePaperEnergy.h"
+#include "ePaperJournal.h"
+#include "ePaperSensorProfile.h"
+#include "ePaperAcquisition.h"
+#include "ePaperDS18B20.h"
+#include "ePaperBattery.h"
+#include "ePaperTrace.h"
+#include "ePaperAlert.h"
+
+// lines from the transport callbacks to the session loop, static storage
+static StaticQueue_t cmdQueueBuffer;
+static uint8_t cmdQueueStorage[CMD_QUEUE_LEN * sizeof(cmdQueueItem)];
+static QueueHandle_t cmdQueue = NULL;
+
+/**************************************************!
+   @brief    cmdReply()
+   @details  format a reply into the reply buffer of the session and send it
+   @param    ctx: session
+   @param    format: printf format
+   @return   void
+***************************************************/
+void cmdReply(cmdContext* ctx, const char* format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(ctx->reply, sizeof(ctx->reply), format, args);
+  va_end(args);
+  if(ctx->replyLine)
+    ctx->replyLine(ctx->reply);
+}
+
+//************** command handlers *************************/
+static void setGraphics(cmdContext* ctx, char name, int32_t type, const char* text)
+{
+  wData.graphicsType = type;
+  wData.preferencesChanged = true;
+  cmdReply(ctx, "Command: %c - %s", name, text);
+}
+static void cmdPressure(const cmdArg* a, cmdContext* ctx)   { setGraphics(ctx, 'P', 0, "use pressure graphics"); }
+static void cmdTemp(const cmdArg* a, cmdContext* ctx)       { setGraphics(ctx, 'T', 1, "temperature graphics"); }
+static void cmdHumi(const cmdArg* a, cmdContext* ctx)       { setGraphics(ctx, 'H', 2, "humidity graphics"); }
+static void cmdPressTemp(const cmdArg* a, cmdContext* ctx)  { setGraphics(ctx, 'L', 4, "Press/Temp graphics"); }
+static void cmdPressHumi(const cmdArg* a, cmdContext* ctx)  { setGraphics(ctx, 'M', 5, "Press/Humidity graphics"); }
+static void cmdTempHumi(const cmdArg* a, cmdContext* ctx)   { setGraphics(ctx, 'N', 6, "Temp/Humidity graphics"); }
+static void cmdAll(const cmdArg* a, cmdContext* ctx)        { setGraphics(ctx, 'O', 7, "Press/Temp/Humi graphics"); }
+static void cmdDiagnostics(const cmdArg* a, cmdContext* ctx){ setGraphics(ctx, 'G', 8, "diagnostics screen"); }
+
+// "ATI" toggles, "ATI,0" / "ATI,1" sets the inversion
+static void cmdInvert(const cmdArg* a, cmdContext* ctx)
+{
+  wData.applyInversion = (a->i < 0) ? !wData.applyInversion : (a->i != 0);
+  wData.preferencesChanged = true;
+  cmdReply(ctx, "Command: I - Changing screen inverted display");
+}
+
+static void cmdCorrection(const cmdArg* a, cmdContext* ctx)
+{
+  wData.applyPressureCorrection = (a->i != 0);
+  wData.preferencesChanged = true;
+  cmdReply(ctx, "Command: C Param: %ld - changing pressure correction", (long)a->i);
+}
+
+static void cmdCorrValue(const cmdArg* a, cmdContext* ctx)
+{
+  wData.pressureCorrValue = a->f;
+  wData.preferencesChanged = true;
+  cmdReply(ctx, "Command: D Param: %f - changing pressure correction", a->f);
+}
+
+// time range of the graph: noDataPoints measurements, 225 s -> 21 h, 450 s -> 42 h, 900 s -> 84 h
+static bool validTimescale(const cmdArg* a, cmdState* st)
+{
+  int32_t target = a->i * 3600 / noDataPoints;
+
+  if(a->i != 21 && a->i != 42 && a->i != 84)
+    return(false);
+  if(target != st->intervalSec && target * 4 != st->intervalSec && target * 2 != st->intervalSec
+     && target != st->intervalSec * 2 && target != st->intervalSec * 4)
+    return(false);
+  st->intervalSec = target;
+  return(true);
+}
+
+static void cmdTimescale(const cmdArg* a, cmdContext* ctx)
+{
+  int32_t cur = wData.targetMeasurementIntervalSec;
+  int32_t target = a->i * 3600 / noDataPoints;
+
+  if(target == cur)
+    cmdReply(ctx, "Command: S Param: %ld - timescale unchanged", (long)a->i);
+  else{
+    if(target * 4 == cur)      quarterMeasurementScale();
+    else if(target * 2 == cur) halfMeasurementScale();
+    else if(target == cur * 2) doubleMeasurementScale();
+    else if(target == cur * 4) quadrupleMeasurementScale();
+    else{
+      cmdReply(ctx, "not possible, Interval: %ld", (long)cur);
+      return;
+    }
+    wData.preferencesChanged = true;
+    cmdReply(ctx, "Command: S Param: %ld - timescale changed", (long)a->i);
+  }
+}
+
+static void cmdLifetime(const cmdArg* a, cmdContext* ctx)
+{
+  wData.targetLifetimeDays = a->i;
+  wData.preferencesChanged = true;
+  cmdReply(ctx, "Command: E Param: %ld - target battery life days", (long)a->i);
+}
+
+// change of measurement scale: allowed only from the given intervals
+static bool validScale(cmdState* st, int32_t interval1, int32_t interval2, int32_t mul, int32_t div)
+{
+  if(st->intervalSec != interval1 && st->intervalSec != interval2)
+    return(false);
+  st->intervalSec = st->intervalSec * mul / div;
+  return(true);
+}
+static bool validQuarter(const cmdArg* a, cmdState* st)   { return(validScale(st, 900, 900, 1, 4)); }
+static bool validHalf(const cmdArg* a, cmdState* st)      { return(validScale(st, 450, 900, 1, 2)); }
+static bool validDouble(const cmdArg* a, cmdState* st)    { return(validScale(st, 225, 450, 2, 1)); }
+static bool validQuadruple(const cmdArg* a, cmdState* st) { return(validScale(st, 225, 225, 4, 1)); }
+
+static void changeScale(cmdContext* ctx, char name, const char* text, const char* done,
+                        void (*change)(), int32_t interval1, int32_t interval2)
+{
+  cmdReply(ctx, "Command: %c - %s", name, text);
+  if(wData.targetMeasurementIntervalSec == interval1 || wData.targetMeasurementIntervalSec == interval2){
+    change();
+    wData.preferencesChanged = true;
+    cmdReply(ctx, "%s", done);
+  }
+  else
+    cmdReply(ctx, "not possible, Interval: %ld", (long)wData.targetMeasurementIntervalSec);
+}
+static void cmdQuarter(const cmdArg* a, cmdContext* ctx)
+  { changeScale(ctx, 'Q', "quarter meas scale", "quartering of scale done", quarterMeasurementScale, 900, 900); }
+static void cmdHalf(const cmdArg* a, cmdContext* ctx)
+  { changeScale(ctx, 'R', "half meas scale", "halfing of scale done", halfMeasurementScale, 450, 900); }
+static void cmdDouble(const cmdArg* a, cmdContext* ctx)
+  { changeScale(ctx, 'U', "double meas scale", "doubling of scale done", doubleMeasurementScale, 225, 450); }
+static void cmdQuadruple(const cmdArg* a, cmdContext* ctx)
+  { changeScale(ctx, 'V', "quadruple meas scale", "quadrupling of scale done", quadrupleMeasurementScale, 225, 225); }
+
+static void cmdWakeProfile(const cmdArg* a, cmdContext* ctx)
+{
+  cmdReply(ctx, "Command: W - wake profile report");
+  profReport(ctx->printLine);
+}
+
+static void cmdEnergy(const cmdArg* a, cmdContext* ctx)
+{
+  cmdReply(ctx, "Command: B - energy report");
+  batReport(ctx->printLine);
+  energyReport(ctx->printLine);
+}
+
+static void cmdJournal(const cmdArg* a, cmdContext* ctx)
+{
+  cmdReply(ctx, "Command: J - journal report");
+  journalReport(wData.targetMeasurementIntervalSec, ctx->printLine);
+}
+
+static void cmdSensors(const cmdArg* a, cmdContext* ctx)
+{
+  cmdReply(ctx, "Command: K - sensor profile report");
+  spReport(ctx->printLine);
+  acqReport(ctx->printLine);
+  dsReport(ctx->printLine);
+}
+
+// "ATA" reports the alert rules, "ATA,<rule>" changes one, "ATA,ACK" acknowledges active alerts
+static bool validAlert(const cmdArg* a, cmdState* st)
+{
+  return(a->s == NULL || alertCommandValid(a->s));
+}
+
+static void cmdAlert(const cmdArg* a, cmdContext* ctx)
+{
+  if(a->s == NULL)
+    cmdReply(ctx, "Command: A - alert rules");
+  else{
+    if(alertCommand(a->s))
+      wData.preferencesChanged = true;
+    cmdReply(ctx, "Command: A Param: %s - alert rules", a->s);
+  }
+  alertReport(ctx->printLine);
+}
+
+static void cmdTrace(const cmdArg* a, cmdContext* ctx)
+{
+  cmdReply(ctx, "Command: Y - trace dump");
+  traceDrain(ctx->printLine);
+}
+
+static void cmdCommit(const cmdArg* a, cmdContext* ctx)
+{
+  if(wData.preferencesChanged){
+    writePreferences();
+    wData.preferencesChanged = false;
+    cmdReply(ctx, "Command: Z - settings saved");
+  }
+  else
+    cmdReply(ctx, "Command: Z - no changes to save");
+}
+
+static void cmdExit(const cmdArg* a, cmdContext* ctx)
+{
+  ctx->exit = true;
+  cmdReply(ctx, "Command: X - Exit");
+}
+
+static void cmdHelpCommand(const cmdArg* a, cmdContext* ctx)
+{
+  cmdReply(ctx, "Command: ? - Sending help message");
+  cmdHelp(ctx->printLine);
+}
+
+//************** command table *************************/
+static constexpr cmdEntry cmdTable[] = {
+  { 'I', ARG_OPT_INT, 0,  1,    NULL,           cmdInvert,      "ATI[,1] : Invert screen (toggle|0|1)" },
+  { 'C', ARG_INT,   0,    1,    NULL,           cmdCorrection,  "ATC,0   : Pressure correction (0|1)" },
+  { 'D', ARG_FLOAT, -300, 300,  NULL,           cmdCorrValue,   "ATD,15.2: Set pressure corr.val (hPa)" },
+  { 'S', ARG_INT,   21,   84,   validTimescale, cmdTimescale,   "ATS,84  : Set timescale (21|42|84 h)" },
+  { 'P', ARG_NONE,  0,    0,    NULL,           cmdPressure,    "ATP     : Pressure graphics" },
+  { 'T', ARG_NONE,  0,    0,    NULL,           cmdTemp,        "ATT     : Temperature graphics" },
+  { 'H', ARG_NONE,  0,    0,    NULL,           cmdHumi,        "ATH     : Humidity graphics" },
+  { 'L', ARG_NONE,  0,    0,    NULL,           cmdPressTemp,   "ATL     : Press/Temp graphics" },
+  { 'M', ARG_NONE,  0,    0,    NULL,           cmdPressHumi,   "ATM     : Press/Humi graphics" },
+  { 'N', ARG_NONE,  0,    0,    NULL,           cmdTempHumi,    "ATN     : Temp/Humi graphics" },
+  { 'O', ARG_NONE,  0,    0,    NULL,           cmdAll,         "ATO     : P/T/H graphics" },
+  { 'Q', ARG_NONE,  0,    0,    validQuarter,   cmdQuarter,     "ATQ     : Meas Scale 84->21h" },
+  { 'R', ARG_NONE,  0,    0,    validHalf,      cmdHalf,        "ATR     : Meas Scale 84/42->42/21h" },
+  { 'U', ARG_NONE,  0,    0,    validDouble,    cmdDouble,      "ATU     : Meas Scale 21/42->42/84" },
+  { 'V', ARG_NONE,  0,    0,    validQuadruple, cmdQuadruple,   "ATV     : Meas Scale 21->84h" },
+  { 'G', ARG_NONE,  0,    0,    NULL,           cmdDiagnostics, "ATG     : Diagnostics screen" },
+  { 'W', ARG_NONE,  0,    0,    NULL,           cmdWakeProfile, "ATW     : Wake profile report" },
+  { 'B', ARG_NONE,  0,    0,    NULL,           cmdEnergy,      "ATB     : Battery/energy report" },
+  { 'E', ARG_INT,   0,    1000, NULL,           cmdLifetime,    "ATE,120 : Target battery life days" },
+  { 'J', ARG_NONE,  0,    0,    NULL,           cmdJournal,     "ATJ     : Counter journal report" },
+  { 'K', ARG_NONE,  0,    0,    NULL,           cmdSensors,     "ATK     : Sensors/profile/acquisition" },
+  { 'A', ARG_TEXT,  0,    0,    validAlert,     cmdAlert,       "ATA[,..]: Alert rules (ATA: list)" },
+  { 'Y', ARG_NONE,  0,    0,    NULL,           cmdTrace,       "ATY     : Trace dump (tools/traceDecode)" },
+  { 'Z', ARG_NONE,  0,    0,    NULL,           cmdCommit,      "ATZ     : Save settings (commit)" },
+  { 'X', ARG_NONE,  0,    0,    NULL,           cmdExit,        "ATX     : Exit Bluetooth Setup" },
+  { '?', ARG_NONE,  0,    0,    NULL,           cmdHelpCommand, "AT?     : Help" },
+};
+#define CMD_COUNT ((int)(sizeof(cmdTable) / sizeof(cmdTable[0])))
+
+// compile time lookup and check of the table (C++11: recursion instead of loops)
+static constexpr const cmdEntry* cmdFindFrom(char name, int i)
+{
+  return (i >= CMD_COUNT) ? nullptr : (cmdTable[i].name == name) ? &cmdTable[i] : cmdFindFrom(name, i+1);
+}
+static constexpr bool cmdUniqueFrom(int i)
+{
+  return (i >= CMD_COUNT) ? true : (cmdFindFrom(cmdTable[i].name, i+1) == nullptr) && cmdUniqueFrom(i+1);
+}
+static_assert(cmdUniqueFrom(0), "command letters in cmdTable must be unique");
+
+/**************************************************!
+   @brief    cmdFind()
+   @param    name: command letter
+   @return   const cmdEntry*: table entry, NULL if unknown
+***************************************************/
+const cmdEntry* cmdFind(char name)
+{
+  return(cmdFindFrom(name, 0));
+}
+
+/**************************************************!
+   @brief    cmdParse()
+   @details  tokenize in place: trim white space, upper case, "AT<x>[,<arg>]"
+   @param    line: zero terminated command line, modified
+   @param    req: command letter and argument text (pointer into line)
+   @return   int: CMD_OK or CMD_ERR_FORMAT
+***************************************************/
+int cmdParse(char* line, cmdRequest* req)
+{
+  char *p, *end;
+
+  req->name = 0;
+  req->argText = NULL;
+  for(p = line; *p == ' ' || *p == '\t'; p++);
+  for(end = p + strlen(p); end > p && isspace((unsigned char)end[-1]); end--);
+  *end = 0;
+  for(char* q = p; *q; q++)
+    *q = toupper((unsigned char)*q);
+  if(end - p < 3 || p[0] != 'A' || p[1] != 'T')
+    return(CMD_ERR_FORMAT);
+  req->name = p[2];
+  if(p[3] == ',')
+    req->argText = p + 4;
+  else if(p[3] != 0)
+    return(CMD_ERR_FORMAT);
+  return(CMD_OK);
+}
+
+/**************************************************!
+   @brief    cmdParseArg()
+   @details  convert the argument text, the whole text must be a number
+   @param    text: argument text
+   @param    argType: ARG_INT, ARG_OPT_INT or ARG_FLOAT
+   @param    arg: value as int and float
+   @return   int: CMD_OK or CMD_ERR_ARG
+***************************************************/
+int cmdParseArg(const char* text, uint8_t argType, cmdArg* arg)
+{
+  char* end;
+
+  while(*text == ' ') text++;
+  if(*text == 0)
+    return(CMD_ERR_ARG);
+  if(argType != ARG_FLOAT){
+    long v = strtol(text, &end, 10);
+    if(v > 1000000L || v < -1000000L) return(CMD_ERR_ARG);
+    arg->i = (int32_t)v;
+    arg->f = (float)v;
+  }
+  else{
+    arg->f = strtof(text, &end);
+    arg->i = (int32_t)arg->f;
+  }
+  while(*end == ' ') end++;
+  return((*end == 0) ? CMD_OK : CMD_ERR_ARG);
+}
+
+/**************************************************!
+   @brief    cmdCheck()
+   @details  parse, look up and validate one command. Errors are replied
+   @param    line: one command, modified
+   @param    ctx: session
+   @param    state: state before the command, updated to the state after it
+   @param    arg: validated argument
+   @param    ret: CMD_OK or CMD_ERR_xxx
+   @return   const cmdEntry*: table entry, NULL if invalid
+***************************************************/
+static const cmdEntry* cmdCheck(char* line, cmdContext* ctx, cmdState* state, cmdArg* arg, int* ret)
+{
+  cmdRequest req;
+  const cmdEntry* e;
+
+  arg->i = 0;
+  arg->f = 0;
+  arg->s = NULL;
+  *ret = cmdParse(line, &req);
+  if(*ret != CMD_OK){
+    cmdReply(ctx, "Not a valid command: _%s_", line);
+    return(NULL);
+  }
+  trace(TR_BT_CMD, req.name, req.argText ? strlen(req.argText) : 0);
+  e = cmdFind(req.name);
+  if(e == NULL){
+    *ret = CMD_ERR_UNKNOWN;
+    cmdReply(ctx, "Not a valid command: _%c_", req.name);
+    return(NULL);
+  }
+  if(e->argType == ARG_TEXT){
+    arg->s = req.argText;
+    if(e->valid != NULL && !e->valid(arg, state)){
+      *ret = CMD_ERR_ARG;
+      cmdReply(ctx, "INVALID command: %c Param: %s", req.name, req.argText ? req.argText : "");
+      return(NULL);
+    }
+  }
+  else if(e->argType == ARG_OPT_INT && req.argText == NULL){
+    arg->i = -1;
+    arg->f = -1;
+  }
+  else if(e->argType != ARG_NONE){
+    *ret = req.argText ? cmdParseArg(req.argText, e->argType, arg) : CMD_ERR_ARG;
+    if(*ret == CMD_OK && !(arg->f >= e->minVal && arg->f <= e->maxVal))   // also catches nan
+      *ret = CMD_ERR_RANGE;
+    if(*ret == CMD_OK && e->valid != NULL && !e->valid(arg, state))
+      *ret = CMD_ERR_RANGE;
+    if(*ret != CMD_OK){
+      cmdReply(ctx, "INVALID command: %c Param: %s", req.name, req.argText ? req.argText : "");
+      return(NULL);
+    }
+  }
+  else if(e->valid != NULL && !e->valid(arg, state)){
+    *ret = CMD_ERR_STATE;
+    cmdReply(ctx, "Command: %c not possible, Interval: %ld", req.name, (long)state->intervalSec);
+    return(NULL);
+  }
+  return(e);
+}
+
+/**************************************************!
+   @brief    cmdExecute()
+   @details  split a batch at ';', validate all commands, then run the handlers.
+   @details  Each command is validated against the state the commands before it
+   @details  leave. If one command is invalid, none is executed (errors are replied)
+   @param    line: zero terminated command line, modified
+   @param    ctx: session, ctx->executed: number of commands run
+   @return   int: CMD_OK or CMD_ERR_xxx of the first invalid command
+***************************************************/
+int cmdExecute(char* line, cmdContext* ctx)
+{
+  const cmdEntry* e[CMD_MAX_BATCH];
+  cmdArg arg[CMD_MAX_BATCH];
+  cmdState state;
+  char *p, *next;
+  int i, n = 0, ret, first = CMD_OK;
+
+  ctx->executed = 0;
+  state.intervalSec = wData.targetMeasurementIntervalSec;
+  for(p = line; p != NULL; p = next){
+    next = strchr(p, ';');
+    if(next != NULL)
+      *next++ = 0;
+    while(*p == ' ') p++;
+    if(*p == 0 && (next != NULL || n > 0))    // empty command, e.g. trailing ';'
+      continue;
+    if(n >= CMD_MAX_BATCH){
+      cmdReply(ctx, "Too many commands, max. %d", CMD_MAX_BATCH);
+      return(CMD_ERR_BATCH);
+    }
+    e[n] = cmdCheck(p, ctx, &state, &arg[n], &ret);
+    if(e[n] == NULL && first == CMD_OK)
+      first = ret;
+    n++;
+  }
+  if(first != CMD_OK){
+    if(n > 1)
+      cmdReply(ctx, "Batch rejected, nothing changed");
+    return(first);
+  }
+  for(i=0; i<n; i++)
+    e[i]->handler(&arg[i], ctx);
+  ctx->executed = n;
+  return(CMD_OK);
+}
+
+/**************************************************!
+   @brief    cmdHelp()
+   @details  send the help lines of all commands
+   @param    printLine : function to output one line of text (serial, bluetooth)
+   @return   void
+***************************************************/
+void cmdHelp(void (*printLine)(char*))
+{
+  char line[CMD_REPLY_LEN];
+  int i;
+
+  snprintf(line, sizeof(line), "Commands:");
+  printLine(line);
+  for(i=0; i<CMD_COUNT; i++){
+    snprintf(line, sizeof(line), "%s", cmdTable[i].help);
+    printLine(line);
+  }
+}
+
+/**************************************************!
+   @brief    cmdQueueBegin()
+   @details  create the line queue with static storage, or empty it for a new session
+   @return   void
+***************************************************/
+void cmdQueueBegin()
+{
+  if(cmdQueue == NULL)
+    cmdQueue = xQueueCreateStatic(CMD_QUEUE_LEN, sizeof(cmdQueueItem), cmdQueueStorage, &cmdQueueBuffer);
+  else
+    xQueueReset(cmdQueue);
+}
+
+/**************************************************!
+   @brief    cmdPost()
+   @details  called by the transport callback (bluetooth task): queue one line.
+   @details  Does not block, if the queue is full the line is dropped
+   @param    data: received characters, not terminated
+   @param    len: number of characters
+   @return   bool: true if queued
+***************************************************/
+bool cmdPost(const char* data, size_t len)
+{
+  cmdQueueItem item;
+
+  if(cmdQueue == NULL || len == 0)
+    return(false);
+  if(len > CMD_MAX_LEN - 1)   // excess characters are dropped
+    len = CMD_MAX_LEN - 1;
+  item.event = CMD_EVENT_NONE;
+  memcpy(item.line, data, len);
+  item.line[len] = 0;
+  if(xQueueSend(cmdQueue, &item, 0) != pdTRUE){
+    logOut<1>("cmdPost: queue full, dropped: %s", item.line);
+    return(false);
+  }
+  return(true);
+}
+
+/**************************************************!
+   @brief    cmdPostEvent()
+   @details  called by the transport callback (bluetooth task): queue an event, in order
+   @details  with the lines, tagged so no client text can be taken for it. Does not block
+   @param    event: event of the transport, > CMD_EVENT_NONE
+   @return   bool: true if queued
+***************************************************/
+bool cmdPostEvent(uint8_t event)
+{
+  cmdQueueItem item;
+
+  if(cmdQueue == NULL || event == CMD_EVENT_NONE)
+    return(false);
+  item.event = event;
+  item.line[0] = 0;
+  if(xQueueSend(cmdQueue, &item, 0) != pdTRUE){
+    logOut<1>("cmdPostEvent: queue full, dropped event %d", event);
+    return(false);
+  }
+  return(true);
+}
+
+/**************************************************!
+   @brief    cmdWait()
+   @details  session loop: block until a line or an event is received. The CPU idles
+   @details  (or sleeps, see cmdSessionPower()) meanwhile
+   @param    line: buffer of CMD_MAX_LEN characters, empty for an event
+   @param    timeoutMs: max. wait time
+   @param    event: CMD_EVENT_NONE for a line, else the event. NULL if the transport posts no events
+   @return   bool: true if a line or event has been received, false at timeout
+***************************************************/
+bool cmdWait(char* line, uint32_t timeoutMs, uint8_t* event)
+{
+  cmdQueueItem item;
+
+  if(cmdQueue == NULL || xQueueReceive(cmdQueue, &item, pdMS_TO_TICKS(timeoutMs)) != pdTRUE)
+    return(false);
+  memcpy(line, item.line, CMD_MAX_LEN);
+  if(event != NULL)
+    *event = item.event;
+  return(true);
+}
+
+/**************************************************!
+   @brief    cmdSessionPower()
+   @details  a session waits for user input most of the time. The CPU clock is
+   @details  reduced to CMD_SESSION_MHZ, the radio keeps its connection; this is the
+   @details  only saving in the configured envs. The light sleep branch needs power
+   @details  management and tickless idle in sdkconfig, the prebuilt sdkconfig of the
+   @details  Arduino core has neither (framework = arduino, espidf would be needed);
+   @details  it is not compiled and its current has not been measured
+   @param    begin: true at start, false at end of a session
+   @return   void
+***************************************************/
+void cmdSessionPower(bool begin)
+{
+  static uint32_t savedMhz = 0;
+
+  if(begin){
+    savedMhz = getCpuFrequencyMhz();
+    #if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+      #ifdef CONFIG_IDF_TARGET_ESP32S3
+        esp_pm_config_esp32s3_t pm = { CMD_SESSION_MHZ, 40, true };
+      #else
+        esp_pm_config_esp32_t pm = { CMD_SESSION_MHZ, 40, true };
+      #endif
+      if(esp_pm_configure(&pm) == ESP_OK)
+        return;
+    #endif
+    if(savedMhz > CMD_SESSION_MHZ)
+      setCpuFrequencyMhz(CMD_SESSION_MHZ);
+  }
+  else if(savedMhz != 0){
+    #if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+      #ifdef CONFIG_IDF_TARGET_ESP32S3
+        esp_pm_config_esp32s3_t pm = { (int)savedMhz, (int)savedMhz, false };
+      #else
+        esp_pm_config_esp32_t pm = { (int)savedMhz, (int)savedMhz, false };
+      #endif
+      esp_pm_configure(&pm);
+    #endif
+    if(getCpuFrequencyMhz() != savedMhz)
+      setCpuFrequencyMhz(savedMhz);
+  }
+}
@@ -0,0 +1,113 @@
+#ifndef _ePaperCommand_H
+#define _ePaperCommand_H
+
+// transport independent configuration commands, used by serial bluetooth (SPP) and BLE.
+// Format: AT<x>[,<argument>], several commands separated by ';' form a batch.
+// The line is tokenized in place, no heap allocation.
+// Commands are looked up in a constexpr table (letter, argument schema, handler, help text),
+// the argument is validated before the handler runs. Replies are formatted into the
+// preallocated buffer of the session context.
+// A batch is validated completely before the first handler runs: either all commands
+// are applied or none. Commands that depend on the state (e.g. "ATQ" only from 84 h)
+// are validated against the state the commands before them in the batch leave, so
+// "ATU;ATQ" is accepted at 21 h. Settings are changed in RAM only; they are persisted once by
+// "ATZ" (commit) or at the end of the session.
+// The transport callbacks run in the bluetooth task: they post received lines into a
+// FreeRTOS queue, the session loop blocks on it (cmdWait) instead of polling. Events of the
+// transport (disconnect, ...) are queued in the same order, but tagged: no client text is
+// taken for an event.
+
+#include <stdint.h>
+#include "global.h"
+
+//************** module defines *************************/
+#define CMD_MAX_LEN         128     // max. length of a command line incl. terminating 0
+#define CMD_MAX_BATCH       12      // max. commands in one line, separated by ';'
+#define CMD_QUEUE_LEN       4       // lines queued between bluetooth task and session
+#define CMD_EVENT_NONE      0       // queue item is a received line, transport events are > 0
+#define CMD_SESSION_MHZ     80      // CPU clock during a session, min. for the radio
+#define CMD_REPLY_LEN       maxLOG_STRING_LEN
+
+// argument schema
+#define ARG_NONE            0       // no argument, ignored if given
+#define ARG_INT             1       // integer, range checked
+#define ARG_FLOAT           2       // float, range checked
+#define ARG_OPT_INT         3       // optional integer, range checked if given, -1 if not
+#define ARG_TEXT            4       // optional text, checked by the validator only, NULL if not given
+
+// results of cmdParse() and cmdExecute()
+#define CMD_OK              0
+#define CMD_ERR_FORMAT     -1       // not AT<x>
+#define CMD_ERR_UNKNOWN    -2       // no such command letter
+#define CMD_ERR_ARG        -3       // argument missing or not a number
+#define CMD_ERR_RANGE      -4       // argument out of range
+#define CMD_ERR_BATCH      -5       // too many commands in one line
+#define CMD_ERR_STATE      -6       // not possible in the state before the command
+
+//************** module global variables *************************/
+// session of one transport, preallocated by the transport
+struct cmdContext
+{
+  char reply[CMD_REPLY_LEN];        // reply buffer
+  void (*replyLine)(char*);         // send a reply: transport, log and display
+  void (*printLine)(char*);         // send one line of a report: transport only
+  bool exit;                        // "ATX": end of configuration session
+  int executed;                     // commands executed by the last cmdExecute()
+};
+
+// parsed command line, pointers into the line buffer
+struct cmdRequest
+{
+  char name;                        // command letter
+  char* argText;                    // argument text, NULL if none
+};
+
+// validated argument
+struct cmdArg
+{
+  int32_t i;
+  float f;
+  const char* s;                    // ARG_TEXT: argument text in the line buffer, NULL if none
+};
+
+// settings the validity of a command depends on, as the commands before it in the batch leave them
+struct cmdState
+{
+  int32_t intervalSec;              // wData.targetMeasurementIntervalSec
+};
+
+typedef void (*cmdHandler)(const cmdArg* arg, cmdContext* ctx);
+typedef bool (*cmdValidator)(const cmdArg* arg, cmdState* state);   // check, then apply to state
+
+// one entry of the command table
+struct cmdEntry
+{
+  char name;                        // letter after "AT"
+  uint8_t argType;                  // ARG_xxx
+  float minVal, maxVal;             // valid range of argument
+  cmdValidator valid;               // additional check before the batch runs, or NULL
+  cmdHandler handler;
+  const char* help;                 // help line
+};
+
+// queue item: a received line or an event of the transport
+struct cmdQueueItem
+{
+  uint8_t event;                    // CMD_EVENT_NONE: line, else event of the transport
+  char line[CMD_MAX_LEN];
+};
+
+//************** function prototypes *************************/
+int cmdParse(char* line, cmdRequest* req);        // tokenize in place: trim, upper case, split
+int cmdParseArg(const char* text, uint8_t argType, cmdArg* arg);  // number, whole text must be used
+const cmdEntry* cmdFind(char name);               // NULL if unknown
+int cmdExecute(char* line, cmdContext* ctx);      // batch: parse and validate all, then run handlers
+void cmdReply(cmdContext* ctx, const char* format, ...);  // format reply and send it
+void cmdHelp(void (*printLine)(char*));           // help lines from the table
+void cmdQueueBegin();                             // create (static) or empty the line queue
+bool cmdPost(const char* data, size_t len);       // from transport callback: queue a line, never blocks
+bool cmdPostEvent(uint8_t event);                 // from transport callback: queue an event, never blocks
+bool cmdWait(char* line, uint32_t timeoutMs, uint8_t* event);  // session: block until a line or event arrives, false at timeout
+void cmdSessionPower(bool begin);                 // reduce CPU clock during a session
+
+#endif // _ePaperCommand_H
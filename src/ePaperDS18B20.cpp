@@ -0,0 +1,206 @@
+/**************************************************!
+   DS18B20 temperature channels
+   The bus is searched only after cold boot, addresses are kept in RTC memory.
+   One "convert T" for all sensors is sent at wake start (skip ROM), with
+   setWaitForConversion(false). After rendering the result is read if the
+   sensors report the conversion as complete, otherwise at the start of the
+   next wake: the sensors keep the result in their scratchpad.
+***************************************************/
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "global.h"
+#include "ePaperDS18B20.h"
+#include "ePaperTrace.h"
+#ifdef DS18B20_PIN
+  #include <OneWire.h>
+  #include <DallasTemperature.h>
+#endif
+
+// addresses and history, in RTC memory which survives the deep sleep. Zero after power on
+RTC_DATA_ATTR dsHistoryData dsData;
+
+#ifdef DS18B20_PIN
+  static OneWire oneWire(DS18B20_PIN);
+  static DallasTemperature sensors(&oneWire);
+#endif
+static uint32_t startMillis = 0;
+
+#ifdef DS18B20_PIN
+/**************************************************!
+   @brief    dsHistValue()
+   @details  temperature to history value, 0.5 °C steps, clamped to -40 .. +87 °C
+   @param    temperature: 0.1 °C or DS_NO_DATA
+   @return   uint8_t: history value
+***************************************************/
+static uint8_t dsHistValue(int16_t temperature)
+{
+  int32_t t = temperature;
+
+  if(temperature == DS_NO_DATA)
+    return(DS_HIST_NO_DATA);
+  if(t < DS_HIST_MIN) t = DS_HIST_MIN;
+  if(t > DS_HIST_MAX) t = DS_HIST_MAX;
+  return((uint8_t)((t - DS_HIST_MIN + 2) / 5));
+}
+
+/**************************************************!
+   @brief    dsSearch()
+   @details  cold boot: find the sensors and set the resolution
+***************************************************/
+static void dsSearch()
+{
+  int i;
+
+  memset(&dsData, 0, sizeof(dsData));
+  sensors.begin();
+  for(i=0; i<DS_MAX_SENSORS && i<sensors.getDeviceCount(); i++){
+    if(sensors.getAddress(dsData.address[dsData.count], i)){
+      sensors.setResolution(dsData.address[dsData.count], DS_RESOLUTION);
+      dsData.count++;
+    }
+  }
+  for(i=0; i<DS_MAX_SENSORS; i++){
+    dsData.actTemperature[i] = DS_NO_DATA;
+    for(int j=0; j<noDataPoints; j++)
+      dsData.history[i][j] = DS_HIST_NO_DATA;
+  }
+  dsData.magic = DS_MAGIC;
+  logOut<2>("DS18B20: %d sensors found", dsData.count);
+}
+
+/**************************************************!
+   @brief    dsRead()
+   @details  read the scratchpads into the newest data point of the history
+***************************************************/
+static void dsRead()
+{
+  int i;
+  int32_t raw;
+
+  for(i=0; i<dsData.count; i++){
+    raw = sensors.getTemp(dsData.address[i]);   // 1/128 °C
+    // disconnected, or power on reset value 85 °C (conversion did not run)
+    if(raw == DEVICE_DISCONNECTED_RAW || raw == 85 * 128)
+      dsData.actTemperature[i] = DS_NO_DATA;
+    else
+      dsData.actTemperature[i] = (int16_t)((raw * 10 + (raw >= 0 ? 64 : -64)) / 128);
+    dsData.history[i][noDataPoints-1] = dsHistValue(dsData.actTemperature[i]);
+  }
+  dsData.pending = false;
+}
+#endif // DS18B20_PIN
+
+/**************************************************!
+   @brief    dsBegin()
+   @details  at wake start. A conversion not collected in the last wake has finished
+   @details  during sleep: it is read into the newest data point. Then a new conversion
+   @details  is started, which does not block.
+   @param    startConversion: false if no measurement expected (e.g. bluetooth setup)
+   @return   void
+***************************************************/
+void dsBegin(bool startConversion)
+{
+  #ifdef DS18B20_PIN
+    if(dsData.magic != DS_MAGIC)
+      dsSearch();
+    if(dsData.count == 0)
+      return;
+    sensors.setWaitForConversion(false);
+    if(dsData.pending){
+      dsRead();
+      dsData.collectedLate++;
+      trace(TR_DS18B20, dsData.actTemperature[0], DS_MAX_SENSORS > 1 ? dsData.actTemperature[DS_MAX_SENSORS-1] : DS_NO_DATA);
+    }
+    if(startConversion){
+      sensors.requestTemperatures();  // convert T to all sensors, returns immediately
+      startMillis = millis();
+      dsData.pending = true;
+    }
+  #endif
+}
+
+/**************************************************!
+   @brief    dsShiftHistory()
+   @details  called by storeMeasurementData(): shift the history, newest point has no data
+   @details  until collected
+   @return   void
+***************************************************/
+void dsShiftHistory()
+{
+  int i, j;
+
+  if(dsData.magic != DS_MAGIC || dsData.count == 0)
+    return;
+  for(i=0; i<dsData.count; i++){
+    for(j=0; j<noDataPoints-1; j++)
+      dsData.history[i][j] = dsData.history[i][j+1];
+    dsData.history[i][noDataPoints-1] = DS_HIST_NO_DATA;
+  }
+}
+
+/**************************************************!
+   @brief    dsCollect()
+   @details  after rendering: read the result if the conversion is complete. Never waits
+   @return   bool: true if collected
+***************************************************/
+bool dsCollect()
+{
+  #ifdef DS18B20_PIN
+    if(!dsData.pending || dsData.count == 0)
+      return(false);
+    if(!sensors.isConversionComplete()){
+      logOut<2>("DS18B20: conversion not complete after %ld ms, collected next wake", millis() - startMillis);
+      return(false);
+    }
+    dsRead();
+    trace(TR_DS18B20, dsData.actTemperature[0], DS_MAX_SENSORS > 1 ? dsData.actTemperature[DS_MAX_SENSORS-1] : DS_NO_DATA);
+    logOut<2>("DS18B20: %3.1f °C %3.1f °C after %ld ms",
+      dsTemperature(0, noDataPoints-1), dsTemperature(1, noDataPoints-1), millis() - startMillis);
+    return(true);
+  #else
+    return(false);
+  #endif
+}
+
+/**************************************************!
+   @brief    dsTemperature()
+   @param    channel: sensor 0..DS_MAX_SENSORS-1
+   @param    index: index in history
+   @return   float: temperature in °C, NAN if no data
+***************************************************/
+float dsTemperature(uint8_t channel, int index)
+{
+  if(dsData.magic != DS_MAGIC || channel >= dsData.count || index < 0 || index >= noDataPoints
+     || dsData.history[channel][index] == DS_HIST_NO_DATA)
+    return(NAN);
+  return((float)(dsData.history[channel][index] * 5 + DS_HIST_MIN) / 10.0);
+}
+
+/**************************************************!
+   @brief    dsReport()
+   @details  output of DS18B20 state
+   @param    printLine : function to output one line of text (serial, bluetooth)
+   @return   void
+***************************************************/
+void dsReport(void (*printLine)(char*))
+{
+  char line[maxLOG_STRING_LEN];
+  int i;
+
+  #ifdef DS18B20_PIN
+    snprintf(line, sizeof(line), "DS18B20: %d sensors, %lu collected late",
+      dsData.count, (unsigned long)dsData.collectedLate);
+  #else
+    snprintf(line, sizeof(line), "DS18B20: not supported on this board");
+  #endif
+  printLine(line);
+  for(i=0; i<dsData.count; i++){
+    snprintf(line, sizeof(line), "  %d: %02X%02X%02X%02X%02X%02X%02X%02X %3.1f °C", i,
+      dsData.address[i][0], dsData.address[i][1], dsData.address[i][2], dsData.address[i][3],
+      dsData.address[i][4], dsData.address[i][5], dsData.address[i][6], dsData.address[i][7],
+      dsData.actTemperature[i] == DS_NO_DATA ? NAN : (float)dsData.actTemperature[i] / 10.0);
+    printLine(line);
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef _ePaperDS18B20_H
+#define _ePaperDS18B20_H
+
+// DS18B20 temperature sensors (J5, J8 on the PCB) as extra temperature channels.
+// The conversion (750 ms at 12 bit) is started at wake start and collected after rendering,
+// without waiting. If it is not finished then, it is collected at the start of the next wake.
+
+#include <stdint.h>
+#include "global.h"
+
+//************** module defines *************************/
+#if defined(LOLIN32_LITE) && defined(PCB_BOARD)
+  #define DS18B20_PIN       25        // OneWire data of J5 / J8, 3.3 K pullup on PCB
+#endif
+#define DS_MAX_SENSORS      2         // J5 and J8, one bus
+#define DS_RESOLUTION       12        // bits, conversion 750 ms
+#define DS_NO_DATA          -32768    // actTemperature if no data
+#define DS_HIST_MIN         -400      // history: 0.5 °C steps from -40 °C (0) to +87 °C (254)
+#define DS_HIST_MAX         870
+#define DS_HIST_NO_DATA     255       // history value if no data
+#define DS_MAGIC            0x44533138  // "DS18", marks initialized RTC data
+
+//************** module global variables *************************/
+// addresses and history, stored in RTC memory which survives deep sleep.
+// 336 bytes of history per sensor: one byte per data point, as the graph needs no finer steps
+struct dsHistoryData
+{
+  uint32_t magic;                             // DS_MAGIC if addresses valid
+  uint8_t count;                              // sensors found at cold boot
+  uint8_t address[DS_MAX_SENSORS][8];         // ROM addresses
+  bool pending;                               // conversion started, not collected yet
+  int16_t actTemperature[DS_MAX_SENSORS];     // last value in 0.1 °C, DS_NO_DATA if none
+  uint32_t collectedLate;                     // conversions collected at start of next wake
+  uint8_t history[DS_MAX_SENSORS][noDataPoints]; // 0.5 °C steps, same index as wData.tempHistory
+};
+extern dsHistoryData dsData;
+
+//************** function prototypes *************************/
+void dsBegin(bool startConversion);   // wake start: collect pending conversion, start a new one
+void dsShiftHistory();                // with storeMeasurementData(): new data point, no data yet
+bool dsCollect();                     // after rendering: collect if finished, never waits
+float dsTemperature(uint8_t channel, int index);  // history value in °C, NAN if no data
+void dsReport(void (*printLine)(char*));
+
+#endif // _ePaperDS18B20_H
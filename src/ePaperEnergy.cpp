@@ -0,0 +1,211 @@
+/**************************************************!
+   energy accounting and battery life estimation
+   uses the phase durations of the wake profiler and the current draw per phase
+   to estimate consumption per day and remaining runtime. From this the display
+   refresh multiplier is chosen, to reach the target lifetime of a battery charge
+***************************************************/
+
+#include <Arduino.h>
+
+#include "global.h"
+#include "ePaperBarograf.h"
+#include "ePaperEnergy.h"
+
+// refresh multipliers to choose from, ascending
+static const uint32_t multipliers[ENERGY_NUM_MULTIPLIERS] = {
+  MULTIPLIER_FULL, MULTIPLIER_50, MULTIPLIER_20, MULTIPLIER_10, MULTIPLIER_5
+};
+
+// current draw per phase of the wake profiler. Panel and radio phases include the waiting CPU
+energyConfig eConfig = {
+  { CURRENT_CPU_MA,                     // boot
+    CURRENT_CPU_MA,                     // readPrf
+    CURRENT_CPU_MA + CURRENT_PANEL_MA,  // initDsp
+    CURRENT_CPU_MA,                     // sensor
+    CURRENT_CPU_MA,                     // store
+    CURRENT_CPU_MA + CURRENT_RADIO_MA,  // radio (beacon)
+    CURRENT_CPU_MA,                     // scene
+    CURRENT_CPU_MA + CURRENT_PANEL_MA,  // refresh
+    CURRENT_CPU_MA,                     // journal
+    CURRENT_CPU_MA,                     // writePrf
+    CURRENT_CPU_MA + CURRENT_PANEL_MA,  // sleep (includes panel hibernate)
+    CURRENT_CPU_MA },                   // wake: only used for the time not covered by other phases
+  CURRENT_SLEEP_MA,
+  CURRENT_RADIO_MA,
+  BATTERY_CAPACITY_MAH
+};
+
+energyEstimate eEstimate;
+
+/**************************************************!
+   @brief    energyWakeMaSec()
+   @details  charge consumed by one measurement wake. The time not covered by a phase
+   @details  is charged at the current of PROF_WAKE
+   @param    phaseUsec: duration of each phase in usec, PROF_NUM_PHASES entries.
+   @param    phaseUsec[PROF_WAKE]: duration of a wake without the scene and refresh phases
+   @param    withDisplay: true if the panel is refreshed in this wake, adds scene and refresh
+   @return   float: charge in mA*sec
+***************************************************/
+float energyWakeMaSec(const uint32_t* phaseUsec, bool withDisplay)
+{
+  float maSec = 0;
+  uint32_t coveredUsec = 0, wakeUsec = phaseUsec[PROF_WAKE];
+  int phase;
+
+  for(phase=0; phase<PROF_WAKE; phase++){
+    if(phase == PROF_SCENE || phase == PROF_REFRESH){
+      if(!withDisplay)
+        continue;
+      wakeUsec += phaseUsec[phase];
+    }
+    maSec += eConfig.phaseCurrentMa[phase] * (float)phaseUsec[phase] / 1000000.0;
+    coveredUsec += phaseUsec[phase];
+  }
+  // remaining awake time not covered by a phase (logging, time calculation etc.)
+  if(wakeUsec > coveredUsec)
+    maSec += eConfig.phaseCurrentMa[PROF_WAKE] * (float)(wakeUsec - coveredUsec) / 1000000.0;
+  return(maSec);
+}
+
+/**************************************************!
+   @brief    energyMahPerDay()
+   @details  consumption per day, if the panel is refreshed every <multiplier> measurements.
+   @details  Bluetooth sessions are charged with CPU and radio current, instead of deep sleep
+   @param    wakeMaSecDisplay: charge of a wake with panel refresh
+   @param    wakeMaSecNoDisplay: charge of a wake without panel refresh
+   @param    measIntervalSec: measurement interval
+   @param    awakeUsec: duration of a wake without panel refresh
+   @param    multiplier: refresh multiplier
+   @param    sessionSecPerDay: bluetooth / BLE sessions, radio on
+   @return   float: consumption in mAh per day
+***************************************************/
+float energyMahPerDay(float wakeMaSecDisplay, float wakeMaSecNoDisplay,
+                      uint32_t measIntervalSec, uint32_t awakeUsec, uint32_t multiplier,
+                      float sessionSecPerDay)
+{
+  float wakesPerDay, meanWakeMaSec, sleepSec;
+
+  if(measIntervalSec == 0) return(0);
+  if(multiplier == 0) multiplier = 1;
+  wakesPerDay = 86400.0 / (float)measIntervalSec;
+  meanWakeMaSec = (wakeMaSecDisplay + (multiplier-1) * wakeMaSecNoDisplay) / (float)multiplier;
+  sleepSec = 86400.0 - wakesPerDay * (float)awakeUsec / 1000000.0 - sessionSecPerDay;
+  if(sleepSec < 0) sleepSec = 0;
+  return((wakesPerDay * meanWakeMaSec + sleepSec * eConfig.sleepCurrentMa
+          + sessionSecPerDay * (eConfig.phaseCurrentMa[PROF_WAKE] + eConfig.radioCurrentMa)) / 3600.0);
+}
+
+/**************************************************!
+   @brief    energySelectMultiplier()
+   @details  smallest refresh multiplier that gives a runtime of at least targetDays
+   @details  if none is sufficient, the largest multiplier is returned
+   @return   uint32_t: refresh multiplier
+***************************************************/
+uint32_t energySelectMultiplier(float wakeMaSecDisplay, float wakeMaSecNoDisplay,
+                      uint32_t measIntervalSec, uint32_t awakeUsec,
+                      float remainingMah, float targetDays, float sessionSecPerDay)
+{
+  int i;
+  float mahPerDay;
+
+  for(i=0; i<ENERGY_NUM_MULTIPLIERS; i++){
+    mahPerDay = energyMahPerDay(wakeMaSecDisplay, wakeMaSecNoDisplay, measIntervalSec, awakeUsec, multipliers[i],
+                                sessionSecPerDay);
+    if(mahPerDay <= 0 || remainingMah / mahPerDay >= targetDays)
+      return(multipliers[i]);
+  }
+  return(multipliers[ENERGY_NUM_MULTIPLIERS-1]);
+}
+
+/**************************************************!
+   @brief    multiplierFromPercent()
+   @details  fallback policy: refresh multiplier from battery percentage only
+   @return   uint32_t: refresh multiplier
+***************************************************/
+static uint32_t multiplierFromPercent(float batteryPercent)
+{
+  if(batteryPercent > 50) return(MULTIPLIER_FULL);
+  if(batteryPercent > 20) return(MULTIPLIER_50);
+  if(batteryPercent > 10) return(MULTIPLIER_20);
+  if(batteryPercent > 5)  return(MULTIPLIER_10);
+  return(MULTIPLIER_5);
+}
+
+/**************************************************!
+   @brief    energyUpdate()
+   @details  update eEstimate from the last wake durations and choose the refresh multiplier.
+   @details  The wake duration is taken without the panel phases, whether the last wake refreshed or not.
+   @details  Bluetooth sessions: mean per day since cold boot, over at least one day
+   @details  lifetime policy: target lifetime in wData.targetLifetimeDays, counted from last charge.
+   @details  if switched off (0), or target has passed: multiplier from battery percentage
+   @param    batteryPercent: state of charge
+   @param    batteryKnown: false if battery voltage is not measured (then no stretching)
+   @param    dischgCnt: measurements since last charge
+   @return   void
+***************************************************/
+void energyUpdate(float batteryPercent, bool batteryKnown, uint32_t dischgCnt)
+{
+  float daysSinceCharge, remainingTargetDays, daysSinceBoot;
+  uint32_t interval = wData.targetMeasurementIntervalSec;
+  uint32_t awakeUsec = pData.wakeNoDisplayUsec;
+  uint32_t phaseUsec[PROF_NUM_PHASES];
+
+  memcpy(phaseUsec, pData.lastUsec, sizeof(phaseUsec));
+  phaseUsec[PROF_WAKE] = awakeUsec;
+  eEstimate.wakeMaSecDisplay   = energyWakeMaSec(phaseUsec, true);
+  eEstimate.wakeMaSecNoDisplay = energyWakeMaSec(phaseUsec, false);
+  eEstimate.remainingMah = eConfig.capacityMah * batteryPercent / 100.0;
+  daysSinceBoot = (float)wData.lastMeasurementTimestamp.tv_sec / 86400.0;   // RTC starts at 0 at cold boot
+  eEstimate.sessionSecPerDay = (float)pData.sessionMs / 1000.0 / (daysSinceBoot > 1.0 ? daysSinceBoot : 1.0);
+
+  daysSinceCharge = (float)dischgCnt * (float)interval / 86400.0;
+  remainingTargetDays = (float)wData.targetLifetimeDays - daysSinceCharge;
+
+  if(!batteryKnown)
+    eEstimate.multiplier = MULTIPLIER_FULL;
+  else if(wData.targetLifetimeDays == 0 || remainingTargetDays <= 0)
+    eEstimate.multiplier = multiplierFromPercent(batteryPercent);
+  else
+    eEstimate.multiplier = energySelectMultiplier(eEstimate.wakeMaSecDisplay, eEstimate.wakeMaSecNoDisplay,
+                              interval, awakeUsec, eEstimate.remainingMah, remainingTargetDays,
+                              eEstimate.sessionSecPerDay);
+
+  eEstimate.mahPerDay = energyMahPerDay(eEstimate.wakeMaSecDisplay, eEstimate.wakeMaSecNoDisplay,
+                              interval, awakeUsec, eEstimate.multiplier, eEstimate.sessionSecPerDay);
+  eEstimate.runtimeDays = (eEstimate.mahPerDay > 0) ? eEstimate.remainingMah / eEstimate.mahPerDay : 0;
+
+  logOut<2>("Energy: wake %3.1f/%3.1f mAs  %3.2f mAh/day  remaining %3.0f mAh %3.1f days  target %ld multiplier %ld",
+    eEstimate.wakeMaSecDisplay, eEstimate.wakeMaSecNoDisplay, eEstimate.mahPerDay,
+    eEstimate.remainingMah, eEstimate.runtimeDays, (long)wData.targetLifetimeDays, (long)eEstimate.multiplier);
+}
+
+/**************************************************!
+   @brief    energyReport()
+   @details  output of the energy estimate
+   @param    printLine : function to output one line of text (serial, bluetooth)
+   @return   void
+***************************************************/
+void energyReport(void (*printLine)(char*))
+{
+  char line[maxLOG_STRING_LEN];
+  int i;
+
+  snprintf(line, sizeof(line), "Wake charge: %3.1f mAs with display, %3.1f mAs without",
+    eEstimate.wakeMaSecDisplay, eEstimate.wakeMaSecNoDisplay);
+  printLine(line);
+  snprintf(line, sizeof(line), "Radio: beacon %3.1f ms/wake, sessions %3.1f s/day",
+    (float)pData.lastUsec[PROF_RADIO] / 1000.0, eEstimate.sessionSecPerDay);
+  printLine(line);
+  for(i=0; i<ENERGY_NUM_MULTIPLIERS; i++){
+    float mahPerDay = energyMahPerDay(eEstimate.wakeMaSecDisplay, eEstimate.wakeMaSecNoDisplay,
+        wData.targetMeasurementIntervalSec, pData.wakeNoDisplayUsec, multipliers[i], eEstimate.sessionSecPerDay);
+    snprintf(line, sizeof(line), "Refresh every %2lu: %5.2f mAh/day, %6.1f days of %4.0f mAh",
+      (unsigned long)multipliers[i], mahPerDay,
+      mahPerDay > 0 ? eConfig.capacityMah / mahPerDay : 0.0, eConfig.capacityMah);
+    printLine(line);
+  }
+  snprintf(line, sizeof(line), "Remaining %3.0f mAh, %3.1f days. Target %ld days, multiplier %lu",
+    eEstimate.remainingMah, eEstimate.runtimeDays, (long)wData.targetLifetimeDays,
+    (unsigned long)eEstimate.multiplier);
+  printLine(line);
+}
@@ -0,0 +1,60 @@
+#ifndef _ePaperEnergy_H
+#define _ePaperEnergy_H
+
+// energy accounting: charge per wake from the phase durations of the wake profiler and the
+// current draw per phase, mAh per day, remaining runtime and the display refresh policy.
+// The calculation functions only use their parameters, no hardware access.
+
+#include "ePaperProfiler.h"
+
+//************** module defines *************************/
+// battery capacity in mAh
+#ifdef LOLIN32_LITE
+  #define BATTERY_CAPACITY_MAH  1800.0
+#else
+  #define BATTERY_CAPACITY_MAH  1000.0
+#endif
+
+// current draw in mA. Estimates for Lolin32 Lite / WeAct panel, to be adapted if measured
+#define CURRENT_CPU_MA        42.0    // CPU running at 240 MHz, no radio
+#define CURRENT_PANEL_MA       8.0    // additional current of ePaper panel during refresh
+#define CURRENT_RADIO_MA      95.0    // additional current of radio (bluetooth) when on
+#define CURRENT_SLEEP_MA       0.15   // deep sleep of complete board (ESP32, regulator, BME280, panel)
+
+// refresh policy. Default target lifetime is d_targetLifetimeDays in global.h
+#define ENERGY_NUM_MULTIPLIERS  5     // number of refresh multipliers to choose from (MULTIPLIER_xxx)
+
+//************** module global variables *************************/
+struct energyConfig
+{
+  float phaseCurrentMa[PROF_NUM_PHASES];  // current draw during each phase of the wake profiler
+  float sleepCurrentMa;                   // current draw in deep sleep
+  float radioCurrentMa;                   // additional current draw when radio is on (sessions; beacon: PROF_RADIO)
+  float capacityMah;                      // battery capacity
+};
+extern energyConfig eConfig;
+
+struct energyEstimate
+{
+  float wakeMaSecDisplay;   // charge of a measurement wake with panel refresh in mA*sec
+  float wakeMaSecNoDisplay; // charge of a measurement wake without panel refresh in mA*sec
+  float sessionSecPerDay;   // bluetooth / BLE sessions per day, mean since cold boot
+  float mahPerDay;          // consumption per day with actual refresh multiplier
+  float remainingMah;       // remaining battery charge
+  float runtimeDays;        // remaining runtime with actual refresh multiplier
+  uint32_t multiplier;      // refresh multiplier chosen: panel is refreshed every <multiplier> measurements
+};
+extern energyEstimate eEstimate;
+
+//************** function prototypes *************************/
+float energyWakeMaSec(const uint32_t* phaseUsec, bool withDisplay);
+float energyMahPerDay(float wakeMaSecDisplay, float wakeMaSecNoDisplay,
+                      uint32_t measIntervalSec, uint32_t awakeUsec, uint32_t multiplier,
+                      float sessionSecPerDay);
+uint32_t energySelectMultiplier(float wakeMaSecDisplay, float wakeMaSecNoDisplay,
+                      uint32_t measIntervalSec, uint32_t awakeUsec,
+                      float remainingMah, float targetDays, float sessionSecPerDay);
+void energyUpdate(float batteryPercent, bool batteryKnown, uint32_t dischgCnt);
+void energyReport(void (*printLine)(char*));
+
+#endif // _ePaperEnergy_H
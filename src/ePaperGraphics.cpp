@@ -78,6 +78,9 @@
 
 #include "ePaperGraphics.h"
 #include "global.h"
+#include "ePaperProfiler.h"
+#include "ePaperSensorProfile.h"
+#include "ePaperDS18B20.h"
 
 // platformio libdeps: olikraus/U8g2_for_Adafruit_GFX@^1.8.0
 #include <U8g2_for_Adafruit_GFX.h>
@@ -104,15 +107,13 @@ void inspectCString(char* str)
   char cc;
 
   strl = strlen(str);
-  // logOut(2,"-----------------------------------------------------------------");
-  sprintf(outstring,"Len: %d", strl);
-  logOut(1, outstring);
+  // logOut<2>("-----------------------------------------------------------------");
+  logOut<1>("Len: %d", (int)strl);
   for (i=0; i<= strl;i++)
   {
     cn = (int)str[i];
     cc = (char)str[i];
-    sprintf(outstring,"%d [%3d]%c ",i, cn, cc);
-    logOut(1, outstring);
+    logOut<1>("%d [%3d]%c ",i, cn, cc);
   }
 }
 
@@ -149,8 +150,7 @@ void displayTextData( uint32_t startCounter, uint32_t dischgCnt,
   display.setTextColor(fgndColor);     // Schriftfarbe Schwarz
   display.setFont(&FreeMonoBold18pt7b);  // Schrift definieren
 
-  sprintf(outstring, "Start of displaySimpleData() ");
-  logOut(2,outstring);
+  logOut<2>("Start of displaySimpleData() ");
 
   display.firstPage();
   do{
@@ -159,7 +159,7 @@ void displayTextData( uint32_t startCounter, uint32_t dischgCnt,
       //display.fillRect(0, 0, display.width(), display.height(), bgndColor); //Xpos,Ypos,box-w,box-h
       
       y=12;
-      logOut(2, "2");
+      logOut<2>("2");
       // Titel schreiben
       display.setCursor(0, y);
       display.setFont(&FreeMonoBold9pt7b);
@@ -182,7 +182,7 @@ void displayTextData( uint32_t startCounter, uint32_t dischgCnt,
       display.setCursor(140, y);
       display.setFont(&FreeMonoBold12pt7b);
       display.print(" C");
-      logOut(2,"3");
+      logOut<2>("3");
 
       // Da bei der Schrift kein Grad Zeichen vorhanden ist selber eins mit Kreisen erstellen
       display.fillCircle(150, 23+5, 4, fgndColor);  //Xpos,Ypos was 23,r,Farbe
@@ -199,7 +199,7 @@ void displayTextData( uint32_t startCounter, uint32_t dischgCnt,
       display.setCursor(140, y);
       display.setFont(&FreeMonoBold12pt7b);
       display.print(" %");
-      logOut(2,"4");
+      logOut<2>("4");
 
       // Luftdruck schreiben
       y = 120; // 100
@@ -214,7 +214,7 @@ void displayTextData( uint32_t startCounter, uint32_t dischgCnt,
       display.setFont(&FreeMonoBold12pt7b);
       display.setCursor(140, y);
       display.print(" hPa");
-      logOut(2,"5");
+      logOut<2>("5");
 
       // Batteriedaten und startCounter schreiben
       int x_offset=15; // X-Offset to take care of damaged display in grey unit
@@ -239,14 +239,14 @@ void displayTextData( uint32_t startCounter, uint32_t dischgCnt,
       display.print(startCounter);
       display.print(" ");
       display.print(dischgCnt);
-      logOut(2,"7");
+      logOut<2>("7");
       /*
       display.print((float)lastTime/1000,1);
       display.print(" sec");
       */
 
   }while (display.nextPage());
-  logOut(2," 8");
+  logOut<2>(" 8");
   // Teil refresh vom  Display
   // display.updateWindow(0, 0, display.width(), display.heigth(), false);
 }
@@ -313,6 +313,7 @@ void epdTest()
 
 
 // initialize display, taken from setup()
+// fullInterval 0: partial init only, no full refresh (fast path at button wake)
 void initDisplay(int startCounter, int fullInterval)
 {
   #ifdef CROW_PANEL
@@ -320,20 +321,20 @@ void initDisplay(int startCounter, int fullInterval)
 
     #ifdef TEST_CROW_PANEL
       epdInit();
-      logOut(2,"Testing panel");
+      logOut<2>("Testing panel");
       epdTest();
       delay(3000);
     #endif // TEST_CROW_PANEL  
   #endif // CROW_PANEL  
   // full refresh of epaper every fullInterval's time. 1: every time
-  if (startCounter % fullInterval == 0)
+  if (fullInterval > 0 && startCounter % fullInterval == 0)
   {
-    logOut(2,(char*)"+++++++ Full window clearing");
+    logOut<2>("+++++++ Full window clearing");
     display.init(115200, true, 2, false); // initial = true  for first start
     display.setFullWindow();
   }
   else{
-    logOut(2,(char*)"------- Partial window clearing");
+    logOut<2>("------- Partial window clearing");
     display.init(115200, false, 2, false); // initial = false for subsequent starts
     display.setPartialWindow(0, 0, display.width(), display.height());
   }
@@ -386,19 +387,18 @@ void endDisplay(int mode)
 ***************************************************/
 void prepareGraphicsParameters(uint16_t hours)
 {
-  int i;
+  int i, j;
+  float t;
   
   if((hours != 72) && (hours != 84))
   {
-    sprintf(outstring,"prepareGraphicsParameters: wrong time range %d", hours);
-    logOut(2,outstring);
+    logOut<2>("prepareGraphicsParameters: wrong time range %d", hours);
     return;
   }
   #ifdef extendedDEBUG_OUTPUT
-  logOut(2,(char*)"prepareGraphicsParameters started");
-  sprintf(outstring,"Heap Size: %ld FreeHp: %ld Max Alloc: %ld",
-      ESP.getHeapSize(),ESP.getFreeHeap(), ESP.getMaxAllocHeap());
-  logOut(2,outstring);    
+  logOut<2>("prepareGraphicsParameters started");
+  logOut<2>("Heap Size: %ld FreeHp: %ld Max Alloc: %ld",
+      ESP.getHeapSize(),ESP.getFreeHeap(), ESP.getMaxAllocHeap());    
   #endif    
 
   switch(hours){
@@ -432,28 +432,31 @@ void prepareGraphicsParameters(uint16_t hours)
       if(wData.humiHistory[i] > wData.humiHistoryMax)  wData.humiHistoryMax = wData.humiHistory[i];
       if(wData.humiHistory[i] < wData.humiHistoryMin)  wData.humiHistoryMin = wData.humiHistory[i];
     }
+    // DS18B20 channels are drawn in the temperature graph, same scale
+    for(j=0; j<DS_MAX_SENSORS; j++){
+      t = dsTemperature(j, i);
+      if(!isnan(t)){
+        if(t > wData.tempHistoryMax)  wData.tempHistoryMax = t;
+        if(t < wData.tempHistoryMin)  wData.tempHistoryMin = t;
+      }
+    }
   }  
   #ifdef extendedDEBUG_OUTPUT
-  sprintf(outstring,"Heap Size: %ld FreeHp: %ld Max Alloc: %ld",
-      ESP.getHeapSize(),ESP.getFreeHeap(), ESP.getMaxAllocHeap());
-  logOut(2,outstring);    
+  logOut<2>("Heap Size: %ld FreeHp: %ld Max Alloc: %ld",
+      ESP.getHeapSize(),ESP.getFreeHeap(), ESP.getMaxAllocHeap());    
 
-  sprintf(outstring,"PrepGraphParam: i: %d FirstPoint: %ld", 
-        i, wData.indexFirstPointToDraw);
-  logOut(2,outstring);    
+  logOut<2>("PrepGraphParam: i: %d FirstPoint: %ld", 
+        i, wData.indexFirstPointToDraw);    
 
-  sprintf(outstring,"Heap Size: %ld FreeHp: %ld Max Alloc: %ld",
-      ESP.getHeapSize(),ESP.getFreeHeap(), ESP.getMaxAllocHeap());
-  logOut(2,outstring);    
+  logOut<2>("Heap Size: %ld FreeHp: %ld Max Alloc: %ld",
+      ESP.getHeapSize(),ESP.getFreeHeap(), ESP.getMaxAllocHeap());    
 
-  sprintf(outstring,"PrepGraphParam: Min/Max: P: %3.1f-%3.1f", 
-        wData.pressHistoryMin, wData.pressHistoryMax);
-  logOut(2,outstring);    
+  logOut<2>("PrepGraphParam: Min/Max: P: %3.1f-%3.1f", 
+        wData.pressHistoryMin, wData.pressHistoryMax);    
 
-  sprintf(outstring,"PrepGraphParam: T:  %3.1f-%3.1f H: %d-%d", 
+  logOut<2>("PrepGraphParam: T:  %3.1f-%3.1f H: %d-%d", 
         wData.tempHistoryMin,  wData.tempHistoryMax,
-        wData.humiHistoryMin, wData.humiHistoryMax);
-  logOut(2,outstring);    
+        wData.humiHistoryMin, wData.humiHistoryMax);    
   #endif 
 }
 
@@ -553,8 +556,7 @@ void drawGraphFrame(uint16_t hours)
   unsigned int x, y, x0, y0, x1, y1, width, height, tickmarks;
 
   if(hours != 84 && hours !=72){
-    sprintf(outstring,"wrong graph time hours: %d", hours);
-    logOut(2,outstring);
+    logOut<2>("wrong graph time hours: %d", hours);
     return;
   }
 
@@ -563,16 +565,14 @@ void drawGraphFrame(uint16_t hours)
   x0=0; y0=0; width=SCREEN_WIDTH; height=SCREEN_HEIGHT;
   display.drawRect(x0,y0,width,height, fgndColor);
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"drawRect1 x0: %d, y0: %d, width: %d, height: %d", x0,y0,width,height);
-    logOut(2,outstring);    
+    logOut<2>("drawRect1 x0: %d, y0: %d, width: %d, height: %d", x0,y0,width,height);    
   #endif
 
   x0=0+extBW; y0=0+extBW; width=SCREEN_WIDTH-2*extBW; height=SCREEN_HEIGHT-2*extBW; 
   display.drawRect(x0,y0,width,height, fgndColor);
     display.drawRect(x0,y0,width,height, fgndColor);
   #ifdef extendedDEBUG_OUTPUT  
-    sprintf(outstring,"drawRect2 x0: %d, y0: %d, width: %d, height: %d", x0,y0,width,height);
-    logOut(2,outstring);    
+    logOut<2>("drawRect2 x0: %d, y0: %d, width: %d, height: %d", x0,y0,width,height);    
   #endif
 
   //display.drawRect(0+extBW, 0+extBW, SCREEN_WIDTH-2*extBW, SCREEN_HEIGHT-2*extBW, extBW+infoHeight, fgndColor);
@@ -586,8 +586,7 @@ void drawGraphFrame(uint16_t hours)
   x0=extBW; y0=extBW+prognameHeight; width= textLWidth+1; height= levelHeight+1;
   display.drawRect(x0,y0,width,height, fgndColor);
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"drawRect3 x0: %d, y0: %d, width: %d, height: %d", x0,y0,width,height);
-    logOut(2,outstring);    
+    logOut<2>("drawRect3 x0: %d, y0: %d, width: %d, height: %d", x0,y0,width,height);    
   #endif  
 
   // pressure, temperature, humidity boxes
@@ -595,8 +594,7 @@ void drawGraphFrame(uint16_t hours)
   x0=extBW+textLWidth; y0= extBW; width= textMWidth+1; height= pressureHeight+1;
   display.drawRect(x0,y0,width,height, fgndColor);
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"drawRect4 x0: %d, y0: %d, width: %d, height: %d", x0,y0,width,height);
-    logOut(2,outstring);    
+    logOut<2>("drawRect4 x0: %d, y0: %d, width: %d, height: %d", x0,y0,width,height);    
   #endif  
 
   //display.drawRect(extBW+textLWidth, extBW+pressureHeight, textMWidth/2, temperatureHeight, fgndColor); // temperature box
@@ -617,8 +615,7 @@ void drawGraphFrame(uint16_t hours)
   x0=extBW+textLWidth+textMWidth; y0= extBW+batHeight; width=textRWidth+1; height= intervalHeight+1;
   display.drawRect(x0,y0,width,height, fgndColor);
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"drawRect interval box x0: %d, y0: %d, width: %d, height: %d", x0,y0,width,height);
-    logOut(2,outstring);    
+    logOut<2>("drawRect interval box x0: %d, y0: %d, width: %d, height: %d", x0,y0,width,height);    
   #endif  
 
   // coordinate bars, bordering the drawing canvas
@@ -652,7 +649,7 @@ void drawGraphFrame(uint16_t hours)
     drawIndicatorLines (canvasLeft+offsetPix72hGraph, canvasTop, canvasWidth-offsetPix72hGraph, canvasHeight, 5, 3);
   }
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"end of drawGraphFrame()");
+    logOut<2>("end of drawGraphFrame()");
   #endif
 }
 
@@ -741,7 +738,7 @@ void drawTextFields()
   float tendencyValue, limit1, limit2, limit3;
 
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"Start of drawTextFields");
+    logOut<2>("Start of drawTextFields");
   #endif  
 
   // Pressure, pressure unit and tendency 
@@ -764,7 +761,7 @@ void drawTextFields()
   sprintf(outstring, "  %+3.1f", wData.pressure3hChange);
   u8g2Fonts.print(outstring);
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"dtTF1 ");
+    logOut<2>("dtTF1 ");
   #endif  
 
   // pressure tendency graphics
@@ -779,41 +776,6 @@ void drawTextFields()
   aw=10; al=14;
   drawTendency(x, y, aw, al, tendencyValue, limit1, limit2, limit3);
 
-  // crude alarm feature
-  /*
-  if(abs(tendencyValue) >= pressureTendencyLimit3)
-    buzzer(5, 150, 75);
-  #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"dtTF2 ");
-  #endif  
-  */
-  // better alarm feature, with acknowledge via button
-  bool alertCondition = false;
-  if(abs(tendencyValue) >= pressureTendencyLimit3){
-    alertCondition = true;
-    logOut(2,(char*)"alertCondition true");
-  }  
-  if(alertCondition){         // is condition for alert met?
-    if(!wData.buttonPressed){ // and button not pressed?
-      buzzer(5, 150, 75);     // then audible alert
-      wData.alertON = true;   // remember that alert has been given
-      logOut(2,(char*)"alert beep sounded");
-      delay(50);
-    } else{                     // button has been pressed
-                                // no buzzer
-                                // do not reset the button pressed since alert condition still active
-      wData.alertON = false;    // remember that alert has NOT been given
-      logOut(2,(char*)"NO alert beep sounded since buttonPressed active");
-      delay(50);
-    }
-  } else {                      // else: no alertCondition
-                                // no buzzer
-    wData.buttonPressed = false;// reset the alert by resetting the button pressed condition
-    wData.alertON = false;      // and remember that no alert has been given
-    logOut(2,(char*)"no alert. reset buttonPressed, reset alertON");
-    delay(50);
-  }  
-
   // Temperature
   //display.setFont(&FreeMonoBold12pt7b);  // Schrift definieren
   u8g2Fonts.setFont(u8g2_font_helvB18_tf);
@@ -835,7 +797,7 @@ void drawTextFields()
   sprintf(outstring, "%+3.1f", wData.temperature3hChange);
   u8g2Fonts.print(outstring);
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"dtTF3 ");
+    logOut<2>("dtTF3 ");
   #endif  
 
   // temperaure tendency graphics
@@ -848,7 +810,7 @@ void drawTextFields()
   aw=9; al=13;
   drawTendency(x, y, aw, al, tendencyValue, limit1, limit2, limit3);
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"dtTF4 ");
+    logOut<2>("dtTF4 ");
   #endif  
 
   // Humidity
@@ -871,7 +833,7 @@ void drawTextFields()
   sprintf(outstring, "%+3.1f", wData.humidity3hChange);
   u8g2Fonts.print(outstring);
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"dtTF4 ");
+    logOut<2>("dtTF4 ");
   #endif  
   // humidity tendency graphics
   tendencyValue = wData.humidity3hChange;
@@ -883,7 +845,7 @@ void drawTextFields()
   aw=9; al=13;
   drawTendency(x, y, aw, al, tendencyValue, limit1, limit2, limit3);
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"dtTF5 ");
+    logOut<2>("dtTF5 ");
   #endif  
 
   // Battery voltage and percent
@@ -905,7 +867,7 @@ void drawTextFields()
   sprintf(outstring, "%3.3f V", wData.batteryVoltage);
   u8g2Fonts.print(outstring);  
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"dtTF6 ");
+    logOut<2>("dtTF6 ");
   #endif
 
   // counter (for debugging)
@@ -916,7 +878,7 @@ void drawTextFields()
   sprintf(outstring, "%d", wData.startCounter);
   u8g2Fonts.print(outstring);  
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"dtTF7 ");
+    logOut<2>("dtTF7 ");
   #endif  
   // pressure correction mode: on: SEA LEVEL, off: STATION
   u8g2Fonts.setFont(u8g2_font_helvR10_tf);
@@ -929,7 +891,7 @@ void drawTextFields()
     sprintf(outstring,    "Unkorrigiert");
   u8g2Fonts.print(outstring);    
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"dtTF8 ");
+    logOut<2>("dtTF8 ");
   #endif  
   // data interval in sec
   u8g2Fonts.setFont(u8g2_font_helvR10_tf);
@@ -942,7 +904,7 @@ void drawTextFields()
   sprintf(outstring, "Interval: %3.1f s", wData.actSecondsSinceLastMeasurement);
   u8g2Fonts.print(outstring);  
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"dtTF9 ");
+    logOut<2>("dtTF9 ");
   #endif  
   // correction value
   u8g2Fonts.setFont(u8g2_font_helvR10_tf);
@@ -955,7 +917,7 @@ void drawTextFields()
   u8g2Fonts.setFont(u8g2_font_helvR08_tf);
   u8g2Fonts.print(outstring);  
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"dtTF10 ");
+    logOut<2>("dtTF10 ");
   #endif  
   // version info
   u8g2Fonts.setFont(u8g2_font_helvR10_tf);
@@ -970,7 +932,7 @@ void drawTextFields()
   sprintf(outstring, "%s %s", VERSION, BUILD_DATE);
   u8g2Fonts.print(outstring);  
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"End of drawTextFields");
+    logOut<2>("End of drawTextFields");
   #endif  
 }
 
@@ -1025,12 +987,10 @@ void drawXAxisNumbers(int hours)
   }    
 
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"oldest: %ld youngest: %ld timerange_sec: %ld timerange_hours: %ld",
+    logOut<2>("oldest: %ld youngest: %ld timerange_sec: %ld timerange_hours: %ld",
         oldest, youngest, timerange_sec, timerange_hours);
-    logOut(2,outstring);
-    sprintf(outstring,"lowestTimeHours: %d highestTimeHours: %d",
+    logOut<2>("lowestTimeHours: %d highestTimeHours: %d",
         lowestTimeHours, highestTimeHours);
-    logOut(2,outstring);
   #endif  
 
   // draw x-axis numbers
@@ -1043,8 +1003,7 @@ void drawXAxisNumbers(int hours)
       display.setCursor(x, y);
       display.print(timeRangeValues[i]);
       #ifdef extendedDEBUG_OUTPUT
-        sprintf(outstring, "time[%d] %d: ", i, timeRangeValues[i]);
-        logOut(2,outstring);
+        logOut<2>("time[%d] %d: ", i, timeRangeValues[i]);
       #endif  
     }
   }
@@ -1055,8 +1014,7 @@ void drawXAxisNumbers(int hours)
       display.setCursor(x, y);
       display.print(timeRangeValues[i]);
       #ifdef extendedDEBUG_OUTPUT
-        sprintf(outstring, "time[%d] %d: ", i, timeRangeValues[i]);
-        logOut(2,outstring);
+        logOut<2>("time[%d] %d: ", i, timeRangeValues[i]);
       #endif  
     }    
   }
@@ -1091,9 +1049,8 @@ void drawPressureYAxisNumbers(char* unit, char* graphName)
     displayRange = 1000;     
 
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"PressHistoryMax: %3.1f pressHistoryMin: %3.1f displayRange:%f",
+    logOut<2>("PressHistoryMax: %3.1f pressHistoryMin: %3.1f displayRange:%f",
       wData.pressHistoryMax, wData.pressHistoryMin, displayRange);
-    logOut(2,outstring);
   #endif  
 
   // calculate y axis numbers
@@ -1128,8 +1085,7 @@ void drawPressureYAxisNumbers(char* unit, char* graphName)
     u8g2Fonts.print(outstring);
   }
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"cvTop: %d cvHeight:%d lowestP: %d displayRange:%f",canvasTop, canvasHeight, lowestPressureMbar, displayRange);
-    logOut(2,outstring);
+    logOut<2>("cvTop: %d cvHeight:%d lowestP: %d displayRange:%f",canvasTop, canvasHeight, lowestPressureMbar, displayRange);
   #endif  
 
   // draw unit and graph name
@@ -1187,8 +1143,7 @@ void drawTemperatureYAxisNumbers(char* unit,  char* graphName, int position)
     displayRange = 1000;    
 
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"tempHistoryMax: %f tempHistoryMin:%f", wData.tempHistoryMax, wData.tempHistoryMin);
-    logOut(2,outstring);
+    logOut<2>("tempHistoryMax: %f tempHistoryMin:%f", wData.tempHistoryMax, wData.tempHistoryMin);
   #endif
   // calculate y axis numbers
   float tempHistMin = wData.tempHistoryMin;
@@ -1228,9 +1183,8 @@ void drawTemperatureYAxisNumbers(char* unit,  char* graphName, int position)
     u8g2Fonts.print(outstring);
   }
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"cvTop: %d cvHeight:%d lowestT: %d highestT: %d displayRange:%f",canvasTop, canvasHeight, 
+    logOut<2>("cvTop: %d cvHeight:%d lowestT: %d highestT: %d displayRange:%f",canvasTop, canvasHeight, 
       lowestTemperatureC, highestTemperatureC, displayRange);
-    logOut(2,outstring);
   #endif
 
   // draw unit and graph name
@@ -1296,9 +1250,8 @@ void drawHumidityYAxisNumbers(char* unit,  char* graphName, int position)
     displayRange = 1000;     
 
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"humiHMax: %d humiHMin:%d (‰) humidityRangePercent: %f", 
+    logOut<2>("humiHMax: %d humiHMin:%d (‰) humidityRangePercent: %f", 
       wData.humiHistoryMax, wData.humiHistoryMin, humidityRangePercent);
-    logOut(2,outstring);
   #endif  
 
   // calculate y axis numbers
@@ -1338,9 +1291,8 @@ void drawHumidityYAxisNumbers(char* unit,  char* graphName, int position)
     u8g2Fonts.print(outstring);
   }
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"cvTop: %d cvHeight:%d lowestH[‰]: %d highestH[‰]: %d displayRange:%f",canvasTop, canvasHeight, 
+    logOut<2>("cvTop: %d cvHeight:%d lowestH[‰]: %d highestH[‰]: %d displayRange:%f",canvasTop, canvasHeight, 
       lowestHumidityPM, highestHumidityPM, displayRange);
-    logOut(2,outstring);
   #endif  
 
   // draw unit and graphName
@@ -1426,9 +1378,8 @@ void drawPressureGraphics(int hours)
     }
     if((i<noPRINTLINESLOW+wData.indexFirstPointToDraw) || (i>=noDataPoints-noPRINTLINESHIGH-1))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
         i, x0, y0, x1, y1, age0, age1, p0, p1);
-      logOut(3,outstring);
     }
   }
 }
@@ -1453,9 +1404,8 @@ void drawTemperatureGraphics(int hours)
   // draw temperature graph (simplified for fixed time distances)
   float wDLTC = wData.graphLowestTemperatureCelsius;
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"WData.lTC: %d wData.hTC %d wData.dR: %f",
-        wData.graphLowestTemperatureCelsius,wData.graphHighestTemperatureCelsius, wData.graphYDisplayRange);
-    logOut(2,outstring); 
+    logOut<2>("WData.lTC: %d wData.hTC %d wData.dR: %f",
+        wData.graphLowestTemperatureCelsius,wData.graphHighestTemperatureCelsius, wData.graphYDisplayRange); 
   #endif  
   int i, x0, y0, x1, y1;
   float t0, t1, d0, d1, e0, e1;
@@ -1481,9 +1431,20 @@ void drawTemperatureGraphics(int hours)
     }  
     if((i<noPRINTLINESLOW+wData.indexFirstPointToDraw) || (i>=noDataPoints-noPRINTLINESHIGH-1))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d t: %f %f d: %f %f e: %f %f wData.lTC: %d %f",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d t: %f %f d: %f %f e: %f %f wData.lTC: %d %f",
         i, x0, y0, x1, y1, t0, t1, d0, d1, e0, e1, wData.graphLowestTemperatureCelsius, wDLTC);
-      logOut(3,outstring);
+    }
+  }
+
+  // DS18B20 channels: dotted, every second pixel
+  for(int j=0; j<DS_MAX_SENSORS; j++){
+    for(i=wData.indexFirstPointToDraw;i<noDataPoints; i+=2)
+    {
+      t0 = dsTemperature(j, i);
+      if(!isnan(t0)){
+        y0=(canvasTop+canvasHeight)-canvasHeight*((t0-wDLTC)/wData.graphYDisplayRange);
+        display.drawPixel(canvasLeft+i+1, y0, fgndColor);
+      }
     }
   }
 }
@@ -1508,9 +1469,8 @@ void drawHumidityGraphics(int hours)
   // draw humidity graph (simplified for fixed time distances)
   int wDLHP = wData.graphLowestHumidityPromille;
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"WData.lHP: %d wData.hHP %d wData.ydR: %f",
-        wData.graphLowestHumidityPromille,wData.graphHighestHumidityPromille, wData.graphYDisplayRange);
-    logOut(2,outstring); 
+    logOut<2>("WData.lHP: %d wData.hHP %d wData.ydR: %f",
+        wData.graphLowestHumidityPromille,wData.graphHighestHumidityPromille, wData.graphYDisplayRange); 
   #endif  
   int i, x0, y0, x1, y1; 
   float h0, h1, lHPercent;
@@ -1529,9 +1489,8 @@ void drawHumidityGraphics(int hours)
     }
     if((i<noPRINTLINESLOW+wData.indexFirstPointToDraw) || (i>=noDataPoints-noPRINTLINESHIGH-1))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d h: %f %f wData.lH%%: %f promille: %d",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d h: %f %f wData.lH%%: %f promille: %d",
         i, x0, y0, x1, y1, h0, h1, lHPercent, wDLHP);
-      logOut(3,outstring);
     }
   }
 }
@@ -1580,9 +1539,8 @@ void drawPressTempGraphics(int hours)
     }
     if((i<noPRINTLINESLOW+wData.indexFirstPointToDraw) || (i>=noDataPoints-noPRINTLINESHIGH-1))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
         i, x0, y0, x1, y1, age0, age1, p0, p1);
-      logOut(3,outstring);
     }
   }
 
@@ -1606,9 +1564,8 @@ void drawPressTempGraphics(int hours)
     }  
     if((i<noPRINTLINESLOW+wData.indexFirstPointToDraw) || (i>=noDataPoints-noPRINTLINESHIGH-1))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d age: %ld l%d p: %f %f",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
         i, x0, y0, x1, y1, age0, age1, p0, p1);
-      logOut(3,outstring);
     }
   }
 }
@@ -1657,9 +1614,8 @@ void drawPressHumiGraphics(int hours)
     }  
     if((i<noPRINTLINESLOW+wData.indexFirstPointToDraw) || (i>=noDataPoints-noPRINTLINESHIGH-1))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
         i, x0, y0, x1, y1, age0, age1, p0, p1);
-      logOut(3,outstring);
     }
   }
 
@@ -1670,9 +1626,8 @@ void drawPressHumiGraphics(int hours)
   
   int wDLHP = wData.graphLowestHumidityPromille;
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"WData.lHP: %d wData.hHP %d wData.ydR: %f",
-        wData.graphLowestHumidityPromille,wData.graphHighestHumidityPromille, wData.graphYDisplayRange);
-    logOut(2,outstring); 
+    logOut<2>("WData.lHP: %d wData.hHP %d wData.ydR: %f",
+        wData.graphLowestHumidityPromille,wData.graphHighestHumidityPromille, wData.graphYDisplayRange); 
   #endif  
 
   float h0, h1, lHPercent;
@@ -1693,9 +1648,8 @@ void drawPressHumiGraphics(int hours)
     }  
     if((i<noPRINTLINESLOW+wData.indexFirstPointToDraw) || (i>=noDataPoints-noPRINTLINESHIGH-1))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d h: %f %f wData.lH%%: %f promille: %d",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d h: %f %f wData.lH%%: %f promille: %d",
         i, x0, y0, x1, y1, h0, h1, lHPercent, wDLHP);
-      logOut(3,outstring);
     }
   }
   /*
@@ -1714,9 +1668,8 @@ void drawPressHumiGraphics(int hours)
     display.drawLine(x0, y0, x1, y1, fgndColor);
     if((i<10+wData.indexFirstPointToDraw) || (i>325))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
         i, x0, y0, x1, y1, age0, age1, p0, p1);
-      logOut(3,outstring);
     }
   }
   */
@@ -1760,9 +1713,8 @@ void drawTempHumiGraphics(int hours)
     }  
     if((i<noPRINTLINESLOW+wData.indexFirstPointToDraw) || (i>=noDataPoints-noPRINTLINESHIGH-1))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
         i, x0, y0, x1, y1, age0, age1, p0, p1);
-      logOut(3,outstring);
     }
   }
 
@@ -1774,9 +1726,8 @@ void drawTempHumiGraphics(int hours)
   
   int wDLHP = wData.graphLowestHumidityPromille;
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"WData.lHP: %d wData.hHP %d wData.ydR: %f",
-        wData.graphLowestHumidityPromille,wData.graphHighestHumidityPromille, wData.graphYDisplayRange);
-    logOut(2,outstring); 
+    logOut<2>("WData.lHP: %d wData.hHP %d wData.ydR: %f",
+        wData.graphLowestHumidityPromille,wData.graphHighestHumidityPromille, wData.graphYDisplayRange); 
   #endif  
 
   float h0, h1, lHPercent;
@@ -1795,9 +1746,8 @@ void drawTempHumiGraphics(int hours)
     }
     if((i<noPRINTLINESLOW+wData.indexFirstPointToDraw) || (i>=noDataPoints-noPRINTLINESHIGH-1))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d h: %f %f wData.lH%%: %f promille: %d",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d h: %f %f wData.lH%%: %f promille: %d",
         i, x0, y0, x1, y1, h0, h1, lHPercent, wDLHP);
-      logOut(3,outstring);
     }
   }
   /*
@@ -1820,9 +1770,8 @@ void drawTempHumiGraphics(int hours)
     display.drawLine(x0, y0, x1, y1, fgndColor);
     if((i<10+wData.indexFirstPointToDraw) || (i>325))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
         i, x0, y0, x1, y1, age0, age1, p0, p1);
-      logOut(3,outstring);
     }
   }
   */
@@ -1837,7 +1786,7 @@ void drawTempHumiGraphics(int hours)
 void drawPressTempHumiGraphics(int hours)
 {
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"Start of drawPressTempHumiGraphics()");
+    logOut<2>("Start of drawPressTempHumiGraphics()");
   #endif  
   // prepare graphics parameters incl. start index, min/max
   prepareGraphicsParameters(hours);
@@ -1875,10 +1824,8 @@ void drawPressTempHumiGraphics(int hours)
     }  
     if((i<noPRINTLINESLOW+wData.indexFirstPointToDraw) || (i>=noDataPoints-noPRINTLINESHIGH-1))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
         i, x0, y0, x1, y1, age0, age1, p0, p1);
-      //inspectCString(outstring);  
-      logOut(3,outstring);
     }
   }
 
@@ -1903,9 +1850,8 @@ void drawPressTempHumiGraphics(int hours)
     }  
     if((i<noPRINTLINESLOW+wData.indexFirstPointToDraw) || (i>=noDataPoints-noPRINTLINESHIGH-1))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d age: %ld %ld p: %f %f",
         i, x0, y0, x1, y1, age0, age1, p0, p1);
-      logOut(3,outstring);
     }
   }
 
@@ -1916,9 +1862,8 @@ void drawPressTempHumiGraphics(int hours)
   
   int wDLHP = wData.graphLowestHumidityPromille;
   #ifdef extendedDEBUG_OUTPUT
-    sprintf(outstring,"WData.lHP: %d wData.hHP %d wData.ydR: %f",
-        wData.graphLowestHumidityPromille,wData.graphHighestHumidityPromille, wData.graphYDisplayRange);
-    logOut(2,outstring); 
+    logOut<2>("WData.lHP: %d wData.hHP %d wData.ydR: %f",
+        wData.graphLowestHumidityPromille,wData.graphHighestHumidityPromille, wData.graphYDisplayRange); 
   #endif  
 
   float h0, h1, lHPercent;
@@ -1937,24 +1882,142 @@ void drawPressTempHumiGraphics(int hours)
     }  
     if((i<noPRINTLINESLOW+wData.indexFirstPointToDraw) || (i>=noDataPoints-noPRINTLINESHIGH-1))
     {
-      sprintf(outstring,"i: %d x0: %d y0: %d x1: %d y1: %d h: %f %f wData.lH%%: %f promille: %d",
+      logOut<3>("i: %d x0: %d y0: %d x1: %d y1: %d h: %f %f wData.lH%%: %f promille: %d",
         i, x0, y0, x1, y1, h0, h1, lHPercent, wDLHP);
-      logOut(3,outstring);
     }
   }
   #ifdef extendedDEBUG_OUTPUT
-    logOut(2,(char*)"End of drawPressTempHumiGraphics()");
+    logOut<2>("End of drawPressTempHumiGraphics()");
   #endif  
 }
 
 
+/**************************************************!
+   @brief    draw the diagnostics screen 
+   @details  shows the wake profiler data: per phase last/median/max duration
+   @details  and the log2 histogram as bar chart
+   @return   void
+***************************************************/
+void drawDiagnostics()
+{
+  int x, y, i, phase, barH, maxCount, rowH;
+
+  display.drawRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, fgndColor);
+  display.drawRect(extBW, extBW, SCREEN_WIDTH-2*extBW, SCREEN_HEIGHT-2*extBW, fgndColor);
+
+  u8g2Fonts.setFont(u8g2_font_helvB12_tf);
+  x = extBW + 8;
+  y = extBW + 20;
+  u8g2Fonts.setCursor(x, y);
+  sprintf(outstring, "Wake profile  %lu wakes  #%ld", (unsigned long)pData.wakes, (long)wData.startCounter);
+  u8g2Fonts.print(outstring);
+
+  u8g2Fonts.setFont(u8g2_font_helvR08_tf);
+  y += 16;
+  u8g2Fonts.setCursor(x, y);
+  sprintf(outstring, "Sensor profile: %s  noise %3.2f Pa  env %3.2f Pa  %lu switches",
+    spProfileName(spData.active), spData.measNoisePa, spData.envNoisePa, (unsigned long)spData.switches);
+  u8g2Fonts.print(outstring);
+  y += 14;
+  u8g2Fonts.setCursor(x, y);
+  u8g2Fonts.print("phase         last     med      max [ms]    histogram 1us .. 8s");
+  rowH = ((int)SCREEN_HEIGHT - 2*extBW - 4 - y) / PROF_NUM_PHASES;   // all phases fit on the screen
+  for(phase=0; phase<PROF_NUM_PHASES; phase++){
+    y += rowH;
+    u8g2Fonts.setCursor(x, y);
+    sprintf(outstring, "%s", profPhaseName(phase));
+    u8g2Fonts.print(outstring);
+    u8g2Fonts.setCursor(x + 58, y);
+    sprintf(outstring, "%7.1f %7.1f %7.1f",
+      (float)pData.lastUsec[phase]/1000.0, (float)profMedianUsec(phase)/1000.0,
+      (float)pData.maxUsec[phase]/1000.0);
+    u8g2Fonts.print(outstring);
+
+    // bar chart of histogram, scaled to max count of phase
+    maxCount = 1;
+    for(i=0; i<PROF_NUM_BUCKETS; i++)
+      if(pData.hist[phase][i] > maxCount) maxCount = pData.hist[phase][i];
+    display.drawLine(x + 210, y, x + 210 + 5*PROF_NUM_BUCKETS, y, fgndColor);
+    for(i=0; i<PROF_NUM_BUCKETS; i++){
+      barH = ((rowH - 5) * (int)pData.hist[phase][i] + maxCount - 1) / maxCount;
+      if(barH > 0)
+        display.fillRect(x + 210 + 5*i, y - barH, 4, barH, fgndColor);
+    }
+  }
+}
+
+/**************************************************!
+   @brief    drawScene()
+   @details  build the screen for graphicsType in the display buffer, without refresh.
+   @details  Called for each page by drawMainGraphics() and by the benchmark
+   @param    graphicsType: 0=pressure, 1=temp, 2=humi, 4..7 combined, 8 diagnostics
+   @return   void
+***************************************************/
+void drawScene(uint32_t graphicsType)
+{
+  display.fillScreen(bgndColor);// clear screen
+  switch (graphicsType)
+  {
+    case 0:
+    default:
+      logOut<2>("Pressure graphics. graphicsType: %ld",(long)graphicsType);
+      drawGraphFrame(84);           // main line frame for 84 h graphics
+      drawTextFields();             // text section
+      drawPressureGraphics(84);  
+      break;
+    case 1:
+      logOut<2>("Temperature graphics. graphicsType: %ld",(long)graphicsType);
+      drawGraphFrame(84);           // main line frame
+      drawTextFields();             // text section
+      drawTemperatureGraphics(84); 
+      break;
+    case 2:
+      logOut<2>("Humidity graphics. graphicsType: %ld",(long)graphicsType);
+      drawGraphFrame(84);           // main line frame
+      drawTextFields();             // text section
+      drawHumidityGraphics(84); 
+      break;
+    case 4:
+      logOut<2>("Pressure and temperature graphics. graphicsType: %ld",(long)graphicsType);
+      drawGraphFrame(72);           // main line frame for 72 h graphics
+      drawTextFields();             // text section
+      drawPressTempGraphics(72); 
+      break; 
+    case 5:
+      logOut<2>("Pressure and humidity graphics. graphicsType: %ld",(long)graphicsType);
+      drawGraphFrame(72);           // main line frame for 72 h graphics
+      drawTextFields();             // text section
+      drawPressHumiGraphics(72); 
+      break;    
+    case 6:
+      logOut<2>("Temperature and humidity graphics. graphicsType: %ld",(long)graphicsType);
+      drawGraphFrame(72);           // main line frame for 72 h graphics
+      drawTextFields();             // text section
+      drawTempHumiGraphics(72); 
+      break;      
+    case 7:
+      logOut<2>("Pressure, Temperature and Humidity graphics. graphicsType: %ld    ",(long)graphicsType);
+      drawGraphFrame(72);           // main line frame for 72 h graphics
+      drawTextFields();             // text section
+      drawPressTempHumiGraphics(72); 
+      break;     
+    case 8:
+      logOut<2>("Diagnostics screen. graphicsType: %ld",(long)graphicsType);
+      drawDiagnostics();
+      break;
+  }
+}
+
 /**************************************************!
    @brief    main Function to draw the graphics 
-   @details  
+   @details  scene build and panel refresh are timed by the wake profiler
    @return   void
 ***************************************************/
 void drawMainGraphics(uint32_t graphicsType)
 {
+  int64_t profT, sceneUsec = 0, refreshUsec = 0;
+  bool morePages;
+
   if(wData.applyInversion){
     fgndColor = GxEPD_WHITE;
     bgndColor = GxEPD_BLACK;
@@ -1972,74 +2035,67 @@ void drawMainGraphics(uint32_t graphicsType)
 
   display.firstPage();
   do{
-    display.fillScreen(bgndColor);// clear screen
-    switch (graphicsType)
-    {
-      case 0:
-      default:
-        sprintf(outstring,"Pressure graphics. graphicsType: %ld",graphicsType);
-        logOut(2,outstring);
-        drawGraphFrame(84);           // main line frame for 84 h graphics
-        drawTextFields();             // text section
-        drawPressureGraphics(84);  
-        break;
-      case 1:
-        sprintf(outstring,"Temperature graphics. graphicsType: %ld",graphicsType);
-        logOut(2,outstring);
-        drawGraphFrame(84);           // main line frame
-        drawTextFields();             // text section
-        drawTemperatureGraphics(84); 
-        break;
-      case 2:
-        sprintf(outstring,"Humidity graphics. graphicsType: %ld",graphicsType);
-        logOut(2,outstring);
-        drawGraphFrame(84);           // main line frame
-        drawTextFields();             // text section
-        drawHumidityGraphics(84); 
-        break;
-      case 4:
-        sprintf(outstring,"Pressure and temperature graphics. graphicsType: %ld",graphicsType);
-        logOut(2,outstring);
-        drawGraphFrame(72);           // main line frame for 72 h graphics
-        drawTextFields();             // text section
-        drawPressTempGraphics(72); 
-        break; 
-      case 5:
-        sprintf(outstring,"Pressure and humidity graphics. graphicsType: %ld",graphicsType);
-        logOut(2,outstring);
-        drawGraphFrame(72);           // main line frame for 72 h graphics
-        drawTextFields();             // text section
-        drawPressHumiGraphics(72); 
-        break;    
-      case 6:
-        sprintf(outstring,"Temperature and humidity graphics. graphicsType: %ld",graphicsType);
-        logOut(2,outstring);
-        drawGraphFrame(72);           // main line frame for 72 h graphics
-        drawTextFields();             // text section
-        drawTempHumiGraphics(72); 
-        break;      
-      case 7:
-        sprintf(outstring,"Pressure, Temperature and Humidity graphics. graphicsType: %ld    ",graphicsType);
-        //inspectCString(outstring);
-        logOut(2,outstring);
-        drawGraphFrame(72);           // main line frame for 72 h graphics
-        drawTextFields();             // text section
-        drawPressTempHumiGraphics(72); 
-        break;     
-    }
-    
-  }while (display.nextPage());
+    profT = profStart();
+    drawScene(graphicsType);
+    sceneUsec += profStart() - profT;
+    profT = profStart();
+    morePages = display.nextPage();   // with full buffer: panel refresh happens here
+    refreshUsec += profStart() - profT;
+  }while (morePages);
   //display.display(false); // Full screen update mode from weather display
+  profRecord(PROF_SCENE, (uint32_t)sceneUsec);
+  profRecord(PROF_REFRESH, (uint32_t)refreshUsec);
 }
 
 /**************************************************!
-   @brief    main Function to draw the graphics 
-   @details  
+   @brief    drawButtonFeedback()
+   @details  immediate answer to a button wake: small inverted box in the upper left
+   @details  corner, refreshed as partial window. Overwritten by the next screen
+   @param    text: text in the box
+   @return   void
+***************************************************/
+void drawButtonFeedback(const char* text)
+{
+  int w, h;
+
+  if(wData.applyInversion){
+    fgndColor = GxEPD_WHITE;
+    bgndColor = GxEPD_BLACK;
+  }
+  else{
+    fgndColor = GxEPD_BLACK;
+    bgndColor = GxEPD_WHITE;
+  }
+  u8g2Fonts.setFont(u8g2_font_helvB10_tf);
+  u8g2Fonts.setForegroundColor(bgndColor);  // text inverted within the box
+  u8g2Fonts.setBackgroundColor(fgndColor);
+  w = (u8g2Fonts.getUTF8Width(text) + 16 + 7) & ~7;   // x and width multiples of 8 for the controller
+  h = u8g2Fonts.getFontAscent() - u8g2Fonts.getFontDescent() + 8;
+
+  display.setPartialWindow(0, 0, w, h);
+  display.firstPage();
+  do{
+    display.fillRect(0, 0, w, h, fgndColor);
+    u8g2Fonts.setCursor(8, 4 + u8g2Fonts.getFontAscent());
+    u8g2Fonts.print(text);
+  } while (display.nextPage());
+
+  u8g2Fonts.setForegroundColor(fgndColor);  // restore for the next screen
+  u8g2Fonts.setBackgroundColor(bgndColor);
+}
+
+/**************************************************!
+   @brief    drawBluetoothInfo()
+   @details  status lines of the bluetooth configuration session
+   @details  mode 1 refreshes only the window of the new line (partial update)
+   @param    text: text of the line
+   @param    mode: 0: clear screen and first line, 1: next line, 2: clear screen
    @return   void
 ***************************************************/
 void drawBluetoothInfo(char* text, int mode)
 {
   static int x, y=20;
+  int lineTop = 0, lineHeight = 0;
   static bool lastInversion = false;
 
   if(wData.applyInversion){
@@ -2068,6 +2124,18 @@ void drawBluetoothInfo(char* text, int mode)
   display.setTextColor(fgndColor,bgndColor); // test color for u8gw functions 
   display.setFont(&FreeMonoBold12pt7b);      // set u8g2 font 
 
+  if(mode == 1){
+    // window of the next line only: from ascent above to descent below the base line
+    lineHeight = u8g2Fonts.getFontAscent() - u8g2Fonts.getFontDescent() + 2;
+    if(y + 14 - u8g2Fonts.getFontDescent() > SCREEN_HEIGHT)   // screen full: continue at top
+      y = 20;
+    y+=14;                                    // base line, not in the page loop
+    lineTop = y - u8g2Fonts.getFontAscent() - 1;
+    display.setPartialWindow(0, lineTop, display.width(), lineHeight);
+  }
+  else
+    display.setFullWindow();
+
   display.firstPage();
   do{
     switch(mode){
@@ -2083,8 +2151,7 @@ void drawBluetoothInfo(char* text, int mode)
         //if (lastInversion != wData.applyInversion)
         //display.fillScreen(bgndColor);// clear screen
         //uint16_t charheight = u8g2Fonts.getFontAscent()-u8g2Fonts.getFontDescent();
-        display.fillRect(0,y,SCREEN_WIDTH, u8g2Fonts.getFontAscent()-u8g2Fonts.getFontDescent()+2, bgndColor); // clear next writing rectangle
-        y+=14;
+        display.fillRect(0, lineTop, SCREEN_WIDTH, lineHeight, bgndColor); // clear next writing rectangle
         u8g2Fonts.setCursor(x, y);
         u8g2Fonts.print(text); 
         break;
@@ -32,6 +32,12 @@
 
 //*************** function prototypes ******************/
 void drawPressureGraphics();
+void prepareGraphicsParameters(uint16_t hours);   // start index and min / max for the 72 or 84 h graph
+// y axis range selection and numbers, result in wData.graphYDisplayRange / graphLowest... / graphHighest...
+void drawPressureYAxisNumbers(char* unit, char* graphName);
+void drawTemperatureYAxisNumbers(char* unit,  char* graphName, int position);
+void drawHumidityYAxisNumbers(char* unit,  char* graphName, int position);
+void drawScene(uint32_t graphicsType);          // screen into the display buffer, no refresh
 void displayTextData( uint32_t startCounter, uint32_t  dischgCnt,
                       float temperature, float humidity, float pressure,
                       float percent, float volt, uint32_t multiplier);
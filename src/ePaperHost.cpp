@@ -0,0 +1,95 @@
+/**************************************************!
+   main program of the host build (env:native), on the host shim (lib/hostshim)
+   Runs the firmware for a number of wakes and prints a summary.
+     -n <wakes>          number of wakes, default 20
+     -q                  no Serial output of the firmware
+     -p <file.pbm>       panel image after the last wake
+     -j <file>           journal file, default journal.bin
+     -b <mV>             battery voltage, default 4000
+     -k <sec>:<pin>:<ms> button press <sec> after the start, held <ms>, repeatable
+     -t <lines>          lines a bluetooth client sends after the next connect, newline separated
+     -s <ms>:<text>      text received by USB serial <ms> after the start ("T": trace dump), lost
+                         if the firmware is in deep sleep then
+   A program with its own main() (benchmark, simulator) defines HOST_NO_MAIN, the unit
+   tests (test/test_*) have their own main() as well.
+***************************************************/
+
+// host only, not with another main()
+#if defined(HOST_NATIVE) && !defined(HOST_NO_MAIN) && !defined(PIO_UNIT_TESTING)
+
+#include <Arduino.h>
+#include <unistd.h>
+
+#include "ePaperJournal.h"
+
+#ifndef VOLTAGE_PIN
+  #define VOLTAGE_PIN         39
+#endif
+
+int main(int argc, char** argv)
+{
+  const char* panelPath = NULL;
+  const char* journalPath = "journal.bin";
+  const char* serialText = NULL;
+  uint32_t wakes = 20, batteryMv = 4000, sec, pin, ms, n, serialMs = 0;
+  hostWakeInfo w;
+  int opt, len;
+
+  while((opt = getopt(argc, argv, "n:qp:j:b:k:t:s:")) != -1){
+    switch(opt){
+      case 'n': wakes = strtoul(optarg, NULL, 10); break;
+      case 'q': hostSerialEcho(false); break;
+      case 'p': panelPath = optarg; break;
+      case 'j': journalPath = optarg; break;
+      case 'b': batteryMv = strtoul(optarg, NULL, 10); break;
+      case 'k':
+        if(sscanf(optarg, "%u:%u:%u", &sec, &pin, &ms) != 3){
+          fprintf(stderr, "-k <sec>:<pin>:<ms>\n");
+          return(1);
+        }
+        hostPress(pin, (uint64_t)sec * 1000000, ms);
+        break;
+      case 't': hostBtClient(optarg); break;
+      case 's':
+        len = 0;
+        if(sscanf(optarg, "%u:%n", &serialMs, &len) != 1 || len == 0){
+          fprintf(stderr, "-s <ms>:<text>\n");
+          return(1);
+        }
+        serialText = optarg + len;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-n wakes] [-q] [-p panel.pbm] [-j journal] [-b mV] [-k sec:pin:ms] [-t lines] [-s ms:text]\n", argv[0]);
+        return(1);
+    }
+  }
+
+  hostPowerOn();
+  if(serialText != NULL)
+    hostSerialInputAt((uint64_t)serialMs * 1000, serialText);
+  if(!journalUseFile(journalPath)){
+    fprintf(stderr, "cannot open %s\n", journalPath);
+    return(1);
+  }
+  hostSetAnalogMv(VOLTAGE_PIN, batteryMv / 2);   // 100 K / 100 K divider
+  for(n=0; n<wakes; n++){
+    if(!hostWake(&w)){
+      fprintf(stderr, "wake %u: %s\n", n, w.slept ? "no wakeup source" : "no deep sleep");
+      break;
+    }
+  }
+
+  printf("host: %u wakes, %.1f s mean interval, %.0f ms awake/wake, %.0f us CPU/wake\n",
+    hostStats.wakes,
+    hostStats.wakes ? (hostStats.awakeUs + hostStats.deepSleepUs) / 1e6 / hostStats.wakes : 0.0,
+    hostStats.wakes ? hostStats.awakeUs / 1e3 / hostStats.wakes : 0.0,
+    hostStats.wakes ? hostStats.cpuNs / 1e3 / hostStats.wakes : 0.0);
+  printf("host: %u full / %u partial refreshes, %u NVS writes (%u bytes), %u timer callbacks\n",
+    hostStats.fullRefreshes, hostStats.partialRefreshes, hostStats.nvsWrites, hostStats.nvsBytes,
+    hostStats.timerCallbacks);
+  if(panelPath != NULL && !hostPanelDump(panelPath))
+    fprintf(stderr, "cannot write %s\n", panelPath);
+  return(n == wakes ? 0 : 2);
+}
+
+#endif // HOST_NATIVE && !HOST_NO_MAIN && !PIO_UNIT_TESTING
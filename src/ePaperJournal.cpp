@@ -0,0 +1,351 @@
+/**************************************************!
+   wear leveled counter journal
+   the counters are appended as records to a dedicated flash area of two sectors.
+   Records are written into erased slots, a sector is erased only when the
+   other sector is full and the journal switches to it. The latest record
+   survives power loss at any time: it is in the sector not erased.
+***************************************************/
+
+#include <Arduino.h>
+#include "esp_rom_crc.h"
+#ifndef HOST_NATIVE
+  #include "esp_partition.h"
+#endif
+
+#include "global.h"
+#include "ePaperJournal.h"
+
+// write position, in RTC memory which survives the deep sleep. Zero after power on
+RTC_DATA_ATTR journalState jState;
+
+static const journalFlash* flashOps = NULL;
+
+/**************************************************!
+   @brief    recordCrc()
+   @param    rec: record
+   @return   uint32_t: crc32 over all bytes of the record before the crc
+***************************************************/
+static uint32_t recordCrc(const journalRecord* rec)
+{
+  return(esp_rom_crc32_le(0x5EED, (const uint8_t*)rec, offsetof(journalRecord, crc)));
+}
+
+/**************************************************!
+   @brief    slotAddr()
+   @return   uint32_t: address of slot within the journal area
+***************************************************/
+static uint32_t slotAddr(uint32_t sector, uint32_t slot)
+{
+  return(sector * JOURNAL_SECTOR_SIZE + slot * sizeof(journalRecord));
+}
+
+/**************************************************!
+   @brief    slotErased()
+   @details  true if all bytes of the slot are 0xFF, i.e. it can be written
+***************************************************/
+static bool slotErased(uint32_t sector, uint32_t slot)
+{
+  uint32_t words[sizeof(journalRecord)/4];
+  unsigned int i;
+
+  if(!flashOps->read(slotAddr(sector, slot), words, sizeof(words)))
+    return(false);
+  for(i=0; i<sizeof(words)/4; i++)
+    if(words[i] != 0xFFFFFFFF) return(false);
+  return(true);
+}
+
+#ifndef HOST_NATIVE
+//************** ESP32 backend: journal partition *************************/
+static const esp_partition_t* journalPartition = NULL;
+
+static bool partRead(uint32_t addr, void* buf, size_t len)
+{
+  return(esp_partition_read(journalPartition, addr, buf, len) == ESP_OK);
+}
+
+static bool partWrite(uint32_t addr, const void* buf, size_t len)
+{
+  return(esp_partition_write(journalPartition, addr, buf, len) == ESP_OK);
+}
+
+static bool partErase(uint32_t addr, size_t len)
+{
+  return(esp_partition_erase_range(journalPartition, addr, len) == ESP_OK);
+}
+
+static const journalFlash partitionFlash = { partRead, partWrite, partErase };
+#endif // HOST_NATIVE
+
+/**************************************************!
+   @brief    journalBegin()
+   @details  select the flash backend. Has to be called before the other functions.
+   @param    flash: flash access functions, NULL for the journal partition of the ESP32
+   @param    (on the host: the file of journalUseFile())
+   @return   bool: true if the journal area is available
+***************************************************/
+bool journalBegin(const journalFlash* flash)
+{
+  if(flash != NULL){
+    flashOps = flash;
+    return(true);
+  }
+  #ifndef HOST_NATIVE
+    journalPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                  (esp_partition_subtype_t)JOURNAL_PARTITION_SUBTYPE, JOURNAL_PARTITION_NAME);
+    if(journalPartition == NULL || journalPartition->size < JOURNAL_NUM_SECTORS * JOURNAL_SECTOR_SIZE){
+      logOut<1>("Journal: no journal partition, check board_build.partitions");
+      flashOps = NULL;
+      return(false);
+    }
+    flashOps = &partitionFlash;
+    return(true);
+  #else
+    return(flashOps != NULL);
+  #endif
+}
+
+/**************************************************!
+   @brief    journalRecover()
+   @details  scan both sectors for the latest valid record and set the write position.
+   @details  slots are filled in ascending order, so the first free slot is found by
+   @details  binary search. Records with wrong crc (power loss while writing) are skipped.
+   @param    rec: latest valid record, unchanged if none found. May be NULL
+   @return   bool: true if a valid record has been found
+***************************************************/
+bool journalRecover(journalRecord* rec)
+{
+  journalRecord r, best;
+  uint32_t fill[JOURNAL_NUM_SECTORS];
+  uint32_t sector, lo, hi, mid, seq, bestSector = 0;
+  int32_t slot;
+  bool found = false;
+
+  if(flashOps == NULL) return(false);
+  for(sector=0; sector<JOURNAL_NUM_SECTORS; sector++){
+    // first slot with seq erased
+    lo = 0; hi = JOURNAL_RECORDS_PER_SECTOR;
+    while(lo < hi){
+      mid = (lo + hi) / 2;
+      if(!flashOps->read(slotAddr(sector, mid), &seq, sizeof(seq))) return(false);
+      if(seq == JOURNAL_EMPTY_SEQ) hi = mid;
+      else lo = mid + 1;
+    }
+    fill[sector] = lo;
+    // latest valid record of this sector
+    for(slot = (int32_t)lo - 1; slot >= 0; slot--){
+      if(!flashOps->read(slotAddr(sector, slot), &r, sizeof(r))) return(false);
+      if(r.crc == recordCrc(&r)){
+        if(!found || r.seq > best.seq){
+          best = r;
+          bestSector = sector;
+          found = true;
+        }
+        break;
+      }
+    }
+  }
+
+  memset(&jState, 0, sizeof(jState));
+  jState.magic  = JOURNAL_MAGIC;
+  jState.sector = bestSector;
+  jState.slot   = fill[bestSector];
+  jState.seq    = found ? best.seq : 0;
+  if(found && rec != NULL)
+    *rec = best;
+
+  logOut<2>("Journal recovered: found %d sector %ld slot %ld seq %ld",
+    found, (long)jState.sector, (long)jState.slot, (long)jState.seq);
+  return(found);
+}
+
+/**************************************************!
+   @brief    journalAppend()
+   @details  append a record with the counters. No erase, except if the sector is full:
+   @details  then the other sector is erased and used. The full sector keeps the latest
+   @details  record until the first record in the new sector is written.
+   @return   bool: true if the record has been written and verified
+***************************************************/
+bool journalAppend(uint32_t startCounter, uint32_t dischgCnt, uint32_t prevMicrovolt)
+{
+  journalRecord rec, check;
+  int tries;
+
+  if(flashOps == NULL) return(false);
+  if(jState.magic != JOURNAL_MAGIC)
+    journalRecover(NULL);
+
+  memset(&rec, 0, sizeof(rec));
+  rec.seq           = jState.seq + 1;
+  if(rec.seq == JOURNAL_EMPTY_SEQ) rec.seq = 1;
+  rec.startCounter  = startCounter;
+  rec.dischgCnt     = dischgCnt;
+  rec.prevMicrovolt = prevMicrovolt;
+  rec.crc           = recordCrc(&rec);
+
+  // a slot not erased (torn write) is skipped, limited number of tries
+  for(tries=0; tries<4; tries++){
+    if(jState.slot >= JOURNAL_RECORDS_PER_SECTOR){
+      jState.sector = (jState.sector + 1) % JOURNAL_NUM_SECTORS;
+      jState.slot = 0;
+      if(!flashOps->erase(slotAddr(jState.sector, 0), JOURNAL_SECTOR_SIZE)) return(false);
+      jState.erases++;
+    }
+    if(!slotErased(jState.sector, jState.slot)){
+      jState.slot++;
+      continue;
+    }
+    if(!flashOps->write(slotAddr(jState.sector, jState.slot), &rec, sizeof(rec))) return(false);
+    jState.slot++;
+    if(flashOps->read(slotAddr(jState.sector, jState.slot-1), &check, sizeof(check))
+       && memcmp(&rec, &check, sizeof(rec)) == 0){
+      jState.seq = rec.seq;
+      jState.appends++;
+      return(true);
+    }
+  }
+  logOut<1>("Journal: append failed");
+  return(false);
+}
+
+/**************************************************!
+   @brief    journalReport()
+   @details  output of journal state and expected lifetime of the flash sectors
+   @param    measIntervalSec : measurement interval, one record per measurement
+   @param    printLine : function to output one line of text (serial, bluetooth)
+   @return   void
+***************************************************/
+void journalReport(uint32_t measIntervalSec, void (*printLine)(char*))
+{
+  char line[maxLOG_STRING_LEN];
+  float erasesPerYear = 0;
+
+  if(measIntervalSec > 0)
+    erasesPerYear = 365.0 * 86400.0 / (float)measIntervalSec
+                    / (float)(JOURNAL_NUM_SECTORS * JOURNAL_RECORDS_PER_SECTOR);
+  snprintf(line, sizeof(line), "Journal: %s sector %lu slot %lu seq %lu, %lu appends %lu erases since boot",
+    flashOps != NULL ? "ok" : "not available",
+    (unsigned long)jState.sector, (unsigned long)jState.slot, (unsigned long)jState.seq,
+    (unsigned long)jState.appends, (unsigned long)jState.erases);
+  printLine(line);
+  snprintf(line, sizeof(line), "Journal: %d records/sector, %3.1f erases/sector/year, %3.0f years for %d cycles",
+    (int)JOURNAL_RECORDS_PER_SECTOR, erasesPerYear,
+    erasesPerYear > 0 ? (float)JOURNAL_ERASE_CYCLES / erasesPerYear : 0.0, JOURNAL_ERASE_CYCLES);
+  printLine(line);
+}
+
+#ifdef HOST_NATIVE
+//************** host backend: file emulating NOR flash *************************/
+static FILE* journalFile = NULL;
+static uint32_t fileErases[JOURNAL_NUM_SECTORS];
+
+static bool fileRead(uint32_t addr, void* buf, size_t len)
+{
+  if(addr + len > JOURNAL_NUM_SECTORS * JOURNAL_SECTOR_SIZE) return(false);
+  fseek(journalFile, addr, SEEK_SET);
+  return(fread(buf, 1, len, journalFile) == len);
+}
+
+// NOR flash: writing can only clear bits
+static bool fileWrite(uint32_t addr, const void* buf, size_t len)
+{
+  uint8_t old[sizeof(journalRecord)];
+  size_t i;
+
+  if(len > sizeof(old) || !fileRead(addr, old, len)) return(false);
+  for(i=0; i<len; i++)
+    old[i] &= ((const uint8_t*)buf)[i];
+  fseek(journalFile, addr, SEEK_SET);
+  if(fwrite(old, 1, len, journalFile) != len) return(false);
+  fflush(journalFile);
+  return(true);
+}
+
+static bool fileErase(uint32_t addr, size_t len)
+{
+  uint8_t ff[JOURNAL_SECTOR_SIZE];
+
+  if(addr % JOURNAL_SECTOR_SIZE != 0 || len != JOURNAL_SECTOR_SIZE
+     || addr + len > JOURNAL_NUM_SECTORS * JOURNAL_SECTOR_SIZE) return(false);
+  memset(ff, 0xFF, sizeof(ff));
+  fseek(journalFile, addr, SEEK_SET);
+  if(fwrite(ff, 1, len, journalFile) != len) return(false);
+  fflush(journalFile);
+  fileErases[addr / JOURNAL_SECTOR_SIZE]++;
+  return(true);
+}
+
+static const journalFlash fileFlash = { fileRead, fileWrite, fileErase };
+
+/**************************************************!
+   @brief    journalUseFile()
+   @details  use a file as journal area. A new file is created erased (0xFF)
+   @param    path: file name
+   @return   bool: true if ok
+***************************************************/
+bool journalUseFile(const char* path)
+{
+  uint32_t sector;
+
+  if(journalFile != NULL) fclose(journalFile);
+  memset(fileErases, 0, sizeof(fileErases));
+  journalFile = fopen(path, "r+b");
+  if(journalFile == NULL){
+    journalFile = fopen(path, "w+b");
+    if(journalFile == NULL) return(false);
+    for(sector=0; sector<JOURNAL_NUM_SECTORS; sector++)
+      fileErase(sector * JOURNAL_SECTOR_SIZE, JOURNAL_SECTOR_SIZE);
+  }
+  memset(&jState, 0, sizeof(jState));
+  return(journalBegin(&fileFlash));
+}
+
+/**************************************************!
+   @brief    journalEnduranceSim()
+   @details  append one record per simulated wake. Every 97th wake the RTC state is lost
+   @details  (cold boot), every 1000th wake the power fails while writing (torn record).
+   @details  After each of these the recovered record must be the last one completely written.
+   @details  Reports the erase count per sector and the projected flash lifetime.
+   @param    wakes: number of wakes to simulate
+   @param    measIntervalSec: measurement interval for the lifetime projection
+   @param    printLine : function to output one line of text
+   @return   bool: true if all recoveries returned the expected record
+***************************************************/
+bool journalEnduranceSim(uint32_t wakes, uint32_t measIntervalSec, void (*printLine)(char*))
+{
+  char line[maxLOG_STRING_LEN];
+  journalRecord rec, torn;
+  uint32_t wake, lastCounter = 0, maxErases = 0, sector, failures = 0;
+  float years;
+
+  if(journalFile == NULL) return(false);
+  journalRecover(&rec);
+  for(wake=1; wake<=wakes; wake++){
+    if(journalAppend(wake, wake % 5000, 4000000 - wake % 1000))
+      lastCounter = wake;
+    if(wake % 1000 == 0 && jState.slot < JOURNAL_RECORDS_PER_SECTOR){
+      // power fails after the first 8 bytes of the next record
+      memset(&torn, 0, sizeof(torn));
+      torn.seq = jState.seq + 1;
+      torn.startCounter = wake + 1;
+      fileWrite(slotAddr(jState.sector, jState.slot), &torn, 8);
+    }
+    if(wake % 97 == 0 || wake % 1000 == 0){
+      memset(&jState, 0, sizeof(jState));
+      memset(&rec, 0, sizeof(rec));
+      if(!journalRecover(&rec) || rec.startCounter != lastCounter)
+        failures++;
+    }
+  }
+
+  for(sector=0; sector<JOURNAL_NUM_SECTORS; sector++)
+    if(fileErases[sector] > maxErases) maxErases = fileErases[sector];
+  years = (maxErases > 0 && measIntervalSec > 0)
+      ? (float)JOURNAL_ERASE_CYCLES / (float)maxErases * (float)wakes * (float)measIntervalSec / (365.0 * 86400.0)
+      : 0;
+  snprintf(line, sizeof(line), "Endurance: %lu wakes, %lu recovery failures, max %lu erases/sector, %3.0f years for %d cycles",
+    (unsigned long)wakes, (unsigned long)failures, (unsigned long)maxErases, years, JOURNAL_ERASE_CYCLES);
+  printLine(line);
+  return(failures == 0);
+}
+#endif // HOST_NATIVE
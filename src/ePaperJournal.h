@@ -0,0 +1,63 @@
+#ifndef _ePaperJournal_H
+#define _ePaperJournal_H
+
+// wear leveled counter journal: startCounter, dischgCnt and prevMicrovolt are appended as small
+// records to a dedicated flash partition on every wake. Two sectors are used alternately,
+// a sector is erased only when the other one is full. Flash access is done via journalFlash,
+// the ESP32 partition API on the device, a file emulating NOR flash on the host (HOST_NATIVE).
+
+#include <stdint.h>
+#include <stddef.h>
+
+//************** module defines *************************/
+#define JOURNAL_PARTITION_NAME  "journal"     // see partitions_xMB_journal.csv, type data, subtype 0x40
+#define JOURNAL_PARTITION_SUBTYPE 0x40
+#define JOURNAL_SECTOR_SIZE     4096          // flash erase unit
+#define JOURNAL_NUM_SECTORS     2
+#define JOURNAL_RECORDS_PER_SECTOR (JOURNAL_SECTOR_SIZE / sizeof(journalRecord))
+#define JOURNAL_EMPTY_SEQ       0xFFFFFFFF    // seq of an erased slot
+#define JOURNAL_MAGIC           0x4A524E4C    // "JRNL", marks initialized RTC journal state
+#define JOURNAL_ERASE_CYCLES    100000        // specified erase cycles of flash sector
+
+//************** module global variables *************************/
+// one record in flash, 20 bytes, 204 records per sector
+struct journalRecord
+{
+  uint32_t seq;             // sequence number, incremented with each record. Never JOURNAL_EMPTY_SEQ
+  uint32_t startCounter;
+  uint32_t dischgCnt;
+  uint32_t prevMicrovolt;
+  uint32_t crc;             // crc32 over all bytes before
+};
+
+// flash access. Addresses are relative to the start of the journal area
+struct journalFlash
+{
+  bool (*read)(uint32_t addr, void* buf, size_t len);
+  bool (*write)(uint32_t addr, const void* buf, size_t len);   // can only clear bits, like NOR flash
+  bool (*erase)(uint32_t addr, size_t len);                    // sets a complete sector to 0xFF
+};
+
+// write position, kept in RTC memory, so the flash is only scanned after cold boot
+struct journalState
+{
+  uint32_t magic;           // JOURNAL_MAGIC if valid
+  uint32_t sector;          // sector appended to
+  uint32_t slot;            // next free slot in this sector
+  uint32_t seq;             // seq of last record written
+  uint32_t appends;         // records written since cold boot
+  uint32_t erases;          // sector erases since cold boot
+};
+extern journalState jState;
+
+//************** function prototypes *************************/
+bool journalBegin(const journalFlash* flash);   // select flash backend, NULL: ESP32 partition (host: journalUseFile)
+bool journalRecover(journalRecord* rec);        // scan flash (cold boot), return latest valid record
+bool journalAppend(uint32_t startCounter, uint32_t dischgCnt, uint32_t prevMicrovolt);
+void journalReport(uint32_t measIntervalSec, void (*printLine)(char*));
+#ifdef HOST_NATIVE
+  bool journalUseFile(const char* path);        // file emulating the journal partition
+  bool journalEnduranceSim(uint32_t wakes, uint32_t measIntervalSec, void (*printLine)(char*));
+#endif
+
+#endif // _ePaperJournal_H
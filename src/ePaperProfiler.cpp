@@ -0,0 +1,189 @@
+/**************************************************!
+   wake profiler: timing of the phases of a wake cycle
+   durations are collected in log2 histograms in RTC memory,
+   which survive deep sleep
+***************************************************/
+
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "esp_sleep.h"
+
+#include "global.h"
+#include "ePaperProfiler.h"
+
+// profiler data, stored in RTC memory which survives the deep sleep. Zero after power on
+RTC_DATA_ATTR profilerData pData;
+
+static uint32_t panelUsec;    // scene and refresh phases of this wake
+
+static const char* phaseNames[PROF_NUM_PHASES] = {
+  "boot", "readPrf", "initDsp", "sensor", "store", "radio", "scene", "refresh", "journal", "writePrf", "sleep", "wake"
+};
+
+/**************************************************!
+   @brief    profClear()
+   @details  clear all histograms and counters
+   @return   void
+***************************************************/
+void profClear()
+{
+  memset(&pData, 0, sizeof(pData));
+  pData.magic = PROF_MAGIC;
+}
+
+/**************************************************!
+   @brief    profInit()
+   @details  to be called first in setup(). Initializes the RTC data after cold boot
+   @details  and records the time from boot to setup()
+   @return   void
+***************************************************/
+void profInit()
+{
+  int64_t now = esp_timer_get_time();   // usec since esp_timer start, i.e. early in boot
+  if(pData.magic != PROF_MAGIC)
+    profClear();
+  pData.wakes++;
+  panelUsec = 0;
+  profRecord(PROF_BOOT, (uint32_t)now);
+}
+
+/**************************************************!
+   @brief    profStart()
+   @details  get start time of a phase
+   @return   int64_t: actual time in usec
+***************************************************/
+int64_t profStart()
+{
+  return(esp_timer_get_time());
+}
+
+/**************************************************!
+   @brief    profStop()
+   @details  record the time elapsed since startUsec for the phase given
+   @param    uint8_t phase: phase to record, PROF_xxx
+   @param    int64_t startUsec: start time as returned by profStart()
+   @return   void
+***************************************************/
+void profStop(uint8_t phase, int64_t startUsec)
+{
+  profRecord(phase, (uint32_t)(esp_timer_get_time() - startUsec));
+}
+
+/**************************************************!
+   @brief    profRecord()
+   @details  add a duration to the histogram of a phase. With PROF_WAKE of a timer wake, the
+   @details  duration without the panel phases is kept as well, for the energy estimate.
+   @details  Cold boot and button wakes (feedback, bluetooth session) are left out there
+   @param    uint8_t phase: phase to record, PROF_xxx
+   @param    uint32_t usec: duration in usec
+   @return   void
+***************************************************/
+void profRecord(uint8_t phase, uint32_t usec)
+{
+  int bucket;
+
+  if(phase >= PROF_NUM_PHASES) return;
+  bucket = (usec == 0) ? 0 : 31 - __builtin_clz(usec);  // floor(log2(usec))
+  if(bucket >= PROF_NUM_BUCKETS) bucket = PROF_NUM_BUCKETS-1;
+  if(pData.hist[phase][bucket] < 0xFFFF)
+    pData.hist[phase][bucket]++;
+  pData.lastUsec[phase] = usec;
+  if(usec > pData.maxUsec[phase])
+    pData.maxUsec[phase] = usec;
+  if(phase == PROF_SCENE || phase == PROF_REFRESH)
+    panelUsec += usec;
+  if(phase == PROF_WAKE && esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER)
+    pData.wakeNoDisplayUsec = (usec > panelUsec) ? usec - panelUsec : 0;
+}
+
+/**************************************************!
+   @brief    profSampleReady()
+   @details  record the time to sample, i.e. time since boot when the sensor data is available
+   @return   void
+***************************************************/
+void profSampleReady()
+{
+  pData.sampleUsec = (uint32_t)esp_timer_get_time();
+  if(pData.sampleUsec > pData.maxSampleUsec)
+    pData.maxSampleUsec = pData.sampleUsec;
+}
+
+/**************************************************!
+   @brief    profSession()
+   @details  add the duration of a bluetooth / BLE configuration session. Sessions are
+   @details  rare and long: they are summed, not put into a histogram of the wake
+   @param    uint32_t ms: duration of the session, radio on
+   @return   void
+***************************************************/
+void profSession(uint32_t ms)
+{
+  pData.sessionMs = (pData.sessionMs > UINT32_MAX - ms) ? UINT32_MAX : pData.sessionMs + ms;
+}
+
+/**************************************************!
+   @brief    profPhaseName()
+   @param    uint8_t phase: phase, PROF_xxx
+   @return   const char*: short name of phase
+***************************************************/
+const char* profPhaseName(uint8_t phase)
+{
+  if(phase >= PROF_NUM_PHASES) return("?");
+  return(phaseNames[phase]);
+}
+
+/**************************************************!
+   @brief    profMedianUsec()
+   @details  median from the histogram. Resolution is one bucket, lower bound is returned
+   @param    uint8_t phase: phase, PROF_xxx
+   @return   uint32_t: median duration in usec, 0 if no data
+***************************************************/
+uint32_t profMedianUsec(uint8_t phase)
+{
+  uint32_t total = 0, sum = 0;
+  int i;
+
+  if(phase >= PROF_NUM_PHASES) return(0);
+  for(i=0; i<PROF_NUM_BUCKETS; i++)
+    total += pData.hist[phase][i];
+  for(i=0; i<PROF_NUM_BUCKETS; i++){
+    sum += pData.hist[phase][i];
+    if(total > 0 && 2*sum >= total)
+      return((uint32_t)1 << i);
+  }
+  return(0);
+}
+
+/**************************************************!
+   @brief    profReport()
+   @details  output of the histograms, one line per phase and one line for the buckets
+   @details  format of bucket line: <bucket>:<count> for all buckets with count > 0
+   @param    printLine : function to output one line of text (serial, bluetooth)
+   @return   void
+***************************************************/
+void profReport(void (*printLine)(char*))
+{
+  char line[maxLOG_STRING_LEN];
+  int phase, i, len;
+
+  snprintf(line, sizeof(line), "Wake profile: %lu wakes. [ms] last/median/max, buckets 2^n usec",
+    (unsigned long)pData.wakes);
+  printLine(line);
+  for(phase=0; phase<PROF_NUM_PHASES; phase++){
+    snprintf(line, sizeof(line), "%-8s %7.1f %7.1f %7.1f",
+      phaseNames[phase],
+      (float)pData.lastUsec[phase]/1000.0, (float)profMedianUsec(phase)/1000.0,
+      (float)pData.maxUsec[phase]/1000.0);
+    printLine(line);
+    len = snprintf(line, sizeof(line), "  ");
+    for(i=0; i<PROF_NUM_BUCKETS; i++){
+      if(pData.hist[phase][i] > 0 && len < (int)sizeof(line)-12)
+        len += snprintf(line+len, sizeof(line)-len, " %d:%u", i, pData.hist[phase][i]);
+    }
+    printLine(line);
+  }
+  snprintf(line, sizeof(line), "sample   %7.1f %7s %7.1f  (time to sample, since boot)",
+    (float)pData.sampleUsec/1000.0, "", (float)pData.maxSampleUsec/1000.0);
+  printLine(line);
+  snprintf(line, sizeof(line), "sessions %7.1f s radio on since cold boot", (float)pData.sessionMs/1000.0);
+  printLine(line);
+}
@@ -0,0 +1,54 @@
+#ifndef _ePaperProfiler_H
+#define _ePaperProfiler_H
+
+//************** module defines *************************/
+// phases of a wake cycle that are timed. Order is the order of execution within a measurement wake
+#define PROF_BOOT         0   // from boot (esp_timer start) to entry of setup()
+#define PROF_READPREFS    1   // readPreferences()
+#define PROF_INITDISPLAY  2   // initDisplay()
+#define PROF_SENSOR       3   // getBME280SensorData(): collect the conversion started in setup()
+#define PROF_STORE        4   // storeMeasurementData()
+#define PROF_RADIO        5   // BLE controller on for the beacon (beaconSend()). Sessions: pData.sessionMs
+#define PROF_SCENE        6   // drawing calls within firstPage()/nextPage() loop (scene build)
+#define PROF_REFRESH      7   // nextPage(): transfer to panel and panel refresh
+#define PROF_JOURNAL      8   // journalAppend(): counters to the journal partition, every measurement wake
+#define PROF_WRITEPREFS   9   // NVS writes (writePreferences(), writeCounterPreferences())
+#define PROF_SLEEP        10  // gotoDeepSleep() until esp_deep_sleep_start()
+#define PROF_WAKE         11  // complete wake, boot until esp_deep_sleep_start()
+#define PROF_NUM_PHASES   12
+
+// log2 histogram buckets: bucket i counts durations of 2^i ... 2^(i+1)-1 usec.
+// bucket 0 also counts 0 usec, last bucket also counts everything above (2^23 usec = 8.4 sec)
+#define PROF_NUM_BUCKETS  24
+#define PROF_MAGIC        0x50524F46  // "PROF", marks initialized RTC profiler data
+
+//************** module global variables *************************/
+// profiler data, stored in RTC memory which survives deep sleep.
+// 12 phases * 24 buckets * 2 bytes + 2*48 bytes + 24 bytes = 696 bytes
+struct profilerData
+{
+  uint32_t magic;                                       // PROF_MAGIC if initialized
+  uint32_t wakes;                                       // number of wakes recorded since cold boot
+  uint16_t hist[PROF_NUM_PHASES][PROF_NUM_BUCKETS];     // histogram counts, saturating at 65535
+  uint32_t lastUsec[PROF_NUM_PHASES];                   // duration of phase in last wake where it ran
+  uint32_t maxUsec[PROF_NUM_PHASES];                    // max duration of phase since cold boot
+  uint32_t sampleUsec;                                  // time to sample: boot until sensor data available
+  uint32_t maxSampleUsec;                               // max time to sample since cold boot
+  uint32_t wakeNoDisplayUsec;                           // last timer wake without its scene and refresh phases
+  uint32_t sessionMs;                                   // bluetooth / BLE sessions (radio on) since cold boot
+};
+extern RTC_DATA_ATTR profilerData pData;
+
+//************** function prototypes *************************/
+void profInit();                                  // init RTC data on cold boot, record PROF_BOOT
+int64_t profStart();                              // returns the actual esp_timer time in usec
+void profStop(uint8_t phase, int64_t startUsec);  // record duration since startUsec for phase
+void profRecord(uint8_t phase, uint32_t usec);    // record a duration for phase
+void profSampleReady();                           // record time to sample (now, since boot)
+void profSession(uint32_t ms);                    // add the duration of a bluetooth / BLE session
+const char* profPhaseName(uint8_t phase);         // short name of phase
+uint32_t profMedianUsec(uint8_t phase);           // approx. median of phase (lower bound of median bucket)
+void profReport(void (*printLine)(char*));        // print histograms line by line via printLine()
+void profClear();                                 // clear all histograms
+
+#endif // _ePaperProfiler_H
@@ -0,0 +1,194 @@
+/**************************************************!
+   BME280 sampling profile manager
+   the pressure noise is estimated from the second differences of the
+   last samples, which removes the weather trend. The noise of the environment
+   is the measured noise without the sensor noise of the active profile.
+   The cheapest profile that reaches the target noise is chosen.
+   More oversampling does not help against environment noise (drafts, gusts):
+   then the cheapest profile close to the best possible is used.
+***************************************************/
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "global.h"
+#include "ePaperBME280.h"
+#include "ePaperEnergy.h"
+#include "ePaperSensorProfile.h"
+
+// profiles in ascending conversion time. Noise: datasheet typical values (osrs_p, filter)
+static const sensorProfile profiles[SP_NUM_PROFILES] = {
+  { "low",    BME_OSRS_X1, BME_OSRS_X1,  BME_OSRS_X1, BME_FILTER_OFF, 3.3 },
+  { "std",    BME_OSRS_X1, BME_OSRS_X4,  BME_OSRS_X1, BME_FILTER_OFF, 2.1 },
+  { "high",   BME_OSRS_X2, BME_OSRS_X16, BME_OSRS_X1, BME_FILTER_OFF, 1.3 },
+  { "smooth", BME_OSRS_X2, BME_OSRS_X16, BME_OSRS_X1, BME_FILTER_4,   0.6 },  // IIR over ~4 measurements
+};
+
+// profile state, in RTC memory which survives the deep sleep. Zero after power on
+RTC_DATA_ATTR sensorProfileData spData;
+
+/**************************************************!
+   @brief    spInit()
+   @details  initialize after cold boot: start with "std"
+***************************************************/
+static void spInit()
+{
+  if(spData.magic == SP_MAGIC && spData.active < SP_NUM_PROFILES)
+    return;
+  memset(&spData, 0, sizeof(spData));
+  spData.magic = SP_MAGIC;
+  spData.active = 1;
+}
+
+/**************************************************!
+   @brief    spApply()
+   @details  set oversampling and filter of the active profile. Called before the conversion is started
+   @return   bool: true if ok
+***************************************************/
+bool spApply()
+{
+  const sensorProfile* p;
+
+  spInit();
+  p = &profiles[spData.active];
+  return(bmeSetSampling(p->osrsT, p->osrsP, p->osrsH, p->filter));
+}
+
+/**************************************************!
+   @brief    spProfileName()
+   @param    profile: index
+   @return   const char*: name of profile
+***************************************************/
+const char* spProfileName(uint8_t profile)
+{
+  if(profile >= SP_NUM_PROFILES) return("?");
+  return(profiles[profile].name);
+}
+
+/**************************************************!
+   @brief    spCostMaSec()
+   @details  charge of one conversion: sensor current during the conversion, plus the CPU
+   @details  current for the part of the conversion not overlapped with other work
+   @param    profile: index
+   @param    collectUsec: time between start of conversion and collection of the result
+   @return   float: charge in mA*sec
+***************************************************/
+float spCostMaSec(uint8_t profile, uint32_t collectUsec)
+{
+  const sensorProfile* p = &profiles[profile];
+  uint32_t convUsec = bmeMaxMeasUsec(p->osrsT, p->osrsP, p->osrsH);
+  uint32_t waitUsec = (convUsec > collectUsec) ? convUsec - collectUsec : 0;
+
+  return((CURRENT_BME_MA * (float)convUsec + CURRENT_CPU_MA * (float)waitUsec) / 1000000.0);
+}
+
+/**************************************************!
+   @brief    spNoiseEstimate()
+   @details  RMS noise from second differences d = p[i] - 2 p[i+1] + p[i+2] of consecutive
+   @details  samples. A linear trend cancels, for white noise var(d) = 6 sigma^2
+   @param    recentPa: ring of samples
+   @param    count: number of valid samples, ring is full if SP_NUM_RECENT
+   @param    next: index of next entry, i.e. oldest if ring full
+   @return   float: noise in Pa, -1 if not enough samples
+***************************************************/
+float spNoiseEstimate(const float* recentPa, int count, int next)
+{
+  float p0, p1, p2, d, sum = 0;
+  int i, first;
+
+  if(count < 3) return(-1);
+  first = (count < SP_NUM_RECENT) ? 0 : next;   // oldest sample
+  for(i=0; i<count-2; i++){
+    p0 = recentPa[(first + i) % SP_NUM_RECENT];
+    p1 = recentPa[(first + i + 1) % SP_NUM_RECENT];
+    p2 = recentPa[(first + i + 2) % SP_NUM_RECENT];
+    d = p0 - 2*p1 + p2;
+    sum += d*d;
+  }
+  return(sqrt(sum / (float)(count-2) / 6.0));
+}
+
+/**************************************************!
+   @brief    spUpdate()
+   @details  add the pressure sample, update the noise estimate and choose the profile
+   @details  for the next conversion. The samples are cleared when the profile changes
+   @param    pressurePa: raw pressure of this measurement in Pa, NAN if failed
+   @param    collectUsec: time between start of conversion and collection of the result
+   @param    batterySaving: true if the display refresh is stretched, then only cheap profiles
+   @return   void
+***************************************************/
+void spUpdate(float pressurePa, uint32_t collectUsec, bool batterySaving)
+{
+  float sensorNoise, total, best, limit, downLimit;
+  int i, maxProfile, candidate;
+
+  spInit();
+  spData.collectUsec = collectUsec;
+  if(isnan(pressurePa)) return;
+
+  spData.recentPa[spData.next] = pressurePa;
+  spData.next = (spData.next + 1) % SP_NUM_RECENT;
+  if(spData.count < SP_NUM_RECENT) spData.count++;
+  spData.measNoisePa = spNoiseEstimate(spData.recentPa, spData.count, spData.next);
+  if(spData.count < SP_MIN_SAMPLES) return;
+
+  sensorNoise = profiles[spData.active].noisePa;
+  spData.envNoisePa = (spData.measNoisePa > sensorNoise)
+      ? sqrt(spData.measNoisePa*spData.measNoisePa - sensorNoise*sensorNoise) : 0;
+
+  maxProfile = batterySaving ? SP_SAVING_MAX : SP_NUM_PROFILES-1;
+  // best possible total noise
+  best = 1e9;
+  for(i=0; i<=maxProfile; i++){
+    total = sqrt(spData.envNoisePa*spData.envNoisePa + profiles[i].noisePa*profiles[i].noisePa);
+    if(total < best) best = total;
+  }
+  // cheapest profile within the limit. Cheaper than active: lower limit (hysteresis)
+  limit = (SP_TARGET_NOISE_PA > SP_BEST_TOLERANCE * best) ? SP_TARGET_NOISE_PA : SP_BEST_TOLERANCE * best;
+  downLimit = (SP_DOWN_FACTOR * SP_TARGET_NOISE_PA > SP_BEST_DOWN * best)
+      ? SP_DOWN_FACTOR * SP_TARGET_NOISE_PA : SP_BEST_DOWN * best;
+  candidate = maxProfile;
+  for(i=0; i<=maxProfile; i++){
+    total = sqrt(spData.envNoisePa*spData.envNoisePa + profiles[i].noisePa*profiles[i].noisePa);
+    if(total <= ((i < spData.active) ? downLimit : limit)){
+      candidate = i;
+      break;
+    }
+  }
+  if(candidate != spData.active){
+    logOut<2>("Sensor profile %s -> %s: noise %3.2f Pa, environment %3.2f Pa, limit %3.2f Pa",
+      profiles[spData.active].name, profiles[candidate].name, spData.measNoisePa, spData.envNoisePa, limit);
+    spData.active = candidate;
+    spData.count = 0;
+    spData.next = 0;
+    spData.switches++;
+  }
+}
+
+/**************************************************!
+   @brief    spReport()
+   @details  output of noise estimate and profile table with conversion time, cost and noise
+   @param    printLine : function to output one line of text (serial, bluetooth)
+   @return   void
+***************************************************/
+void spReport(void (*printLine)(char*))
+{
+  char line[maxLOG_STRING_LEN];
+  const sensorProfile* p;
+  int i;
+
+  spInit();
+  snprintf(line, sizeof(line), "Sensor profile %s, noise %3.2f Pa (env %3.2f Pa, %d samples), %lu switches",
+    profiles[spData.active].name, spData.measNoisePa, spData.envNoisePa, spData.count,
+    (unsigned long)spData.switches);
+  printLine(line);
+  for(i=0; i<SP_NUM_PROFILES; i++){
+    p = &profiles[i];
+    snprintf(line, sizeof(line), "%c %-6s T/P/H x%d/x%d/x%d IIR %d: %5.1f ms %5.3f mAs %3.1f Pa",
+      (i == spData.active) ? '*' : ' ', p->name,
+      1 << (p->osrsT-1), 1 << (p->osrsP-1), 1 << (p->osrsH-1), p->filter ? 1 << p->filter : 0,
+      (float)bmeMaxMeasUsec(p->osrsT, p->osrsP, p->osrsH) / 1000.0,
+      spCostMaSec(i, spData.collectUsec), p->noisePa);
+    printLine(line);
+  }
+}
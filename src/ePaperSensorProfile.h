@@ -0,0 +1,53 @@
+#ifndef _ePaperSensorProfile_H
+#define _ePaperSensorProfile_H
+
+// BME280 sampling profiles: oversampling per channel and IIR filter.
+// The short-term pressure noise is estimated from the last samples, the cheapest profile
+// that reaches the target noise is used for the next conversion.
+
+#include <stdint.h>
+
+//************** module defines *************************/
+#define SP_NUM_PROFILES     4
+#define SP_NUM_RECENT       8       // pressure samples for noise estimation
+#define SP_MIN_SAMPLES      8       // min. samples before a decision (full ring)
+#define SP_TARGET_NOISE_PA  2.5     // target pressure noise in Pa (display resolution is 10 Pa)
+#define SP_DOWN_FACTOR      0.8     // hysteresis: switch to cheaper profile only below 0.8 * target
+#define SP_BEST_TOLERANCE   1.25    // if target not reachable: keep profile within 25% of best
+#define SP_BEST_DOWN        1.1     // if target not reachable: switch to cheaper profile within 10% of best
+#define SP_SAVING_MAX       1       // highest profile when display refresh is stretched (battery saving)
+#define CURRENT_BME_MA      0.714   // BME280 current during pressure conversion, datasheet
+#define SP_MAGIC            0x53505246  // "SPRF", marks initialized RTC profile data
+
+//************** module global variables *************************/
+struct sensorProfile
+{
+  const char* name;
+  uint8_t osrsT, osrsP, osrsH, filter;  // BME_OSRS_xx, BME_FILTER_xx
+  float noisePa;                        // typical RMS pressure noise of the sensor
+};
+
+// profile state, stored in RTC memory which survives deep sleep
+struct sensorProfileData
+{
+  uint32_t magic;                   // SP_MAGIC if initialized
+  uint8_t active;                   // profile used for the next conversion
+  uint8_t count;                    // valid entries in recentPa
+  uint8_t next;                     // next index in recentPa (ring)
+  float recentPa[SP_NUM_RECENT];    // last pressures in Pa, measured with the active profile
+  float measNoisePa;                // RMS noise estimated from recentPa
+  float envNoisePa;                 // noise of the environment, sensor noise removed
+  uint32_t collectUsec;             // time between conversion start and collection (overlap)
+  uint32_t switches;                // profile changes since cold boot
+};
+extern sensorProfileData spData;
+
+//************** function prototypes *************************/
+bool spApply();                                   // set sampling of the active profile in the BME280
+void spUpdate(float pressurePa, uint32_t collectUsec, bool batterySaving); // noise estimate, choose profile
+const char* spProfileName(uint8_t profile);
+float spCostMaSec(uint8_t profile, uint32_t collectUsec);  // charge of one conversion of profile
+float spNoiseEstimate(const float* recentPa, int count, int next); // RMS noise from second differences
+void spReport(void (*printLine)(char*));
+
+#endif // _ePaperSensorProfile_H
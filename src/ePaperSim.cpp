@@ -0,0 +1,759 @@
+/**************************************************!
+   wake-cycle simulator: months of wakes of the unchanged firmware on the host
+   Each simulated wake: weather of the scenario to the BME280 fake, battery voltage to the
+   ADC pin, slow clock drift from the temperature, then hostWake() runs setup() / loop()
+   until the deep sleep and passes the sleep. The charge of the wake (awake, light sleep,
+   panel refresh, deep sleep) is taken from the battery. Then the state of the firmware is
+   compared with the state before the wake (history shift) and recomputed from scratch
+   (min / max, alert windows). Violations are counted per invariant, the first ones printed.
+   Only with -D SIM on the host build: env:sim_native or the g++ line of the host build
+   with -DSIM -DHOST_NO_MAIN.
+***************************************************/
+
+// only with -D SIM, host only
+#if defined(SIM) && defined(HOST_NATIVE)
+
+#include <Arduino.h>
+#include <unistd.h>
+#include <algorithm>
+#include "esp_sleep.h"
+
+#include "global.h"
+#include "ePaperBarograf.h"
+#include "ePaperBME280.h"
+#include "ePaperBattery.h"
+#include "ePaperButton.h"
+#include "ePaperEnergy.h"
+#include "ePaperAlert.h"
+#include "ePaperJournal.h"
+#include "ePaperSim.h"
+
+#ifndef VOLTAGE_PIN
+  #define VOLTAGE_PIN   39        // PCB_BOARD, as in ePaperBarograf.cpp
+#endif
+#define US_PER_HOUR   3600000000.0
+#define US_PER_DAY    86400000000.0
+
+simStatistics simStats;
+
+// mean time between events in days, 0: none
+struct simEventRates
+{
+  float frontDays;
+  float stormDays;
+  float dropoutDays;
+};
+static const simEventRates simRates[SIM_NUM_SCENARIOS] = {
+  { 5.0, 20.0, 10.0 },  // mixed
+  { 0.0,  0.0,  0.0 },  // diurnal
+  { 3.0,  0.0,  0.0 },  // front
+  { 0.0,  5.0,  0.0 },  // storm
+  { 0.0,  0.0,  1.5 },  // dropout
+};
+
+// state of the weather generator, advanced by simWeatherAt()
+struct simWeatherState
+{
+  uint32_t random;
+  uint8_t scenario;
+  uint64_t lastUs;
+  double anomaly;               // hPa, slow random pressure deviation (highs and lows)
+  double dewAnomaly;            // °C, air mass humidity
+  double cooling;               // °C, cold air behind the last front, decaying
+  uint64_t frontUs;             // centre of the next front, UINT64_MAX: none
+  double frontDepth, frontCooling;
+  uint64_t stormUs;             // centre of the next storm
+  double stormDepth;
+  uint64_t dropStartUs, dropEndUs;  // next sensor dropout
+};
+static simWeatherState sw;
+
+// state of the firmware before a wake, to compare with afterwards
+static measurementData simBefore;
+
+static bmeCalib simCalib;                 // calibration of the BME280 fake
+static const uint8_t simButtons[] = BUTTON_PINS;
+
+//************** random numbers *************************/
+static double simUniform()
+{
+  sw.random = sw.random * 1103515245 + 12345;
+  return((double)(sw.random >> 8) / 16777216.0);
+}
+
+static double simGauss()
+{
+  double u = simUniform();
+
+  return(sqrt(-2.0 * log(1.0 - u)) * cos(2 * PI * simUniform()));
+}
+
+// time of the next event of a rate, exponentially distributed
+static uint64_t simNextEvent(uint64_t afterUs, float meanDays)
+{
+  if(meanDays <= 0)
+    return(UINT64_MAX);
+  return(afterUs + (uint64_t)(-log(1.0 - simUniform()) * meanDays * US_PER_DAY));
+}
+
+//************** weather *************************/
+static double simRamp(uint64_t us, uint64_t centreUs, double widthHours)
+{
+  return(0.5 * (1.0 + tanh(((double)us - (double)centreUs) / US_PER_HOUR / widthHours)));
+}
+
+static double simBell(uint64_t us, uint64_t centreUs, double widthHours)
+{
+  double x = ((double)us - (double)centreUs) / US_PER_HOUR / widthHours;
+
+  return(exp(-x * x));
+}
+
+static void simWeatherBegin(uint32_t seed, uint8_t scenario)
+{
+  const simEventRates* r = &simRates[scenario];
+
+  memset(&sw, 0, sizeof(sw));
+  sw.random = seed;
+  sw.scenario = scenario;
+  sw.frontUs = simNextEvent(30 * US_PER_HOUR, r->frontDays);
+  sw.frontDepth = 6.0 + 10.0 * simUniform();
+  sw.frontCooling = 2.0 + 5.0 * simUniform();
+  sw.stormUs = simNextEvent(12 * US_PER_HOUR, r->stormDays);
+  sw.stormDepth = 15.0 + 20.0 * simUniform();
+  sw.dropStartUs = simNextEvent(0, r->dropoutDays);
+  sw.dropEndUs = 0;
+}
+
+/**************************************************!
+   @brief    simWeatherAt()
+   @details  pressure: 1013.25 hPa + slow anomaly (3 days correlation, 6 hPa) + semidiurnal
+   @details  tide, troughs of fronts (10 h wide) and storms (4 h, with gusts). Temperature:
+   @details  season and diurnal cycle, cold air behind a front. Humidity from the dew point.
+   @details  The random parts advance with each call, the times have to be ascending
+   @param    worldUs: time since the start of the run
+   @param    w: weather
+   @return   void
+***************************************************/
+void simWeatherAt(uint64_t worldUs, simWeather* w)
+{
+  const simEventRates* r = &simRates[sw.scenario];
+  double hours = worldUs / US_PER_HOUR, day = hours / 24.0 + SIM_START_DAY;
+  double dtHours = (worldUs - sw.lastUs) / US_PER_HOUR, decay, tMean, dew, b;
+
+  // slow random parts, exact discretisation of an Ornstein-Uhlenbeck process
+  decay = exp(-dtHours / 72.0);
+  sw.anomaly = sw.anomaly * decay + 6.0 * sqrt(1.0 - decay * decay) * simGauss();
+  decay = exp(-dtHours / 48.0);
+  sw.dewAnomaly = sw.dewAnomaly * decay + 2.0 * sqrt(1.0 - decay * decay) * simGauss();
+  sw.cooling = sw.cooling * decay;
+  if(sw.frontUs != UINT64_MAX)
+    sw.cooling += sw.frontCooling * (simRamp(worldUs, sw.frontUs, 2.0) - simRamp(sw.lastUs, sw.frontUs, 2.0));
+  sw.lastUs = worldUs;
+
+  tMean = 9.0 - 9.0 * cos(2 * PI * (day - 15.0) / 365.0);
+  w->pressure = 1013.25 + sw.anomaly + 0.5 * cos(2 * PI * (fmod(hours, 12.0) - 10.0) / 12.0);
+  w->temperature = tMean + 5.0 * sin(2 * PI * (fmod(hours, 24.0) - 9.0) / 24.0) - sw.cooling;
+  dew = tMean - 6.0 + sw.dewAnomaly - sw.cooling;
+
+  // front: trough, moist air in it, cold air behind it
+  if(sw.frontUs != UINT64_MAX){
+    b = simBell(worldUs, sw.frontUs, 10.0);
+    w->pressure -= sw.frontDepth * b;
+    dew += 3.0 * b;
+    if(worldUs > sw.frontUs + 30 * US_PER_HOUR){
+      sw.cooling += sw.frontCooling * (1.0 - simRamp(worldUs, sw.frontUs, 2.0));  // ramp complete
+      sw.frontUs = simNextEvent(worldUs + 30 * US_PER_HOUR, r->frontDays);
+      sw.frontDepth = 6.0 + 10.0 * simUniform();
+      sw.frontCooling = 2.0 + 5.0 * simUniform();
+    }
+  }
+  // storm: deep, fast trough with gusts
+  if(sw.stormUs != UINT64_MAX){
+    b = simBell(worldUs, sw.stormUs, 4.0);
+    w->pressure -= sw.stormDepth * b - 0.4 * b * simGauss();
+    w->temperature -= 2.0 * b;
+    dew += 2.0 * b;
+    if(worldUs > sw.stormUs + 12 * US_PER_HOUR){
+      sw.stormUs = simNextEvent(worldUs + 12 * US_PER_HOUR, r->stormDays);
+      sw.stormDepth = 15.0 + 20.0 * simUniform();
+    }
+  }
+
+  if(dew > w->temperature)
+    dew = w->temperature;
+  w->humidity = 100.0 * exp(17.62 * dew / (243.12 + dew) - 17.62 * w->temperature / (243.12 + w->temperature));
+  w->humidity = constrain(w->humidity, 5.0, 100.0);
+
+  // sensor dropout: 5 min to 6 h without acknowledge
+  if(sw.dropStartUs != UINT64_MAX && worldUs >= sw.dropEndUs && worldUs >= sw.dropStartUs){
+    if(sw.dropEndUs <= sw.dropStartUs)
+      sw.dropEndUs = sw.dropStartUs + (uint64_t)((5.0 / 60.0 + 5.9 * simUniform()) * US_PER_HOUR);
+    else{
+      sw.dropStartUs = simNextEvent(worldUs, r->dropoutDays);
+      sw.dropEndUs = 0;
+    }
+  }
+  w->sensorOk = !(worldUs >= sw.dropStartUs && worldUs < sw.dropEndUs);
+}
+
+/**************************************************!
+   @brief    simSetSensor()
+   @details  raw values of the BME280 fake for the weather: the compensation is monotonic
+   @details  in each raw value, so the raw value is found by bisection. Temperature first,
+   @details  its tFine is input of pressure and humidity
+   @param    w: weather
+   @return   void
+***************************************************/
+static void simSetSensor(const simWeather* w)
+{
+  int32_t lo, hi, mid, tFine, target;
+  int32_t adcT, adcP, adcH;
+  uint32_t targetU;
+
+  target = lround(w->temperature * 100.0);            // rises with adcT
+  for(lo=0, hi=0xFFFFF; lo<hi; ){
+    mid = (lo + hi) / 2;
+    if(bmeCompensateT(mid, &simCalib, &tFine) < target) lo = mid + 1; else hi = mid;
+  }
+  adcT = lo;
+  bmeCompensateT(adcT, &simCalib, &tFine);
+
+  targetU = (uint32_t)lround(w->pressure * 100.0 * 256.0);    // falls with adcP
+  for(lo=0, hi=0xFFFFF; lo<hi; ){
+    mid = (lo + hi) / 2;
+    if(bmeCompensateP(mid, &simCalib, tFine) > targetU) lo = mid + 1; else hi = mid;
+  }
+  adcP = lo;
+
+  targetU = (uint32_t)lround(w->humidity * 1024.0);           // rises with adcH
+  for(lo=0, hi=0xFFFF; lo<hi; ){
+    mid = (lo + hi) / 2;
+    if(bmeCompensateH(mid, &simCalib, tFine) < targetU) lo = mid + 1; else hi = mid;
+  }
+  adcH = lo;
+
+  bmeFakeSetRaw(adcT, adcP, adcH, 2);
+  bmeFakeSetAbsent(!w->sensorOk);
+}
+
+//************** battery *************************/
+// open circuit voltage of a state of charge: inverse of the table of the firmware
+static uint16_t simBatteryMv(double socPermille)
+{
+  uint16_t lo = 3000, hi = 4300, mid;
+
+  while(lo < hi){
+    mid = (lo + hi) / 2;
+    if(batSocPermille(mid) < socPermille) lo = mid + 1; else hi = mid;
+  }
+  return(lo);
+}
+
+//************** invariants *************************/
+static inline bool simValid(float v) { return(v < nanDATA/4); }   // false for NaN as well
+
+static void simViolation(int inv, void (*printLine)(char*), const char* format, ...)
+{
+  static const char* names[] = SIM_INVARIANT_NAMES;
+  char line[2 * maxLOG_STRING_LEN], detail[maxLOG_STRING_LEN];
+  va_list args;
+
+  if(simStats.violations[inv]++ >= SIM_MAX_REPORTS)
+    return;
+  va_start(args, format);
+  vsnprintf(detail, sizeof(detail), format, args);
+  va_end(args);
+  snprintf(line, sizeof(line), "sim: day %.3f wake %u: %s: %s",
+    hostWorldUs() / US_PER_DAY, simStats.wakes, names[inv], detail);
+  printLine(line);
+}
+
+/**************************************************!
+   @brief    simCheckHistory()
+   @details  after a measurement the history is shifted by one point, the ages by the last
+   @details  interval; without a measurement it is unchanged. Not checked if the time
+   @details  range has been changed in the wake: the history is rescaled then
+   @param    measured: the wake took a measurement
+   @param    printLine: output of violations
+   @return   void
+***************************************************/
+static void simCheckHistory(bool measured, void (*printLine)(char*))
+{
+  const int n = noDataPoints;
+  int i, shift = measured ? 1 : 0;
+  int32_t add = measured ? simBefore.lastTargetSleeptime : 0;
+
+  if(wData.targetMeasurementIntervalSec != simBefore.targetMeasurementIntervalSec)
+    return;
+  for(i=0; i<n-shift; i++){
+    if(memcmp(&wData.pressHistory[i], &simBefore.pressHistory[i+shift], sizeof(float)) != 0
+       || memcmp(&wData.tempHistory[i], &simBefore.tempHistory[i+shift], sizeof(float)) != 0
+       || wData.humiHistory[i] != simBefore.humiHistory[i+shift]
+       || wData.qualHistory[i] != simBefore.qualHistory[i+shift]){
+      simViolation(SIM_INV_SHIFT, printLine, "point %d not shifted: %.2f <- %.2f", i,
+        wData.pressHistory[i], simBefore.pressHistory[i+shift]);
+      return;
+    }
+    if(wData.ageOfDatapoint[i] != simBefore.ageOfDatapoint[i+shift] + add){
+      simViolation(SIM_INV_SHIFT, printLine, "age %d: %ld, expected %ld", i,
+        (long)wData.ageOfDatapoint[i], (long)(simBefore.ageOfDatapoint[i+shift] + add));
+      return;
+    }
+  }
+}
+
+static void simCheckAges(void (*printLine)(char*))
+{
+  int i;
+
+  if(wData.ageOfDatapoint[noDataPoints-1] != 0)
+    simViolation(SIM_INV_AGES, printLine, "newest point %ld s old", (long)wData.ageOfDatapoint[noDataPoints-1]);
+  for(i=0; i<noDataPoints-1; i++){
+    if(wData.ageOfDatapoint[i] <= wData.ageOfDatapoint[i+1]){
+      simViolation(SIM_INV_AGES, printLine, "age %d: %ld, age %d: %ld", i, (long)wData.ageOfDatapoint[i],
+        i+1, (long)wData.ageOfDatapoint[i+1]);
+      return;
+    }
+  }
+}
+
+// newest point: the weather fed to the sensor, invalid if the sensor did not answer
+static void simCheckValue(const simWeather* w, void (*printLine)(char*))
+{
+  const int i = noDataPoints-1;
+  float p = wData.pressHistory[i], t = wData.tempHistory[i];
+  int16_t h = wData.humiHistory[i];
+
+  if(!w->sensorOk){
+    if(simValid(p) || simValid(t) || simValid(h))
+      simViolation(SIM_INV_VALUE, printLine, "dropout stored as valid: %.2f hPa %.2f °C %d", p, t, h);
+    return;
+  }
+  if(!simValid(p) || fabs(p - w->pressure) > SIM_TOL_PRESSURE
+     || !simValid(t) || fabs(t - w->temperature) > SIM_TOL_TEMPERATURE
+     || !simValid(h) || abs(h - (int)lround(w->humidity * 10.0)) > SIM_TOL_HUMIDITY)
+    simViolation(SIM_INV_VALUE, printLine, "stored %.2f hPa %.2f °C %d, weather %.2f hPa %.2f °C %.1f %%",
+      p, t, h, w->pressure, w->temperature, w->humidity);
+}
+
+// min / max of the valid points from index first on
+struct simRange
+{
+  float pMin, pMax, tMin, tMax;
+  int16_t hMin, hMax;
+};
+
+static void simValidRange(int first, simRange* r)
+{
+  int i;
+
+  r->pMin = 100000; r->pMax = -1; r->tMin = 100000; r->tMax = -300;
+  r->hMin = 10000; r->hMax = 0;
+  for(i=first; i<noDataPoints; i++){
+    if(simValid(wData.pressHistory[i])){
+      r->pMin = std::min(r->pMin, wData.pressHistory[i]);
+      r->pMax = std::max(r->pMax, wData.pressHistory[i]);
+    }
+    if(simValid(wData.tempHistory[i])){
+      r->tMin = std::min(r->tMin, wData.tempHistory[i]);
+      r->tMax = std::max(r->tMax, wData.tempHistory[i]);
+    }
+    if(simValid(wData.humiHistory[i])){
+      r->hMin = std::min(r->hMin, wData.humiHistory[i]);
+      r->hMax = std::max(r->hMax, wData.humiHistory[i]);
+    }
+  }
+}
+
+static bool simSameRange(const simRange* r)
+{
+  return(wData.pressHistoryMin == r->pMin && wData.pressHistoryMax == r->pMax
+         && wData.tempHistoryMin == r->tMin && wData.tempHistoryMax == r->tMax
+         && wData.humiHistoryMin == r->hMin && wData.humiHistoryMax == r->hMax);
+}
+
+/**************************************************!
+   @brief    simCheckStatistics()
+   @details  min / max recomputed over the valid points: of the whole history as stored
+   @details  by storeMeasurementData(), or of the graph window if the panel has been drawn
+   @details  (prepareGraphicsParameters()). The 3 h changes finite and in a physical range
+   @param    printLine: output of violations
+   @return   void
+***************************************************/
+static void simCheckStatistics(void (*printLine)(char*))
+{
+  simRange all, shown;
+
+  simValidRange(0, &all);
+  simValidRange(wData.indexFirstPointToDraw, &shown);
+  if(!simSameRange(&all) && !simSameRange(&shown))
+    simViolation(SIM_INV_STATS, printLine, "min/max P %.1f-%.1f T %.1f-%.1f H %d-%d, valid points P %.1f-%.1f T %.1f-%.1f H %d-%d",
+      wData.pressHistoryMin, wData.pressHistoryMax, wData.tempHistoryMin, wData.tempHistoryMax,
+      wData.humiHistoryMin, wData.humiHistoryMax, all.pMin, all.pMax, all.tMin, all.tMax, all.hMin, all.hMax);
+  if(!(fabs(wData.pressure3hChange) < 100) || !(fabs(wData.temperature3hChange) < 100)
+     || !(fabs(wData.humidity3hChange) < 100))
+    simViolation(SIM_INV_STATS, printLine, "3 h changes P %.2f T %.2f H %.2f",
+      wData.pressure3hChange, wData.temperature3hChange, wData.humidity3hChange);
+}
+
+// alert windows: the running sums against a build from scratch as alertWindowBuild() does it
+static void simCheckAlerts(void (*printLine)(char*))
+{
+  static const uint8_t hours[] = ALERT_WINDOW_HOURS;
+  int32_t limit, sum[ALERT_NUM_CHANNELS];
+  int w, i, oldest, count;
+
+  for(w=0; w<ALERT_NUM_WINDOWS; w++){
+    if(aData.win[w].oldest <= 0)
+      continue;
+    limit = (int32_t)hours[w] * 3600 + wData.targetMeasurementIntervalSec / 2;
+    for(i=noDataPoints-1; i>0 && wData.ageOfDatapoint[i-1] <= limit; i--);
+    while(i < noDataPoints-1 && (wData.ageOfDatapoint[i] > limit || !simValid(wData.pressHistory[i])
+          || !simValid(wData.tempHistory[i]) || !simValid(wData.humiHistory[i])))
+      i++;
+    oldest = i;
+    count = 0;
+    memset(sum, 0, sizeof(sum));
+    for(; i<noDataPoints; i++){
+      if(!simValid(wData.pressHistory[i]) || !simValid(wData.tempHistory[i]) || !simValid(wData.humiHistory[i]))
+        continue;
+      sum[ALERT_CH_PRESSURE] += lroundf(wData.pressHistory[i] * 100.0);
+      sum[ALERT_CH_TEMPERATURE] += lroundf(wData.tempHistory[i] * 100.0);
+      sum[ALERT_CH_HUMIDITY] += (int32_t)wData.humiHistory[i] * 10;
+      count++;
+    }
+    if(aData.win[w].oldest != oldest || aData.win[w].count != count
+       || memcmp(aData.win[w].sum, sum, sizeof(sum)) != 0){
+      simViolation(SIM_INV_ALERT, printLine, "window %d h: oldest %d count %d P %ld, rebuilt oldest %d count %d P %ld",
+        hours[w], aData.win[w].oldest, aData.win[w].count, (long)aData.win[w].sum[ALERT_CH_PRESSURE],
+        oldest, count, (long)sum[ALERT_CH_PRESSURE]);
+      return;
+    }
+  }
+}
+
+// energy model: charge of the wakes as estimated by the firmware against the simulated charge,
+// separately for wakes with and without panel refresh, and the estimated mAh per day
+static void simCheckEnergy(void (*printLine)(char*))
+{
+  static const char* types[2] = { "without", "with" };
+  double error;
+  int d;
+
+  if(simStats.chargeMah > 0 && fabs(simStats.estimateMah / simStats.chargeMah - 1.0) > SIM_TOL_ENERGY)
+    simViolation(SIM_INV_ENERGY, printLine, "estimate %.1f mAh, simulated %.1f mAh",
+      simStats.estimateMah, simStats.chargeMah);
+
+  for(d=0; d<2; d++){
+    if(simStats.energyWakes[d] == 0 || simStats.wakeMaSec[d] <= 0)
+      continue;
+    error = simStats.estimateMaSec[d] / simStats.wakeMaSec[d] - 1.0;
+    if(fabs(error) > SIM_TOL_ENERGY)
+      simViolation(SIM_INV_ENERGY, printLine, "wakes %s refresh: estimate %.1f mAs/wake, simulated %.1f mAs/wake",
+        types[d], simStats.estimateMaSec[d] / simStats.energyWakes[d], simStats.wakeMaSec[d] / simStats.energyWakes[d]);
+  }
+}
+
+//************** run *************************/
+void simDefaultConfig(simConfig* c)
+{
+  memset(c, 0, sizeof(simConfig));
+  c->days = SIM_DEFAULT_DAYS;
+  c->seed = SIM_SEED;
+  c->scenario = SIM_SC_MIXED;
+  c->driftPpm = SIM_DRIFT_PPM;
+  c->pressPerDay = SIM_PRESS_PER_DAY;
+  c->sessionsPerDay = SIM_SESSIONS_PER_DAY;
+}
+
+// next random button press: graph type or time range
+static uint64_t simPlanPress(const simConfig* c, uint64_t afterUs)
+{
+  uint64_t atUs = simNextEvent(afterUs, c->pressPerDay > 0 ? 1.0 / c->pressPerDay : 0);
+
+  if(atUs != UINT64_MAX)
+    hostPress(simButtons[simUniform() < 0.5 ? 1 : 2], atUs, 100);
+  return(atUs);
+}
+
+// next random bluetooth session: long press of the configuration button
+static uint64_t simPlanSession(const simConfig* c, uint64_t afterUs)
+{
+  uint64_t atUs = simNextEvent(afterUs, c->sessionsPerDay > 0 ? 1.0 / c->sessionsPerDay : 0);
+
+  if(atUs != UINT64_MAX)
+    hostPress(simButtons[0], atUs, BTN_LONG_MS + 500);
+  return(atUs);
+}
+
+/**************************************************!
+   @brief    simRun()
+   @details  power on, then wakes until the simulated time or the number of wakes is
+   @details  reached. Statistics in simStats, hostStats
+   @param    c: options
+   @param    printLine: output of violations and of the day lines (verbose)
+   @return   bool: false if the firmware did not reach the deep sleep or cannot wake
+***************************************************/
+bool simRun(const simConfig* c, void (*printLine)(char*))
+{
+  char line[maxLOG_STRING_LEN];
+  uint8_t calib00[26], calib26[7];
+  uint64_t endUs, startUs, pressUs, sessionUs, wakeUs, lastMeasUs = 0;
+  int64_t wakeRtcUs, errUs, lastRtcUs = 0;
+  double capacityMah = BATTERY_CAPACITY_MAH, remainingMah = capacityMah, wakeMaSec, maSec, drift;
+  int32_t sleepPpm = 0, intervalSec = 0;
+  uint32_t day = 0, dayWakes = 0;
+  hostStatistics before;
+  hostWakeInfo w;
+  struct timeval tv;
+  simWeather weather;
+  bool measured, refreshed, lastTimer = false, interrupted = false;
+
+  memset(&simStats, 0, sizeof(simStats));
+  simWeatherBegin(c->seed, c->scenario);
+  bmeFakeSetAbsent(false);
+  bmeFakeBus.read(BME_I2C_ADDR, BME_REG_CALIB00, calib00, sizeof(calib00));
+  bmeFakeBus.read(BME_I2C_ADDR, BME_REG_CALIB26, calib26, sizeof(calib26));
+  bmeParseCalib(calib00, calib26, &simCalib);
+
+  startUs = hostWorldUs();
+  endUs = startUs + (uint64_t)c->days * (uint64_t)US_PER_DAY;
+  pressUs = simPlanPress(c, startUs);
+  sessionUs = simPlanSession(c, startUs);
+  while(hostWorldUs() < endUs && (c->maxWakes == 0 || simStats.wakes < c->maxWakes)){
+    // inputs of this wake
+    simWeatherAt(hostWorldUs() - startUs, &weather);
+    simSetSensor(&weather);
+    hostSetAnalogMv(VOLTAGE_PIN, simBatteryMv(1000.0 * remainingMah / capacityMah) / BAT_DIVIDER);
+    drift = c->driftPpm + SIM_DRIFT_PPM_PER_K * (weather.temperature - 25.0);
+    hostSetRtcDriftPpm((int32_t)lround(drift));
+
+    simBefore = wData;
+    before = hostStats;
+    gettimeofday(&tv, NULL);          // RTC of the simulated chip at the wakeup
+    wakeRtcUs = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    wakeUs = hostWorldUs();
+    bool ok = hostWake(&w);
+    simStats.wakes++;
+    dayWakes++;
+    if(w.cause == ESP_SLEEP_WAKEUP_EXT1)
+      simStats.buttonWakes++;
+
+    // charge of the wake and of the following sleep
+    uint64_t lightUs = hostStats.lightSleepUs - before.lightSleepUs;
+    uint64_t panelUs = hostStats.panelBusyUs - before.panelBusyUs;
+    uint64_t radioUs = hostStats.radioUs - before.radioUs;
+    wakeMaSec = (w.awakeUs - std::min(lightUs, w.awakeUs)) / 1e6 * CURRENT_CPU_MA + lightUs / 1e6 * SIM_LIGHT_SLEEP_MA
+              + panelUs / 1e6 * CURRENT_PANEL_MA + radioUs / 1e6 * CURRENT_RADIO_MA;
+    maSec = wakeMaSec + (hostStats.deepSleepUs - before.deepSleepUs) / 1e6 * CURRENT_SLEEP_MA;
+    refreshed = hostStats.fullRefreshes + hostStats.partialRefreshes > before.fullRefreshes + before.partialRefreshes;
+    simStats.chargeMah += maSec / 3600.0;
+    simStats.estimateMah += eEstimate.mahPerDay * (w.awakeUs + hostStats.deepSleepUs - before.deepSleepUs) / US_PER_DAY;
+    remainingMah -= maSec / 3600.0;
+    if(remainingMah <= 0){      // empty: the user recharges
+      remainingMah = capacityMah;
+      simStats.recharges++;
+    }
+
+    if(!ok){
+      snprintf(line, sizeof(line), "sim: wake %u: %s", simStats.wakes, w.slept ? "no wakeup source" : "no deep sleep");
+      printLine(line);
+      return(false);
+    }
+
+    // invariants
+    measured = wData.lastMeasurementTimestamp.tv_sec != simBefore.lastMeasurementTimestamp.tv_sec
+            || wData.lastMeasurementTimestamp.tv_usec != simBefore.lastMeasurementTimestamp.tv_usec;
+    simCheckHistory(measured, printLine);
+    if(measured){
+      simStats.measurements++;
+      if(!weather.sensorOk)
+        simStats.dropoutWakes++;
+      simCheckAges(printLine);
+      simCheckValue(&weather, printLine);
+      simCheckStatistics(printLine);
+      simCheckAlerts(printLine);
+
+      // energy estimate of this wake, made before the refresh. Not after cold boot (no
+      // durations yet) and not at button wakes (feedback and BT session on top)
+      if(simStats.measurements > 2 && w.cause == ESP_SLEEP_WAKEUP_TIMER){
+        simStats.wakeMaSec[refreshed] += wakeMaSec;
+        simStats.estimateMaSec[refreshed] += refreshed ? eEstimate.wakeMaSecDisplay : eEstimate.wakeMaSecNoDisplay;
+        simStats.energyWakes[refreshed]++;
+      }
+
+      // interval between the wakeups of two measurements, timer wakes with the same target.
+      // Not the measurement timestamps: the time to the sample depends on the sampling profile.
+      // The RTC runs with the drifting slow clock, the true interval is longer by its drift
+      if(lastTimer && w.cause == ESP_SLEEP_WAKEUP_TIMER && intervalSec == simBefore.lastTargetSleeptime
+         && simStats.measurements > 2){
+        errUs = wakeRtcUs - lastRtcUs - (int64_t)intervalSec * 1000000;
+        simStats.maxIntervalErrUs = std::max(simStats.maxIntervalErrUs, (int64_t)llabs(errUs));
+        if(llabs(errUs) > (interrupted ? SIM_TOL_INTERRUPT_US : SIM_TOL_INTERVAL_US))
+          simViolation(SIM_INV_INTERVAL, printLine, "RTC interval %.3f s, target %ld s",
+            (wakeRtcUs - lastRtcUs) / 1e6, (long)intervalSec);
+        errUs = (int64_t)(wakeUs - lastMeasUs) - (int64_t)intervalSec * 1000000;
+        simStats.sumWorldErrPpm += errUs * 1.0 / intervalSec;
+        errUs -= (int64_t)intervalSec * sleepPpm;
+        simStats.maxWorldErrUs = std::max(simStats.maxWorldErrUs, (int64_t)llabs(errUs));
+        if(llabs(errUs) > SIM_TOL_WORLD_US)
+          simViolation(SIM_INV_WORLD, printLine, "true interval %.3f s, target %ld s, drift %ld ppm",
+            (wakeUs - lastMeasUs) / 1e6, (long)intervalSec, (long)sleepPpm);
+        simStats.checkedIntervals++;
+      }
+      lastRtcUs = wakeRtcUs;
+      lastMeasUs = wakeUs;
+      intervalSec = wData.lastTargetSleeptime;
+      lastTimer = (w.cause == ESP_SLEEP_WAKEUP_TIMER || w.cause == ESP_SLEEP_WAKEUP_UNDEFINED);
+      sleepPpm = (int32_t)lround(drift);
+      interrupted = false;
+    }
+    else{
+      interrupted = true;
+      if(wData.targetMeasurementIntervalSec != simBefore.targetMeasurementIntervalSec)
+        lastTimer = false;      // interval of the new time range starts with the next measurement
+    }
+
+    if(hostWorldUs() >= pressUs)
+      pressUs = simPlanPress(c, hostWorldUs());
+    if(hostWorldUs() >= sessionUs)
+      sessionUs = simPlanSession(c, hostWorldUs());
+
+    if(c->verbose && hostWorldUs() - startUs >= (day + 1) * (uint64_t)US_PER_DAY){
+      day++;
+      snprintf(line, sizeof(line), "sim: day %u: %.1f hPa %.1f °C %.0f %%%s, battery %u mV %.0f mAh, %u wakes, estimate %.1f mAh/day, interval %ld s",
+        day, weather.pressure, weather.temperature, weather.humidity, weather.sensorOk ? "" : " (dropout)",
+        simBatteryMv(1000.0 * remainingMah / capacityMah), remainingMah, dayWakes,
+        eEstimate.mahPerDay, (long)wData.targetMeasurementIntervalSec);
+      printLine(line);
+      dayWakes = 0;
+    }
+  }
+  simCheckEnergy(printLine);
+  return(true);
+}
+
+/**************************************************!
+   @brief    simReport()
+   @details  wakes, CPU time, simulated awake time, energy, intervals, invariants
+   @param    printLine : function to output one line of text
+   @return   void
+***************************************************/
+void simReport(void (*printLine)(char*))
+{
+  static const char* names[] = SIM_INVARIANT_NAMES;
+  char line[maxLOG_STRING_LEN];
+  double days = (hostStats.awakeUs + hostStats.deepSleepUs) / US_PER_DAY;
+  double cpuSec = (double)clock() / CLOCKS_PER_SEC;
+  uint32_t n = std::max(simStats.wakes, (uint32_t)1);
+  int i;
+
+  snprintf(line, sizeof(line), "sim: %.1f days, %u wakes (%u measurements, %u button wakes, %u measurements in dropouts)",
+    days, simStats.wakes, simStats.measurements, simStats.buttonWakes, simStats.dropoutWakes);
+  printLine(line);
+  snprintf(line, sizeof(line), "sim: CPU %.1f s (firmware %.1f s), %.0f us/wake, %.0f wakes/s, %.0f x real time",
+    cpuSec, hostStats.cpuNs / 1e9, cpuSec * 1e6 / n, n / std::max(cpuSec, 1e-6),
+    days * 86400.0 / std::max(cpuSec, 1e-6));
+  printLine(line);
+  snprintf(line, sizeof(line), "sim: awake %.0f s (%.1f ms/wake, light sleep %.0f s), %u full / %u partial refreshes, %u NVS writes",
+    hostStats.awakeUs / 1e6, hostStats.awakeUs / 1e3 / n, hostStats.lightSleepUs / 1e6,
+    hostStats.fullRefreshes, hostStats.partialRefreshes, hostStats.nvsWrites);
+  printLine(line);
+  snprintf(line, sizeof(line), "sim: energy %.1f mAh, %.2f mAh/day (firmware estimate %.2f mAh/day), %u recharges of %.0f mAh",
+    simStats.chargeMah, simStats.chargeMah / std::max(days, 1e-6), simStats.estimateMah / std::max(days, 1e-6),
+    simStats.recharges, (double)BATTERY_CAPACITY_MAH);
+  printLine(line);
+  snprintf(line, sizeof(line), "sim: radio on %.0f s in bluetooth sessions", hostStats.radioUs / 1e6);
+  printLine(line);
+  snprintf(line, sizeof(line), "sim: wake charge %.1f / %.1f mAs without / with refresh, firmware estimate %.1f / %.1f mAs",
+    simStats.wakeMaSec[0] / std::max(simStats.energyWakes[0], (uint32_t)1),
+    simStats.wakeMaSec[1] / std::max(simStats.energyWakes[1], (uint32_t)1),
+    simStats.estimateMaSec[0] / std::max(simStats.energyWakes[0], (uint32_t)1),
+    simStats.estimateMaSec[1] / std::max(simStats.energyWakes[1], (uint32_t)1));
+  printLine(line);
+  snprintf(line, sizeof(line), "sim: %u intervals, max error %.1f ms RTC, %.1f ms true (after drift), mean true error %+.0f ppm",
+    simStats.checkedIntervals, simStats.maxIntervalErrUs / 1e3, simStats.maxWorldErrUs / 1e3,
+    simStats.checkedIntervals ? simStats.sumWorldErrPpm / simStats.checkedIntervals : 0.0);
+  printLine(line);
+  for(i=0; i<SIM_NUM_INVARIANTS; i++){
+    snprintf(line, sizeof(line), "sim: invariant %-15s %u violations", names[i], simStats.violations[i]);
+    printLine(line);
+  }
+}
+
+//************** host program *************************/
+static void simPrintLine(char* line)
+{
+  puts(line);
+}
+
+/**************************************************!
+   simulator main program (env:sim_native, needs -D HOST_NO_MAIN)
+     -d <days>           simulated time, default SIM_DEFAULT_DAYS
+     -n <wakes>          stop after this number of wakes
+     -s <seed>           random numbers of weather and buttons
+     -c <scenario>       mixed, diurnal, front, storm, dropout
+     -r <ppm>            RTC slow clock error at 25 °C
+     -u <presses/day>    random button presses, 0: none
+     -b <sessions/day>   random bluetooth sessions, 0: none
+     -v                  one line per simulated day
+     -j <file>           journal file, default sim_journal.bin, emptied at start
+     -p <file.pbm>       panel image at the end
+   Exit code 1 if an invariant has been violated, 2 if the firmware stopped waking up
+***************************************************/
+int main(int argc, char** argv)
+{
+  static const char* scenarios[] = SIM_SCENARIO_NAMES;
+  const char* journalPath = "sim_journal.bin";
+  const char* panelPath = NULL;
+  simConfig c;
+  uint32_t violations = 0;
+  bool ok;
+  int opt, i;
+
+  simDefaultConfig(&c);
+  while((opt = getopt(argc, argv, "d:n:s:c:r:u:b:vj:p:")) != -1){
+    switch(opt){
+      case 'd': c.days = strtoul(optarg, NULL, 10); break;
+      case 'n': c.maxWakes = strtoul(optarg, NULL, 10); break;
+      case 's': c.seed = strtoul(optarg, NULL, 10); break;
+      case 'c':
+        for(i=0; i<SIM_NUM_SCENARIOS && strcmp(optarg, scenarios[i]) != 0; i++);
+        if(i == SIM_NUM_SCENARIOS){
+          fprintf(stderr, "scenarios: mixed, diurnal, front, storm, dropout\n");
+          return(2);
+        }
+        c.scenario = i;
+        break;
+      case 'r': c.driftPpm = strtol(optarg, NULL, 10); break;
+      case 'u': c.pressPerDay = atof(optarg); break;
+      case 'b': c.sessionsPerDay = atof(optarg); break;
+      case 'v': c.verbose = true; break;
+      case 'j': journalPath = optarg; break;
+      case 'p': panelPath = optarg; break;
+      default:
+        fprintf(stderr, "usage: %s [-d days] [-n wakes] [-s seed] [-c scenario] [-r ppm] [-u presses/day] [-b sessions/day] [-v] [-j journal] [-p panel.pbm]\n", argv[0]);
+        return(2);
+    }
+  }
+
+  hostSerialEcho(false);
+  hostPowerOn();
+  remove(journalPath);
+  if(!journalUseFile(journalPath)){
+    fprintf(stderr, "cannot open %s\n", journalPath);
+    return(2);
+  }
+  printf("sim: scenario %s, seed %u, %u days, drift %ld ppm + %d ppm/K, %.1f button presses/day, %.1f sessions/day\n",
+    scenarios[c.scenario], c.seed, c.days, (long)c.driftPpm, SIM_DRIFT_PPM_PER_K, c.pressPerDay, c.sessionsPerDay);
+  ok = simRun(&c, simPrintLine);
+  simReport(simPrintLine);
+  if(panelPath != NULL && !hostPanelDump(panelPath))
+    fprintf(stderr, "cannot write %s\n", panelPath);
+  for(i=0; i<SIM_NUM_INVARIANTS; i++)
+    violations += simStats.violations[i];
+  return(!ok ? 2 : (violations > 0 ? 1 : 0));
+}
+
+#endif // SIM && HOST_NATIVE
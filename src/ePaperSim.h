@@ -0,0 +1,111 @@
+#ifndef _ePaperSim_H
+#define _ePaperSim_H
+
+// wake-cycle simulator (-D SIM, host only): runs the unchanged firmware through months of
+// wakes on the virtual clock of the host shim. Synthetic weather (slow pressure anomaly,
+// pressure tide, diurnal and seasonal temperature, humidity from the dew point, fronts,
+// storms, sensor dropouts) is fed to the BME280 fake as raw values, inverted through the
+// compensation formulas with the calibration of the fake. The battery is discharged by the
+// charge of each wake and recharged when empty, the RTC slow clock drifts with temperature,
+// buttons are pressed at random, bluetooth sessions (radio on) are started at random. After every wake invariants are checked: measurement
+// interval against the target, shift of the history, newest point against the weather and
+// no invalid value (nanDATA, NaN) in min / max, 3 h changes and the alert window sums. At the
+// end the wake charge estimated by the energy model is compared with the simulated one.
+// All random numbers come from one seed: two runs with the same options give the same wakes.
+
+#include <stdint.h>
+
+//************** module defines *************************/
+#define SIM_DEFAULT_DAYS      90
+#define SIM_SEED              4711
+#define SIM_START_DAY         0         // day of the year at the start, 0: 1 January
+#define SIM_DRIFT_PPM         200       // RTC slow clock error at 25 °C, > 0: sleeps too long
+#define SIM_DRIFT_PPM_PER_K   10        // temperature coefficient of the slow clock
+#define SIM_PRESS_PER_DAY     1.0       // random button presses per day (graph type, time range)
+#define SIM_SESSIONS_PER_DAY  0.2       // random bluetooth sessions per day: long press, no client connects
+#define SIM_LIGHT_SLEEP_MA    0.8       // current in light sleep, the other currents from ePaperEnergy.h
+
+// invariant limits
+#define SIM_TOL_INTERVAL_US   50000     // RTC interval between measurements vs. target
+#define SIM_TOL_INTERRUPT_US  1000000   // same, sleep interrupted by a button: the firmware aims
+                                        // the rest of the sleep at the last measurement, not the wake
+#define SIM_TOL_WORLD_US      1000000   // true interval vs. target, in addition to the drift
+#define SIM_TOL_PRESSURE      0.1       // hPa, newest history point vs. weather
+#define SIM_TOL_TEMPERATURE   0.05      // °C
+#define SIM_TOL_HUMIDITY      1         // promille
+#define SIM_TOL_ENERGY        0.1       // relative, charge of the wakes estimated by the firmware vs. simulated
+#define SIM_MAX_REPORTS       5         // violations printed per invariant, the others only counted
+
+// weather scenarios
+#define SIM_SC_MIXED          0         // all of the following
+#define SIM_SC_DIURNAL        1         // calm: tide, diurnal cycle, slow anomaly only
+#define SIM_SC_FRONT          2         // a frontal passage every few days
+#define SIM_SC_STORM          3         // deep, fast lows with gusts
+#define SIM_SC_DROPOUT        4         // calm weather, frequent sensor dropouts
+#define SIM_NUM_SCENARIOS     5
+#define SIM_SCENARIO_NAMES    { "mixed", "diurnal", "front", "storm", "dropout" }
+
+// invariants
+#define SIM_INV_INTERVAL      0         // RTC time between two measurements = target
+#define SIM_INV_WORLD         1         // true time between two measurements = target + drift
+#define SIM_INV_SHIFT         2         // history shifted by one point, ages by the interval
+#define SIM_INV_AGES          3         // ages ascending to the oldest point, newest 0
+#define SIM_INV_VALUE         4         // newest point = weather, invalid after a dropout
+#define SIM_INV_STATS         5         // no invalid value in min / max and 3 h changes
+#define SIM_INV_ALERT         6         // alert window sums = sums over the history
+#define SIM_INV_ENERGY        7         // energy model = simulated: mAh/day, wake charge per refresh type
+#define SIM_NUM_INVARIANTS    8
+#define SIM_INVARIANT_NAMES   { "interval", "world interval", "history shift", "ages", \
+                                "newest value", "statistics", "alert sums", "energy estimate" }
+
+//************** module global variables *************************/
+// weather at one point in time, as the sensor sees it
+struct simWeather
+{
+  double pressure;              // hPa
+  double temperature;           // °C
+  double humidity;              // %
+  bool sensorOk;                // false: sensor does not acknowledge (dropout)
+};
+
+// options of a run
+struct simConfig
+{
+  uint32_t days;                // simulated time
+  uint32_t maxWakes;            // 0: no limit
+  uint32_t seed;
+  uint8_t scenario;             // SIM_SC_xxx
+  int32_t driftPpm;             // slow clock error at 25 °C
+  float pressPerDay;            // random button presses
+  float sessionsPerDay;         // random bluetooth sessions (until the timeout of the session)
+  bool verbose;                 // one line per simulated day
+};
+
+// result of a run
+struct simStatistics
+{
+  uint32_t wakes;
+  uint32_t measurements;
+  uint32_t buttonWakes;
+  uint32_t dropoutWakes;        // measurements while the sensor was missing
+  uint32_t checkedIntervals;    // intervals compared with the target
+  int64_t maxIntervalErrUs;     // largest |RTC interval - target|
+  int64_t maxWorldErrUs;        // largest |true interval - target - drift|
+  double sumWorldErrPpm;        // mean of (true interval - target) / target
+  double chargeMah;             // drawn from the battery, whole run
+  double estimateMah;           // same, mAh/day estimated by the firmware over the time it was valid
+  double wakeMaSec[2];          // charge of the measurement wakes without / with refresh, simulated
+  double estimateMaSec[2];      // same, estimated by the firmware (eEstimate of the wake)
+  uint32_t energyWakes[2];
+  uint32_t recharges;
+  uint32_t violations[SIM_NUM_INVARIANTS];
+};
+extern simStatistics simStats;
+
+//************** function prototypes *************************/
+void simDefaultConfig(simConfig* c);
+void simWeatherAt(uint64_t worldUs, simWeather* w);   // weather of the scenario, call with ascending times
+bool simRun(const simConfig* c, void (*printLine)(char*));  // false if the firmware stopped waking up
+void simReport(void (*printLine)(char*));
+
+#endif // _ePaperSim_H
@@ -0,0 +1,104 @@
+/**************************************************!
+   binary trace ring in RTC memory
+   a record costs a few µs, a text line at 115200 baud about 87 µs per
+   character. Text output is opt-in (-D LOG_TEXT), the trace is always on.
+   Dump format, one line each:
+     TRACE BEGIN <wakes> <count>
+     TRACE <16 hex digits: record bytes in memory order>   (oldest first)
+     TRACE END
+***************************************************/
+
+#include <Arduino.h>
+
+#include "global.h"
+#include "ePaperTrace.h"
+
+// trace ring, in RTC memory which survives the deep sleep. Zero after power on
+RTC_DATA_ATTR traceRing tRing;
+
+/**************************************************!
+   @brief    traceClear()
+   @details  clear all records
+***************************************************/
+void traceClear()
+{
+  uint32_t wakes = (tRing.magic == TRACE_MAGIC) ? tRing.wakes : 0;
+
+  memset(&tRing, 0, sizeof(tRing));
+  tRing.magic = TRACE_MAGIC;
+  tRing.wakes = wakes;
+}
+
+/**************************************************!
+   @brief    traceBegin()
+   @details  at wake start: initialize after cold boot, count the wake
+   @return   void
+***************************************************/
+void traceBegin()
+{
+  if(tRing.magic != TRACE_MAGIC || tRing.next >= TRACE_RECORDS || tRing.count > TRACE_RECORDS)
+    traceClear();
+  tRing.wakes++;
+}
+
+/**************************************************!
+   @brief    saturate()
+   @return   int16_t: value limited to the int16 range
+***************************************************/
+static int16_t saturate(int32_t v)
+{
+  if(v > 32767) return(32767);
+  if(v < -32768) return(-32768);
+  return((int16_t)v);
+}
+
+/**************************************************!
+   @brief    trace()
+   @details  add a record, overwrites the oldest if the ring is full
+   @param    event: TR_xxx
+   @param    arg0, arg1: arguments, saturated to int16
+   @return   void
+***************************************************/
+void trace(uint8_t event, int32_t arg0, int32_t arg1)
+{
+  traceRecord* r;
+  uint32_t ms = millis();
+
+  if(tRing.magic != TRACE_MAGIC)
+    traceBegin();
+  r = &tRing.rec[tRing.next];
+  r->event = event;
+  r->wake = (uint8_t)tRing.wakes;
+  r->msec = (ms > 65535) ? 65535 : (uint16_t)ms;
+  r->arg[0] = saturate(arg0);
+  r->arg[1] = saturate(arg1);
+  tRing.next = (tRing.next + 1) % TRACE_RECORDS;
+  if(tRing.count < TRACE_RECORDS) tRing.count++;
+}
+
+/**************************************************!
+   @brief    traceDrain()
+   @details  dump the ring as hex lines, oldest first, for tools/traceDecode.cpp.
+   @details  The ring is kept, "ATY" can be repeated
+   @param    printLine : function to output one line of text (serial, bluetooth)
+   @return   void
+***************************************************/
+void traceDrain(void (*printLine)(char*))
+{
+  char line[maxLOG_STRING_LEN];
+  const uint8_t* b;
+  int i, j, idx, len;
+
+  snprintf(line, sizeof(line), "%s BEGIN %lu %d", TRACE_LINE_PREFIX, (unsigned long)tRing.wakes, tRing.count);
+  printLine(line);
+  for(i=0; i<tRing.count; i++){
+    idx = (tRing.next + TRACE_RECORDS - tRing.count + i) % TRACE_RECORDS;
+    b = (const uint8_t*)&tRing.rec[idx];
+    len = snprintf(line, sizeof(line), "%s ", TRACE_LINE_PREFIX);
+    for(j=0; j<(int)sizeof(traceRecord); j++)
+      len += snprintf(line+len, sizeof(line)-len, "%02X", b[j]);
+    printLine(line);
+  }
+  snprintf(line, sizeof(line), "%s END", TRACE_LINE_PREFIX);
+  printLine(line);
+}
@@ -0,0 +1,83 @@
+#ifndef _ePaperTrace_H
+#define _ePaperTrace_H
+
+// binary trace: event id, time since boot and two numeric arguments per record,
+// written into a ring in RTC memory instead of printing text at 115200 baud.
+// The ring is drained on demand (bluetooth "ATY", or 'T' sent to the USB serial port
+// during a wake) as hex lines, decoded by tools/traceDecode.cpp.
+// This header is also used by the host decoder: no Arduino dependencies.
+
+#include <stdint.h>
+
+//************** module defines *************************/
+#define TRACE_RECORDS       48            // 8 bytes each, about 6 wakes
+#define TRACE_MAGIC         0x54524331    // "TRC1", marks initialized RTC data
+#define TRACE_LINE_PREFIX   "TRACE"       // prefix of the hex lines of a dump
+
+// events: id, name, format of the two arguments for the decoder
+#define TRACE_EVENTS(X) \
+  X(TR_WAKE,        "wake",       "cause %d counter %d")              \
+  X(TR_NOT_READY,   "notReady",   "elapsed %d s sleep %d s")          \
+  X(TR_MEASURE,     "measure",    "pressure %d/10 hPa temp %d/100 C") \
+  X(TR_HUMIDITY,    "humidity",   "humidity %d/10 %% quality 0x%02X") \
+  X(TR_BME_FAIL,    "bmeFail",    "samples %d failed %d")             \
+  X(TR_BATTERY,     "battery",    "%d mV soc %d/10 %%")               \
+  X(TR_DS18B20,     "ds18b20",    "ch0 %d/10 C ch1 %d/10 C")          \
+  X(TR_REFRESH,     "refresh",    "graphics %d multiplier %d")        \
+  X(TR_SKIP,        "skipped",    "counter %d multiplier %d")         \
+  X(TR_JOURNAL,     "journal",    "ok %d appends %d")                 \
+  X(TR_PREFS,       "prefs",      "written %d generation %d")             \
+  X(TR_BT_CMD,      "btCommand",  "command %c length %d")              \
+  X(TR_SLEEP,       "sleep",      "sleep %d s awake %d ms")           \
+  X(TR_BT_SESSION,  "btSession",  "%d s %d command lines")         \
+  X(TR_BEACON,      "beacon",     "advertising %d ms total %d ms")    \
+  X(TR_BUTTON,      "button",     "press %d first pixel %d ms")      \
+  X(TR_KEY,         "key",        "button %d press %d")               \
+  X(TR_ALERT,       "alert",      "rule %d value %d/10")              \
+  X(TR_ALERT_CLEAR, "alertClear", "rule %d value %d/10")
+
+#define TRACE_ENUM(id, name, format) id,
+enum traceEvent { TRACE_EVENTS(TRACE_ENUM) TR_NUM_EVENTS };
+#undef TRACE_ENUM
+
+//************** module global variables *************************/
+// one trace record, 8 bytes
+struct traceRecord
+{
+  uint8_t event;        // traceEvent
+  uint8_t wake;         // wake number, low 8 bits
+  uint16_t msec;        // ms since boot, saturating at 65535
+  int16_t arg[2];       // event arguments
+};
+
+// ring, stored in RTC memory which survives deep sleep
+struct traceRing
+{
+  uint32_t magic;       // TRACE_MAGIC if initialized
+  uint16_t next;        // index of next record
+  uint16_t count;       // valid records, up to TRACE_RECORDS
+  uint32_t wakes;       // wakes since cold boot
+  traceRecord rec[TRACE_RECORDS];
+};
+
+//************** function prototypes *************************/
+void traceBegin();                                // at wake start: init after cold boot, count wake
+void trace(uint8_t event, int32_t arg0, int32_t arg1);  // add record, arguments saturated to int16
+void traceDrain(void (*printLine)(char*));        // dump ring as hex lines, oldest first
+void traceClear();
+
+// name and argument format of an event, for the decoder
+#define TRACE_NAME_CASE(id, name, format) case id: return(name);
+#define TRACE_FORMAT_CASE(id, name, format) case id: return(format);
+inline const char* traceEventName(uint8_t event)
+{
+  switch(event){ TRACE_EVENTS(TRACE_NAME_CASE) default: return("?"); }
+}
+inline const char* traceEventFormat(uint8_t event)
+{
+  switch(event){ TRACE_EVENTS(TRACE_FORMAT_CASE) default: return("%d %d"); }
+}
+#undef TRACE_NAME_CASE
+#undef TRACE_FORMAT_CASE
+
+#endif // _ePaperTrace_H
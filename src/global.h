@@ -3,13 +3,22 @@
 #ifndef _global_H
 #define _global_H
 
+#include <stdarg.h>
+#include <type_traits>
+
 /***************** global defines */
 #define noDataPoints 336        // number of measurement data points stored. 84 h every 15 min
 #define offsetData72hGraph 48   // number of points to be ignored at the beginning of arrays if 72 hour graph
 #define nanDATA 11111           // this value marks a data point as invalid and not to be shown
 #undef showSimpleData           // no simple data display, but full graphics
 #undef extendedDEBUG_OUTPUT     // print more stuff
-#define logLEVEL 2              // any output with log level <= this number is logged
+// any output with log level <= logLEVEL is logged as text. Text is opt-in (-D LOG_TEXT),
+// otherwise only errors: the wake is traced in the binary trace ring (ePaperTrace.h)
+#ifdef LOG_TEXT
+  #define logLEVEL 2
+#else
+  #define logLEVEL 1
+#endif
 #define maxLOG_STRING_LEN 240   // max len of logstring
 
 extern RTC_DATA_ATTR uint32_t fgndColor;
@@ -23,7 +32,8 @@ extern RTC_DATA_ATTR uint32_t bgndColor;
 #define maxSleeptimeSafetyLimit 2000000000 // safety limit: no sleep above 2000 sec
 #define d_timeRangeHours 21 //84
 #define d_applyInversion false
-#define d_graphicsType 7;  // 0: pressure, 1: temperature, 2: humidity
+#define d_graphicsType 7   // 0: pressure, 1: temperature, 2: humidity
+#define d_targetLifetimeDays 120 // target lifetime in days for one battery charge. 0: no lifetime policy
 
 //*************** global global variables ******************/
 extern char outstring[maxLOG_STRING_LEN];
@@ -33,7 +43,7 @@ struct measurementData
   // admin stuff
   bool justInitialized;   // indicator for the fact that software has just been initialized (test data)
   bool dataPresent;       // for simulation. do not create simulation data if this is true
-  int32_t graphicsType; // determine which graph is shown  0: pressure, 1: temperature, 2: humidity
+  int32_t graphicsType; // determine which graph is shown  0: pressure, 1: temperature, 2: humidity ... 8: diagnostics
   int32_t startCounter;    // total counter for starts of ESP32
   int32_t dischgCnt;    // counter for starts of ESP32 since last charge
   struct timeval lastMeasurementTimestamp;  // time value when last measurement has been taken
@@ -42,9 +52,7 @@ struct measurementData
   bool preferencesChanged; // determines if preference values have been changed and must be saved
   bool applyPressureCorrection; // false: station mode, true: corrected to sea level
   bool applyInversion;   // if true, white on black. otherwise black on white
-
-  bool buttonPressed;    // remembers if button has been pressed to acknowledge an alert
-  bool alertON;          // remembers if an alert has been triggered
+  int32_t targetLifetimeDays; // target lifetime of a battery charge, controls display refresh multiplier
 
   int32_t targetMeasurementIntervalSec;    // sleep time target in seconds, controls the measurement
   int32_t lastTargetSleeptime;             // last target standard sleep time in seconds
@@ -75,6 +83,7 @@ struct measurementData
   float actPressureCorr;  // corrected pressure, pressureCorrValue applied
   float actTemperature;   // temperature as read by the sensor
   int16_t actHumidity=0;      // humidity as read by the sensor. Stored in promille as integer!
+  uint8_t actQuality;     // quality flags of the measurement, QUAL_xxx in ePaperAcquisition.h
   const char* pressureUnit = "hPa";
   const char* humidityUnit = "%";
   const char* temperatureUnit ="°C";
@@ -95,6 +104,7 @@ struct measurementData
   float pressHistory[noDataPoints];   // pressure data points in the past in hPa, not corrected
   int16_t humiHistory[noDataPoints];  // humidity data points in the past  in %
   float tempHistory[noDataPoints];    // temperature data points in the past in °C
+  uint8_t qualHistory[noDataPoints];  // quality flags of the data points, QUAL_xxx
 
 };
 extern RTC_DATA_ATTR measurementData wData;
@@ -114,11 +124,38 @@ void writePreferences();
   void bleConfigMain() ;
 #endif 
 void drawBluetoothInfo(char* text, int mode);
+void drawButtonFeedback(const char* text);  // small partial window update at button wake
 void quarterMeasurementScale();
 void halfMeasurementScale();
 void quadrupleMeasurementScale();
 void doubleMeasurementScale();
-void logOut(int logLevel, char* str);
-void buzzer(uint16_t number, uint16_t duration, uint16_t interval);
+
+//*************** logging ******************/
+// logOut<level>(format, args...): printf style log output, formatted directly into the
+// local buffer of logWriteV(). Statements with level > logLEVEL compile to nothing,
+// their arguments are not formatted. Both are declared as printf like, so the compiler
+// checks format and arguments of every statement, also of the filtered ones.
+void logWrite(const char* format, ...) __attribute__((format(printf, 1, 2)));
+void logWriteV(const char* format, va_list args);
+
+template<int level>
+typename std::enable_if<(level <= logLEVEL)>::type logOut(const char* format, ...)
+  __attribute__((format(printf, 1, 2)));
+template<int level>
+typename std::enable_if<(level <= logLEVEL)>::type logOut(const char* format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  logWriteV(format, args);
+  va_end(args);
+}
+
+// filtered: empty, always inlined, so no call and no argument passing remains
+template<int level>
+inline typename std::enable_if<(level > logLEVEL)>::type logOut(const char* format, ...)
+  __attribute__((format(printf, 1, 2), always_inline));
+template<int level>
+inline typename std::enable_if<(level > logLEVEL)>::type logOut(const char* format, ...) {}
 
 #endif // _global_H
\ No newline at end of file
@@ -0,0 +1,132 @@
+/**************************************************!
+   fuzz target of the command parser (ePaperCommand.cpp): cmdExecute() on any input,
+   which includes cmdParse() and cmdParseArg(). Besides memory errors (build with
+   sanitizers) it checks that a rejected batch changed no setting.
+   Not a pio test suite (no test_ prefix). Build from the repo root with this file and
+   all .cpp files of src and lib/hostshim/src, defines HOST_NATIVE LOLIN32_LITE PCB_BOARD
+   HOST_NO_MAIN, include paths src and lib/hostshim/src:
+   libFuzzer:          clang++ -std=gnu++11 -g -fsanitize=fuzzer,address,undefined ...; ./fuzzCommand
+   without libFuzzer:  g++ -std=gnu++11 -g -fsanitize=address,undefined -DFUZZ_STANDALONE ...
+                       ./fuzzCommand [iterations] [files...]: runs the given files, or random
+                       mutations of built in seeds (default 1000000)
+***************************************************/
+
+#include <Arduino.h>
+#include <stdlib.h>
+
+#include "global.h"
+#include "ePaperCommand.h"
+#include "ePaperAlert.h"
+
+// settings a command can change
+struct settingsSnapshot
+{
+  int32_t graphicsType, intervalSec, lifetimeDays;
+  bool inversion, correction;
+  float corrValue;
+  alertRule rules[ALERT_MAX_RULES];
+};
+
+static cmdContext ctx;
+
+static void fuzzLine(char* line) {}
+
+static void snapshot(settingsSnapshot* s)
+{
+  memset(s, 0, sizeof(*s));
+  s->graphicsType = wData.graphicsType;
+  s->intervalSec = wData.targetMeasurementIntervalSec;
+  s->lifetimeDays = wData.targetLifetimeDays;
+  s->inversion = wData.applyInversion;
+  s->correction = wData.applyPressureCorrection;
+  s->corrValue = wData.pressureCorrValue;
+  memcpy(s->rules, aData.rules, sizeof(s->rules));
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+  char line[CMD_MAX_LEN];
+  settingsSnapshot before, after;
+  int ret;
+
+  if(wData.targetMeasurementIntervalSec == 0){   // first input
+    hostSerialEcho(false);
+    wData.targetMeasurementIntervalSec = d_measIntervalSec;
+    ctx.replyLine = fuzzLine;
+    ctx.printLine = fuzzLine;
+  }
+  if(size > CMD_MAX_LEN - 1)          // the transport never passes more
+    size = CMD_MAX_LEN - 1;
+  memcpy(line, data, size);
+  line[size] = 0;
+  snapshot(&before);
+  ret = cmdExecute(line, &ctx);
+  snapshot(&after);
+  if(ret != CMD_OK && (ctx.executed != 0 || memcmp(&before, &after, sizeof(before)) != 0)){
+    fprintf(stderr, "rejected batch changed settings: %.*s\n", (int)size, (const char*)data);
+    abort();
+  }
+  if(ctx.exit)
+    ctx.exit = false;
+  return(0);
+}
+
+#ifdef FUZZ_STANDALONE
+static const char* seeds[] = {
+  "ATP", "ati", "ATI,1", "ATC,1", "ATD,-12.5", "ATS,42", "ATE,120", "ATQ", "ATR", "ATU", "ATV",
+  "ATA", "ATA,ACK", "ATA,2,OFF", "ATA,3,PF,1,1.5,0.3,60", "ATK", "ATW", "AT?",
+  "ATU;ATQ", "ATU;ATU;ATQ", "ATD,12.5;ATT;ATE,5000", " atd , 1e3 ;;", "ATS,21;ATV;ATV",
+};
+#define SEED_COUNT ((int)(sizeof(seeds) / sizeof(seeds[0])))
+
+// random edit of a seed: replace, insert or delete characters, or join two seeds
+static size_t mutate(char* buf, size_t cap)
+{
+  size_t len, i;
+  int edits = 1 + rand() % 4;
+  static const char alphabet[] = "ATatIDCSEQRUVPHAKXZ?,;.-+e0123456789 \t\r\nnNfF";
+
+  snprintf(buf, cap, "%s", seeds[rand() % SEED_COUNT]);
+  if(rand() % 4 == 0){
+    len = strlen(buf);
+    snprintf(buf + len, cap - len, ";%s", seeds[rand() % SEED_COUNT]);
+  }
+  len = strlen(buf);
+  while(edits-- > 0){
+    i = len ? rand() % (len + 1) : 0;
+    switch(rand() % 3){
+      case 0: if(i < len) buf[i] = (rand() % 8) ? alphabet[rand() % (sizeof(alphabet) - 1)] : (char)(rand() % 256); break;
+      case 1: if(len + 1 < cap){ memmove(buf + i + 1, buf + i, len - i + 1); buf[i] = alphabet[rand() % (sizeof(alphabet) - 1)]; len++; } break;
+      case 2: if(i < len){ memmove(buf + i, buf + i + 1, len - i); len--; } break;
+    }
+  }
+  return(len);
+}
+
+int main(int argc, char** argv)
+{
+  char buf[2 * CMD_MAX_LEN];
+  long n = (argc > 1) ? atol(argv[1]) : 1000000;
+  long i;
+  size_t len;
+  FILE* f;
+
+  hostPowerOn();
+  if(argc > 2){
+    for(i=2; i<argc; i++){
+      if((f = fopen(argv[i], "rb")) == NULL) continue;
+      len = fread(buf, 1, sizeof(buf), f);
+      fclose(f);
+      LLVMFuzzerTestOneInput((const uint8_t*)buf, len);
+    }
+    return(0);
+  }
+  srand(1);
+  for(i=0; i<n; i++){
+    len = mutate(buf, sizeof(buf));
+    LLVMFuzzerTestOneInput((const uint8_t*)buf, len);
+  }
+  printf("fuzz_command: %ld inputs, no failure\n", n);
+  return(0);
+}
+#endif // FUZZ_STANDALONE
@@ -0,0 +1,33 @@
+#ifndef _dischargeCurve_H
+#define _dischargeCurve_H
+
+// discharge curve of a 1S LiPo cell for test_battery.
+// This is a REFERENCE curve, not a recording of this barograph: there is no recorded
+// data yet. It is the typical open circuit voltage chart of a 1S LiPo cell in 5 % steps
+// (the source of the firmware table) for a 1000 mAh cell at the barograph's 6.6 mAh/day,
+// each step with a midpoint 4 mV below the straight line, as a cell deviating from the
+// chart. A recording replaces it in the same format: hours since full charge and
+// battery voltage (e.g. "ATB" output or the trace) at the constant mean load of the
+// barograph, the last point at the cutoff of 3.5 V. The true state of charge of a point
+// is the remaining share of the total time, as the load is constant.
+
+struct dischargePoint
+{
+  float hours;              // since full charge
+  uint16_t milliVolt;       // battery voltage
+};
+
+static const dischargePoint dischargeCurve[] = {
+  {    0.0, 4190 }, {   90.0, 4166 }, {  180.0, 4150 }, {  270.0, 4126 }, {  360.0, 4110 },
+  {  450.0, 4091 }, {  540.0, 4080 }, {  630.0, 4046 }, {  720.0, 4020 }, {  810.0, 3996 },
+  {  900.0, 3980 }, {  990.0, 3961 }, { 1080.0, 3950 }, { 1170.0, 3926 }, { 1260.0, 3910 },
+  { 1350.0, 3886 }, { 1440.0, 3870 }, { 1530.0, 3856 }, { 1620.0, 3850 }, { 1710.0, 3841 },
+  { 1800.0, 3840 }, { 1890.0, 3826 }, { 1980.0, 3820 }, { 2070.0, 3806 }, { 2160.0, 3800 },
+  { 2250.0, 3791 }, { 2340.0, 3790 }, { 2430.0, 3776 }, { 2520.0, 3770 }, { 2610.0, 3756 },
+  { 2700.0, 3750 }, { 2790.0, 3736 }, { 2880.0, 3730 }, { 2970.0, 3716 }, { 3060.0, 3710 },
+  { 3150.0, 3696 }, { 3240.0, 3690 }, { 3330.0, 3646 }, { 3420.0, 3610 }, { 3510.0, 3551 },
+  { 3600.0, 3500 },
+};
+#define DISCHARGE_CURVE_LEN (sizeof(dischargeCurve) / sizeof(dischargeCurve[0]))
+
+#endif // _dischargeCurve_H
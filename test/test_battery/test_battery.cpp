@@ -0,0 +1,95 @@
+/**************************************************!
+   host test of the battery module (ePaperBattery.cpp):
+   state of charge of the table against a discharge curve, measurement interval
+   pio test -e native -f test_battery
+***************************************************/
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "global.h"
+#include "ePaperBattery.h"
+#include "dischargeCurve.h"
+
+#define TEST_PIN            35
+#define SOC_MAX_ERROR       30        // permille, any point of the curve
+#define SOC_MEAN_ERROR      10        // permille, mean over the curve
+
+static void setBatteryMv(uint16_t milliVolt)
+{
+  hostSetAnalogMv(TEST_PIN, (milliVolt + BAT_DIVIDER/2) / BAT_DIVIDER);
+}
+
+void setUp(void)
+{
+  hostPowerOn();
+}
+
+void tearDown(void)
+{
+}
+
+//************** tests *************************/
+static void test_soc_table_shape(void)
+{
+  uint16_t mv, soc, prev = 0;
+
+  TEST_ASSERT_EQUAL_UINT16(0, batSocPermille(0));
+  TEST_ASSERT_EQUAL_UINT16(0, batSocPermille(3500));
+  TEST_ASSERT_EQUAL_UINT16(1000, batSocPermille(4190));
+  TEST_ASSERT_EQUAL_UINT16(1000, batSocPermille(4500));
+  for(mv=3400; mv<=4300; mv++){
+    soc = batSocPermille(mv);
+    TEST_ASSERT_TRUE(soc >= prev);
+    TEST_ASSERT_TRUE(soc <= 1000);
+    prev = soc;
+  }
+}
+
+static void test_soc_against_discharge_curve(void)
+{
+  const float total = dischargeCurve[DISCHARGE_CURVE_LEN-1].hours;
+  int32_t truth, err, maxErr = 0;
+  uint32_t i, sumErr = 0;
+  char line[80];
+
+  for(i=0; i<DISCHARGE_CURVE_LEN; i++){
+    setBatteryMv(dischargeCurve[i].milliVolt);
+    TEST_ASSERT_TRUE(batUpdate(TEST_PIN, true));
+    TEST_ASSERT_UINT32_WITHIN(1, dischargeCurve[i].milliVolt, batData.milliVolt);
+    truth = (int32_t)(1000.0 * (1.0 - dischargeCurve[i].hours / total) + 0.5);
+    err = abs((int32_t)batData.socPermille - truth);
+    if(err > maxErr) maxErr = err;
+    sumErr += err;
+  }
+  snprintf(line, sizeof(line), "SoC error over %u points: max %ld, mean %lu permille",
+    (unsigned)DISCHARGE_CURVE_LEN, (long)maxErr, (unsigned long)(sumErr / DISCHARGE_CURVE_LEN));
+  TEST_MESSAGE(line);
+  TEST_ASSERT_TRUE(maxErr <= SOC_MAX_ERROR);
+  TEST_ASSERT_TRUE(sumErr / DISCHARGE_CURVE_LEN <= SOC_MEAN_ERROR);
+}
+
+static void test_measure_interval(void)
+{
+  int i;
+
+  setBatteryMv(4000);
+  TEST_ASSERT_TRUE(batUpdate(TEST_PIN, false));     // cold boot: measured
+  setBatteryMv(3800);
+  for(i=1; i<BAT_MEASURE_INTERVAL-1; i++){
+    TEST_ASSERT_FALSE(batUpdate(TEST_PIN, false));  // value from RTC memory
+    TEST_ASSERT_EQUAL_UINT16(4000, batData.milliVolt);
+  }
+  TEST_ASSERT_TRUE(batUpdate(TEST_PIN, false));
+  TEST_ASSERT_EQUAL_UINT16(3800, batData.milliVolt);
+  TEST_ASSERT_EQUAL_UINT32(2, batData.measurements);
+}
+
+int main(int argc, char** argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_soc_table_shape);
+  RUN_TEST(test_soc_against_discharge_curve);
+  RUN_TEST(test_measure_interval);
+  return(UNITY_END());
+}
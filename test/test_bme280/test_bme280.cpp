@@ -0,0 +1,132 @@
+/**************************************************!
+   host test of the native BME280 driver (ePaperBME280.cpp) on the register level fake:
+   compensation against the datasheet example, I2C transactions per forced read,
+   behaviour with a missing sensor
+   pio test -e native -f test_bme280
+***************************************************/
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "global.h"
+#include "ePaperBME280.h"
+
+// datasheet BST-BME280-DS002 / BMP280 example: raw values and calibration of the fake
+#define EXAMPLE_ADC_T     519888
+#define EXAMPLE_ADC_P     415148
+#define EXAMPLE_T         2508        // 25.08 °C
+#define EXAMPLE_T_FINE    128422
+#define EXAMPLE_P_Q24_8   25767236    // 100653.27 Pa, 64 bit version
+#define EXAMPLE_P_TOL     4           // 0.016 Pa: the datasheet table rounds the intermediate values
+#define EXAMPLE_ADC_H     27000
+#define BUSY_POLLS        2           // status reads that return "measuring"
+
+static bool beginAndConfigure()
+{
+  return(bmeBegin(BME_I2C_ADDR, &bmeFakeBus)
+         && bmeSetSampling(BME_OSRS_X1, BME_OSRS_X1, BME_OSRS_X1, BME_FILTER_OFF));
+}
+
+void setUp(void)
+{
+  hostPowerOn();                        // RTC cache of calibration and configuration empty
+  bmeFakeSetAbsent(false);
+  bmeFakeSetRaw(EXAMPLE_ADC_T, EXAMPLE_ADC_P, EXAMPLE_ADC_H, BUSY_POLLS);
+}
+
+void tearDown(void)
+{
+  bmeFakeSetAbsent(false);
+}
+
+//************** tests *************************/
+static void test_compensation_datasheet_example(void)
+{
+  uint8_t calib00[26], calib26[7];
+  bmeCalib c;
+  int32_t tFine;
+
+  TEST_ASSERT_TRUE(bmeFakeBus.read(BME_I2C_ADDR, BME_REG_CALIB00, calib00, sizeof(calib00)));
+  TEST_ASSERT_TRUE(bmeFakeBus.read(BME_I2C_ADDR, BME_REG_CALIB26, calib26, sizeof(calib26)));
+  bmeParseCalib(calib00, calib26, &c);
+  TEST_ASSERT_EQUAL_UINT16(27504, c.dig_T1);
+  TEST_ASSERT_EQUAL_INT16(-7, c.dig_P6);
+  TEST_ASSERT_EQUAL_INT16(313, c.dig_H4);
+  TEST_ASSERT_EQUAL_INT16(50, c.dig_H5);
+
+  TEST_ASSERT_EQUAL_INT32(EXAMPLE_T, bmeCompensateT(EXAMPLE_ADC_T, &c, &tFine));
+  TEST_ASSERT_EQUAL_INT32(EXAMPLE_T_FINE, tFine);
+  TEST_ASSERT_UINT32_WITHIN(EXAMPLE_P_TOL, EXAMPLE_P_Q24_8, bmeCompensateP(EXAMPLE_ADC_P, &c, tFine));
+  // no datasheet example for humidity: plausible and within the range
+  TEST_ASSERT_UINT32_WITHIN(100 * 1024 / 2, 100 * 1024 / 2, bmeCompensateH(EXAMPLE_ADC_H, &c, tFine));
+  TEST_ASSERT_EQUAL_UINT32(0, bmeCompensateH(0, &c, tFine));
+  TEST_ASSERT_EQUAL_UINT32(100 * 1024, bmeCompensateH(65535, &c, tFine));
+}
+
+static void test_forced_read_through_the_bus(void)
+{
+  bmeReading r;
+
+  TEST_ASSERT_TRUE(beginAndConfigure());
+  TEST_ASSERT_TRUE(bmeStartForced());
+  TEST_ASSERT_TRUE(bmeReadForced(&r));
+  TEST_ASSERT_EQUAL_INT32(EXAMPLE_T, r.temperature);
+  TEST_ASSERT_UINT32_WITHIN(EXAMPLE_P_TOL, EXAMPLE_P_Q24_8, r.pressure);
+  TEST_ASSERT_TRUE(r.waitUsec <= bmeMaxMeasUsec(BME_OSRS_X1, BME_OSRS_X1, BME_OSRS_X1)
+                   + (BUSY_POLLS + 1) * BME_POLL_USEC);
+}
+
+static void test_transactions_per_forced_read(void)
+{
+  bmeReading r;
+
+  // cold boot: chip id, 2 calibration blocks, 4 register writes
+  TEST_ASSERT_TRUE(beginAndConfigure());
+  TEST_ASSERT_EQUAL_UINT32(3 + 4, bmeStats.transactions);
+
+  // warm wake: calibration and configuration from RTC memory, no transaction
+  TEST_ASSERT_TRUE(beginAndConfigure());
+  TEST_ASSERT_EQUAL_UINT32(0, bmeStats.transactions);
+
+  // start, status polls until ready, one burst read of all data registers
+  TEST_ASSERT_TRUE(bmeStartForced());
+  TEST_ASSERT_TRUE(bmeReadForced(&r));
+  TEST_ASSERT_EQUAL_UINT32(BUSY_POLLS + 1, bmeStats.polls);
+  TEST_ASSERT_EQUAL_UINT32(1 + (BUSY_POLLS + 1) + 1, bmeStats.transactions);
+}
+
+static void test_sensor_absent_at_cold_boot(void)
+{
+  bmeFakeSetAbsent(true);
+  TEST_ASSERT_FALSE(bmeBegin(BME_I2C_ADDR, &bmeFakeBus));
+  TEST_ASSERT_FALSE(bmeSetSampling(BME_OSRS_X1, BME_OSRS_X1, BME_OSRS_X1, BME_FILTER_OFF));
+  TEST_ASSERT_FALSE(bmeStartForced());
+
+  // sensor back: next begin reads the calibration
+  bmeFakeSetAbsent(false);
+  TEST_ASSERT_TRUE(beginAndConfigure());
+  TEST_ASSERT_EQUAL_UINT32(3 + 4, bmeStats.transactions);
+}
+
+static void test_sensor_dropout_after_configuration(void)
+{
+  bmeReading r;
+
+  TEST_ASSERT_TRUE(beginAndConfigure());
+  bmeFakeSetAbsent(true);
+  TEST_ASSERT_TRUE(beginAndConfigure());    // from RTC cache, the bus is not used
+  TEST_ASSERT_FALSE(bmeStartForced());
+  TEST_ASSERT_FALSE(bmeReadForced(&r));
+  TEST_ASSERT_FALSE(bmeIsMeasuring());
+}
+
+int main(int argc, char** argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_compensation_datasheet_example);
+  RUN_TEST(test_forced_read_through_the_bus);
+  RUN_TEST(test_transactions_per_forced_read);
+  RUN_TEST(test_sensor_absent_at_cold_boot);
+  RUN_TEST(test_sensor_dropout_after_configuration);
+  return(UNITY_END());
+}
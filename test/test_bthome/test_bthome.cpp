@@ -0,0 +1,97 @@
+/**************************************************!
+   host test of the BTHome v2 encoder (ePaperBTHome.cpp):
+   payload of known readings byte by byte, object order, buffer bound
+   pio test -e native -f test_bthome
+***************************************************/
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "ePaperBTHome.h"
+
+#define CANARY              0xA5
+
+// 1006.53 hPa, 25.08 °C, 39.1 %, 4.000 V, 78 %, -1.5 hPa in 3 h
+static const bthomeReadings reference = { 7, 78, 2508, 3910, 100653, 4000, -15 };
+
+static const uint8_t referenceAdv[] = {
+  0x02, 0x01, 0x06,                   // flags
+  0x18, 0x16, 0xD2, 0xFC,             // service data, UUID 0xFCD2
+  0x40,                               // BTHome v2, not encrypted
+  0x00, 0x07,                         // packet id
+  0x01, 0x4E,                         // battery 78 %
+  0x02, 0xCC, 0x09,                   // temperature 2508
+  0x03, 0x46, 0x0F,                   // humidity 3910
+  0x04, 0x2D, 0x89, 0x01,             // pressure 100653
+  0x0C, 0xA0, 0x0F,                   // voltage 4000 mV
+  0x5A, 0xF1, 0xFF                    // count sint16 -15
+};
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+//************** tests *************************/
+static void test_reference_payload(void)
+{
+  uint8_t adv[BTHOME_ADV_MAX];
+  int len;
+
+  len = bthomeEncode(&reference, adv, sizeof(adv));
+  TEST_ASSERT_EQUAL_INT(sizeof(referenceAdv), len);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(referenceAdv, adv, sizeof(referenceAdv));
+}
+
+static void test_structure(void)
+{
+  bthomeReadings r = { 255, 0, -4000, 10000, 1100000, 65535, -32768 };   // extremes of the types used
+  uint8_t adv[BTHOME_ADV_MAX];
+  int len, i, prevId = -1;
+
+  len = bthomeEncode(&r, adv, sizeof(adv));
+  TEST_ASSERT_TRUE(len > 0 && len <= BTHOME_ADV_MAX);
+  // AD structures fill the payload exactly
+  TEST_ASSERT_EQUAL_INT(len, 1 + adv[0] + 1 + adv[3]);
+  // objects: id and value, ids ascending as required by BTHome v2
+  for(i=8; i<len; ){
+    TEST_ASSERT_TRUE(adv[i] > prevId);
+    prevId = adv[i];
+    switch(adv[i]){
+      case BTHOME_PACKET_ID: case BTHOME_BATTERY:                   i += 2; break;
+      case BTHOME_TEMPERATURE: case BTHOME_HUMIDITY:
+      case BTHOME_VOLTAGE: case BTHOME_COUNT_S16:                   i += 3; break;
+      case BTHOME_PRESSURE:                                         i += 4; break;
+      default: TEST_FAIL_MESSAGE("unknown object id");
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(len, i);
+  // signed values two's complement, pressure 24 bit
+  TEST_ASSERT_EQUAL_HEX8(0x60, adv[13]);   // -4000 = 0xF060
+  TEST_ASSERT_EQUAL_HEX8(0xF0, adv[14]);
+  TEST_ASSERT_EQUAL_HEX8(0x10, adv[21]);   // 1100000 = 0x10C8E0, high byte
+}
+
+static void test_buffer_too_small(void)
+{
+  uint8_t adv[BTHOME_ADV_MAX + 1];
+  int n;
+
+  for(n=0; n<(int)sizeof(referenceAdv); n++){
+    memset(adv, CANARY, sizeof(adv));
+    TEST_ASSERT_EQUAL_INT(-1, bthomeEncode(&reference, adv, n));
+    TEST_ASSERT_EQUAL_HEX8(CANARY, adv[n]);     // nothing written behind maxLen
+  }
+}
+
+int main(int argc, char** argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_reference_payload);
+  RUN_TEST(test_structure);
+  RUN_TEST(test_buffer_too_small);
+  return(UNITY_END());
+}
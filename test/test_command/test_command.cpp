@@ -0,0 +1,197 @@
+/**************************************************!
+   host test of the command parser (ePaperCommand.cpp): tokenizing, argument
+   conversion, validation, and batches that are applied completely or not at all,
+   also if a command depends on the state the commands before it leave. Lines and
+   transport events in the session queue.
+   pio test -e native -f test_command
+***************************************************/
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "global.h"
+#include "ePaperCommand.h"
+
+static cmdContext ctx;
+static char lastReply[CMD_REPLY_LEN];
+
+static void testReply(char* line)
+{
+  strncpy(lastReply, line, sizeof(lastReply) - 1);
+}
+
+static void testPrintLine(char* line)
+{
+}
+
+// cmdExecute() on a copy, the line is modified
+static int execute(const char* text)
+{
+  char line[CMD_MAX_LEN];
+
+  strncpy(line, text, sizeof(line) - 1);
+  line[sizeof(line) - 1] = 0;
+  return(cmdExecute(line, &ctx));
+}
+
+void setUp(void)
+{
+  hostPowerOn();
+  wData.targetMeasurementIntervalSec = 225;
+  wData.graphicsType = 0;
+  wData.pressureCorrValue = 15.0;
+  wData.targetLifetimeDays = 120;
+  wData.preferencesChanged = false;
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.replyLine = testReply;
+  ctx.printLine = testPrintLine;
+  lastReply[0] = 0;
+}
+
+void tearDown(void)
+{
+}
+
+//************** tests *************************/
+static void test_parse(void)
+{
+  char line[CMD_MAX_LEN];
+  cmdRequest req;
+
+  strcpy(line, "  atd,-12.5 \r\n");
+  TEST_ASSERT_EQUAL_INT(CMD_OK, cmdParse(line, &req));
+  TEST_ASSERT_EQUAL_INT('D', req.name);
+  TEST_ASSERT_EQUAL_STRING("-12.5", req.argText);
+
+  strcpy(line, "ATP");
+  TEST_ASSERT_EQUAL_INT(CMD_OK, cmdParse(line, &req));
+  TEST_ASSERT_EQUAL_INT('P', req.name);
+  TEST_ASSERT_NULL(req.argText);
+
+  strcpy(line, "AT");
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_FORMAT, cmdParse(line, &req));
+  strcpy(line, "XTP");
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_FORMAT, cmdParse(line, &req));
+  strcpy(line, "ATPX");
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_FORMAT, cmdParse(line, &req));
+  strcpy(line, "");
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_FORMAT, cmdParse(line, &req));
+}
+
+static void test_parse_argument(void)
+{
+  cmdArg a;
+
+  TEST_ASSERT_EQUAL_INT(CMD_OK, cmdParseArg(" 42 ", ARG_INT, &a));
+  TEST_ASSERT_EQUAL_INT32(42, a.i);
+  TEST_ASSERT_EQUAL_INT(CMD_OK, cmdParseArg("-12.5", ARG_FLOAT, &a));
+  TEST_ASSERT_EQUAL_FLOAT(-12.5, a.f);
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_ARG, cmdParseArg("12.5", ARG_INT, &a));
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_ARG, cmdParseArg("12x", ARG_FLOAT, &a));
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_ARG, cmdParseArg("", ARG_INT, &a));
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_ARG, cmdParseArg("   ", ARG_FLOAT, &a));
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_ARG, cmdParseArg("99999999999", ARG_INT, &a));
+}
+
+static void test_single_commands(void)
+{
+  TEST_ASSERT_EQUAL_INT(CMD_OK, execute("ATD,12.5"));
+  TEST_ASSERT_EQUAL_FLOAT(12.5, wData.pressureCorrValue);
+  TEST_ASSERT_TRUE(wData.preferencesChanged);
+  TEST_ASSERT_EQUAL_INT(1, ctx.executed);
+
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_RANGE, execute("ATD,300.5"));
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_RANGE, execute("ATD,nan"));
+  TEST_ASSERT_EQUAL_FLOAT(12.5, wData.pressureCorrValue);
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_ARG, execute("ATE"));
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_UNKNOWN, execute("ATF"));
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_FORMAT, execute("hello"));
+  TEST_ASSERT_EQUAL_INT(0, ctx.executed);
+}
+
+static void test_batch_rejected_completely(void)
+{
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_RANGE, execute("ATD,12.5;ATT;ATE,5000"));
+  TEST_ASSERT_EQUAL_INT(0, ctx.executed);
+  TEST_ASSERT_EQUAL_FLOAT(15.0, wData.pressureCorrValue);
+  TEST_ASSERT_EQUAL_INT32(0, wData.graphicsType);
+  TEST_ASSERT_FALSE(wData.preferencesChanged);
+  TEST_ASSERT_EQUAL_STRING("Batch rejected, nothing changed", lastReply);
+
+  TEST_ASSERT_EQUAL_INT(CMD_OK, execute("ATD,12.5;ATT;ATE,200;"));
+  TEST_ASSERT_EQUAL_INT(3, ctx.executed);
+  TEST_ASSERT_EQUAL_INT32(1, wData.graphicsType);
+  TEST_ASSERT_EQUAL_INT32(200, wData.targetLifetimeDays);
+}
+
+static void test_batch_state_dependent(void)
+{
+  // 21 h: U doubles to 450 s, Q needs 900 s: rejected before U runs
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_STATE, execute("ATU;ATQ"));
+  TEST_ASSERT_EQUAL_INT(0, ctx.executed);
+  TEST_ASSERT_EQUAL_INT32(225, wData.targetMeasurementIntervalSec);
+  TEST_ASSERT_FALSE(wData.preferencesChanged);
+
+  // valid in the state the earlier commands leave
+  TEST_ASSERT_EQUAL_INT(CMD_OK, execute("ATU;ATU;ATQ"));
+  TEST_ASSERT_EQUAL_INT(3, ctx.executed);
+  TEST_ASSERT_EQUAL_INT32(225, wData.targetMeasurementIntervalSec);
+
+  TEST_ASSERT_EQUAL_INT(CMD_OK, execute("ATV;ATS,42"));
+  TEST_ASSERT_EQUAL_INT32(450, wData.targetMeasurementIntervalSec);
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_STATE, execute("ATS,21;ATV;ATV"));
+  TEST_ASSERT_EQUAL_INT32(450, wData.targetMeasurementIntervalSec);
+}
+
+static void test_scale_not_possible_changes_nothing(void)
+{
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_STATE, execute("ATQ"));
+  TEST_ASSERT_FALSE(wData.preferencesChanged);
+  TEST_ASSERT_EQUAL_INT32(225, wData.targetMeasurementIntervalSec);
+  TEST_ASSERT_EQUAL_STRING("Command: Q not possible, Interval: 225", lastReply);
+}
+
+static void test_too_many_commands(void)
+{
+  TEST_ASSERT_EQUAL_INT(CMD_ERR_BATCH, execute("ATP;ATP;ATP;ATP;ATP;ATP;ATP;ATP;ATP;ATP;ATP;ATP;ATT"));
+  TEST_ASSERT_EQUAL_INT(0, ctx.executed);
+  TEST_ASSERT_EQUAL_INT32(0, wData.graphicsType);
+}
+
+// transport events are tagged queue items: client text that starts like an event is a line
+static void test_queue_events_apart_from_lines(void)
+{
+  char line[CMD_MAX_LEN];
+  uint8_t event;
+
+  cmdQueueBegin();
+  TEST_ASSERT_TRUE(cmdPost("!ATX", 4));
+  TEST_ASSERT_TRUE(cmdPost(" ATP", 4));
+  TEST_ASSERT_TRUE(cmdPostEvent(2));
+  TEST_ASSERT_FALSE(cmdPostEvent(CMD_EVENT_NONE));
+
+  TEST_ASSERT_TRUE(cmdWait(line, 0, &event));
+  TEST_ASSERT_EQUAL_UINT8(CMD_EVENT_NONE, event);
+  TEST_ASSERT_EQUAL_STRING("!ATX", line);
+  TEST_ASSERT_TRUE(cmdWait(line, 0, &event));
+  TEST_ASSERT_EQUAL_UINT8(CMD_EVENT_NONE, event);
+  TEST_ASSERT_EQUAL_INT(0, execute(line));     // leading space: executed
+  TEST_ASSERT_TRUE(cmdWait(line, 0, &event));
+  TEST_ASSERT_EQUAL_UINT8(2, event);
+  TEST_ASSERT_EQUAL_STRING("", line);
+  TEST_ASSERT_FALSE(cmdWait(line, 0, &event));
+}
+
+int main(int argc, char** argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_parse);
+  RUN_TEST(test_parse_argument);
+  RUN_TEST(test_single_commands);
+  RUN_TEST(test_batch_rejected_completely);
+  RUN_TEST(test_batch_state_dependent);
+  RUN_TEST(test_scale_not_possible_changes_nothing);
+  RUN_TEST(test_too_many_commands);
+  RUN_TEST(test_queue_events_apart_from_lines);
+  return(UNITY_END());
+}
@@ -0,0 +1,74 @@
+/**************************************************!
+   host test of the counter journal (ePaperJournal.cpp) on the file emulating NOR flash:
+   append and recover, cold boot, endurance with lost RTC state and torn records
+   pio test -e native -f test_journal
+***************************************************/
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "global.h"
+#include "ePaperJournal.h"
+
+#define JOURNAL_TEST_FILE     "test_journal.bin"
+#define ENDURANCE_WAKES       200000    // 1.4 years of wakes at 225 s
+#define ENDURANCE_INTERVAL    225
+
+static void testPrintLine(char* line)
+{
+  TEST_MESSAGE(line);
+}
+
+void setUp(void)
+{
+  remove(JOURNAL_TEST_FILE);
+  TEST_ASSERT_TRUE(journalUseFile(JOURNAL_TEST_FILE));
+}
+
+void tearDown(void)
+{
+  remove(JOURNAL_TEST_FILE);
+}
+
+//************** tests *************************/
+static void test_empty_journal_has_no_record(void)
+{
+  journalRecord rec;
+
+  TEST_ASSERT_FALSE(journalRecover(&rec));
+}
+
+static void test_recover_after_cold_boot(void)
+{
+  journalRecord rec;
+  uint32_t i;
+
+  journalRecover(&rec);
+  for(i=1; i<=300; i++)
+    TEST_ASSERT_TRUE(journalAppend(i, i / 2, 4000000 - i));
+  memset(&jState, 0, sizeof(jState));   // RTC memory lost
+  TEST_ASSERT_TRUE(journalRecover(&rec));
+  TEST_ASSERT_EQUAL_UINT32(300, rec.startCounter);
+  TEST_ASSERT_EQUAL_UINT32(150, rec.dischgCnt);
+  TEST_ASSERT_EQUAL_UINT32(4000000 - 300, rec.prevMicrovolt);
+
+  // appending goes on after the recovered record
+  TEST_ASSERT_TRUE(journalAppend(301, 151, 3999699));
+  memset(&jState, 0, sizeof(jState));
+  TEST_ASSERT_TRUE(journalRecover(&rec));
+  TEST_ASSERT_EQUAL_UINT32(301, rec.startCounter);
+}
+
+static void test_endurance(void)
+{
+  TEST_ASSERT_TRUE(journalEnduranceSim(ENDURANCE_WAKES, ENDURANCE_INTERVAL, testPrintLine));
+}
+
+int main(int argc, char** argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_journal_has_no_record);
+  RUN_TEST(test_recover_after_cold_boot);
+  RUN_TEST(test_endurance);
+  return(UNITY_END());
+}
@@ -0,0 +1,351 @@
+/**************************************************!
+   host test of the settings storage (ePaperBarograf.cpp) on the NVS stand-in of the
+   host shim: settings record and alert rules blob round trip, unchanged saves, counter
+   fallback key, migration of the former layouts, and flash writes / time per save
+   against the key-per-setting layout.
+   pio test -e native -f test_settings
+***************************************************/
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "esp_rom_crc.h"
+#include <unity.h>
+
+#include "global.h"
+#include "ePaperBarograf.h"
+#include "ePaperAlert.h"
+
+#define LEGACY_NAMESPACE  "barograf1"   // namespace of the firmware, former counter key too
+#define ALERTS_ENTRIES    (2 + (sizeof(alertsBlob) + 31) / 32)
+
+// NVS cost of one save, from the counters of the shim
+struct saveCost
+{
+  uint32_t calls;               // put calls
+  uint32_t entries;             // 32 byte entries programmed
+  uint64_t us;                  // virtual time
+};
+
+static void costBegin(saveCost* c)
+{
+  c->calls = hostStats.nvsWrites;
+  c->entries = hostStats.nvsEntries;
+  c->us = hostWorldUs();
+}
+
+static void costEnd(saveCost* c)
+{
+  c->calls = hostStats.nvsWrites - c->calls;
+  c->entries = hostStats.nvsEntries - c->entries;
+  c->us = hostWorldUs() - c->us;
+}
+
+static void costMessage(const char* what, const saveCost* record, const saveCost* legacy)
+{
+  char line[160];
+
+  snprintf(line, sizeof(line), "%s: record %u put, %u entries, %llu us / seven keys %u put, %u entries, %llu us",
+    what, record->calls, record->entries, (unsigned long long)record->us,
+    legacy->calls, legacy->entries, (unsigned long long)legacy->us);
+  TEST_MESSAGE(line);
+}
+
+// writePreferences() of V0.26: seven puts on every save, counters as float array
+static void legacyWrite()
+{
+  Preferences p;
+  float counters[4] = { (float)startCounter, (float)dischgCnt, (float)prevMicrovolt, 0.0 };
+
+  p.begin(LEGACY_NAMESPACE, false);
+  p.putBytes(LEGACY_NAMESPACE, counters, sizeof(counters));
+  p.putBool("applyPCorr", wData.applyPressureCorrection);
+  p.putFloat("pCorrValue", wData.pressureCorrValue);
+  p.putBool("applyInversion", wData.applyInversion);
+  p.putULong("measIntervalSec", wData.targetMeasurementIntervalSec);
+  p.putULong("timeRangeHours", wData.graphTimeRangeHours);
+  p.putULong("graphicsType", wData.graphicsType);
+  p.end();
+}
+
+static bool nvsKey(const char* key)
+{
+  Preferences p;
+  bool found;
+
+  p.begin(LEGACY_NAMESPACE, true);
+  found = p.isKey(key);
+  p.end();
+  return(found);
+}
+
+// cold boot: RTC memory to initial values, settings from NVS
+static void coldBoot()
+{
+  hostPowerOn();
+  readPreferences();
+}
+
+void setUp(void)
+{
+  hostNvsErase();
+  coldBoot();
+}
+
+void tearDown(void) {}
+
+//************** tests *************************/
+static void test_defaults_written_once(void)
+{
+  Preferences p;
+  saveCost c;
+
+  TEST_ASSERT_EQUAL_INT32(d_graphicsType, wData.graphicsType);
+  TEST_ASSERT_EQUAL_INT32(d_measIntervalSec, wData.targetMeasurementIntervalSec);
+  p.begin(LEGACY_NAMESPACE, true);
+  TEST_ASSERT_EQUAL(sizeof(uint64_t), p.getBytesLength("settingsRec"));
+  TEST_ASSERT_EQUAL(sizeof(alertsBlob), p.getBytesLength("alerts"));
+  TEST_ASSERT_FALSE(p.isKey("counters"));
+  p.end();
+
+  // second cold boot finds the record: nothing written
+  costBegin(&c);
+  coldBoot();
+  costEnd(&c);
+  TEST_ASSERT_EQUAL_UINT32(0, c.calls);
+}
+
+static void test_unchanged_save_writes_nothing(void)
+{
+  saveCost c;
+
+  // counters advance every wake, they are journaled and not part of the settings
+  startCounter += 100;
+  dischgCnt += 100;
+  costBegin(&c);
+  writeSettings("test");
+  writePreferences();
+  costEnd(&c);
+  TEST_ASSERT_EQUAL_UINT32(0, c.calls);
+  TEST_ASSERT_EQUAL_UINT32(0, c.entries);
+}
+
+static void test_round_trip(void)
+{
+  saveCost c;
+
+  wData.applyPressureCorrection = true;
+  wData.pressureCorrValue = -12.37;
+  wData.graphicsType = 3;
+  wData.graphTimeRangeHours = 42;
+  wData.targetMeasurementIntervalSec = 450;
+  wData.targetLifetimeDays = 1000;
+  costBegin(&c);
+  writeSettings("test");
+  costEnd(&c);
+  TEST_ASSERT_EQUAL_UINT32(1, c.calls);
+  TEST_ASSERT_EQUAL_UINT32(1, c.entries);
+
+  // alert rules in their own key, the record is not written again
+  TEST_ASSERT_TRUE(alertCommand("3,ON"));
+  costBegin(&c);
+  writeSettings("test");
+  costEnd(&c);
+  TEST_ASSERT_EQUAL_UINT32(1, c.calls);
+  TEST_ASSERT_EQUAL_UINT32(ALERTS_ENTRIES, c.entries);
+
+  coldBoot();
+  TEST_ASSERT_TRUE(wData.applyPressureCorrection);
+  TEST_ASSERT_EQUAL_FLOAT(-12.37, wData.pressureCorrValue);
+  TEST_ASSERT_EQUAL_INT32(3, wData.graphicsType);
+  TEST_ASSERT_EQUAL_INT32(42, wData.graphTimeRangeHours);
+  TEST_ASSERT_EQUAL_INT32(450, wData.targetMeasurementIntervalSec);
+  TEST_ASSERT_EQUAL_INT32(1000, wData.targetLifetimeDays);
+  TEST_ASSERT_EQUAL_UINT8(1, aData.rules[2].enabled);
+}
+
+// without journal, the counters are written to their own key every WRITE_PREFS_INTERVAL wakes
+static void test_counter_fallback(void)
+{
+  startCounter = 123456;
+  dischgCnt = 789;
+  prevMicrovolt = 3912000;
+  writeCounterPreferences();
+
+  coldBoot();
+  TEST_ASSERT_EQUAL_UINT32(123456, startCounter);
+  TEST_ASSERT_EQUAL_UINT32(789, dischgCnt);
+  TEST_ASSERT_EQUAL_UINT32(3912000, prevMicrovolt);
+}
+
+static void test_invalid_record_gives_defaults(void)
+{
+  Preferences p;
+  uint64_t record;
+
+  wData.graphicsType = 2;
+  writeSettings("test");
+  p.begin(LEGACY_NAMESPACE, false);
+  record = p.getULong64("settingsRec", 0);
+  p.putULong64("settingsRec", record | (1ULL << 63));  // unused bit set
+  p.end();
+
+  coldBoot();
+  TEST_ASSERT_EQUAL_INT32(d_graphicsType, wData.graphicsType);
+
+  p.begin(LEGACY_NAMESPACE, false);
+  p.putULong64("settingsRec", (record & ~0xFULL) | (SETTINGS_RECORD_VERSION + 1));
+  p.end();
+  coldBoot();
+  TEST_ASSERT_EQUAL_INT32(d_graphicsType, wData.graphicsType);
+}
+
+static void test_migration_of_legacy_keys(void)
+{
+  hostNvsErase();
+  hostPowerOn();
+  wData.applyPressureCorrection = true;
+  wData.pressureCorrValue = 7.5;
+  wData.applyInversion = true;
+  wData.targetMeasurementIntervalSec = 900;
+  wData.graphTimeRangeHours = 84;
+  wData.graphicsType = 1;
+  startCounter = 5000;
+  dischgCnt = 250;
+  prevMicrovolt = 4010000;
+  legacyWrite();
+
+  // power lost during the migration: the old keys are kept, the next cold boot migrates
+  hostNvsFailAfter(1);
+  coldBoot();
+  hostNvsFailAfter(-1);
+  TEST_ASSERT_TRUE(nvsKey("graphicsType"));
+  TEST_ASSERT_TRUE(nvsKey(LEGACY_NAMESPACE));
+  TEST_ASSERT_FALSE(nvsKey("settingsRec"));
+
+  coldBoot();
+  TEST_ASSERT_TRUE(wData.applyPressureCorrection);
+  TEST_ASSERT_EQUAL_FLOAT(7.5, wData.pressureCorrValue);
+  TEST_ASSERT_TRUE(wData.applyInversion);
+  TEST_ASSERT_EQUAL_INT32(900, wData.targetMeasurementIntervalSec);
+  TEST_ASSERT_EQUAL_INT32(84, wData.graphTimeRangeHours);
+  TEST_ASSERT_EQUAL_INT32(1, wData.graphicsType);
+  TEST_ASSERT_EQUAL_UINT32(5000, startCounter);
+  TEST_ASSERT_EQUAL_UINT32(250, dischgCnt);
+
+  // old keys removed after the new layout is written
+  TEST_ASSERT_FALSE(nvsKey("graphicsType"));
+  TEST_ASSERT_FALSE(nvsKey(LEGACY_NAMESPACE));
+  TEST_ASSERT_TRUE(nvsKey("settingsRec"));
+  TEST_ASSERT_TRUE(nvsKey("counters"));
+
+  // counters survive a further power loss until the journal has them
+  coldBoot();
+  TEST_ASSERT_EQUAL_UINT32(5000, startCounter);
+}
+
+static void test_migration_of_blob_v2(void)
+{
+  Preferences p;
+  settingsBlobV2 b;
+
+  hostNvsErase();
+  hostPowerOn();
+  memset(&b, 0, sizeof(b));
+  b.version = 2;
+  b.size = sizeof(b);
+  b.values.applyInversion = true;
+  b.values.pressureCorrValue = 3.25;
+  b.values.measIntervalSec = 450;
+  b.values.timeRangeHours = 42;
+  b.values.graphicsType = 5;
+  b.values.targetLifetimeDays = 90;
+  alertDefaultRules(b.values.alertRules);
+  b.values.alertRules[3].enabled = 1;
+  b.startCounter = 7000;
+  b.dischgCnt = 300;
+  b.prevMicrovolt = 3950000;
+  b.crc = esp_rom_crc32_le(0x5EED, (const uint8_t*)&b, offsetof(settingsBlobV2, crc));
+  p.begin(LEGACY_NAMESPACE, false);
+  p.putBytes("settings", &b, sizeof(b));
+  p.end();
+
+  coldBoot();
+  TEST_ASSERT_TRUE(wData.applyInversion);
+  TEST_ASSERT_EQUAL_FLOAT(3.25, wData.pressureCorrValue);
+  TEST_ASSERT_EQUAL_INT32(450, wData.targetMeasurementIntervalSec);
+  TEST_ASSERT_EQUAL_INT32(42, wData.graphTimeRangeHours);
+  TEST_ASSERT_EQUAL_INT32(5, wData.graphicsType);
+  TEST_ASSERT_EQUAL_INT32(90, wData.targetLifetimeDays);
+  TEST_ASSERT_EQUAL_UINT8(1, aData.rules[3].enabled);
+  TEST_ASSERT_EQUAL_UINT32(7000, startCounter);
+  TEST_ASSERT_FALSE(nvsKey("settings"));
+}
+
+// flash writes and time per save, record against seven keys. Both start from the same state.
+// The record is never worse: not in put calls, not in entries programmed, not in time
+static void test_cost_against_legacy(void)
+{
+  saveCost record, legacy;
+
+  legacyWrite();
+
+  // nothing changed: the record is compared with the RTC cache, no NVS access at all
+  costBegin(&record);
+  writeSettings("test");
+  costEnd(&record);
+  costBegin(&legacy);
+  legacyWrite();
+  costEnd(&legacy);
+  costMessage("unchanged", &record, &legacy);
+  TEST_ASSERT_EQUAL_UINT32(0, record.calls);
+  TEST_ASSERT_EQUAL_UINT32(0, record.us);
+  TEST_ASSERT_EQUAL_UINT32(7, legacy.calls);
+  TEST_ASSERT_EQUAL_UINT32(0, legacy.entries);
+
+  // one setting changed (button: next graph type): one entry each, one put instead of seven
+  wData.graphicsType = (wData.graphicsType + 1) % 8;
+  costBegin(&record);
+  writeSettings("test");
+  costEnd(&record);
+  costBegin(&legacy);
+  legacyWrite();
+  costEnd(&legacy);
+  costMessage("one setting", &record, &legacy);
+  TEST_ASSERT_EQUAL_UINT32(1, record.calls);
+  TEST_ASSERT_EQUAL_UINT32(1, record.entries);
+  TEST_ASSERT_EQUAL_UINT32(7, legacy.calls);
+  TEST_ASSERT_EQUAL_UINT32(1, legacy.entries);
+  TEST_ASSERT_TRUE(record.us <= legacy.us);
+
+  // two settings and counters changed: counters go to the journal, not to NVS
+  wData.graphicsType = (wData.graphicsType + 1) % 8;
+  wData.applyInversion = !wData.applyInversion;
+  startCounter += 250;
+  dischgCnt += 250;
+  costBegin(&record);
+  writeSettings("test");
+  costEnd(&record);
+  costBegin(&legacy);
+  legacyWrite();
+  costEnd(&legacy);
+  costMessage("settings and counters", &record, &legacy);
+  TEST_ASSERT_EQUAL_UINT32(1, record.calls);
+  TEST_ASSERT_EQUAL_UINT32(1, record.entries);
+  TEST_ASSERT_EQUAL_UINT32(7, legacy.calls);
+  TEST_ASSERT_EQUAL_UINT32(5, legacy.entries);
+  TEST_ASSERT_TRUE(record.us <= legacy.us);
+}
+
+int main(int argc, char** argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_defaults_written_once);
+  RUN_TEST(test_unchanged_save_writes_nothing);
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_counter_fallback);
+  RUN_TEST(test_invalid_record_gives_defaults);
+  RUN_TEST(test_migration_of_legacy_keys);
+  RUN_TEST(test_migration_of_blob_v2);
+  RUN_TEST(test_cost_against_legacy);
+  return(UNITY_END());
+}
@@ -0,0 +1,94 @@
+/**************************************************!
+   benchCompare: host tool, compares a benchmark result with a baseline
+   build:  g++ -std=gnu++11 -o benchCompare benchCompare.cpp
+   usage:  benchCompare baseline.json result.json [threshold %, default 10]
+   The files can be the output of the host benchmark or the serial monitor log of
+   env:bench; lines without a benchmark result are ignored. Compared is the minimum
+   time per call, the most stable value. Exit code 1 if a benchmark is slower by more
+   than the threshold (and by more than NOISE_NS).
+***************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BENCH   64
+#define NOISE_NS    100     // smaller differences are timer resolution and noise
+
+struct benchLine
+{
+  char name[40];
+  unsigned long minNs, meanNs;
+};
+
+/**************************************************!
+   @brief    readResults()
+   @details  one result per line: {"name":"...","n":..,"minNs":..,"meanNs":..,"maxNs":..}
+   @param    path: file name
+   @param    b: results
+   @param    target: "host" / "esp32" of the header line, empty if none
+   @return   int: number of results, -1 if the file cannot be read
+***************************************************/
+static int readResults(const char* path, benchLine* b, char* target)
+{
+  char line[512];
+  const char* p;
+  unsigned long n;
+  int count = 0;
+  FILE* f = fopen(path, "r");
+
+  if(f == NULL) return(-1);
+  target[0] = 0;
+  while(fgets(line, sizeof(line), f) && count < MAX_BENCH){
+    if((p = strstr(line, "\"target\":\"")) != NULL)
+      sscanf(p, "\"target\":\"%15[^\"]\"", target);
+    p = strstr(line, "{\"name\":\"");
+    if(p == NULL) continue;
+    if(sscanf(p, "{\"name\":\"%39[^\"]\",\"n\":%lu,\"minNs\":%lu,\"meanNs\":%lu",
+              b[count].name, &n, &b[count].minNs, &b[count].meanNs) == 4)
+      count++;
+  }
+  fclose(f);
+  return(count);
+}
+
+int main(int argc, char** argv)
+{
+  static benchLine base[MAX_BENCH], res[MAX_BENCH];
+  char baseTarget[16], resTarget[16];
+  int nBase, nRes, i, j, slower = 0, faster = 0;
+  double threshold = 10.0, change;
+  long delta;
+  const char* mark;
+
+  if(argc < 3){
+    fprintf(stderr, "usage: %s baseline.json result.json [threshold %%]\n", argv[0]);
+    return(2);
+  }
+  if(argc > 3) threshold = atof(argv[3]);
+  nBase = readResults(argv[1], base, baseTarget);
+  nRes = readResults(argv[2], res, resTarget);
+  if(nBase <= 0 || nRes <= 0){
+    fprintf(stderr, "no results in %s\n", nBase <= 0 ? argv[1] : argv[2]);
+    return(2);
+  }
+  if(strcmp(baseTarget, resTarget) != 0)
+    printf("warning: baseline of target %s, result of target %s\n", baseTarget, resTarget);
+
+  printf("benchmark                      base ns     new ns   change\n");
+  for(i=0; i<nRes; i++){
+    for(j=0; j<nBase && strcmp(base[j].name, res[i].name) != 0; j++);
+    if(j == nBase){
+      printf("%-28s %10s %10lu      new\n", res[i].name, "-", res[i].minNs);
+      continue;
+    }
+    delta = (long)res[i].minNs - (long)base[j].minNs;
+    change = base[j].minNs > 0 ? 100.0 * delta / base[j].minNs : 0.0;
+    mark = "";
+    if(labs(delta) > NOISE_NS && change > threshold){ mark = "  SLOWER"; slower++; }
+    if(labs(delta) > NOISE_NS && change < -threshold){ mark = "  faster"; faster++; }
+    printf("%-28s %10lu %10lu %+7.1f %%%s\n", res[i].name, base[j].minNs, res[i].minNs, change, mark);
+  }
+  printf("%d slower, %d faster (threshold %.0f %%)\n", slower, faster, threshold);
+  return(slower > 0 ? 1 : 0);
+}
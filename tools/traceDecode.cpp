@@ -0,0 +1,66 @@
+/**************************************************!
+   traceDecode: host tool, decodes the trace dump of the barograph
+   build:  g++ -std=gnu++11 -I../src -o traceDecode traceDecode.cpp
+   usage:  traceDecode < log.txt
+   The log can be the serial monitor output ('T' sent during a wake) or the
+   bluetooth terminal output of "ATY". Other lines are ignored.
+***************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ePaperTrace.h"
+
+/**************************************************!
+   @brief    hexByte()
+   @return   int: value of two hex digits, -1 if invalid
+***************************************************/
+static int hexByte(const char* s)
+{
+  char buf[3] = { s[0], s[1], 0 };
+  char* end;
+  long v;
+
+  if(s[0] == 0 || s[1] == 0) return(-1);
+  v = strtol(buf, &end, 16);
+  return((*end == 0) ? (int)v : -1);
+}
+
+int main(int argc, char** argv)
+{
+  char line[512], text[128];
+  const char* p;
+  traceRecord r;
+  uint8_t* b = (uint8_t*)&r;
+  unsigned long wakes = 0, wake;
+  int count = 0, n = 0, i, v;
+
+  while(fgets(line, sizeof(line), stdin)){
+    p = strstr(line, TRACE_LINE_PREFIX " ");
+    if(!p) continue;
+    p += strlen(TRACE_LINE_PREFIX) + 1;
+    if(sscanf(p, "BEGIN %lu %d", &wakes, &count) == 2){
+      printf("trace: %d records, %lu wakes since cold boot\n", count, wakes);
+      printf(" wake     ms  event       arguments\n");
+      n = 0;
+      continue;
+    }
+    if(strncmp(p, "END", 3) == 0){
+      printf("trace end: %d of %d records decoded\n\n", n, count);
+      continue;
+    }
+    for(i=0; i<(int)sizeof(traceRecord); i++){
+      v = hexByte(p + 2*i);
+      if(v < 0) break;
+      b[i] = (uint8_t)v;
+    }
+    if(i < (int)sizeof(traceRecord)) continue;
+    // wake number from the low 8 bits, relative to the last wake of the dump
+    wake = wakes - (((wakes & 0xFF) - r.wake) & 0xFF);
+    snprintf(text, sizeof(text), traceEventFormat(r.event), r.arg[0], r.arg[1]);
+    printf("%5lu %6u  %-10s  %s\n", wake, r.msec, traceEventName(r.event), text);
+    n++;
+  }
+  return(0);
+}